@@ -115,6 +115,32 @@ ssize_t OW_get(const char *path, char **return_buffer, size_t * buffer_length)
 	return ReturnAndErrno(size_or_error);
 }
 
+ssize_t OW_getmany(const char **paths, int count, char **buffers, ssize_t * lengths)
+{
+	SIZE_OR_ERROR ret = -EACCES ;
+
+	/* Check the parameters */
+	if (paths == NULL || buffers == NULL || lengths == NULL || count < 0) {
+		return ReturnAndErrno(-EINVAL);
+	}
+
+	if (API_access_start() == 0) {	/* Check for prior init */
+		SIZE_OR_ERROR * sizes = owcalloc( count + 1, sizeof(SIZE_OR_ERROR) ) ;
+		if ( sizes == NULL ) {
+			ret = -ENOMEM ;
+		} else {
+			int i ;
+			ret = FS_getmany( paths, count, buffers, sizes );
+			for ( i = 0 ; i < count ; ++i ) {
+				lengths[i] = sizes[i] ;
+			}
+			owfree( sizes ) ;
+		}
+		API_access_end();
+	}
+	return ReturnAndErrno(ret);
+}
+
 int OW_present(const char *path)
 {
 	ssize_t ret = -ENOENT;		/* current buffer string length */
@@ -78,6 +78,21 @@ extern "C" {
 	 */
 	ssize_t OW_get(const char *path, char **buffer, size_t * buffer_length);
 
+	/* OW_getmany -- several data reads at once
+	   paths is an array of count OWFS style names (as for OW_get)
+
+	   buffers is an array of count char pointers, each assigned by OW_getmany
+	   each non-NULL buffer MUST BE "free"ed after use.
+	   lengths is an array of count values, each the length of the returned data
+	   or <0 (negative errno) for an error on that path
+
+	   Values on the same remote owserver are fetched in a single message
+
+	   return value = 0 ok (check lengths for each path)
+	   <0 error
+	 */
+	ssize_t OW_getmany(const char **paths, int count, char **buffers, ssize_t * lengths);
+
 	/* OW_present -- check if path is present
 	   path is OWFS style name,
 	   "" or "/" for root directory
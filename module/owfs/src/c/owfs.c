@@ -109,10 +109,11 @@ int main(int argc, char *argv[])
 	/* Set up "command line" for main fuse routines */
 	Fuse_setup(&fuse_options);	// command line setup
 	Fuse_add(Outbound_Control.head->name, &fuse_options);	// mount point
-#if FUSE_VERSION >= 22
+#if FUSE_VERSION >= 22 && FUSE_VERSION < 25
 	Fuse_add("-o", &fuse_options);	// add "-o direct_io" to prevent buffering
 	Fuse_add("direct_io", &fuse_options);
-#endif							/* FUSE_VERSION >= 22 */
+#endif							/* FUSE_VERSION >= 22 && FUSE_VERSION < 25 */
+	// newer FUSE: direct_io is set per file in FS_open
 	switch (Globals.daemon_status) {
 		case e_daemon_fg:
 			Fuse_add("-f", &fuse_options);	// foreground for fuse too
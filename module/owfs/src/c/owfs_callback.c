@@ -15,6 +15,7 @@
 
 #include "owfs.h"
 #include "ow_pid.h"
+#include "ow_standard.h"
 
 /* There was a major change in the function prototypes at FUSE 2.2, we'll make a flag */
 #undef FUSE22PLUS
@@ -38,7 +39,13 @@
 #define FUSEFLAG int
 #endif							/* FUSE_MAJOR_VERSION */
 
+#if FUSE_VERSION >= 25
+static int FS_readdir(const char *path, void *buf, fuse_fill_dir_t filler, off_t offset, struct fuse_file_info *flags);
+static int CB_getattr(const char *path, struct stat *stbuf);
+#else							/* FUSE_VERSION < 25 */
 static int FS_getdir(const char *path, fuse_dirh_t h, fuse_dirfil_t filler);
+#define CB_getattr FS_fstat
+#endif							/* FUSE_VERSION < 25 */
 static int FS_utime(const char *path, struct utimbuf *buf);
 static int FS_truncate(const char *path, const off_t size);
 static int FS_chmod(const char *path, mode_t mode);
@@ -46,6 +53,7 @@ static int FS_chown(const char *path, uid_t uid, gid_t gid);
 static int FS_open(const char *path, FUSEFLAG flags);
 static int FS_release(const char *path, FUSEFLAG flags);
 #ifdef FUSE22PLUS
+static SIZE_OR_ERROR CB_dispatch(SIZE_OR_ERROR (*postparse) (struct one_wire_query *), struct one_wire_query *owq);
 static int CB_read(const char *path, char *buffer, size_t size, off_t offset, struct fuse_file_info *flags);
 static int CB_write(const char *path, const char *buffer, size_t size, off_t offset, struct fuse_file_info *flags);
 #else							/* fuse < 2.2 */
@@ -65,9 +73,13 @@ static int FS_statfs(struct fuse_statfs *fst);
 #endif							/* FUSE_MAJOR_VERSION */
 
 struct fuse_operations owfs_oper = {
-  getattr:FS_fstat,
+  getattr:CB_getattr,
   readlink:NULL,
+#if FUSE_VERSION >= 25
+  readdir:FS_readdir,
+#else							/* FUSE_VERSION < 25 */
   getdir:FS_getdir,
+#endif							/* FUSE_VERSION < 25 */
   mknod:NULL,
   mkdir:NULL,
   symlink:NULL,
@@ -117,6 +129,59 @@ static int FS_chown(const char *path, uid_t uid, gid_t gid)
 	return 0;
 }
 
+#if FUSE_VERSION >= 25
+/* Properties made from the name alone (address, family, id...) can stay in
+   the kernel page cache, everything else bypasses it.
+   The type comes from the local device list, so not for a remote bus,
+   whose owserver may know the device better */
+static int CB_kernel_cached(const struct parsedname *pn)
+{
+	ZERO_OR_ERROR (*read) (struct one_wire_query *);
+
+	if (IsDir(pn)) {
+		return 0;
+	}
+	read = pn->selected_filetype->read;
+	if (read == FS_type) {
+		return !BusIsServer(pn->selected_connection);
+	}
+	return read == FS_address || read == FS_r_address || read == FS_crc8
+		|| read == FS_ID || read == FS_r_ID || read == FS_code;
+}
+
+/* Same as FS_fstat, but a kernel cached property needs its true length,
+   since the page cache pads a short read with zeros.
+   Those are made from the name, so no bus access */
+static int CB_getattr(const char *path, struct stat *stbuf)
+{
+	int return_code;
+	OWQ_allocate_struct_and_pointer( owq ) ;
+
+	if (path == NO_PATH) {
+		path = "/";
+	}
+
+	if ( BAD( OWQ_create(path, owq) ) ) {	/* Can we parse the input string */
+		return -ENOENT;
+	}
+
+	return_code = FS_fstat_postparse(stbuf, PN(owq));
+	if (return_code == 0 && CB_kernel_cached(PN(owq))) {
+		size_t length = FullFileLength(PN(owq));
+		char *value = owmalloc(length + 1);
+		if (value != NULL) {
+			OWQ_assign_read_buffer(value, length, 0, owq);
+			if (PN(owq)->selected_filetype->read(owq) >= 0) {
+				stbuf->st_size = OWQ_length(owq);
+			}
+			owfree(value);
+		}
+	}
+	OWQ_destroy(owq);
+	return return_code;
+}
+#endif							/* FUSE_VERSION >= 25 */
+
 /* In theory, should handle file opening, but OWFS doesn't care. Device opened/closed with every read/write */
 static int FS_open(const char *path, FUSEFLAG flags)
 {
@@ -125,7 +190,24 @@ static int FS_open(const char *path, FUSEFLAG flags)
 		PIDstart();
 #endif							/* FUSE_VERSION < 23 */
 	LEVEL_CALL("OPEN path=%s", SAFESTRING(path));
+#if FUSE_VERSION >= 25
+	{
+		struct parsedname pn;
+
+		if (FS_ParsedName(path, &pn) != 0) {
+			return -ENOENT;
+		}
+		// values are read afresh unless they can never change
+		if (CB_kernel_cached(&pn)) {
+			flags->keep_cache = 1;
+		} else {
+			flags->direct_io = 1;
+		}
+		FS_ParsedName_destroy(&pn);
+	}
+#else							/* FUSE_VERSION < 25 */
 	(void) flags;
+#endif							/* FUSE_VERSION < 25 */
 	return 0;
 }
 
@@ -145,6 +227,54 @@ static int FS_truncate(const char *path, const off_t size)
 	return 0;
 }
 
+#if FUSE_VERSION >= 25
+struct readdirstruct {
+	void *buf;
+	fuse_fill_dir_t filler;
+};
+	/* Callback function to FS_dir */
+	/* Prints this directory element (not the whole path) */
+	/* With its type, so a walk (find, ls -R) knows directories from properties without a getattr each */
+static void FS_readdir_callback(void *v, const struct parsedname *pn_entry)
+{
+	struct readdirstruct *rds = v;
+	struct stat stbuf;
+
+	if (FS_fstat_postparse(&stbuf, pn_entry) != 0) {
+		memset(&stbuf, 0, sizeof(struct stat));
+		stbuf.st_mode = S_IFDIR;
+	}
+	(rds->filler) (rds->buf, FS_DirName(pn_entry), &stbuf, 0);
+}
+
+static int FS_readdir(const char *path, void *buf, fuse_fill_dir_t filler, off_t offset, struct fuse_file_info *flags)
+{
+	struct parsedname pn;
+	ZERO_OR_ERROR return_code ;
+
+	(void) offset;
+	(void) flags;
+	RETURN_CODE_ERROR_RETURN( FS_ParsedName(path, &pn) ) ;
+	
+	LEVEL_CALL("READDIR path=%s", SAFESTRING(path));
+
+	if (IsDir(&pn)) {
+		struct readdirstruct rds = { buf, filler, };
+		filler(buf, ".", NULL, 0);
+		filler(buf, "..", NULL, 0);
+		/* Call directory spanning function */
+		FS_dir(FS_readdir_callback, &rds, &pn);
+		RETURN_CODE_SET_SCALAR( return_code, 0  ) ; // success
+	} else {					/* property */
+		RETURN_CODE_SET_SCALAR( return_code, 69 ) ; // Directory - not a directory
+	}
+
+	/* Clean up */
+	FS_ParsedName_destroy(&pn);
+	return return_code;
+}
+
+#else							/* FUSE_VERSION < 25 */
 #ifdef FUSE22PLUS
 #define FILLER(handle,name) filler(handle,name,DT_DIR,(ino_t)0)
 #else							/* FUSE22PLUS */
@@ -190,8 +320,33 @@ static int FS_getdir(const char *path, fuse_dirh_t h, fuse_dirfil_t filler)
 	FS_ParsedName_destroy(&pn);
 	return return_code;
 }
+#endif							/* FUSE_VERSION < 25 */
 
 #ifdef FUSE22PLUS
+/* fuse runs each request on its own thread. With --bus_requests, reads and
+ * writes that will use a bus are dispatched to it and wait there (see
+ * BUS_request_begin), so a slow bus holds back only its own requests.
+ * Reads the cache can answer, and the interface, settings and statistics
+ * directories, go straight through. */
+static SIZE_OR_ERROR CB_dispatch(SIZE_OR_ERROR (*postparse) (struct one_wire_query *), struct one_wire_query *owq)
+{
+	struct parsedname * pn = PN(owq) ;
+	struct connection_in * in = pn->selected_connection ;
+	SIZE_OR_ERROR return_size ;
+
+	if ( Globals.bus_requests <= 0 || in == NO_CONNECTION || NotRealDir(pn) ) {
+		return postparse(owq) ;
+	}
+	if ( postparse == FS_read_postparse && GOOD( OWQ_Cache_Get(owq) ) ) {
+		// answered from the cache
+		return postparse(owq) ;
+	}
+	BUS_request_begin(in) ;
+	return_size = postparse(owq) ;
+	BUS_request_end(in) ;
+	return return_size ;
+}
+
 static int CB_read(const char *path, char *buffer, size_t size, off_t offset, struct fuse_file_info *flags)
 {
 	(void) flags;
@@ -217,7 +372,7 @@ static int CB_read(const char *path, char *buffer, size_t size, off_t offset, st
 			size = MAX_OWSERVER_PROTOCOL_PAYLOAD_SIZE ;
 		}
 		OWQ_assign_read_buffer( buffer, size, offset, owq) ;
-		return_size = FS_read_postparse(owq) ;
+		return_size = CB_dispatch( FS_read_postparse, owq ) ;
 	}
 	OWQ_destroy(owq);
 
@@ -227,7 +382,19 @@ static int CB_read(const char *path, char *buffer, size_t size, off_t offset, st
 static int CB_write(const char *path, const char *buffer, size_t size, off_t offset, struct fuse_file_info *flags)
 {
 	(void) flags;
-	return FS_write(path, buffer, size, offset);
+	int return_size ;
+	OWQ_allocate_struct_and_pointer( owq ) ;
+
+	LEVEL_CALL("path=%s size=%d offset=%d", SAFESTRING(path), (int) size, (int) offset);
+
+	if ( BAD( OWQ_create(path, owq) ) ) {	/* Can we parse the input string */
+		return -ENOENT;
+	}
+	OWQ_assign_write_buffer(buffer, size, offset, owq) ;
+	return_size = CB_dispatch( FS_write_postparse, owq ) ;
+	OWQ_destroy(owq);
+
+	return return_size ;
 }
 #endif							/* FUSE22PLUS */
 
@@ -35,6 +35,8 @@
 
 static void Acceptor(int listenfd);
 
+pthread_mutex_t keepalive_mutex ;
+
 int main(int argc, char *argv[])
 {
 	int c;
@@ -97,7 +99,9 @@ int main(int argc, char *argv[])
 	set_exit_signal_handlers(exit_handler);
 	set_signal_handlers(NULL);
 
+	_MUTEX_INIT(keepalive_mutex);
 	ServerProcess(Acceptor);
+	_MUTEX_DESTROY(keepalive_mutex);
 
 	LEVEL_DEBUG("ServerProcess done");
 	ow_exit(0);
@@ -107,10 +111,40 @@ int main(int argc, char *argv[])
 
 static void Acceptor(int listenfd)
 {
-	FILE *fp = fdopen(listenfd, "w+");
-	if (fp) {
-		handle_socket(fp);
-		fflush(fp);
-		fclose(fp);
+	struct timeval tv = { HTTP_KEEPALIVE_TIMEOUT, 0, } ;
+	int tcp_nodelay = 1 ;
+	FILE_DESCRIPTOR_OR_ERROR in_fd ;
+	FILE_DESCRIPTOR_OR_ERROR wire_fd ;
+	FILE *in = NULL ;
+	FILE *wire = NULL ;
+
+	// an idle persistent connection times out
+	setsockopt(listenfd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+	// each response is one write -- don't hold a pipelined one back for the ack of the last
+	setsockopt(listenfd, IPPROTO_TCP, TCP_NODELAY, &tcp_nodelay, sizeof(tcp_nodelay));
+
+	// separate streams: reading and writing one stdio stream needs a flush between
+	// (on copies -- the server closes listenfd itself)
+	in_fd = dup(listenfd);
+	wire_fd = dup(listenfd);
+	if ( FILE_DESCRIPTOR_VALID(in_fd) ) {
+		in = fdopen(in_fd, "r");
+	}
+	if ( FILE_DESCRIPTOR_VALID(wire_fd) ) {
+		wire = fdopen(wire_fd, "w");
+	}
+	if ( in != NULL && wire != NULL ) {
+		handle_socket(in, wire);
+	}
+	// a stream closes its descriptor, a copy without one is closed here
+	if ( wire != NULL ) {
+		fclose(wire);
+	} else {
+		Test_and_Close( &wire_fd ) ;
+	}
+	if ( in != NULL ) {
+		fclose(in);
+	} else {
+		Test_and_Close( &in_fd ) ;
 	}
 }
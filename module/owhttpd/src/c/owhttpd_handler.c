@@ -22,43 +22,106 @@ struct urlparse {
 	char *version;
 	char *request;
 	char *value;
+	char *query; // copy of everything after '?'
 };
 
-enum http_return { http_ok, http_dir, http_icon, http_400, http_404 } ;
+enum http_return { http_ok, http_dir, http_icon, http_snapshot, http_400, http_404 } ;
 
 	/* Error page functions */
 enum content_type PoorMansParser( char * bad_url ) ;
 static void Bad400( struct OutputControl * oc, const enum content_type ct);
 static void Bad404( struct OutputControl * oc, const enum content_type ct);
 
+static void handle_request(struct OutputControl * oc, int prior_requests) ;
+static void KeepAliveReserve(struct OutputControl * oc, int requests) ;
+static void KeepAliveRelease(struct OutputControl * oc) ;
+
 /* URL parsing function */
 static void URLparse(struct urlparse *up);
 static enum http_return handle_GET( struct OutputControl * oc, struct urlparse * up) ;
 static enum http_return handle_POST( struct OutputControl * oc, struct urlparse * up) ;
-static void ReadToCRLF( struct OutputControl * oc ) ;
 static void TrimBoundary( char ** boundary ) ;
 static int GetPostData( char * boundary, struct memblob * mb, struct OutputControl * oct ) ;
 static char * GetPostPath(  struct OutputControl * oc ) ;
-static GOOD_OR_BAD GetHostURL( struct OutputControl * oc ) ;
+static int GetRequestLine( struct OutputControl * oc, struct urlparse * up ) ;
+static GOOD_OR_BAD GetHeaders( struct OutputControl * oc, struct urlparse * up ) ;
+
+/* Persistent connections waiting for their next request */
+static int keepalive_idle = 0 ;
 
 /* --------------- Functions ---------------- */
 
-/* Main handler for a web page */
-int handle_socket(FILE * out)
+/* Main handler for a web connection */
+/* Requests are answered in order -- pipelined ones included, since they wait
+ * in the input buffer -- while the client keeps the connection alive */
+int handle_socket(FILE * in, FILE * wire)
+{
+	struct OutputControl s_oc = { in, wire, NULL, NULL, 0, NULL, ct_html, 0, 0, 0, 0, 0, NULL, NULL, NULL, } ;
+	int requests = 0 ;
+
+	do {
+		handle_request( &s_oc, requests++ ) ;
+	} while ( s_oc.keep_alive ) ;
+	KeepAliveRelease( &s_oc ) ;
+	LEVEL_DEBUG("Connection closed after %d requests", requests);
+
+	return 0 ;
+}
+
+/* A connection stays open for another request only within both limits:
+ * HTTP_KEEPALIVE_REQUESTS on the connection, and HTTP_KEEPALIVE_IDLE
+ * connections waiting at once (the place is taken now, before the response
+ * says keep-alive, and given back when the next request line is in) */
+static void KeepAliveReserve(struct OutputControl * oc, int requests)
+{
+	if ( requests >= HTTP_KEEPALIVE_REQUESTS ) {
+		LEVEL_DEBUG("Connection closed after its %d requests", requests);
+		oc->keep_alive = 0 ;
+		return ;
+	}
+	_MUTEX_LOCK(keepalive_mutex) ;
+	if ( keepalive_idle < HTTP_KEEPALIVE_IDLE ) {
+		++keepalive_idle ;
+		oc->idle = 1 ;
+	} else {
+		oc->keep_alive = 0 ;
+	}
+	_MUTEX_UNLOCK(keepalive_mutex) ;
+	if ( oc->keep_alive == 0 ) {
+		LEVEL_DEBUG("Too many idle connections -- close this one after the response");
+	}
+}
+
+static void KeepAliveRelease(struct OutputControl * oc)
+{
+	if ( oc->idle ) {
+		_MUTEX_LOCK(keepalive_mutex) ;
+		--keepalive_idle ;
+		_MUTEX_UNLOCK(keepalive_mutex) ;
+		oc->idle = 0 ;
+	}
+}
+
+/* One request and its response */
+static void handle_request(struct OutputControl * oc, int prior_requests)
 {
 	enum http_return http_code ;
 	enum content_type pmp = ct_html;
 
 	struct urlparse up;
-	
-	struct OutputControl s_oc = { out, 0, NULL, NULL, } ;
-	struct OutputControl * oc = &s_oc ;
 
 	struct parsedname s_pn;
 	struct parsedname * pn = &s_pn ;
-	
+
+	oc->keep_alive = 0 ;
+	oc->not_first = 0 ;
+	oc->base_url = NULL ;
+	oc->host = NULL ;
+
 	up.line = NULL ; // prep for getline with null. Will be allocated by getline.
-	if ( getline(&(up.line), &(up.line_length), out) >= 0 ) {
+	up.query = NULL ;
+	if ( GetRequestLine( oc, &up ) ) {
+		KeepAliveRelease( oc ) ;
 		LEVEL_CALL("PreParse line=%s", up.line);
 		URLparse(&up);				/* Break up URL */
 		httpunescape((BYTE *) up.file    );
@@ -72,8 +135,8 @@ int handle_socket(FILE * out)
 
 		oc->base_url = owstrdup( up.file==NULL ? "" : up.file ) ;
 
-		if ( BAD( GetHostURL(oc) ) ) {
-			// No command line in request
+		if ( BAD( GetHeaders(oc, &up) ) ) {
+			// No Host line in request
 			pn = NO_PARSEDNAME ;
 			http_code = http_400 ;
 		} else if (up.cmd == NULL) {
@@ -87,22 +150,26 @@ int handle_socket(FILE * out)
 		} else if (strcasecmp(up.file, "/favicon.ico") == 0) {
 			// special case for the icon
 			LEVEL_DEBUG("http icon request.");
-			ReadToCRLF(oc) ;
 			pn = NO_PARSEDNAME ;
 			http_code = http_icon ;
+		} else if (strcasecmp(up.file, "/snapshot") == 0) {
+			// every device and its values
+			LEVEL_DEBUG("http snapshot request.");
+			pn = NO_PARSEDNAME ;
+			http_code = http_snapshot ;
 		} else 	if (FS_ParsedName(up.file, pn) != 0) {
 			// Can't understand the file name = URL
 			LEVEL_DEBUG("http %s not understood.",up.file);
-			ReadToCRLF(oc) ;
 			pn = NO_PARSEDNAME ;
 			http_code = http_404 ;
 		} else if (pn->selected_device == NO_DEVICE) {
 			// directory!
 			LEVEL_DEBUG("http directory request.");
-			ReadToCRLF(oc) ;
 			http_code = http_dir ;
 		} else if (strcmp(up.cmd, "POST") == 0) {
 			LEVEL_DEBUG("http POST request.");
+			// the upload isn't framed by length -- don't look for another request after it
+			oc->keep_alive = 0 ;
 			http_code = handle_POST( oc, &up ) ;
 		} else if (strcmp(up.cmd, "GET") == 0) {
 			LEVEL_DEBUG("http GET request.");
@@ -123,11 +190,13 @@ int handle_socket(FILE * out)
 				}
 			}
 		} else {
-			ReadToCRLF(oc) ;
 			http_code = http_400 ;
 		}
 		switch ( http_code ) {
 			case http_400:
+				// the request may not have been read through
+				oc->keep_alive = 0 ;
+				// fall through
 			case http_404:
 				// need to call this before freeing up.file
 				pmp = PoorMansParser(up.file) ;
@@ -138,19 +207,27 @@ int handle_socket(FILE * out)
 		}
 		// allocated by getline
 		free(up.line) ;
+	} else if ( prior_requests > 0 ) {
+		// client done with a persistent connection (or idle too long)
+		return ;
 	} else {
 		LEVEL_DEBUG("No http data.");
 		pn = NO_PARSEDNAME ;
 		http_code = http_400 ;
 	}
 
-	// This is necessary for SunOS
-	fflush(out);
-	
+	if ( oc->keep_alive ) {
+		KeepAliveReserve( oc, prior_requests + 1 ) ;
+	}
+
+	HTTPcompose(oc);
 	switch ( http_code ) {
 		case http_icon:
 			Favicon(oc);
 			break ;
+		case http_snapshot:
+			Snapshot(oc, up.query);
+			break ;
 		case http_400:
 			Bad400(oc,pmp);
 			break ;
@@ -164,6 +241,11 @@ int handle_socket(FILE * out)
 			ShowDevice(oc, pn);
 			break ;
 	}
+	HTTPsend(oc);
+
+	if ( up.query != NULL ) {
+		owfree( up.query ) ;
+	}
 	if ( pn != NO_PARSEDNAME ) {
 		FS_ParsedName_destroy(pn);
 	}
@@ -174,18 +256,12 @@ int handle_socket(FILE * out)
 	if ( oc->host != NULL ) {
 		owfree( oc->host ) ;
 	}
-	
-	return 0 ;
 }	
 
 /* The HTTP request is a GET message */
 static enum http_return handle_GET( struct OutputControl * oc, struct urlparse * up)
 {
-	/* read lines until blank */
-	if (up->version) {
-		ReadToCRLF( oc ) ;
-	}
-	
+	(void) oc ;
 	if (up->request == NULL) {
 		// NO request -- just a read or dir, not a write
 		LEVEL_DEBUG("Simple GET request -- read a value or directory");
@@ -235,19 +311,15 @@ static enum http_return handle_GET( struct OutputControl * oc, struct urlparse *
 /* The HTTP request is a POST message */
 static enum http_return handle_POST( struct OutputControl * oc, struct urlparse * up)
 {
-	FILE* out = oc->out ;
+	FILE* in = oc->in ;
 	enum http_return http_code = http_404 ; // default error mode
+	(void) up ;
 
 	char * boundary = NULL ;
 	size_t boundary_length ;
 	
-	/* read lines until blank */
-	if (up->version) {
-		ReadToCRLF( oc ) ;
-	}
-	
 	// use getline because it handles null chars
-	if ( getline(&boundary,&boundary_length,out) > 2 ) {
+	if ( getline(&boundary,&boundary_length,in) > 2 ) {
 		char * post_path  = GetPostPath( oc ) ;
 
 		TrimBoundary( &boundary) ;
@@ -290,7 +362,7 @@ static void URLparse(struct urlparse *up)
 	int first = 1;
 	char * extension ;
 
-	up->cmd = up->version = up->file = up->request = up->value = NULL;
+	up->cmd = up->version = up->file = up->request = up->value = up->query = NULL;
 	
 	/* Special case for sparse array
 	 * Substitute "/" for "?EXTENSION=" 
@@ -333,6 +405,7 @@ static void URLparse(struct urlparse *up)
 			if (*str == '?') {
 				*str = '\0';
 				up->request = str + 1;
+				up->query = owstrdup( up->request ) ;
 				break;
 			}
 		}
@@ -418,27 +491,6 @@ static void Bad404(struct OutputControl * oc, const enum content_type ct)
 }	}
 
 
-static void ReadToCRLF( struct OutputControl * oc )
-{
-	FILE * out = oc->out ;
-	char * text_in = NULL ;
-	size_t length_in = 0 ;
-	ssize_t getline_length ;
-
-	/* read lines until blank */
-	while ( (getline_length = getline(&text_in, &length_in, out)) > 0 )  {
-		LEVEL_DEBUG("More (%d) data:%s",(int)getline_length,text_in);
-		if ( strcmp(text_in, "\r\n")==0 || strcmp(text_in, "\n")==0 ) {
-			break ;
-		}
-	}
-	
-	
-	if ( text_in != NULL ) {
-		free( text_in) ;
-	}
-}
-
 static void TrimBoundary( char ** boundary )
 {
 	char * remove_char ;
@@ -456,13 +508,13 @@ static void TrimBoundary( char ** boundary )
 
 static char * GetPostPath(struct OutputControl * oc )
 {
-	FILE * out = oc->out ;
+	FILE * in = oc->in ;
 	char * text_in = NULL ;
 	size_t length_in = 0 ;
 	char * path_found = NO_PATH ;
 	
 	/* read lines until blank */
-	while (getline(&text_in, &length_in, out)>-1)  {
+	while (getline(&text_in, &length_in, in)>-1)  {
 		char * namestart ;
 		LEVEL_DEBUG("Post data:%s",SAFESTRING(text_in));
 		if ( strcmp(text_in, "\r\n")==0 || strcmp(text_in, "\n")==0 ) {
@@ -493,14 +545,14 @@ static char * GetPostPath(struct OutputControl * oc )
 // read data from file upload
 static int GetPostData( char * boundary, struct memblob * mb, struct OutputControl * oc )
 {
-	FILE * out = oc->out ;
+	FILE * in = oc->in ;
 	char * data = NULL ;
 	size_t data_length ;
 
 	ssize_t read_this_pass ;
 
 	MemblobInit( mb, 1000 ) ; // increqment in 1K amounts (arbitrary)
-	while ( (read_this_pass = getline(&data, &data_length, out)) > -1 ) {
+	while ( (read_this_pass = getline(&data, &data_length, in)) > -1 ) {
 		Debug_Bytes(boundary,(BYTE *)data,(size_t)read_this_pass);
 		if ( strstr( data, boundary ) != NULL ) {
 			free(data) ; // allocated by getline with malloc, not owmalloc
@@ -544,33 +596,90 @@ enum content_type PoorMansParser( char * bad_url )
 	return ct_html ;
 }
 			
-static GOOD_OR_BAD GetHostURL( struct OutputControl * oc )
+/* The request line, skipping blank lines left between requests */
+static int GetRequestLine( struct OutputControl * oc, struct urlparse * up )
 {
-	FILE * out = oc->out ;
+	do {
+		if ( getline(&(up->line), &(up->line_length), oc->in) < 0 ) {
+			free( up->line ) ;
+			return 0 ;
+		}
+	} while ( strcmp(up->line, "\r\n")==0 || strcmp(up->line, "\n")==0 ) ;
+	return 1 ;
+}
+
+/* Header patterns, compiled once */
+static regex_t rx_host ;
+static regex_t rx_connection ;
+
+static void regex_fini(void)
+{
+	regfree( &rx_host ) ;
+	regfree( &rx_connection ) ;
+}
+
+static pthread_once_t regex_init_once = PTHREAD_ONCE_INIT;
+
+static void regex_init(void)
+{
+	ow_regcomp( &rx_host, "^host *: *([^ ]+) *\r", REG_ICASE ) ;
+	ow_regcomp( &rx_connection, "^connection *: *([^\r\n]*)", REG_ICASE ) ;
+
+	atexit(regex_fini);
+}
+
+/* Connection: is a comma-separated list of options, e.g. "keep-alive, Upgrade" */
+static void ConnectionOptions( struct OutputControl * oc, char * options )
+{
+	char * option ;
+
+	while ( (option = strsep( &options, ", \t" )) != NULL ) {
+		if ( strcasecmp( option, "close" ) == 0 ) {
+			oc->keep_alive = 0 ;
+			return ;
+		} else if ( strcasecmp( option, "keep-alive" ) == 0 ) {
+			oc->keep_alive = 1 ;
+		}
+	}
+}
+
+/* Read the header lines through the blank one that ends them.
+ * Keeps the Host and whether the connection may stay open afterwards:
+ * HTTP/1.1 unless "Connection: close", HTTP/1.0 only with "Connection: keep-alive" */
+static GOOD_OR_BAD GetHeaders( struct OutputControl * oc, struct urlparse * up )
+{
+	FILE * in = oc->in ;
 	char * line = NULL ;
-	regex_t rx_host ;
+	size_t s = 0 ;
 	struct ow_regmatch orm ;
 	
 	orm.number = 1 ;	
 	
-	ow_regcomp( &rx_host, "host *: *([^ ]+) *\r", REG_ICASE ) ;
+	pthread_once(&regex_init_once, regex_init);
 
-	do {
-		size_t s ;
+	oc->http11 = ( up->version != NULL && strcmp( up->version, "HTTP/1.1" ) == 0 ) ;
+	oc->keep_alive = oc->http11 ;
 
-		if ( getline( &line, &s, out ) < 0 ) {
-			free( line ) ;
-			LEVEL_DEBUG("Couldn't find Host: line in HTTP header") ;
-			return gbBAD ;
-		}
+	while ( getline( &line, &s, in ) >= 0 ) {
 		LEVEL_DEBUG("Test line <%s>",line ) ;
-		if ( ow_regexec( &rx_host, line, &orm ) != 0 ) {
-			LEVEL_DEBUG("No match <%s>",line) ;
-			continue ;
+		if ( strcmp(line, "\r\n")==0 || strcmp(line, "\n")==0 ) {
+			free(line) ;
+			if ( oc->host == NULL ) {
+				LEVEL_DEBUG("Couldn't find Host: line in HTTP header") ;
+				return gbBAD ;
+			}
+			return gbGOOD ;
 		}
-		oc->host = owstrdup( orm.match[1] ) ;
-		ow_regexec_free( &orm ) ;
-		free(line) ;
-		return gbGOOD ;				
-	} while (1) ;
+		if ( oc->host == NULL && ow_regexec( &rx_host, line, &orm ) == 0 ) {
+			oc->host = owstrdup( orm.match[1] ) ;
+			ow_regexec_free( &orm ) ;
+		} else if ( ow_regexec( &rx_connection, line, &orm ) == 0 ) {
+			ConnectionOptions( oc, orm.match[1] ) ;
+			ow_regexec_free( &orm ) ;
+		}
+	}
+	free( line ) ;
+	LEVEL_DEBUG("HTTP header not complete") ;
+	oc->keep_alive = 0 ;
+	return gbBAD ;
 }
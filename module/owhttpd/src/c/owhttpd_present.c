@@ -15,38 +15,140 @@
 
 /* ------------ Protoypes ---------------- */
 
+static void HTTPheaders(struct OutputControl * oc);
+
+/* Pages are composed in memory, so the response can give its length
+ * and the connection stay open for the next request */
+void HTTPcompose(struct OutputControl * oc)
+{
+	oc->body = NULL ;
+	oc->body_length = 0 ;
+	oc->status = NULL ;
+	oc->content_type = ct_html ;
+	oc->chunked = 0 ;
+#ifdef HAVE_OPEN_MEMSTREAM
+	oc->out = open_memstream( &(oc->body), &(oc->body_length) ) ;
+	if ( oc->out != NULL ) {
+		return ;
+	}
+	LEVEL_DEBUG("Cannot compose the page in memory -- send it as written and close");
+#endif							/* HAVE_OPEN_MEMSTREAM */
+	// the end of the connection marks the end of the page
+	oc->out = oc->wire ;
+	oc->keep_alive = 0 ;
+}
+
 	/* Utility HTML page display functions */
 void HTTPstart(struct OutputControl * oc, const char *status, const enum content_type ct)
 {
-	FILE * out = oc->out ;
+	oc->status = status ;
+	oc->content_type = ct ;
+	if ( oc->out == oc->wire ) {
+		// not composed -- headers go out first
+		HTTPheaders(oc) ;
+	}
+}
+
+/* Pages too large to compose whole go out as they are written instead:
+ * in chunks to an HTTP/1.1 client, otherwise up to the end of the connection */
+void HTTPstream(struct OutputControl * oc, const char *status, const enum content_type ct)
+{
+	if ( oc->out != oc->wire ) {
+		// drop the page begun in memory
+		fclose( oc->out ) ;
+		if ( oc->body != NULL ) {
+			free( oc->body ) ; // allocated by open_memstream with malloc, not owmalloc
+			oc->body = NULL ;
+		}
+		oc->body_length = 0 ;
+		oc->out = oc->wire ;
+		if ( oc->http11 ) {
+			oc->chunked = 1 ;
+		} else {
+			oc->keep_alive = 0 ;
+		}
+	}
+	HTTPstart( oc, status, ct ) ;
+}
+
+/* Part of a streamed page */
+void HTTPchunk(struct OutputControl * oc, const char * data, size_t length)
+{
+	if ( length == 0 ) {
+		// an empty chunk would end the page
+		return ;
+	}
+	if ( oc->chunked ) {
+		fprintf(oc->wire, "%lx\r\n", (unsigned long) length);
+	}
+	fwrite( data, 1, length, oc->wire ) ;
+	if ( oc->chunked ) {
+		fprintf(oc->wire, "\r\n");
+	}
+}
+
+static void HTTPheaders(struct OutputControl * oc)
+{
+	FILE * wire = oc->wire ;
 	char d[44];
 	time_t t = NOW_TIME;
 	size_t l = strftime(d, sizeof(d), "%a, %d %b %Y %T GMT", gmtime(&t));
 
-	fprintf(out, "HTTP/1.0 %s\r\n", status);
-	fprintf(out, "Date: %*s\r\n", (int) l, d);
-	fprintf(out, "Server: %s\r\n", SVERSION);
-	fprintf(out, "Last-Modified: %*s\r\n", (int) l, d);
+	fprintf(wire, "HTTP/1.1 %s\r\n", oc->status);
+	fprintf(wire, "Date: %*s\r\n", (int) l, d);
+	fprintf(wire, "Server: %s\r\n", SVERSION);
+	fprintf(wire, "Last-Modified: %*s\r\n", (int) l, d);
 	/*
-	 * fprintf( out, "MIME-version: 1.0\r\n" );
+	 * fprintf( wire, "MIME-version: 1.0\r\n" );
 	 */
-	switch (ct) {
+	switch (oc->content_type) {
 	case ct_html:
-		fprintf(out, "Content-Type: text/html\r\n");
+		fprintf(wire, "Content-Type: text/html\r\n");
 		break;
 	case ct_icon:
-		fprintf(out, "Content-Length: 894\r\n");
-		fprintf(out, "Connection: close\r\n");
+		fprintf(wire, "Content-Type: image/x-icon\r\n");
 		break ;
 	case ct_text:
-		fprintf(out, "Content-Type: text/plain\r\n");
+		fprintf(wire, "Content-Type: text/plain\r\n");
 		break ;
 	case ct_json:
-		fprintf(out, "Access-Control-Allow-Origin: *\r\n");
-		fprintf(out, "Content-Type: application/json\r\n");
+		fprintf(wire, "Access-Control-Allow-Origin: *\r\n");
+		fprintf(wire, "Content-Type: application/json\r\n");
 		break ;
 	}
-	fprintf(out, "\r\n");
+	if ( oc->chunked ) {
+		fprintf(wire, "Transfer-Encoding: chunked\r\n");
+	} else if ( oc->out != oc->wire ) {
+		fprintf(wire, "Content-Length: %lu\r\n", (unsigned long) oc->body_length);
+	}
+	fprintf(wire, "Connection: %s\r\n", oc->keep_alive ? "keep-alive" : "close");
+	fprintf(wire, "\r\n");
+}
+
+/* Send the composed page behind its headers */
+void HTTPsend(struct OutputControl * oc)
+{
+	if ( oc->out != oc->wire ) {
+		fclose( oc->out ) ; // sets body and body_length
+		if ( oc->status == NULL ) {
+			oc->status = "500 Internal Server Error" ;
+			oc->body_length = 0 ;
+		}
+		HTTPheaders(oc) ;
+		if ( oc->body != NULL ) {
+			fwrite( oc->body, 1, oc->body_length, oc->wire ) ;
+			free( oc->body ) ; // allocated by open_memstream with malloc, not owmalloc
+		}
+	} else if ( oc->chunked ) {
+		// last chunk
+		fprintf(oc->wire, "0\r\n\r\n");
+		oc->chunked = 0 ;
+	}
+	oc->out = NULL ;
+	if ( fflush( oc->wire ) != 0 ) {
+		LEVEL_DEBUG("Cannot send the response -- close the connection");
+		oc->keep_alive = 0 ;
+	}
 }
 
 void HTTPtitle(struct OutputControl * oc, const char *title)
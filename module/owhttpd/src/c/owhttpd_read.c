@@ -14,6 +14,9 @@
 // #include <libgen.h>  /* for dirname() */
 
 /* --------------- Prototypes---------------- */
+static SIZE_OR_ERROR ReadValue(struct OutputControl * oc, struct one_wire_query *owq);
+static void ReadAhead(struct OutputControl * oc, struct parsedname *pn);
+static void ReadAheadDone(struct OutputControl * oc);
 static void Show(struct OutputControl * oc, const struct parsedname *pn_entry);
 static void ShowDirectory(struct OutputControl * oc, const struct parsedname *pn_entry);
 static void ShowReadWrite(struct OutputControl * oc, struct one_wire_query *owq);
@@ -31,7 +34,6 @@ static void ShowTextReadonly(struct OutputControl * oc, struct one_wire_query *o
 static void ShowTextWriteonly(struct OutputControl * oc, struct one_wire_query *owq);
 static void ShowTextStructure(struct OutputControl * oc, struct one_wire_query *owq);
 
-static void ShowJson(struct OutputControl * oc, const struct parsedname *pn_entry);
 static void ShowJsonDirectory(struct OutputControl * oc, const struct parsedname *pn_entry);
 static void ShowJsonReadWrite(struct OutputControl * oc, struct one_wire_query *owq);
 static void ShowJsonReadonly(struct OutputControl * oc, struct one_wire_query *owq);
@@ -41,6 +43,126 @@ static void StructureDetailJson(struct OutputControl * oc, const char * structur
 
 /* --------------- Functions ---------------- */
 
+/* A whole device page on an owserver bus reads its values first, all at once
+ * on the task pool, so the round trips to the owserver overlap, and is
+ * rendered when they are in. A local bus page reads as it goes: reads queued
+ * together do combine into one hold of the bus (see BUS_transaction), but
+ * that only saves the lock hand-offs -- the bus time is the same. */
+struct device_value {
+	char * path ;
+	struct one_wire_query * owq ;
+	SIZE_OR_ERROR read_return ;
+} ;
+
+struct device_values {
+	struct device_value * value ;
+	int count ;
+	int allocated ;
+} ;
+
+/* Callback from the device listing -- note each readable value */
+static void ReadAheadEntry(void *v, const struct parsedname *pn_entry)
+{
+	struct device_values * dvs = v ;
+	struct filetype * ft = pn_entry->selected_filetype ;
+
+	if ( ft == NO_FILETYPE || IsStructureDir(pn_entry) ) {
+		return ;
+	}
+	if ( ft->format == ft_directory || ft->format == ft_subdir || ft->read == NO_READ_FUNCTION ) {
+		return ;
+	}
+	if ( pn_entry->extension == EXTENSION_UNKNOWN && ft->ag != NON_AGGREGATE && ft->ag->combined == ag_sparse ) {
+		return ;
+	}
+	if ( dvs->count == dvs->allocated ) {
+		struct device_value * more = owrealloc( dvs->value, (dvs->allocated + 32) * sizeof(struct device_value) ) ;
+		if ( more == NULL ) {
+			return ;
+		}
+		dvs->value = more ;
+		dvs->allocated += 32 ;
+	}
+	dvs->value[dvs->count].path = owstrdup( pn_entry->path ) ;
+	if ( dvs->value[dvs->count].path == NULL ) {
+		return ;
+	}
+	dvs->value[dvs->count].owq = NO_ONE_WIRE_QUERY ;
+	dvs->value[dvs->count].read_return = -ENOMEM ;
+	++dvs->count ;
+}
+
+/* Task (pool thread or caller) once per value */
+static void ReadAheadValue(void * v)
+{
+	struct device_value * dv = v ;
+
+	dv->owq = OWQ_create_from_path( dv->path ) ; // for read
+	if ( dv->owq == NO_ONE_WIRE_QUERY ) {
+		return ;
+	}
+	if ( BAD( OWQ_allocate_read_buffer( dv->owq ) ) ) {
+		return ;
+	}
+	dv->read_return = FS_read_postparse( dv->owq ) ;
+}
+
+static void ReadAhead(struct OutputControl * oc, struct parsedname *pn)
+{
+	struct device_values * dvs ;
+
+	if ( ! KnownBus(pn) || ! BusIsServer(pn->selected_connection) ) {
+		return ;
+	}
+	dvs = owcalloc( 1, sizeof(struct device_values) ) ;
+	if ( dvs == NULL ) {
+		return ;
+	}
+	FS_dir( ReadAheadEntry, dvs, pn ) ;
+	TaskPool_Run( ReadAheadValue, dvs->value, sizeof(struct device_value), dvs->count ) ;
+	oc->values = dvs ;
+}
+
+static void ReadAheadDone(struct OutputControl * oc)
+{
+	struct device_values * dvs = oc->values ;
+	int value_index ;
+
+	if ( dvs == NULL ) {
+		return ;
+	}
+	for ( value_index = 0 ; value_index < dvs->count ; ++value_index ) {
+		OWQ_destroy( dvs->value[value_index].owq ) ;
+		owfree( dvs->value[value_index].path ) ;
+	}
+	SAFEFREE( dvs->value ) ;
+	owfree( dvs ) ;
+	oc->values = NULL ;
+}
+
+/* The value for the page: read ahead with the rest of the device, or now */
+static SIZE_OR_ERROR ReadValue(struct OutputControl * oc, struct one_wire_query *owq)
+{
+	struct device_values * dvs = oc->values ;
+	int value_index ;
+
+	if ( dvs != NULL ) {
+		for ( value_index = 0 ; value_index < dvs->count ; ++value_index ) {
+			struct device_value * dv = &(dvs->value[value_index]) ;
+			if ( strcmp( dv->path, PN(owq)->path ) == 0 ) {
+				if ( dv->read_return > 0 ) {
+					if ( (size_t) dv->read_return > OWQ_size(owq) ) {
+						return -EMSGSIZE ;
+					}
+					memcpy( OWQ_buffer(owq), OWQ_buffer(dv->owq), dv->read_return ) ;
+				}
+				return dv->read_return ;
+			}
+		}
+	}
+	return FS_read_postparse(owq) ;
+}
+
 /* Device entry -- table line for a filetype */
 static void Show(struct OutputControl * oc, const struct parsedname *pn_entry)
 {
@@ -88,7 +210,7 @@ static void ShowReadWrite(struct OutputControl * oc, struct one_wire_query *owq)
 	FILE * out = oc->out ;
 	struct parsedname * pn = PN(owq) ;
 	const char *file = FS_DirName(pn);
-	SIZE_OR_ERROR read_return = FS_read_postparse(owq);
+	SIZE_OR_ERROR read_return = ReadValue(oc, owq);
 	if (read_return < 0) {
 		fprintf(out, "Error: %s", strerror(-read_return));
 		return;
@@ -151,7 +273,7 @@ static void Extension( struct OutputControl * oc, const struct parsedname * pn )
 static void ShowReadonly(struct OutputControl * oc, struct one_wire_query *owq)
 {
 	FILE * out = oc->out ;
-	SIZE_OR_ERROR read_return = FS_read_postparse(owq);
+	SIZE_OR_ERROR read_return = ReadValue(oc, owq);
 	struct parsedname * pn = PN(owq) ;
 	if (read_return < 0) {
 		fprintf(out, "Error: %s", strerror(-read_return));
@@ -196,7 +318,7 @@ static void ShowReadonly(struct OutputControl * oc, struct one_wire_query *owq)
 static void ShowStructure(struct OutputControl * oc, struct one_wire_query *owq)
 {
 	FILE * out = oc->out ;
-	SIZE_OR_ERROR read_return = FS_read_postparse(owq);
+	SIZE_OR_ERROR read_return = ReadValue(oc, owq);
 	if (read_return < 0) {
 		fprintf(out, "Error: %s", strerror(-read_return));
 		return;
@@ -370,7 +492,7 @@ static void ShowText(struct OutputControl * oc, const struct parsedname *pn_entr
 static void ShowTextStructure(struct OutputControl * oc, struct one_wire_query *owq)
 {
 	FILE * out = oc->out ;
-	SIZE_OR_ERROR read_return = FS_read_postparse(owq);
+	SIZE_OR_ERROR read_return = ReadValue(oc, owq);
 	if (read_return < 0) {
 		//fprintf(out, "error: %s", strerror(-read_return));
 		return;
@@ -383,7 +505,7 @@ static void ShowTextStructure(struct OutputControl * oc, struct one_wire_query *
 static void ShowTextReadWrite(struct OutputControl * oc, struct one_wire_query *owq)
 {
 	FILE * out = oc->out ;
-	SIZE_OR_ERROR read_return = FS_read_postparse(owq);
+	SIZE_OR_ERROR read_return = ReadValue(oc, owq);
 	if (read_return < 0) {
 		//fprintf(out, "error: %s", strerror(-read_return));
 		return;
@@ -450,15 +572,17 @@ static void ShowDeviceText(struct OutputControl * oc, struct parsedname *pn)
 
 	if (pn->selected_filetype == NO_DEVICE) {	/* whole device */
 		//printf("whole directory path=%s \n", pn->path);
+		ReadAhead(oc, pn);
 		FS_dir(ShowDeviceTextCallback, oc, pn);
+		ReadAheadDone(oc);
 	} else {					/* Single item */
 		//printf("single item path=%s\n", pn->path);
 		ShowText(oc, pn);
 	}
 }
 
-/* Device entry -- table line for a filetype */
-static void ShowJson(struct OutputControl * oc, const struct parsedname *pn_entry)
+/* Device entry -- JSON value for a filetype (also used by the snapshot) */
+void ShowJson(struct OutputControl * oc, const struct parsedname *pn_entry)
 {
 	FILE * out = oc->out ;
 	struct one_wire_query *owq = OWQ_create_from_path(pn_entry->path); // for read or dir
@@ -493,7 +617,7 @@ static void ShowJson(struct OutputControl * oc, const struct parsedname *pn_entr
 static void ShowJsonStructure(struct OutputControl * oc, struct one_wire_query *owq)
 {
 	FILE * out = oc->out ;
-	SIZE_OR_ERROR read_return = FS_read_postparse(owq);
+	SIZE_OR_ERROR read_return = ReadValue(oc, owq);
 	if (read_return < 0) {
 		fprintf(out, "null");
 		return;
@@ -597,7 +721,7 @@ static void ShowJsonReadWrite(struct OutputControl * oc, struct one_wire_query *
 {
 	FILE * out = oc->out ;
 	struct parsedname * pn = PN(owq) ;
-	SIZE_OR_ERROR read_return = FS_read_postparse(owq);
+	SIZE_OR_ERROR read_return = ReadValue(oc, owq);
 
 	if (read_return < 0) {
 		fprintf(out, "null");
@@ -665,7 +789,9 @@ static void ShowDeviceJson(struct OutputControl * oc, struct parsedname *pn)
 	if (pn->selected_filetype == NO_DEVICE) {	/* whole device */
 		JSON_dir_init( oc ) ;
 		fprintf(out, "{\n" ) ;
+		ReadAhead(oc, pn);
 		FS_dir(ShowDeviceJsonCallback, oc, pn);
+		ReadAheadDone(oc);
 		JSON_dir_finish(oc) ;
 		fprintf(out, "}" );
 	} else {					/* Single item */
@@ -677,16 +803,9 @@ static void ShowDeviceJson(struct OutputControl * oc, struct parsedname *pn)
 }
 
 
-void ShowDevice(struct OutputControl * oc, struct parsedname *pn)
+static void ShowDeviceHtml(struct OutputControl * oc, struct parsedname *pn)
 {
 	FILE * out = oc->out ;
-	if (pn->state & ePS_text) {
-		ShowDeviceText(oc, pn);
-		return;
-	} else if (pn->state & ePS_json) {
-		ShowDeviceJson(oc, pn);
-		return;
-	}
 
 	HTTPstart(oc, "200 OK", ct_html);
 
@@ -701,10 +820,30 @@ void ShowDevice(struct OutputControl * oc, struct parsedname *pn)
 
 
 	if (pn->selected_filetype == NO_FILETYPE) {	/* whole device */
+		ReadAhead(oc, pn);
 		FS_dir(ShowDeviceCallback, oc, pn);
+		ReadAheadDone(oc);
 	} else {					/* single item */
 		Show(oc, pn);
 	}
 	fprintf(out, "</TABLE>");
 	HTTPfoot(oc);
 }
+
+void ShowDevice(struct OutputControl * oc, struct parsedname *pn)
+{
+	struct timeval start ;
+	struct timeval now ;
+
+	timernow( &start ) ;
+	if (pn->state & ePS_text) {
+		ShowDeviceText(oc, pn);
+	} else if (pn->state & ePS_json) {
+		ShowDeviceJson(oc, pn);
+	} else {
+		ShowDeviceHtml(oc, pn);
+	}
+	timernow( &now ) ;
+	timersub( &now, &start, &now ) ;
+	LEVEL_DEBUG("Page %s in %ld ms", pn->path, (long) (now.tv_sec * 1000 + now.tv_usec / 1000) ) ;
+}
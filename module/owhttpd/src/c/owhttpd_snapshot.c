@@ -0,0 +1,293 @@
+/*
+ * http.c for owhttpd (1-wire web server)
+ * By Paul Alfille 2003, using libow
+ * offshoot of the owfs ( 1wire file system )
+ *
+ * GPL license ( Gnu Public Lincense )
+ *
+ * Based on chttpd. copyright(c) 0x7d0 greg olszewski <noop@nwonknu.org>
+ *
+ */
+
+/* /snapshot -- every device with its readable properties as one JSON document
+ *
+ *   /snapshot?family=28,10&property=temperature
+ *
+ * family and property are optional comma separated lists.
+ * Values come from the cache where possible. Each port (and its buses) is
+ * read by its own task, in parallel. The document is not composed whole:
+ * each device is put together in memory and sent on its own (a chunk to an
+ * HTTP/1.1 client) as soon as it is read, so devices of different ports
+ * interleave and only one device per port is held at a time.
+ * */
+
+#include "owhttpd.h"
+
+struct snapshot_filter {
+	char * family ; // comma separated family codes, or NULL for all
+	char * property ; // comma separated property names, or NULL for all
+} ;
+
+/* The response, shared by the port tasks */
+struct snapshot_stream {
+	struct OutputControl * oc ;
+	pthread_mutex_t mutex ; // one device at a time onto the wire
+	int not_first ;
+} ;
+
+/* One task per port */
+struct snapshot_port {
+	struct port_in * pin ;
+	const struct snapshot_filter * filter ;
+	struct snapshot_stream * stream ;
+	struct memblob devices ; // device paths, null terminated, listed before reading
+} ;
+
+/* Properties of one device */
+struct snapshot_device {
+	struct snapshot_port * sp ;
+	struct OutputControl oc ; // oc.out gets the device
+	size_t path_length ; // of the device path, to name the properties relative to it
+	int not_first ;
+} ;
+static void SnapshotProperty(void *v, const struct parsedname *pn_entry);
+
+/* Is name in the comma separated list? (all are, with no list) */
+static int SnapshotMatch(const char * list, const char * name)
+{
+	size_t length = strlen(name) ;
+
+	if ( list == NULL ) {
+		return 1 ;
+	}
+	while ( list[0] != '\0' ) {
+		const char * comma = strchr( list, ',' ) ;
+		size_t item_length = ( comma == NULL ) ? strlen(list) : (size_t) (comma - list) ;
+
+		if ( item_length == length && strncasecmp( list, name, length ) == 0 ) {
+			return 1 ;
+		}
+		if ( comma == NULL ) {
+			break ;
+		}
+		list = comma + 1 ;
+	}
+	return 0 ;
+}
+
+/* Callback from the bus listing -- note each device to read afterwards */
+static void SnapshotListDevice(void *v, const struct parsedname *pn_entry)
+{
+	struct snapshot_port * sp = v ;
+
+	if ( pn_entry->selected_device == NO_DEVICE || pn_entry->selected_filetype != NO_FILETYPE || NotRealDir(pn_entry) ) {
+		// not a 1-wire chip
+		return ;
+	}
+	if ( pn_entry->selected_device == DeviceSimultaneous ) {
+		// reading it would start conversions, not report values
+		return ;
+	}
+	if ( ! SnapshotMatch( sp->filter->family, pn_entry->selected_device->family_code ) ) {
+		return ;
+	}
+	MemblobAdd( (const BYTE *) pn_entry->path, strlen(pn_entry->path) + 1, &(sp->devices) ) ;
+}
+
+/* Callback from the device listing -- one property, or a subdirectory of them */
+static void SnapshotProperty(void *v, const struct parsedname *pn_entry)
+{
+	struct snapshot_device * sd = v ;
+	struct filetype * ft = pn_entry->selected_filetype ;
+	const char * name = &(pn_entry->path[sd->path_length+1]) ;
+	FILE * out = sd->oc.out ;
+
+	if ( ft == NO_FILETYPE ) {
+		return ;
+	}
+	if ( ft->format == ft_subdir ) {
+		struct parsedname s_pn_subdir ;
+		if ( FS_ParsedName( pn_entry->path, &s_pn_subdir ) == 0 ) {
+			FS_dir( SnapshotProperty, v, &s_pn_subdir ) ;
+			FS_ParsedName_destroy( &s_pn_subdir ) ;
+		}
+		return ;
+	}
+	if ( ft->format == ft_directory || ft->read == NO_READ_FUNCTION ) {
+		return ;
+	}
+	if ( ! SnapshotMatch( sd->sp->filter->property, name ) && ! SnapshotMatch( sd->sp->filter->property, ft->name ) ) {
+		return ;
+	}
+
+	if ( sd->not_first ) {
+		fprintf(out, ",\n" ) ;
+	} else {
+		sd->not_first = 1 ;
+	}
+	fprintf(out, "\"%s\":", name ) ;
+	ShowJson( &(sd->oc), pn_entry ) ;
+}
+
+static void SnapshotDeviceCompose(struct snapshot_device * sd, const char * device_path)
+{
+	struct parsedname s_pn_device ;
+	const char * device_name = strrchr( device_path, '/' ) + 1 ;
+
+	if ( FS_ParsedName( device_path, &s_pn_device ) != 0 ) {
+		return ;
+	}
+	fprintf( sd->oc.out, "\"%s\":{\n", device_name ) ;
+	FS_dir( SnapshotProperty, sd, &s_pn_device ) ;
+	fprintf( sd->oc.out, "\n}" ) ;
+	FS_ParsedName_destroy( &s_pn_device ) ;
+}
+
+/* Compose one device and send it */
+static void SnapshotDevice(struct snapshot_port * sp, const char * device_path)
+{
+	struct snapshot_stream * stream = sp->stream ;
+	struct snapshot_device sd ;
+	char * body = NULL ;
+	size_t body_length = 0 ;
+
+	memset( &sd, 0, sizeof(struct snapshot_device) ) ;
+	sd.sp = sp ;
+	sd.path_length = strlen(device_path) ;
+
+#ifdef HAVE_OPEN_MEMSTREAM
+	sd.oc.out = open_memstream( &body, &body_length ) ;
+#endif							/* HAVE_OPEN_MEMSTREAM */
+	if ( sd.oc.out == NULL ) {
+		if ( stream->oc->chunked ) {
+			LEVEL_DEBUG("Cannot compose %s in memory -- left out of the snapshot",device_path);
+			return ;
+		}
+		// unframed response -- written in place, holding the wire while reading
+		_MUTEX_LOCK( stream->mutex ) ;
+		sd.oc.out = stream->oc->out ;
+		if ( stream->not_first ) {
+			fprintf( sd.oc.out, ",\n" ) ;
+		}
+		stream->not_first = 1 ;
+		SnapshotDeviceCompose( &sd, device_path ) ;
+		_MUTEX_UNLOCK( stream->mutex ) ;
+		return ;
+	}
+
+	SnapshotDeviceCompose( &sd, device_path ) ;
+	fclose( sd.oc.out ) ; // sets body and body_length
+	if ( body == NULL ) {
+		return ;
+	}
+	if ( body_length > 0 ) {
+		_MUTEX_LOCK( stream->mutex ) ;
+		if ( stream->not_first ) {
+			HTTPchunk( stream->oc, ",\n", 2 ) ;
+		}
+		stream->not_first = 1 ;
+		HTTPchunk( stream->oc, body, body_length ) ;
+		_MUTEX_UNLOCK( stream->mutex ) ;
+	}
+	free( body ) ; // allocated by open_memstream with malloc, not owmalloc
+}
+
+/* Task (pool thread or caller) once per port */
+static void SnapshotPort(void * v)
+{
+	struct snapshot_port * sp = v ;
+	struct connection_in * cin ;
+
+	for ( cin = sp->pin->first ; cin != NO_CONNECTION ; cin = cin->next ) {
+		char bus_path[32] ;
+		struct parsedname s_pn_bus ;
+		size_t offset ;
+
+		UCLIBCLOCK ;
+		snprintf( bus_path, sizeof(bus_path), "/bus.%d", cin->index ) ;
+		UCLIBCUNLOCK ;
+		if ( FS_ParsedName( bus_path, &s_pn_bus ) != 0 ) {
+			continue ;
+		}
+
+		// list the whole bus before reading, so reads don't interleave with the search
+		MemblobInit( &(sp->devices), 1000 ) ;
+		FS_dir( SnapshotListDevice, sp, &s_pn_bus ) ;
+		FS_ParsedName_destroy( &s_pn_bus ) ;
+
+		for ( offset = 0 ; offset < MemblobLength( &(sp->devices) ) ; ) {
+			const char * device_path = (const char *) MemblobData( &(sp->devices) ) + offset ;
+			SnapshotDevice( sp, device_path ) ;
+			offset += strlen( device_path ) + 1 ;
+		}
+		MemblobClear( &(sp->devices) ) ;
+	}
+}
+
+/* Pull family= and property= out of the query string */
+static void SnapshotFilter(struct snapshot_filter * filter, char * query)
+{
+	char * field ;
+
+	filter->family = filter->property = NULL ;
+	if ( query == NULL ) {
+		return ;
+	}
+	while ( (field = strsep( &query, "&" )) != NULL ) {
+		char * value = strchr( field, '=' ) ;
+		if ( value == NULL || value[1] == '\0' ) {
+			continue ;
+		}
+		*value++ = '\0' ;
+		httpunescape( (BYTE *) value ) ;
+		if ( strcasecmp( field, "family" ) == 0 ) {
+			filter->family = value ;
+		} else if ( strcasecmp( field, "property" ) == 0 ) {
+			filter->property = value ;
+		} else {
+			LEVEL_DEBUG("Unknown snapshot filter %s",field);
+		}
+	}
+}
+
+void Snapshot(struct OutputControl * oc, char * query)
+{
+	struct snapshot_filter filter ;
+	struct snapshot_stream stream ;
+	struct snapshot_port * sps ;
+	struct port_in * pin ;
+	int ports = 0 ;
+	int port_index ;
+
+	SnapshotFilter( &filter, query ) ;
+
+	HTTPstream(oc, "200 OK", ct_json);
+	HTTPchunk(oc, "{\n", 2 ) ;
+
+	for ( pin = Inbound_Control.head_port ; pin != NULL ; pin = pin->next ) {
+		++ports ;
+	}
+	sps = owcalloc( ports, sizeof(struct snapshot_port) ) ;
+	if ( sps == NULL ) {
+		HTTPchunk(oc, "}", 1 ) ;
+		return ;
+	}
+
+	stream.oc = oc ;
+	stream.not_first = 0 ;
+	_MUTEX_INIT( stream.mutex ) ;
+	for ( pin = Inbound_Control.head_port, port_index = 0 ; pin != NULL ; pin = pin->next, ++port_index ) {
+		sps[port_index].pin = pin ;
+		sps[port_index].filter = &filter ;
+		sps[port_index].stream = &stream ;
+	}
+	TaskPool_Run( SnapshotPort, sps, sizeof(struct snapshot_port), ports ) ;
+	_MUTEX_DESTROY( stream.mutex ) ;
+	owfree( sps ) ;
+
+	if ( stream.not_first ) {
+		HTTPchunk(oc, "\n}", 2 ) ;
+	} else {
+		HTTPchunk(oc, "}", 1 ) ;
+	}
+}
@@ -21,6 +21,7 @@
 #include <pwd.h>				// getpwuid
 #include <grp.h>				// initgroups
 #include <limits.h>
+#include <netinet/tcp.h>			// TCP_NODELAY
 
 #define SVERSION "owhttpd"
 
@@ -29,26 +30,54 @@
 #define DEVTABLE "BGCOLOR='#DDDDDD' BORDER='1'"
 #define VALTABLE "BGCOLOR='#DDDDDD' BORDER='1'"
 
+/* Seconds an idle persistent connection is kept open */
+#define HTTP_KEEPALIVE_TIMEOUT 15
+/* Requests answered on one connection before it is closed */
+#define HTTP_KEEPALIVE_REQUESTS 100
+/* Persistent connections allowed to wait idle at once, more are closed after their response */
+#define HTTP_KEEPALIVE_IDLE 32
+
+extern pthread_mutex_t keepalive_mutex ;
+
 /*
  * Main routine for actually handling a request
  * deals with a conncection
+ * (requests are answered in turn until the client or an error closes it)
  */
 /* in owhttpd_handler.c */
-int handle_socket(FILE * out);
+int handle_socket(FILE * in, FILE * wire);
+
+enum content_type { ct_text, ct_html, ct_icon, ct_json, };
+
+struct device_values ; // a device page's values, read ahead (owhttpd_read.c)
 
 struct OutputControl {
-	FILE * out ;
+	FILE * in ; // request from the client
+	FILE * wire ; // response to the client
+	FILE * out ; // page being composed (or the wire itself if it can't be buffered)
+	char * body ; // composed page, once out is closed
+	size_t body_length ;
+	const char * status ;
+	enum content_type content_type ;
+	int keep_alive ; // answer and wait for another request
+	int idle ; // holds one of the HTTP_KEEPALIVE_IDLE places while waiting
+	int http11 ; // client takes a chunked response
+	int chunked ; // page streamed in chunks (see HTTPstream)
 	int not_first ;
 	char * base_url ;
 	char * host ;
+	struct device_values * values ;
 } ;
 
 /* in owhttpd_present */
-enum content_type { ct_text, ct_html, ct_icon, ct_json, };
 void HTTPstart( struct OutputControl * oc, const char *status, const enum content_type ct);
 void HTTPtitle( struct OutputControl * oc, const char *title);
 void HTTPheader( struct OutputControl * oc, const char *head);
 void HTTPfoot( struct OutputControl * oc);
+void HTTPcompose( struct OutputControl * oc);
+void HTTPsend( struct OutputControl * oc);
+void HTTPstream( struct OutputControl * oc, const char *status, const enum content_type ct);
+void HTTPchunk( struct OutputControl * oc, const char * data, size_t length);
 
 /* in owhttpd_write.c */
 void PostData(struct one_wire_query *owq);
@@ -56,6 +85,10 @@ void ChangeData(struct one_wire_query *owq);
 
 /* in owhttpd_read.c */
 void ShowDevice( struct OutputControl * oc, struct parsedname *const pn);
+void ShowJson(struct OutputControl * oc, const struct parsedname *pn_entry);
+
+/* in owhttpd_snapshot.c */
+void Snapshot(struct OutputControl * oc, char * query);
 
 /* in owhttpd_dir.c */
 struct JsonCBstruct {
@@ -0,0 +1,195 @@
+#! /usr/bin/env python
+"""
+::BOH
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or (at
+your option) any later version.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+::EOH
+
+Requests per second from owhttpd, one connection per request against
+persistent (keep-alive) and pipelined connections.
+
+    owhttpd --fake=28 -p 3001
+    python http_load.py localhost:3001 /text/28.67C6697351FF/temperature 2000
+
+Options:
+    -c n    clients at once (default 1)
+    -p n    requests in flight on a pipelined connection (default 10)
+"""
+
+
+import getopt
+import socket
+import sys
+import threading
+import time
+
+
+class Client:
+    """ One HTTP/1.1 client connection, reconnecting when the server closes """
+
+    def __init__(self, host, port, path):
+        self.host = host
+        self.port = port
+        self.request = ('GET %s HTTP/1.1\r\nHost: %s\r\n\r\n' % (path, host)).encode('ascii')
+        self.close_request = ('GET %s HTTP/1.1\r\nHost: %s\r\nConnection: close\r\n\r\n' % (path, host)).encode('ascii')
+        self.socket = None
+        self.buffer = b''
+        self.reconnects = 0
+
+
+    def connect(self):
+        self.socket = socket.create_connection((self.host, self.port))
+        self.socket.setsockopt(socket.IPPROTO_TCP, socket.TCP_NODELAY, 1)
+        self.buffer = b''
+
+
+    def close(self):
+        if self.socket is not None:
+            self.socket.close()
+            self.socket = None
+
+
+    def response(self):
+        """ Read one response, returns (status, keep_alive) """
+        while b'\r\n\r\n' not in self.buffer:
+            self.more()
+        head, self.buffer = self.buffer.split(b'\r\n\r\n', 1)
+        lines = head.decode('latin-1').split('\r\n')
+        status = int(lines[0].split()[1])
+        length = None
+        keep_alive = True
+        for line in lines[1:]:
+            name, value = line.split(':', 1)
+            name = name.strip().lower()
+            if name == 'content-length':
+                length = int(value)
+            elif name == 'connection':
+                keep_alive = value.strip().lower() == 'keep-alive'
+        if length is None:
+            # no length -- the body runs to the end of the connection
+            try:
+                while True:
+                    self.more()
+            except EOFError:
+                pass
+            self.buffer = b''
+            return status, False
+        while len(self.buffer) < length:
+            self.more()
+        self.buffer = self.buffer[length:]
+        return status, keep_alive
+
+
+    def more(self):
+        data = self.socket.recv(65536)
+        if not data:
+            raise EOFError
+        self.buffer += data
+
+
+    def run_close(self, count):
+        """ A new connection for each request """
+        for i in range(count):
+            self.connect()
+            self.socket.sendall(self.close_request)
+            status, keep_alive = self.response()
+            self.close()
+            if status != 200:
+                raise IOError('HTTP status %d' % status)
+
+
+    def run_pipelined(self, count, depth):
+        """ Up to depth requests in flight on a persistent connection
+            (depth 1 is plain keep-alive) """
+        done = 0
+        while done < count:
+            self.connect()
+            sent = 0
+            answered = 0
+            keep_alive = True
+            while keep_alive and done + answered < count:
+                try:
+                    while sent - answered < depth and done + sent < count:
+                        self.socket.sendall(self.request)
+                        sent += 1
+                except socket.error:
+                    # closed after an earlier response, which is still to be read
+                    pass
+                if sent == answered:
+                    break
+                status, keep_alive = self.response()
+                if status != 200:
+                    raise IOError('HTTP status %d' % status)
+                answered += 1
+            # the server closed (request or idle limit) -- the rest are resent
+            done += answered
+            self.close()
+            if done < count:
+                self.reconnects += 1
+
+
+def measure(name, host, port, path, count, clients, run):
+    """ count requests spread over clients threads, prints requests/sec """
+    each = [ count // clients + (1 if i < count % clients else 0) for i in range(clients) ]
+    workers = [ Client(host, port, path) for i in range(clients) ]
+    errors = []
+
+    def work(client, n):
+        try:
+            run(client, n)
+        except (IOError, EOFError, socket.error) as e:
+            errors.append(e)
+
+    threads = [ threading.Thread(target = work, args = (w, n)) for w, n in zip(workers, each) ]
+    start = time.time()
+    for t in threads:
+        t.start()
+    for t in threads:
+        t.join()
+    elapsed = time.time() - start
+    if errors:
+        print('%-28s failed: %s' % (name, errors[0]))
+        return
+    reconnects = sum([ w.reconnects for w in workers ])
+    print('%-28s %8.0f req/s  (%d requests, %.2f s, %d reconnects)' % (name, count / elapsed, count, elapsed, reconnects))
+
+
+def main(argv):
+    clients = 1
+    depth = 10
+    opts, args = getopt.getopt(argv, 'c:p:')
+    for opt, value in opts:
+        if opt == '-c':
+            clients = int(value)
+        elif opt == '-p':
+            depth = int(value)
+    if len(args) < 2:
+        print(__doc__)
+        return 1
+    host, port = args[0].rsplit(':', 1)
+    port = int(port)
+    path = args[1]
+    count = int(args[2]) if len(args) > 2 else 1000
+
+    measure('new connection per request', host, port, path, count, clients,
+            lambda c, n: c.run_close(n))
+    measure('persistent connection', host, port, path, count, clients,
+            lambda c, n: c.run_pipelined(n, 1))
+    measure('pipelined %d at a time' % depth, host, port, path, count, clients,
+            lambda c, n: c.run_pipelined(n, depth))
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main(sys.argv[1:]))
@@ -55,11 +55,13 @@ struct global Globals = {
 	.max_clients = 250,
 
 	.cache_size = 0,
+	.cache_policy = cache_policy_clock,
 
 	.one_device = 0,
 
 	.altUSB = 0,
 	.usb_flextime = 1,
+	.usb_sync = 1,
 	.serial_flextime = 1,
 	.serial_reverse = 0,  // 1 is "reverse" polarity
 	.serial_hardflow = 0, // hardware flow control
@@ -79,6 +81,11 @@ struct global Globals = {
 	.timeout_persistent_high = 3600,
 	.clients_persistent_low = 10,
 	.clients_persistent_high = 20,
+	.server_threads = 16,
+	.server_pool = 4,
+	.server_pool_idle = 60,
+	.pool_threads = 8,
+	.bus_requests = 0,
 
 	.pingcrazy = 0,
 	.no_dirall = 0,
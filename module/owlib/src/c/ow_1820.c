@@ -224,6 +224,7 @@ DeviceEntryExtended(42, DS28EA00, DEV_temp | DEV_alarm | DEV_chain, NO_GENERIC_R
 /* Internal properties */
 Make_SlaveSpecificTag(RES, fc_stable);	// resolution
 Make_SlaveSpecificTag(POW, fc_stable);	// power status
+Make_SlaveSpecificTag(CNV, fc_stable);	// conversion time, per mille of the datasheet time
 
 struct tempresolution {
 	int bits; // resolution in bits
@@ -303,9 +304,11 @@ enum temperature_problem_flag { allow_85C, deny_85C, } ;
 
 /* DS1820*/
 static GOOD_OR_BAD OW_10latesttemp(_FLOAT * temp, enum temperature_problem_flag accept_85C, const struct parsedname *pn);
+static GOOD_OR_BAD OW_10scratchpad_temp(_FLOAT * temp, enum temperature_problem_flag accept_85C, BYTE * data);
 static GOOD_OR_BAD OW_10temp(_FLOAT * temp, enum temperature_problem_flag accept_85C, int simul_good, const struct parsedname *pn);
 static GOOD_OR_BAD OW_thermocouple(_FLOAT * temp, enum temperature_problem_flag accept_85C, int simul_good, const struct parsedname *pn);
 static GOOD_OR_BAD OW_22latesttemp(_FLOAT * temp, enum temperature_problem_flag accept_85C, const struct parsedname *pn);
+static GOOD_OR_BAD OW_22scratchpad_temp(_FLOAT * temp, enum temperature_problem_flag accept_85C, struct tempresolution ** Resolution, BYTE * data, const struct parsedname *pn);
 static GOOD_OR_BAD OW_22temp(_FLOAT * temp, enum temperature_problem_flag accept_85C, int simul_good, const struct parsedname *pn);
 static GOOD_OR_BAD OW_power(BYTE * data, const struct parsedname *pn);
 static GOOD_OR_BAD OW_r_templimit(_FLOAT * T, const int Tindex, const struct parsedname *pn);
@@ -325,7 +328,7 @@ static GOOD_OR_BAD OW_temperature_ready( enum temperature_problem_flag accept_85
 
 static GOOD_OR_BAD OW_read_piostate(UINT * piostate, const struct parsedname *pn) ;
 static _FLOAT OW_masked_temperature( BYTE * data, struct tempresolution * Resolution ) ;
-static GOOD_OR_BAD OW_poll_convert(const struct parsedname *pn) ;
+static GOOD_OR_BAD OW_poll_convert(UINT delay, const struct parsedname *pn) ;
 
 static GOOD_OR_BAD OW_r_mem(BYTE * data, size_t size, off_t offset, struct parsedname *pn) ;
 static GOOD_OR_BAD OW_w_mem( BYTE * data, size_t size, off_t offset, struct parsedname * pn ) ;
@@ -864,7 +867,7 @@ static GOOD_OR_BAD OW_temperature_ready( enum temperature_problem_flag accept_85
 			GOOD_OR_BAD ret;
 			LEVEL_DEBUG("Powered temperature conversion -- poll for completion");
 			BUSLOCK(pn);
-			ret = BUS_transaction_nolock(tpowered, pn) || OW_poll_convert(pn);
+			ret = BUS_transaction_nolock(tpowered, pn) || OW_poll_convert(delay, pn);
 			BUSUNLOCK(pn);
 			RETURN_BAD_IF_BAD(ret)
 		}
@@ -881,10 +884,16 @@ static GOOD_OR_BAD OW_temperature_ready( enum temperature_problem_flag accept_85
 static GOOD_OR_BAD OW_10latesttemp(_FLOAT * temp, enum temperature_problem_flag accept_85C, const struct parsedname *pn)
 {
 	BYTE data[SCRATCHPAD_LENGTH];
-	struct tempresolution * Resolution = &ResolutionS ;
 
 	RETURN_BAD_IF_BAD(OW_r_scratchpad(data, pn)) ;
 
+	return OW_10scratchpad_temp(temp, accept_85C, data);
+}
+
+static GOOD_OR_BAD OW_10scratchpad_temp(_FLOAT * temp, enum temperature_problem_flag accept_85C, BYTE * data)
+{
+	struct tempresolution * Resolution = &ResolutionS ;
+
 	// Correction thanks to Nathan D. Holmes
 	//temp[0] = (_FLOAT) ((int16_t)(data[1]<<8|data[0])) * .5 ; // Main conversion
 	// Further correction, using "truncation" thanks to Wim Heirman
@@ -917,26 +926,32 @@ static GOOD_OR_BAD OW_22latesttemp(_FLOAT * temp, enum temperature_problem_flag
 
 	RETURN_BAD_IF_BAD( OW_r_scratchpad(data, pn) ) ;
 
+	return OW_22scratchpad_temp(temp, accept_85C, &Resolution, data, pn);
+}
+
+/* Resolution is the one the scratchpad was converted at */
+static GOOD_OR_BAD OW_22scratchpad_temp(_FLOAT * temp, enum temperature_problem_flag accept_85C, struct tempresolution ** Resolution, BYTE * data, const struct parsedname *pn)
+{
 	switch (data[4] & 0x60) {
 		case 0x00:
-			Resolution = &Resolution9 ;
+			Resolution[0] = &Resolution9 ;
 			break ;
 		case 0x20:
-			Resolution = &Resolution10 ;
+			Resolution[0] = &Resolution10 ;
 			break ;
 		case 0x40:
-			Resolution = &Resolution11 ;
+			Resolution[0] = &Resolution11 ;
 			break ;
 		case 0x60:
 		default:
-			Resolution = &Resolution12 ;
+			Resolution[0] = &Resolution12 ;
 			break ;
 	}
         if ((pn->sn[0] == 0x3B) && (data[4] & 0x80)) {
             /* MAX31850 shows internal temperature at data[2] as "temperatureXXX"! */
             temp[0] = ((_FLOAT) ((int16_t) ((data[3] << 8) | (data[2] & 0xf0)))) / 256.0;
         } else {
-            temp[0] = OW_masked_temperature( data, Resolution ) ;
+            temp[0] = OW_masked_temperature( data, Resolution[0] ) ;
         }
 	if ( accept_85C==allow_85C || data[0] != 0x50 || data[1] != 0x05 ) {
 		return gbGOOD;
@@ -955,6 +970,46 @@ static GOOD_OR_BAD OW_22temp(_FLOAT * temp, enum temperature_problem_flag accept
 	return OW_22latesttemp(temp, accept_85C, pn);
 }
 
+/* Temperature from a scratchpad read right after a bus-wide conversion (/simultaneous/temperature_all)
+ * property is the temperature property of the device this reading belongs to */
+GOOD_OR_BAD OW_scratchpad_temperature(_FLOAT * temp, const char ** property, BYTE * data, const struct parsedname *pn)
+{
+	struct tempresolution *Resolution ;
+
+	switch ( pn->sn[0] ) {
+		case 0x10:
+			property[0] = "temperature" ;
+			return OW_10scratchpad_temp(temp, deny_85C, data);
+		case 0x3B:
+			if ( data[4] & 0x80 ) {
+				// MAX31850 thermocouple, not read this way
+				return gbBAD ;
+			}
+			// fall through
+		case 0x22:
+		case 0x28:
+		case 0x42:
+			RETURN_BAD_IF_BAD( OW_22scratchpad_temp(temp, deny_85C, &Resolution, data, pn) ) ;
+			switch ( Resolution->bits ) {
+				case 9:
+					property[0] = "temperature9" ;
+					break ;
+				case 10:
+					property[0] = "temperature10" ;
+					break ;
+				case 11:
+					property[0] = "temperature11" ;
+					break ;
+				default:
+					property[0] = "temperature12" ;
+					break ;
+			}
+			return gbGOOD ;
+		default:
+			return gbBAD ;
+	}
+}
+
 /* MAX31850 Thermocouple */
 /* get the temp from the scratchpad buffer after starting a conversion and waiting */
 static GOOD_OR_BAD OW_thermocouple(_FLOAT * temp, enum temperature_problem_flag accept_85C, int simul_good, const struct parsedname *pn)
@@ -1200,31 +1255,56 @@ static enum eDie OW_die(const struct parsedname *pn)
 }
 
 /* Powered temperature measurements -- need to poll line since it is held low during measurement */
-/* We check every 10 msec (arbitrary) up to 1.25 seconds */
-static GOOD_OR_BAD OW_poll_convert(const struct parsedname *pn)
+/* delay is the datasheet conversion time, we give up after half as long again.
+ * Chips are usually much faster, so the time this chip took is kept (as a share
+ * of delay, so it carries over to other resolutions) and polling starts just before it. */
+static GOOD_OR_BAD OW_poll_convert(UINT delay, const struct parsedname *pn)
 {
-	int i;
 	BYTE p[1];
+	UINT step = delay / 20 + 1 ; // msec between polls
+	UINT learned ;
+	UINT elapsed ;
+	struct timeval start ;
+	struct timeval now ;
 	struct transaction_log t[] = {
-		{NULL, NULL, 10, trxn_delay,},
 		TRXN_READ1(p),
 		TRXN_END,
 	};
 
-	// the first test is faster for just DS2438 (10 msec)
-	// subsequent polling is slower since the DS18x20 is a slower converter
-	for (i = 0; i < 22; ++i) {
-		//LEVEL_DEBUG("TEST polling %d",i);
+	timernow( &start ) ;
+	if ( GOOD( Cache_Get_SlaveSpecific(&learned, sizeof(learned), SlaveSpecificTag(CNV), pn) ) ) {
+		// sleep through most of the usual time, then poll more closely
+		UT_delay( delay * learned / 1000 * 9 / 10 ) ;
+		step = delay / 100 + 1 ;
+		STAT_THREAD_ADD1(convert_learned);
+	}
+
+	do {
 		if ( BAD( BUS_transaction_nolock(t, pn) )) {
 			LEVEL_DEBUG("BUS_transaction failed");
-			break;
+			return gbBAD;
 		}
+		timernow( &now ) ;
+		timersub( &now, &start, &now ) ;
+		elapsed = now.tv_sec * 1000 + now.tv_usec / 1000 ;
 		if (p[0] != 0) {
-			LEVEL_DEBUG("BUS_transaction done after %dms", (i + 1) * 10);
+			UINT share = elapsed * 1000 / delay ;
+			LEVEL_DEBUG("BUS_transaction done after %dms", elapsed);
+			if ( GOOD( Cache_Get_SlaveSpecific(&learned, sizeof(learned), SlaveSpecificTag(CNV), pn) ) ) {
+				// smooth out the odd slow or early poll
+				share = ( 3 * learned + share ) / 4 ;
+			}
+			Cache_Add_SlaveSpecific(&share, sizeof(share), SlaveSpecificTag(CNV), pn);
+			STAT_THREAD_ADD1(convert_polled);
+			STAT_THREAD_ADD(convert_msec, elapsed);
+			if ( elapsed > STAT_THREAD(convert_max) ) {
+				STAT_THREAD(convert_max) = elapsed ;
+			}
 			return gbGOOD;
 		}
-		t[0].size = 50;			// 50 msec for rest of delays
-	}
+		UT_delay( step ) ;
+	} while ( elapsed < delay + delay / 2 ) ;
+
 	LEVEL_DEBUG("Temperature measurement failed");
 	return gbBAD;
 }
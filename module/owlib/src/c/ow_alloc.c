@@ -75,4 +75,238 @@ char *OWstrdup(const char * file, int line, const char * func, const char *s)
 	return c;
 }
 
-#endif							/* OW_ALLOC_H */
+#else							/* OW_ALLOC_DEBUG */
+
+/* Slab allocator
+ * Each object is preceded by a small header holding its size class.
+ * Classes are powers of two from 64 to 1024 bytes (header included).
+ * Objects are carved from chunks aligned on their size, so the chunk of an
+ * object is found from its address. Each chunk keeps its own free list and
+ * count of objects in use; the chunks with a free object are listed per class.
+ * Chunks that have emptied are kept for the cache to refill (one per class
+ * at least), and the rest returned to the system by owslab_trim.
+ * */
+
+#define OWSLAB_MIN_SHIFT  6
+#define OWSLAB_CHUNK_SIZE 16384 /* also the chunk alignment */
+#define OWSLAB_UNPOOLED   OWSLAB_CLASSES
+
+union slab_header {
+	int size_class ;
+	void * free_next ; // valid only while on the free list
+	long double align ; // keep the payload aligned as malloc would
+} ;
+
+struct slab_chunk {
+	struct slab_chunk * next ; // chunks of this class with a free object
+	struct slab_chunk * prev ;
+	union slab_header * free_list ;
+	int in_use ; // objects handed out
+} ;
+
+static struct {
+	struct slab_chunk * available ; // chunks with a free object
+	int empty ; // chunks with no object in use
+} slab_list[OWSLAB_CLASSES] ;
+
+#define SLAB_CLASS_SIZE(c)  (((size_t)1) << ((c) + OWSLAB_MIN_SHIFT))
+#define SLAB_CHUNK_OF(sh)   ((struct slab_chunk *) ((uintptr_t)(sh) & ~((uintptr_t) OWSLAB_CHUNK_SIZE - 1)))
+// objects start after the chunk header, keeping the header alignment
+#define SLAB_FIRST_OBJECT   (((sizeof(struct slab_chunk) + sizeof(union slab_header) - 1) / sizeof(union slab_header)) * sizeof(union slab_header))
+#define SLAB_LOCK(c)        _MUTEX_LOCK(  Mutex.slab_mutex[c] )
+#define SLAB_UNLOCK(c)      _MUTEX_UNLOCK(Mutex.slab_mutex[c] )
+
+static int slab_class( size_t size )
+{
+	int size_class ;
+	size += sizeof(union slab_header) ;
+	for ( size_class = 0 ; size_class < OWSLAB_CLASSES ; ++size_class ) {
+		if ( size <= SLAB_CLASS_SIZE(size_class) ) {
+			return size_class ;
+		}
+	}
+	return OWSLAB_UNPOOLED ;
+}
+
+/* Called with the class locked */
+static void slab_list_add( int size_class, struct slab_chunk * chunk )
+{
+	chunk->prev = NULL ;
+	chunk->next = slab_list[size_class].available ;
+	if ( chunk->next != NULL ) {
+		chunk->next->prev = chunk ;
+	}
+	slab_list[size_class].available = chunk ;
+}
+
+/* Called with the class locked */
+static void slab_list_remove( int size_class, struct slab_chunk * chunk )
+{
+	if ( chunk->prev != NULL ) {
+		chunk->prev->next = chunk->next ;
+	} else {
+		slab_list[size_class].available = chunk->next ;
+	}
+	if ( chunk->next != NULL ) {
+		chunk->next->prev = chunk->prev ;
+	}
+	chunk->next = chunk->prev = NULL ;
+}
+
+/* Carve a new chunk into free objects of this class */
+/* Called with the class locked */
+static void slab_grow( int size_class )
+{
+	size_t object_size = SLAB_CLASS_SIZE(size_class) ;
+	void * memory ;
+	struct slab_chunk * chunk ;
+	char * object ;
+
+	if ( posix_memalign( &memory, OWSLAB_CHUNK_SIZE, OWSLAB_CHUNK_SIZE ) != 0 ) {
+		return ;
+	}
+	chunk = memory ;
+	chunk->free_list = NULL ;
+	chunk->in_use = 0 ;
+	for ( object = (char *) chunk + SLAB_FIRST_OBJECT ; object + object_size <= (char *) chunk + OWSLAB_CHUNK_SIZE ; object += object_size ) {
+		union slab_header * sh = (union slab_header *) object ;
+		sh->free_next = chunk->free_list ;
+		chunk->free_list = sh ;
+	}
+	slab_list_add( size_class, chunk ) ;
+	++slab_list[size_class].empty ;
+}
+
+void *owslab_malloc(size_t size)
+{
+	int size_class = slab_class( size ) ;
+	union slab_header * sh = NULL ;
+
+	if ( size_class == OWSLAB_UNPOOLED ) {
+		sh = malloc( sizeof(union slab_header) + size ) ;
+	} else {
+		struct slab_chunk * chunk ;
+
+		SLAB_LOCK(size_class) ;
+		if ( slab_list[size_class].available == NULL ) {
+			slab_grow( size_class ) ;
+		}
+		chunk = slab_list[size_class].available ;
+		if ( chunk != NULL ) {
+			sh = chunk->free_list ;
+			chunk->free_list = sh->free_next ;
+			if ( chunk->in_use++ == 0 ) {
+				--slab_list[size_class].empty ;
+			}
+			if ( chunk->free_list == NULL ) {
+				// full
+				slab_list_remove( size_class, chunk ) ;
+			}
+		}
+		SLAB_UNLOCK(size_class) ;
+	}
+
+	if ( sh == NULL ) {
+		return NULL ;
+	}
+	sh->size_class = size_class ;
+	return (void *) (sh+1) ;
+}
+
+void owslab_free(void *ptr)
+{
+	union slab_header * sh ;
+	struct slab_chunk * chunk ;
+	int size_class ;
+
+	if ( ptr == NULL ) {
+		return ;
+	}
+	sh = ((union slab_header *) ptr) - 1 ;
+	size_class = sh->size_class ;
+	if ( size_class == OWSLAB_UNPOOLED ) {
+		free( sh ) ;
+		return ;
+	}
+	chunk = SLAB_CHUNK_OF( sh ) ;
+	SLAB_LOCK(size_class) ;
+	if ( chunk->free_list == NULL ) {
+		// was full -- has a free object again
+		slab_list_add( size_class, chunk ) ;
+	}
+	sh->free_next = chunk->free_list ;
+	chunk->free_list = sh ;
+	if ( --chunk->in_use == 0 ) {
+		++slab_list[size_class].empty ;
+	}
+	SLAB_UNLOCK(size_class) ;
+}
+
+/* Return the empty chunks to the system, keeping one per class for the next additions */
+/* Called now and then (cache housekeeping) */
+void owslab_trim(void)
+{
+	int size_class ;
+
+	for ( size_class = 0 ; size_class < OWSLAB_CLASSES ; ++size_class ) {
+		struct slab_chunk * chunk ;
+		struct slab_chunk * next ;
+
+		SLAB_LOCK(size_class) ;
+		for ( chunk = slab_list[size_class].available ; chunk != NULL && slab_list[size_class].empty > 1 ; chunk = next ) {
+			next = chunk->next ;
+			if ( chunk->in_use == 0 ) {
+				slab_list_remove( size_class, chunk ) ;
+				--slab_list[size_class].empty ;
+				free( chunk ) ;
+			}
+		}
+		SLAB_UNLOCK(size_class) ;
+	}
+}
+
+void owslab_treefree(void *ptr)
+{
+	owslab_free(ptr) ;
+}
+
+void *owslab_realloc(void *ptr, size_t size)
+{
+	union slab_header * sh ;
+	int old_class ;
+	int new_class = slab_class( size ) ;
+	size_t old_size ;
+	void * new_ptr ;
+
+	if ( ptr == NULL ) {
+		return owslab_malloc( size ) ;
+	}
+	sh = ((union slab_header *) ptr) - 1 ;
+	old_class = sh->size_class ;
+
+	if ( old_class == new_class ) {
+		if ( old_class == OWSLAB_UNPOOLED ) {
+			sh = realloc( sh, sizeof(union slab_header) + size ) ;
+			return ( sh == NULL ) ? NULL : (void *) (sh+1) ;
+		}
+		// still fits
+		return ptr ;
+	}
+
+	new_ptr = owslab_malloc( size ) ;
+	if ( new_ptr == NULL ) {
+		// old block untouched, as realloc
+		return NULL ;
+	}
+	if ( old_class == OWSLAB_UNPOOLED ) {
+		// only ever shrinking from an unpooled block
+		old_size = size ;
+	} else {
+		old_size = SLAB_CLASS_SIZE(old_class) - sizeof(union slab_header) ;
+	}
+	memcpy( new_ptr, ptr, (old_size < size) ? old_size : size ) ;
+	owslab_free( ptr ) ;
+	return new_ptr ;
+}
+
+#endif							/* OW_ALLOC_DEBUG */
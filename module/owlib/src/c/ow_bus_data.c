@@ -82,6 +82,9 @@ GOOD_OR_BAD BUS_sendback_data(const BYTE * data, BYTE * resp, const size_t len,
 	
 	/* Native function for this bus master? */
 	if ( sendback_data != NO_SENDBACKDATA_ROUTINE ) {
+		// bus is locked -- no STATLOCK needed
+		++pn->selected_connection->bus_stat[e_bus_transfers] ;
+		pn->selected_connection->bus_stat[e_bus_transfer_bytes] += len ;
 		return (sendback_data) (data, resp, len, pn);
 	}
 
@@ -43,23 +43,6 @@ int AliasMarkerLoc ;
 void * Alias_Marker = &AliasMarkerLoc ;
 
 
-/* Put the globals into a struct to declutter the namespace */
-struct cache_data {
-	void *temporary_tree_new;			// current cache database
-	void *temporary_tree_old;			// older cache database
-	void *persistent_tree;				// persistent database
-	void *temporary_alias_tree_new;		// current cache database
-	void *temporary_alias_tree_old;		// older cache database
-	void *persistent_alias_tree;		// persistent database
-	size_t old_ram_size;				// cache size
-	size_t new_ram_size;				// cache size
-	time_t time_retired;				// start time of older
-	time_t time_to_kill;				// deathtime of older
-	time_t retired_lifespan;			// lifetime of older
-	UINT added;					// items added
-};
-static struct cache_data cache;
-
 /* Cache elements are placed in a Red/Black binary tree
 	-- standard glibc implementation
 	-- use gnu tdestroy extension
@@ -72,6 +55,8 @@ static struct cache_data cache;
 	key -- sorted component as above
 	expires -- the time that the element is no longer valid
 	dsize -- length in bytes of trailing data
+	wheel links -- place in the expiry wheel (temporary cache only)
+	clock links -- place in the CLOCK replacement ring (temporary cache only)
   Cache data is the actual data
 	allocated at same call as cache node
 	access via macro TREE_DATA
@@ -95,13 +80,75 @@ struct tree_key {
    A key (see above)
    An expiration time
    And a size in bytes
+   Links for the expiry wheel
+   Links and a reference flag for CLOCK replacement
    Actaully size bytes follows with the data
 */
 struct tree_node {
 	struct tree_key tk;
 	time_t expires;
 	size_t dsize;
+	struct tree_node *wheel_next;
+	struct tree_node *wheel_prev;
+	struct tree_node *clock_next;
+	struct tree_node *clock_prev;
+	int referenced;				// set on each hit, cleared as the clock hand passes
+};
+
+/* Readers set the reference bit holding only the shard read lock */
+#if ( __GNUC__ > 4 ) || (__GNUC__ == 4 && __GNUC_MINOR__ > 6 ) || defined(__clang__)
+#define CLOCK_REFERENCE(tn)	__atomic_store_n( &((tn)->referenced), 1, __ATOMIC_RELAXED )
+#else
+#define CLOCK_REFERENCE(tn)	( (tn)->referenced = 1 )
+#endif
+
+/* The volatile cache is split into shards chosen by a hash of the tree_key.
+   Each shard has its own lock and tree so lookups of different properties
+   don't contend for one lock.
+   Every node is also listed in an expiry "wheel" slot by its expiration second.
+   A housekeeping thread visits the slots as time passes and frees only the
+   expired nodes, a few at a time, so there is no whole-tree purge.
+   When a shard is full (Globals.cache_size) the CLOCK ring picks cold
+   entries to evict so that hot ones still fit. */
+#define CACHE_SHARDS	16	/* must be a power of 2 */
+#define CACHE_WHEEL_SLOTS	64	/* seconds in one turn of the expiry wheel */
+#define CACHE_PURGE_BATCH	64	/* most nodes visited while holding the shard lock */
+
+struct cache_shard {
+	my_rwlock_t lock;					// protects this shard only
+	void *temporary_tree;				// cache database
+	struct tree_node *wheel[CACHE_WHEEL_SLOTS];	// nodes by expiration second
+	struct tree_node *purge_next;		// where an unfinished slot purge resumes
+	int purge_resume;					// slot purge unfinished
+	time_t swept;						// wheel purged through this time
+	struct tree_node *hand;				// CLOCK hand (NULL if empty)
+	size_t ram_size;					// cache size
+	UINT items;							// nodes in tree
+};
+
+/* Put the globals into a struct to declutter the namespace */
+struct cache_data {
+	struct cache_shard shard[CACHE_SHARDS];	// volatile cache
+	void *persistent_tree;				// persistent database
+	void *temporary_alias_tree_new;		// current cache database
+	void *temporary_alias_tree_old;		// older cache database
+	void *persistent_alias_tree;		// persistent database
+	size_t old_alias_ram_size;			// alias cache size
+	size_t new_alias_ram_size;			// alias cache size
+	time_t alias_time_to_kill;			// deathtime of older alias tree
+	time_t retired_lifespan;			// lifetime of older alias tree
+	int housekeeping;					// purge thread running
+	int housekeeping_stop;				// set by Cache_Close
+	pthread_t housekeeping_thread;
+	pthread_mutex_t housekeeping_mutex;	// guards housekeeping_stop
+	pthread_cond_t housekeeping_cond;	// wakes the thread to stop
 };
+static struct cache_data cache;
+
+#define SHARD_WLOCK(shard)		RWLOCK_WLOCK(   (shard)->lock )
+#define SHARD_WUNLOCK(shard)	RWLOCK_WUNLOCK( (shard)->lock )
+#define SHARD_RLOCK(shard)		RWLOCK_RLOCK(   (shard)->lock )
+#define SHARD_RUNLOCK(shard)	RWLOCK_RUNLOCK( (shard)->lock )
 
 struct alias_tree_node {
 	size_t size;
@@ -121,14 +168,26 @@ struct tree_opaque {
 };
 
 #define TREE_DATA(tn)    ( (BYTE *)(tn) + sizeof(struct tree_node) )
+#define TREE_NODE_SIZE(tn)    ( sizeof(struct tree_node) + (tn)->dsize )
 #define CONST_TREE_DATA(tn)    ( (const BYTE *)(tn) + sizeof(struct tree_node) )
 
 #define ALIAS_TREE_DATA(atn)    ( (ASCII *)(atn) + sizeof(struct alias_tree_node) )
+#define ALIAS_TREE_NODE_SIZE(atn)    ( sizeof(struct alias_tree_node) + (atn)->size + 1 )
 #define CONST_ALIAS_TREE_DATA(atn)    ( (const ASCII *)(atn) + sizeof(struct alias_tree_node) )
 
 enum cache_task_return { ctr_ok, ctr_not_found, ctr_expired, ctr_size_mismatch, } ;
 
-static void FlipTree( void ) ;
+static void Cache_Purge_Shard( struct cache_shard * shard, time_t now ) ;
+static int Cache_Purge_Slot( struct cache_shard * shard, int slot, time_t now, int * purged ) ;
+static void Cache_Remove_Node( struct cache_shard * shard, struct tree_node * tn ) ;
+static void WheelAdd( struct cache_shard * shard, struct tree_node * tn ) ;
+static void WheelRemove( struct cache_shard * shard, struct tree_node * tn ) ;
+static void ClockAdd( struct cache_shard * shard, struct tree_node * tn ) ;
+static void ClockRemove( struct cache_shard * shard, struct tree_node * tn ) ;
+static GOOD_OR_BAD Cache_Make_Room( struct cache_shard * shard, size_t size ) ;
+static void * Cache_Housekeeping( void * v ) ;
+static void FlipAliasTree( void ) ;
+static struct cache_shard * CacheShard( const struct tree_node * tn ) ;
 
 static int IsThisPersistent( const struct parsedname * pn ) ;
 
@@ -152,6 +211,7 @@ static void Cache_Add_Alias_Common(struct alias_tree_node *atn);
 static INDEX_OR_ERROR Cache_Get_Alias_Common( struct alias_tree_node * atn) ;
 
 static void Cache_Add_Alias_SN(const ASCII * alias_name, const BYTE * sn) ;
+static int Cache_Alias_Changed(const ASCII *name, const BYTE * sn) ;
 static void Cache_Del_Alias_SN(const ASCII * alias_name) ;
 
 static void Cache_Add_Alias_Persistent(struct alias_tree_node *atn);
@@ -249,8 +309,11 @@ static void tree_show(const void *node, const VISIT which, const int depth)
 }
 static void new_tree(void)
 {
-	fprintf(stderr,"Walk the new tree:\n");
-	twalk(cache.temporary_tree_new, tree_show);
+	int shard_index ;
+	for ( shard_index = 0 ; shard_index < CACHE_SHARDS ; ++shard_index ) {
+		fprintf(stderr,"Walk the new tree of shard %d:\n", shard_index);
+		twalk(cache.shard[shard_index].temporary_tree, tree_show);
+	}
 }
 #else							/* CACHE_DEBUG */
 #define new_tree()
@@ -262,10 +325,27 @@ static int IsThisPersistent( const struct parsedname * pn )
 	return ( (pn->selected_filetype->change==fc_persistent) || get_busmode(pn->selected_connection)==bus_mock ) ;
 }
 
+/* Pick the shard for this key */
+/* FNV-1a hash over the whole key (LoadTK zeroes the padding) */
+static struct cache_shard * CacheShard( const struct tree_node * tn )
+{
+	const BYTE * key = (const BYTE *) &(tn->tk) ;
+	UINT hash = 2166136261U ;
+	size_t key_index ;
+
+	for ( key_index = 0 ; key_index < sizeof(struct tree_key) ; ++key_index ) {
+		hash ^= key[key_index] ;
+		hash *= 16777619U ;
+	}
+	return &cache.shard[ hash & (CACHE_SHARDS-1) ] ;
+}
+
 /* DB cache creation code */
 /* Note: done in single-threaded mode so locking not yet needed */
 void Cache_Open(void)
 {
+	int shard_index ;
+
 	memset(&cache, 0, sizeof(struct cache_data));
 
 	cache.retired_lifespan = TimeOut(fc_stable);
@@ -273,67 +353,330 @@ void Cache_Open(void)
 		cache.retired_lifespan = 3600;	/* 1 hour tops */
 	}
 
-	// Flip once (at start) to set up old tree.
-	FlipTree() ;
+	for ( shard_index = 0 ; shard_index < CACHE_SHARDS ; ++shard_index ) {
+		RWLOCK_INIT( cache.shard[shard_index].lock ) ;
+		cache.shard[shard_index].swept = NOW_TIME ;
+	}
+	// Flip once (at start) to set up old alias tree.
+	FlipAliasTree() ;
 }
 
 /* Note: done in a simgle single thread mode so locking not needed */
+/* apart from the housekeeping thread, which is stopped first */
+/* Not for LibClose -- detached server threads may still be using the cache */
 void Cache_Close(void)
 {
+	int shard_index ;
+
+	Cache_Housekeeping_Stop() ;
 	Cache_Clear() ;
-	SAFETDESTROY( cache.persistent_tree, owfree_func);
+	for ( shard_index = 0 ; shard_index < CACHE_SHARDS ; ++shard_index ) {
+		RWLOCK_DESTROY( cache.shard[shard_index].lock ) ;
+	}
+	SAFETDESTROY( cache.persistent_tree, owslab_treefree);
 	SAFETDESTROY( cache.persistent_alias_tree, owfree_func);
 }
 
-/* Moves new to old tree, initializes new tree, and clears former old tree location */
-static void FlipTree( void )
+/* Start the thread that frees expired cache entries */
+/* Called from LibStart (after any fork to the background) */
+void Cache_Housekeeping_Start(void)
 {
-	void * flip = cache.temporary_tree_old; // old old saved for later clearing
-	void * flip_alias = cache.temporary_alias_tree_old; // old old saved for later clearing
+	if ( cache.housekeeping ) {
+		// already running (LibStart called again)
+		return ;
+	}
+	_MUTEX_INIT( cache.housekeeping_mutex ) ;
+	my_pthread_cond_init( &(cache.housekeeping_cond), NULL ) ;
+	cache.housekeeping_stop = 0 ;
+	if ( pthread_create( &(cache.housekeeping_thread), DEFAULT_THREAD_ATTR, Cache_Housekeeping, NULL ) != 0 ) {
+		ERROR_DEFAULT( "Could not create the cache housekeeping thread. Expired entries won't be freed." ) ;
+		_MUTEX_DESTROY( cache.housekeeping_mutex ) ;
+		my_pthread_cond_destroy( &(cache.housekeeping_cond) ) ;
+		return ;
+	}
+	cache.housekeeping = 1 ;
+}
 
-	/* Flip caches! old = new. New truncated, reset time and counters and flag */
-	LEVEL_DEBUG("Flipping cache tree (purging timed-out data)");
+/* Wake the housekeeping thread and wait for it to finish */
+/* Called from LibClose, and from Cache_Close before the shards are torn down */
+void Cache_Housekeeping_Stop(void)
+{
+	if ( ! cache.housekeeping ) {
+		return ;
+	}
+	_MUTEX_LOCK( cache.housekeeping_mutex ) ;
+	cache.housekeeping_stop = 1 ;
+	my_pthread_cond_signal( &(cache.housekeeping_cond) ) ;
+	_MUTEX_UNLOCK( cache.housekeeping_mutex ) ;
 
-	// move "new" pointers to "old"
-	cache.temporary_tree_old = cache.temporary_tree_new;
-	cache.old_ram_size = cache.new_ram_size;
-	cache.temporary_alias_tree_old = cache.temporary_alias_tree_new;
+	pthread_join( cache.housekeeping_thread, NULL ) ;
+	cache.housekeeping = 0 ;
 
-	// New cache setup
-	cache.temporary_tree_new = NULL;
-	cache.temporary_alias_tree_new = NULL;
-	cache.new_ram_size = 0;
-	cache.added = 0;
+	_MUTEX_DESTROY( cache.housekeeping_mutex ) ;
+	my_pthread_cond_destroy( &(cache.housekeeping_cond) ) ;
+}
+
+/* Once a second, free the expired entries in every shard */
+static void * Cache_Housekeeping( void * v )
+{
+	LEVEL_DEBUG("Cache housekeeping thread started");
+	_MUTEX_LOCK( cache.housekeeping_mutex ) ;
+	while ( ! cache.housekeeping_stop ) {
+		struct timespec wake ;
+		time_t now ;
+		int shard_index ;
+
+		wake.tv_sec = time(NULL) + 1 ;
+		wake.tv_nsec = 0 ;
+		// returns early when Cache_Close signals, else times out after a second
+		pthread_cond_timedwait( &(cache.housekeeping_cond), &(cache.housekeeping_mutex), &wake ) ;
+		if ( cache.housekeeping_stop ) {
+			break ;
+		}
+		_MUTEX_UNLOCK( cache.housekeeping_mutex ) ;
+
+		now = NOW_TIME ;
+		for ( shard_index = 0 ; shard_index < CACHE_SHARDS ; ++shard_index ) {
+			Cache_Purge_Shard( &cache.shard[shard_index], now ) ;
+		}
+		STAT_ADD1(cache_purges) ;
+		owslab_trim() ;
+
+		_MUTEX_LOCK( cache.housekeeping_mutex ) ;
+	}
+	_MUTEX_UNLOCK( cache.housekeeping_mutex ) ;
+	LEVEL_DEBUG("Cache housekeeping thread stopped");
+	return v ;
+}
+
+/* Visit each wheel slot that came due since the last sweep */
+/* The shard lock is taken per batch, so readers only wait for one batch */
+static void Cache_Purge_Shard( struct cache_shard * shard, time_t now )
+{
+	time_t sweep = shard->swept ; // only this thread changes swept
+
+	if ( now - sweep > CACHE_WHEEL_SLOTS ) {
+		// behind by more than a turn -- one full turn covers every slot
+		sweep = now - CACHE_WHEEL_SLOTS ;
+	}
+	for ( ++sweep ; sweep <= now ; ++sweep ) {
+		int more ;
+		do {
+			struct timeval tv_start ;
+			struct timeval tv_end ;
+			int purged = 0 ;
+
+			timernow( &tv_start ) ;
+			SHARD_WLOCK(shard);
+			more = Cache_Purge_Slot( shard, sweep % CACHE_WHEEL_SLOTS, now, &purged ) ;
+			SHARD_WUNLOCK(shard);
+			timernow( &tv_end ) ;
+
+			if ( purged > 0 ) {
+				timersub( &tv_end, &tv_start, &tv_end ) ;
+				STATLOCK;
+				cache_purged += purged ;
+				timeradd( &cache_purge_time, &tv_end, &cache_purge_time ) ;
+				if ( timercmp( &tv_end, &cache_purge_max, > ) ) {
+					cache_purge_max = tv_end ;
+				}
+				STATUNLOCK;
+			}
+		} while ( more ) ;
+	}
+	shard->swept = now ;
+}
+
+/* Free expired nodes in one wheel slot, visiting at most CACHE_PURGE_BATCH */
+/* Nodes for a later turn of the wheel stay */
+/* Returns non-zero if the slot isn't finished -- call again (after releasing the lock) */
+/* and the walk resumes at shard->purge_next, which WheelRemove keeps valid */
+/* Called with the shard write-locked */
+static int Cache_Purge_Slot( struct cache_shard * shard, int slot, time_t now, int * purged )
+{
+	struct tree_node * tn = shard->purge_resume ? shard->purge_next : shard->wheel[slot] ;
+	int visited = 0 ;
+
+	shard->purge_next = NULL ;
+	shard->purge_resume = 0 ;
+	while ( tn != NULL ) {
+		struct tree_node * tn_next = tn->wheel_next ; // read before free
+		if ( visited++ == CACHE_PURGE_BATCH ) {
+			// rest of the slot in the next batch
+			shard->purge_next = tn ;
+			shard->purge_resume = 1 ;
+			return 1 ;
+		}
+		if ( tn->expires <= now ) {
+			Cache_Remove_Node( shard, tn ) ;
+			++purged[0] ;
+		}
+		tn = tn_next ;
+	}
+	return 0 ;
+}
+
+/* Take a node out of the tree and wheel and free it */
+/* Called with the shard write-locked */
+static void Cache_Remove_Node( struct cache_shard * shard, struct tree_node * tn )
+{
+	WheelRemove( shard, tn ) ;
+	ClockRemove( shard, tn ) ;
+	tdelete( tn, &shard->temporary_tree, tree_compare ) ;
+	shard->ram_size -= TREE_NODE_SIZE(tn) ;
+	--shard->items ;
+	owslab_free( tn ) ;
+	STAT_AVERAGE_OUT(new_avg);
+}
+
+/* Expiry wheel is a doubly linked list per slot (expiration second modulo slots) */
+/* expires must not change while the node is on the wheel */
+static void WheelAdd( struct cache_shard * shard, struct tree_node * tn )
+{
+	struct tree_node ** slot = &( shard->wheel[ tn->expires % CACHE_WHEEL_SLOTS ] ) ;
+
+	tn->wheel_prev = NULL ;
+	tn->wheel_next = slot[0] ;
+	if ( slot[0] != NULL ) {
+		slot[0]->wheel_prev = tn ;
+	}
+	slot[0] = tn ;
+}
 
-	// set up "old" cache times
-	cache.time_retired = NOW_TIME;
-	cache.time_to_kill = cache.time_retired + cache.retired_lifespan;
+static void WheelRemove( struct cache_shard * shard, struct tree_node * tn )
+{
+	if ( shard->purge_next == tn ) {
+		// keep the unfinished purge walk on the list
+		shard->purge_next = tn->wheel_next ;
+	}
+	if ( tn->wheel_prev != NULL ) {
+		tn->wheel_prev->wheel_next = tn->wheel_next ;
+	} else {
+		shard->wheel[ tn->expires % CACHE_WHEEL_SLOTS ] = tn->wheel_next ;
+	}
+	if ( tn->wheel_next != NULL ) {
+		tn->wheel_next->wheel_prev = tn->wheel_prev ;
+	}
+}
+
+/* Same for the alias->bus trees, called with CACHE_WLOCK */
+static void FlipAliasTree( void )
+{
+	void * flip_alias = cache.temporary_alias_tree_old; // old old saved for later clearing
+
+	cache.temporary_alias_tree_old = cache.temporary_alias_tree_new;
+	cache.old_alias_ram_size = cache.new_alias_ram_size;
+	cache.temporary_alias_tree_new = NULL;
+	cache.new_alias_ram_size = 0;
+	cache.alias_time_to_kill = NOW_TIME + cache.retired_lifespan;
 
-	// delete really old tree
-	LEVEL_DEBUG("flip cache. tdestroy() will be called.");
-	SAFETDESTROY( flip, owfree_func);
 	SAFETDESTROY( flip_alias, owfree_func);
-	STATLOCK;
-	++cache_flips;			/* statistics */
-	memcpy(&old_avg, &new_avg, sizeof(struct average));
-	AVERAGE_CLEAR(&new_avg);
-	STATUNLOCK;
+}
+
+/* CLOCK ring is circular and doubly linked, with new nodes placed just behind the hand */
+static void ClockAdd( struct cache_shard * shard, struct tree_node * tn )
+{
+	tn->referenced = 0 ;
+	if ( shard->hand == NULL ) {
+		tn->clock_next = tn->clock_prev = tn ;
+		shard->hand = tn ;
+	} else {
+		tn->clock_next = shard->hand ;
+		tn->clock_prev = shard->hand->clock_prev ;
+		tn->clock_prev->clock_next = tn ;
+		shard->hand->clock_prev = tn ;
+	}
+}
+
+static void ClockRemove( struct cache_shard * shard, struct tree_node * tn )
+{
+	if ( tn->clock_next == tn ) {
+		// last one
+		shard->hand = NULL ;
+		return ;
+	}
+	tn->clock_prev->clock_next = tn->clock_next ;
+	tn->clock_next->clock_prev = tn->clock_prev ;
+	if ( shard->hand == tn ) {
+		shard->hand = tn->clock_next ;
+	}
+}
+
+/* Free room for size more bytes in the shard */
+/* Sweep the clock hand: referenced entries get a second chance, others are evicted */
+/* Two turns of the hand are enough to clear every reference flag */
+/* Called with the shard write-locked */
+static GOOD_OR_BAD Cache_Make_Room( struct cache_shard * shard, size_t size )
+{
+	size_t limit = Globals.cache_size / CACHE_SHARDS ;
+	UINT steps = 2 * shard->items ;
+	UINT evicted = 0 ;
+	time_t now = NOW_TIME ;
+
+	if ( Globals.cache_size == 0 ) {
+		// no limit
+		return gbGOOD ;
+	}
+	if ( Globals.cache_policy == cache_policy_reject || size > limit ) {
+		// old way -- don't add when full
+		return ( shard->ram_size + size > limit ) ? gbBAD : gbGOOD ;
+	}
+
+	while ( shard->ram_size + size > limit && shard->hand != NULL && steps-- > 0 ) {
+		struct tree_node * tn = shard->hand ;
+		if ( tn->referenced && tn->expires > now ) {
+			// recently used -- second chance
+			tn->referenced = 0 ;
+			shard->hand = tn->clock_next ;
+		} else {
+			Cache_Remove_Node( shard, tn ) ; // moves hand
+			++evicted ;
+		}
+	}
+
+	if ( evicted > 0 ) {
+		STATLOCK;
+		cache_evictions += evicted ;
+		STATUNLOCK;
+	}
+	return ( shard->ram_size + size > limit ) ? gbBAD : gbGOOD ;
 }
 
 /* Clear the cache (a change was made that might give stale information) */
 void Cache_Clear(void)
 {
+	int shard_index ;
+
+	for ( shard_index = 0 ; shard_index < CACHE_SHARDS ; ++shard_index ) {
+		struct cache_shard * shard = &cache.shard[shard_index] ;
+		UINT items ;
+
+		SHARD_WLOCK(shard);
+		SAFETDESTROY( shard->temporary_tree, owslab_treefree);
+		memset( shard->wheel, 0, sizeof(shard->wheel) ) ;
+		shard->purge_next = NULL ;
+		shard->purge_resume = 0 ;
+		shard->hand = NULL ;
+		items = shard->items ;
+		shard->items = 0 ;
+		shard->ram_size = 0 ;
+		SHARD_WUNLOCK(shard);
+
+		StatGauge( &(stat_total.new_avg.current), -(int) items ) ;
+	}
 	CACHE_WLOCK;
-	FlipTree() ;
-	FlipTree() ;
+	FlipAliasTree() ;
+	FlipAliasTree() ;
 	CACHE_WUNLOCK;
+	STAT_ADD1(cache_flips);
 }
 
 /* Wrapper to perform a cache function and add statistics */
+/* scache is this thread's counters (STAT_THREAD) so no lock is needed */
 static GOOD_OR_BAD Add_Stat(struct cache_stats *scache, GOOD_OR_BAD result)
 {
 	if ( GOOD(result) ) {
-		STAT_ADD1(scache->adds);
+		++scache->adds;
 	}
 	return result;
 }
@@ -413,7 +756,7 @@ static GOOD_OR_BAD Cache_Add(const void *data, const size_t datasize, const stru
 	}
 
 	// allocate space for the node and data
-	tn = (struct tree_node *) owmalloc(sizeof(struct tree_node) + datasize);
+	tn = (struct tree_node *) owslab_malloc(sizeof(struct tree_node) + datasize);
 	if (!tn) {
 		return gbBAD;
 	}
@@ -428,8 +771,8 @@ static GOOD_OR_BAD Cache_Add(const void *data, const size_t datasize, const stru
 		memcpy(TREE_DATA(tn), data, datasize);
 	}
 	return persistent ?
-		Add_Stat(&cache_pst, Cache_Add_Persistent(tn)) :
-		Add_Stat(&cache_ext, Cache_Add_Common(tn)) ;
+		Add_Stat(&STAT_THREAD(cache_pst), Cache_Add_Persistent(tn)) :
+		Add_Stat(&STAT_THREAD(cache_ext), Cache_Add_Common(tn)) ;
 }
 
 /* Add a directory entry to the cache */
@@ -470,7 +813,7 @@ GOOD_OR_BAD Cache_Add_Dir(const struct dirblob *db, const struct parsedname *pn)
 	}
 	
 	// allocate space for the node and data
-	tn = (struct tree_node *) owmalloc(sizeof(struct tree_node) + size);
+	tn = (struct tree_node *) owslab_malloc(sizeof(struct tree_node) + size);
 	if (!tn) {
 		return gbBAD;
 	}
@@ -485,7 +828,7 @@ GOOD_OR_BAD Cache_Add_Dir(const struct dirblob *db, const struct parsedname *pn)
 	if (size) {
 		memcpy(TREE_DATA(tn), db->snlist, size);
 	}
-	return Add_Stat(&cache_dir, Cache_Add_Common(tn));
+	return Add_Stat(&STAT_THREAD(cache_dir), Cache_Add_Common(tn));
 }
 
 /* Add a Simultaneous entry to the cache */
@@ -508,7 +851,7 @@ GOOD_OR_BAD Cache_Add_Simul(const struct internal_prop *ip, const struct parsedn
 	
 	// allocate space for the node and data
 	LEVEL_DEBUG("Adding for conversion time for "SNformat, SNvar(pn->sn));
-	tn = (struct tree_node *) owmalloc(sizeof(struct tree_node));
+	tn = (struct tree_node *) owslab_malloc(sizeof(struct tree_node));
 	if (!tn) {
 		return gbBAD;
 	}
@@ -520,7 +863,7 @@ GOOD_OR_BAD Cache_Add_Simul(const struct internal_prop *ip, const struct parsedn
 	LEVEL_DEBUG("Simultaneous add type=%s",ip->name);
 	tn->expires = duration + NOW_TIME;
 	tn->dsize = 0;
-	return Add_Stat(&cache_dir, Cache_Add_Common(tn));
+	return Add_Stat(&STAT_THREAD(cache_dir), Cache_Add_Common(tn));
 }
 
 /* Add a device entry to the cache */
@@ -538,7 +881,7 @@ GOOD_OR_BAD Cache_Add_Device(const int bus_nr, const BYTE * sn)
 		return gbGOOD ;
 	}
 
-	tn = (struct tree_node *) owmalloc(sizeof(struct tree_node) + sizeof(int));
+	tn = (struct tree_node *) owslab_malloc(sizeof(struct tree_node) + sizeof(int));
 	if (!tn) {
 		return gbBAD;
 	}
@@ -548,7 +891,7 @@ GOOD_OR_BAD Cache_Add_Device(const int bus_nr, const BYTE * sn)
 	tn->expires = duration + NOW_TIME;
 	tn->dsize = sizeof(int);
 	memcpy(TREE_DATA(tn), &bus_nr, sizeof(int));
-	return Add_Stat(&cache_dev, Cache_Add_Common(tn));
+	return Add_Stat(&STAT_THREAD(cache_dev), Cache_Add_Common(tn));
 }
 
 /* What do we cache?
@@ -576,7 +919,7 @@ GOOD_OR_BAD Cache_Add_SlaveSpecific(const void *data, const size_t datasize, con
 		return gbGOOD;				/* in case timeout set to 0 */
 	}
 
-	tn = (struct tree_node *) owmalloc(sizeof(struct tree_node) + datasize);
+	tn = (struct tree_node *) owslab_malloc(sizeof(struct tree_node) + datasize);
 	if (!tn) {
 		return gbBAD;
 	}
@@ -592,9 +935,9 @@ GOOD_OR_BAD Cache_Add_SlaveSpecific(const void *data, const size_t datasize, con
 	//printf("  ADD INTERNAL data[0]=%d size=%d \n",((BYTE *)data)[0],datasize);
 	switch (ip->change) {
 	case fc_persistent:
-		return Add_Stat(&cache_pst, Cache_Add_Persistent(tn));
+		return Add_Stat(&STAT_THREAD(cache_pst), Cache_Add_Persistent(tn));
 	default:
-		return Add_Stat(&cache_int, Cache_Add_Common(tn));
+		return Add_Stat(&STAT_THREAD(cache_int), Cache_Add_Common(tn));
 	}
 }
 
@@ -604,12 +947,14 @@ GOOD_OR_BAD Cache_Add_Alias(const ASCII *name, const BYTE * sn)
 {
 	struct tree_node *tn;
 	size_t size = strlen(name) ;
+	int changed ;
+	GOOD_OR_BAD ret ;
 
 	if ( size == 0 ) {
 		return gbGOOD ;
 	}
 
-	tn = (struct tree_node *) owmalloc(sizeof(struct tree_node) + size + 1 );
+	tn = (struct tree_node *) owslab_malloc(sizeof(struct tree_node) + size + 1 );
 	if (!tn) {
 		return gbBAD;
 	}
@@ -619,8 +964,30 @@ GOOD_OR_BAD Cache_Add_Alias(const ASCII *name, const BYTE * sn)
 	tn->expires = NOW_TIME;
 	tn->dsize = size;
 	memcpy((ASCII *)TREE_DATA(tn), name, size+1 ); // includes NULL
+	changed = Cache_Alias_Changed( name, sn ) ;
 	Cache_Add_Alias_SN( name, sn ) ;
-	return Add_Stat(&cache_pst, Cache_Add_Persistent(tn));
+	ret = Add_Stat(&STAT_THREAD(cache_pst), Cache_Add_Persistent(tn));
+	if ( changed ) {
+		// cached parses may have used the old mapping
+		ParsedName_Cache_Invalidate() ;
+	}
+	return ret ;
+}
+
+/* Would name -> sn be new? (not just the same alias learned again, e.g. from a remote parse) */
+static int Cache_Alias_Changed(const ASCII *name, const BYTE * sn)
+{
+	BYTE alias_sn[SERIAL_NUMBER_SIZE] ;
+	ASCII * alias_name ;
+	int changed ;
+
+	if ( BAD( Cache_Get_Alias_SN( name, alias_sn ) ) || memcmp( alias_sn, sn, SERIAL_NUMBER_SIZE ) != 0 ) {
+		return 1 ;
+	}
+	alias_name = Cache_Get_Alias( sn ) ;
+	changed = ( alias_name == NULL ) || ( strcmp( alias_name, name ) != 0 ) ;
+	SAFEFREE( alias_name ) ;
+	return changed ;
 }
 
 /* Add an item to the cache */
@@ -629,45 +996,46 @@ GOOD_OR_BAD Cache_Add_Alias(const ASCII *name, const BYTE * sn)
 static GOOD_OR_BAD Cache_Add_Common(struct tree_node *tn)
 {
 	struct tree_opaque *opaque;
+	struct cache_shard *shard = CacheShard(tn);
 	enum { no_add, yes_add, just_update } state = no_add;
 
 	node_show(tn);
 	LEVEL_DEBUG("Add to cache sn " SNformat " pointer=%p index=%d size=%d", SNvar(tn->tk.sn), tn->tk.p, tn->tk.extension, tn->dsize);
-	CACHE_WLOCK;
-	if (cache.time_to_kill < NOW_TIME) {	// old database has timed out
-		FlipTree() ;
-	}
-	if (Globals.cache_size && (cache.old_ram_size + cache.new_ram_size > Globals.cache_size)) {
-		// failed size test
-		owfree(tn);
-	} else if ((opaque = tsearch(tn, &cache.temporary_tree_new, tree_compare))) {
+	SHARD_WLOCK(shard);
+	if ( BAD( Cache_Make_Room(shard, TREE_NODE_SIZE(tn)) ) ) {
+		// failed size test (each shard gets an equal part)
+		owslab_free(tn);
+	} else if ((opaque = tsearch(tn, &shard->temporary_tree, tree_compare))) {
 		//printf("Cache_Add_Common to %p\n",opaque);
 		if (tn != opaque->key) {
-			cache.new_ram_size += sizeof(tn) - sizeof(opaque->key);
-			owfree(opaque->key);
+			shard->ram_size += TREE_NODE_SIZE(tn) - TREE_NODE_SIZE(opaque->key);
+			WheelRemove(shard, opaque->key);
+			ClockRemove(shard, opaque->key);
+			owslab_free(opaque->key);
 			opaque->key = tn;
+			WheelAdd(shard, tn);
+			ClockAdd(shard, tn);
 			state = just_update;
 		} else {
 			state = yes_add;
-			cache.new_ram_size += sizeof(tn);
+			shard->ram_size += TREE_NODE_SIZE(tn);
+			++shard->items;
+			WheelAdd(shard, tn);
+			ClockAdd(shard, tn);
 		}
 	} else {					// nothing found or added?!? free our memory segment
-		owfree(tn);
+		owslab_free(tn);
 	}
-	CACHE_WUNLOCK;
+	SHARD_WUNLOCK(shard);
 	/* Added or updated, update statistics */
 	switch (state) {
 		case yes_add: // add new entry
-			STATLOCK;
-			AVERAGE_IN(&new_avg);
-			++cache_adds;			/* statistics */
-			STATUNLOCK;
+			STAT_AVERAGE_IN(new_avg);
+			STAT_THREAD_ADD1(cache_adds);	/* statistics */
 			return gbGOOD;
 		case just_update: // update the time mark and data
-			STATLOCK;
-			AVERAGE_MARK(&new_avg);
-			++cache_adds;			/* statistics */
-			STATUNLOCK;
+			STAT_AVERAGE_MARK(new_avg);
+			STAT_THREAD_ADD1(cache_adds);	/* statistics */
 			return gbGOOD;
 		default: // unable to add
 			return gbBAD;
@@ -688,27 +1056,23 @@ static GOOD_OR_BAD Cache_Add_Persistent(struct tree_node *tn)
 	if ( opaque != NULL ) {
 		//printf("CACHE ADD pointer=%p, key=%p\n",tn,opaque->key);
 		if (tn != opaque->key) {
-			owfree(opaque->key);
+			owslab_free(opaque->key);
 			opaque->key = tn;
 			state = just_update;
 		} else {
 			state = yes_add;
 		}
 	} else {					// nothing found or added?!? free our memory segment
-		owfree(tn);
+		owslab_free(tn);
 	}
 	PERSISTENT_WUNLOCK;
 
 	switch (state) {
 	case yes_add:
-		STATLOCK;
-		AVERAGE_IN(&store_avg);
-		STATUNLOCK;
+		STAT_AVERAGE_IN(store_avg);
 		return gbGOOD;
 	case just_update:
-		STATLOCK;
-		AVERAGE_MARK(&store_avg);
-		STATUNLOCK;
+		STAT_AVERAGE_MARK(store_avg);
 		return gbGOOD;
 	default:
 		return gbBAD;
@@ -718,8 +1082,17 @@ static GOOD_OR_BAD Cache_Add_Persistent(struct tree_node *tn)
 static GOOD_OR_BAD Get_Stat(struct cache_stats *scache, const enum cache_task_return result)
 {
 	GOOD_OR_BAD gbret = gbBAD ; // default
-	
-	STATLOCK;
+	struct stat_counters * counters = StatThread() ;
+	enum cache_policy policy = Globals.cache_policy ;
+
+	if ( scache != &(counters->cache_pst) ) {
+		// volatile cache -- also counted by replacement policy, to compare them
+		++counters->policy_tries[policy] ;
+		if ( result == ctr_ok ) {
+			++counters->policy_hits[policy] ;
+		}
+	}
+
 	++scache->tries;
 	switch ( result ) {
 		case ctr_expired:
@@ -732,7 +1105,6 @@ static GOOD_OR_BAD Get_Stat(struct cache_stats *scache, const enum cache_task_re
 		default:
 			break ;
 	}	
-	STATUNLOCK;
 	return gbret ;
 }
 
@@ -835,8 +1207,8 @@ GOOD_OR_BAD Cache_Get(void *data, size_t * dsize, const struct parsedname *pn)
 	LEVEL_DEBUG(SNformat " size=%d IsUncachedDir=%d", SNvar(pn->sn), (int) dsize[0], IsUncachedDir(pn));
 	LoadTK( pn->sn, pn->selected_filetype, pn->extension, &tn );
 	return persistent ?
-		Get_Stat(&cache_pst, Cache_Get_Persistent(data, dsize, &duration, &tn)) :
-		Get_Stat(&cache_ext, Cache_Get_Common(data, dsize, &duration, &tn));
+		Get_Stat(&STAT_THREAD(cache_pst), Cache_Get_Persistent(data, dsize, &duration, &tn)) :
+		Get_Stat(&STAT_THREAD(cache_ext), Cache_Get_Common(data, dsize, &duration, &tn));
 }
 
 /* Look in caches, 0=found and valid, 1=not or uncachable in the first place */
@@ -853,7 +1225,7 @@ GOOD_OR_BAD Cache_Get_Dir(struct dirblob *db, const struct parsedname *pn)
 	LEVEL_DEBUG("Looking for directory "SNformat, SNvar(pn->sn));
 	FS_LoadDirectoryOnly(&pn_directory, pn);
 	LoadTK( pn_directory.sn, Directory_Marker, pn->selected_connection->index, &tn) ;
-	return Get_Stat(&cache_dir, Cache_Get_Common_Dir(db, &duration, &tn));
+	return Get_Stat(&STAT_THREAD(cache_dir), Cache_Get_Common_Dir(db, &duration, &tn));
 }
 
 /* Look in caches, 0=found and valid, 1=not or uncachable in the first place */
@@ -863,20 +1235,15 @@ static enum cache_task_return Cache_Get_Common_Dir(struct dirblob *db, time_t *
 	time_t now = NOW_TIME;
 	size_t size;
 	struct tree_opaque *opaque;
+	struct cache_shard *shard = CacheShard(tn);
 	LEVEL_DEBUG("Get from cache sn " SNformat " pointer=%p extension=%d", SNvar(tn->tk.sn), tn->tk.p, tn->tk.extension);
-	CACHE_RLOCK;
-	opaque = tfind(tn, &cache.temporary_tree_new, tree_compare) ;
-	if ( opaque == NULL ) {
-		// not found in new tree
-		if ( cache.time_retired + duration[0] > now ) {
-			// old tree could be new enough
-			opaque = tfind(tn, &cache.temporary_tree_old, tree_compare) ;
-		}
-	}
+	SHARD_RLOCK(shard);
+	opaque = tfind(tn, &shard->temporary_tree, tree_compare) ;
 	if ( opaque != NULL ) {
 		duration[0] = opaque->key->expires - now ;
 		if (duration[0] >= 0) {
 			LEVEL_DEBUG("Dir found in cache");
+			CLOCK_REFERENCE( opaque->key ) ; // only ever set to 1 by readers
 			size = opaque->key->dsize;
 			if (DirblobRecreate(TREE_DATA(opaque->key), size, db) == 0) {
 				//printf("Cache: snlist=%p, devices=%lu, size=%lu\n",*snlist,devices[0],size) ;
@@ -895,7 +1262,7 @@ static enum cache_task_return Cache_Get_Common_Dir(struct dirblob *db, time_t *
 		LEVEL_DEBUG("Dir not found in cache");
 		ctr_ret = ctr_not_found;
 	}
-	CACHE_RUNLOCK;
+	SHARD_RUNLOCK(shard);
 	return ctr_ret;
 }
 
@@ -911,7 +1278,7 @@ GOOD_OR_BAD Cache_Get_Device(void *bus_nr, const struct parsedname *pn)
 
 	LEVEL_DEBUG("Looking for device "SNformat, SNvar(pn->sn));
 	LoadTK( pn->sn, Device_Marker, 0, &tn ) ;
-	return Get_Stat(&cache_dev, Cache_Get_Common(bus_nr, &size, &duration, &tn));
+	return Get_Stat(&STAT_THREAD(cache_dev), Cache_Get_Common(bus_nr, &size, &duration, &tn));
 }
 
 /* Does cache get, but doesn't allow play in data size */
@@ -942,9 +1309,9 @@ static GOOD_OR_BAD Cache_Get_Internal(void *data, size_t * dsize, const struct i
 	LoadTK( pn->sn, ip->name, EXTENSION_INTERNAL, &tn) ;
 	switch (ip->change) {
 		case fc_persistent:
-			return Get_Stat(&cache_pst, Cache_Get_Persistent(data, dsize, &duration, &tn));
+			return Get_Stat(&STAT_THREAD(cache_pst), Cache_Get_Persistent(data, dsize, &duration, &tn));
 		default:
-			return Get_Stat(&cache_int, Cache_Get_Common(data, dsize, &duration, &tn));
+			return Get_Stat(&STAT_THREAD(cache_int), Cache_Get_Common(data, dsize, &duration, &tn));
 	}
 }
 
@@ -971,7 +1338,7 @@ GOOD_OR_BAD Cache_Get_Simul_Time(const struct internal_prop *ip, time_t * dwell_
 	
 	FS_LoadDirectoryOnly(&pn_directory, pn);
 	LoadTK(pn_directory.sn, ip->name, 0, &tn ) ;
-	if ( Get_Stat(&cache_int, Cache_Get_Common(NULL, &dsize_simul, &duration, &tn)) ) {
+	if ( Get_Stat(&STAT_THREAD(cache_int), Cache_Get_Common(NULL, &dsize_simul, &duration, &tn)) ) {
 		return gbBAD ;
 	}
 	// duration_simul is time left
@@ -1002,7 +1369,7 @@ static GOOD_OR_BAD Cache_Get_Simultaneous(const struct internal_prop *ip, struct
 	
 	LoadTK( pn->sn, pn->selected_filetype, pn->extension, &tn ) ;
 	
-	if ( Get_Stat(&cache_ext, Cache_Get_Common( &OWQ_val(owq), &dsize, &time_left, &tn)) == 0 ) {
+	if ( Get_Stat(&STAT_THREAD(cache_ext), Cache_Get_Common( &OWQ_val(owq), &dsize, &time_left, &tn)) == 0 ) {
 		// valid cached primary data -- see if a simultaneous conversion should be used instead
 		time_t dwell_time_data = duration - time_left ;
 		
@@ -1066,19 +1433,13 @@ static enum cache_task_return Cache_Get_Common(void *data, size_t * dsize, time_
 	enum cache_task_return ctr_ret;
 	time_t now = NOW_TIME;
 	struct tree_opaque *opaque;
+	struct cache_shard *shard = CacheShard(tn);
 	
 	LEVEL_DEBUG("Search in cache sn " SNformat " pointer=%p index=%d size=%d", SNvar(tn->tk.sn), tn->tk.p, tn->tk.extension, (int) dsize[0]);
 	//node_show(tn);
 	//new_tree();
-	CACHE_RLOCK;
-	opaque = tfind(tn, &cache.temporary_tree_new, tree_compare) ;
-	if ( opaque == NULL ) {
-		// not found in new tree
-		if ( cache.time_retired + duration[0] > now ) {
-			// retired time isn't too old for this data item
-			opaque = tfind(tn, &cache.temporary_tree_old, tree_compare) ;
-		}
-	}
+	SHARD_RLOCK(shard);
+	opaque = tfind(tn, &shard->temporary_tree, tree_compare) ;
 	if ( opaque != NULL ) {
 		// modify duration to time left (can be negative if expired)
 		duration[0] = opaque->key->expires - now ;
@@ -1086,6 +1447,7 @@ static enum cache_task_return Cache_Get_Common(void *data, size_t * dsize, time_
 			LEVEL_DEBUG("Value found in cache. Remaining life: %d seconds.",duration[0]);
 			// Compared with >= before, but fc_second(1) always cache for 2 seconds in that case.
 			// Very noticable when reading time-data like "/26.80A742000000/date" for example.
+			CLOCK_REFERENCE( opaque->key ) ; // only ever set to 1 by readers
 			if ( dsize[0] >= opaque->key->dsize) {
 				// lower data size if stored value is shorter
 				dsize[0] = opaque->key->dsize;
@@ -1094,7 +1456,7 @@ static enum cache_task_return Cache_Get_Common(void *data, size_t * dsize, time_
 					memcpy(data, TREE_DATA(opaque->key), dsize[0]);
 				}
 				ctr_ret = ctr_ok;
-				//twalk(cache.temporary_tree_new,tree_show) ;
+				//twalk(shard->temporary_tree,tree_show) ;
 			} else {
 				ctr_ret = ctr_size_mismatch;
 			}
@@ -1106,7 +1468,7 @@ static enum cache_task_return Cache_Get_Common(void *data, size_t * dsize, time_
 		LEVEL_DEBUG("Value not found in cache");
 		ctr_ret = ctr_not_found;
 	}
-	CACHE_RUNLOCK;
+	SHARD_RUNLOCK(shard);
 	return ctr_ret;
 }
 
@@ -1138,7 +1500,7 @@ static enum cache_task_return Cache_Get_Persistent(void *data, size_t * dsize, t
 static void Del_Stat(struct cache_stats *scache, const int result)
 {
 	if ( GOOD( result)) {
-		STAT_ADD1(scache->deletes);
+		++scache->deletes;
 	}
 }
 
@@ -1202,16 +1564,18 @@ void Cache_Del_Alias(const BYTE * sn)
 
 	LEVEL_DEBUG("Deleting alias %s from "SNformat, alias_name, SNvar(sn)) ;
 	size = strlen( alias_name ) ;
-	tn = (struct tree_node *) owmalloc(sizeof(struct tree_node) + size + 1 );
+	tn = (struct tree_node *) owslab_malloc(sizeof(struct tree_node) + size + 1 );
 	if ( tn != NULL ) {
 		tn->expires = NOW_TIME;
 		tn->dsize = size;
 		memcpy((ASCII *)TREE_DATA(tn), alias_name, size+1); // includes NULL
 		LoadTK( sn, Alias_Marker, 0, tn ) ;
-		Del_Stat(&cache_pst, Cache_Del_Persistent(tn));
+		Del_Stat(&STAT_THREAD(cache_pst), Cache_Del_Persistent(tn));
 		Cache_Del_Alias_SN( alias_name ) ;
+		owslab_free( tn ) ;
 	}
 	owfree( alias_name ) ;
+	ParsedName_Cache_Invalidate() ;
 }
 
 static void Cache_Del(const struct parsedname *pn)
@@ -1233,10 +1597,10 @@ static void Cache_Del(const struct parsedname *pn)
 	LoadTK( pn->sn, pn->selected_filetype, pn->extension, &tn ) ;
 	switch (pn->selected_filetype->change) {
 		case fc_persistent:
-			Del_Stat(&cache_pst, Cache_Del_Persistent(&tn));
+			Del_Stat(&STAT_THREAD(cache_pst), Cache_Del_Persistent(&tn));
 			break ;
 		default:
-			Del_Stat(&cache_ext, Cache_Del_Common(&tn));
+			Del_Stat(&STAT_THREAD(cache_ext), Cache_Del_Common(&tn));
 			break ;
 	}
 }
@@ -1261,10 +1625,10 @@ void Cache_Del_Mixed_Individual(const struct parsedname *pn)
 	for ( tn.tk.extension = pn->selected_filetype->ag->elements-1 ; tn.tk.extension >= 0 ; --tn.tk.extension ) {
 		switch (pn->selected_filetype->change) {
 			case fc_persistent:
-				Del_Stat(&cache_pst, Cache_Del_Persistent(&tn));
+				Del_Stat(&STAT_THREAD(cache_pst), Cache_Del_Persistent(&tn));
 				break ;
 			default:
-				Del_Stat(&cache_ext, Cache_Del_Common(&tn));
+				Del_Stat(&STAT_THREAD(cache_ext), Cache_Del_Common(&tn));
 				break ;
 		}
 	}
@@ -1289,10 +1653,10 @@ void Cache_Del_Mixed_Aggregate(const struct parsedname *pn)
 	LoadTK( pn->sn, pn->selected_filetype, EXTENSION_ALL, &tn) ;
 	switch (pn->selected_filetype->change) {
 		case fc_persistent:
-			Del_Stat(&cache_pst, Cache_Del_Persistent(&tn));
+			Del_Stat(&STAT_THREAD(cache_pst), Cache_Del_Persistent(&tn));
 			break ;
 		default:
-			Del_Stat(&cache_ext, Cache_Del_Common(&tn));
+			Del_Stat(&STAT_THREAD(cache_ext), Cache_Del_Common(&tn));
 			break ;
 	}
 }
@@ -1304,7 +1668,7 @@ void Cache_Del_Dir(const struct parsedname *pn)
 	
 	FS_LoadDirectoryOnly(&pn_directory, pn);
 	LoadTK( pn_directory.sn, Directory_Marker, pn->selected_connection->index, &tn ) ;
-	Del_Stat(&cache_dir, Cache_Del_Common(&tn));
+	Del_Stat(&STAT_THREAD(cache_dir), Cache_Del_Common(&tn));
 }
 
 void Cache_Del_Simul(const struct internal_prop *ip, const struct parsedname *pn)
@@ -1314,7 +1678,7 @@ void Cache_Del_Simul(const struct internal_prop *ip, const struct parsedname *pn
 	
 	FS_LoadDirectoryOnly(&pn_directory, pn);
 	LoadTK(pn_directory.sn, ip->name, 0, &tn );
-	Del_Stat(&cache_dir, Cache_Del_Common(&tn));
+	Del_Stat(&STAT_THREAD(cache_dir), Cache_Del_Common(&tn));
 }
 
 void Cache_Del_Device(const struct parsedname *pn)
@@ -1326,7 +1690,7 @@ void Cache_Del_Device(const struct parsedname *pn)
 	}
 
 	LoadTK(pn->sn, Device_Marker, 0, &tn) ;
-	Del_Stat(&cache_dev, Cache_Del_Common(&tn));
+	Del_Stat(&STAT_THREAD(cache_dev), Cache_Del_Common(&tn));
 }
 
 void Cache_Del_Internal(const struct internal_prop *ip, const struct parsedname *pn)
@@ -1346,10 +1710,10 @@ void Cache_Del_Internal(const struct internal_prop *ip, const struct parsedname
 	LoadTK(pn->sn, ip->name, 0, &tn);
 	switch (ip->change) {
 	case fc_persistent:
-		Del_Stat(&cache_pst, Cache_Del_Persistent(&tn));
+		Del_Stat(&STAT_THREAD(cache_pst), Cache_Del_Persistent(&tn));
 		break;
 	default:
-		Del_Stat(&cache_int, Cache_Del_Common(&tn));
+		Del_Stat(&STAT_THREAD(cache_int), Cache_Del_Common(&tn));
 		break;
 	}
 }
@@ -1357,24 +1721,17 @@ void Cache_Del_Internal(const struct internal_prop *ip, const struct parsedname
 static GOOD_OR_BAD Cache_Del_Common(const struct tree_node *tn)
 {
 	struct tree_opaque *opaque;
-	time_t now = NOW_TIME;
+	struct cache_shard *shard = CacheShard(tn);
 	GOOD_OR_BAD ret = gbBAD;
 	LEVEL_DEBUG("Delete from cache sn " SNformat " in=%p index=%d", SNvar(tn->tk.sn), tn->tk.p, tn->tk.extension);
 
-	CACHE_WLOCK;
-	opaque = tfind(tn, &cache.temporary_tree_new, tree_compare) ;
-	if ( opaque == NULL ) {
-		// not in new tree
-		if ( cache.time_to_kill > now ) {
-			// old tree still alive
-			opaque = tfind(tn, &cache.temporary_tree_old, tree_compare) ;
-		}
-	}
+	SHARD_WLOCK(shard);
+	opaque = tfind(tn, &shard->temporary_tree, tree_compare) ;
 	if ( opaque != NULL ) {
-		opaque->key->expires = now - 1;
+		Cache_Remove_Node( shard, opaque->key ) ;
 		ret = gbGOOD;
 	}
-	CACHE_WUNLOCK;
+	SHARD_WUNLOCK(shard);
 
 	return ret;
 }
@@ -1396,10 +1753,8 @@ static GOOD_OR_BAD Cache_Del_Persistent(const struct tree_node *tn)
 		return gbBAD;
 	}
 
-	owfree(tn_found);
-	STATLOCK;
-	AVERAGE_OUT(&store_avg);
-	STATUNLOCK;
+	owslab_free(tn_found);
+	STAT_AVERAGE_OUT(store_avg);
 	return gbGOOD;
 }
 
@@ -1491,19 +1846,19 @@ static void Cache_Add_Alias_Common(struct alias_tree_node *atn)
 	struct tree_opaque *opaque;
 
 	CACHE_WLOCK;
-	if (cache.time_to_kill < NOW_TIME) {	// old database has timed out
-		FlipTree() ;
+	if (cache.alias_time_to_kill < NOW_TIME) {	// old database has timed out
+		FlipAliasTree() ;
 	}
-	if (Globals.cache_size && (cache.old_ram_size + cache.new_ram_size > Globals.cache_size)) {
-		// failed size test
+	if (Globals.cache_size && (cache.old_alias_ram_size + cache.new_alias_ram_size > Globals.cache_size / CACHE_SHARDS)) {
+		// failed size test (same share as a value shard)
 		owfree(atn);
 	} else if ((opaque = tsearch(atn, &cache.temporary_alias_tree_new, alias_tree_compare))) {
 		if ( (void *)atn != (void *) (opaque->key) ) {
-			cache.new_ram_size += sizeof(atn) - sizeof(opaque->key);
+			cache.new_alias_ram_size += ALIAS_TREE_NODE_SIZE(atn) - ALIAS_TREE_NODE_SIZE((struct alias_tree_node *) opaque->key);
 			owfree(opaque->key);
 			opaque->key = (void *) atn;
 		} else {
-			cache.new_ram_size += sizeof(atn);
+			cache.new_alias_ram_size += ALIAS_TREE_NODE_SIZE(atn);
 		}
 	} else {					// nothing found or added?!? free our memory segment
 		owfree(atn);
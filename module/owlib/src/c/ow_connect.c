@@ -121,6 +121,9 @@ static struct connection_in *AllocIn(const struct connection_in *old_in)
 		new_in->index = Inbound_Control.next_index++;
 		_MUTEX_INIT(new_in->bus_mutex);
 		_MUTEX_INIT(new_in->dev_mutex);
+		Transaction_queue_init(new_in);
+		_MUTEX_INIT(new_in->read_flight_mutex);
+		new_in->read_flights = NULL;
 		new_in->dev_db = NULL;
 	} else {
 		LEVEL_DEFAULT("Cannot allocate memory for bus master structure");
@@ -181,6 +184,7 @@ struct port_in *LinkPort(struct port_in *pin)
 		Inbound_Control.head_port = pin ;
 
 		_MUTEX_INIT(pin->port_mutex);
+		ParsedName_Cache_Invalidate() ;
 	}
 	return pin;
 }
@@ -212,6 +216,9 @@ void RemoveIn( struct connection_in * conn )
 	 * and what-not that expects the conn to be kept setup. */
 	BUS_close(conn) ;
 
+	/* Cached parses may point at this bus */
+	ParsedName_Cache_Invalidate() ;
+
 	// owning port
 	pin = conn->pown ;
 
@@ -244,6 +251,8 @@ void RemoveIn( struct connection_in * conn )
 	/* Now free up thread-sync resources */
 	_MUTEX_DESTROY(conn->bus_mutex);
 	_MUTEX_DESTROY(conn->dev_mutex);
+	Transaction_queue_destroy(conn);
+	_MUTEX_DESTROY(conn->read_flight_mutex);
 	SAFETDESTROY( conn->dev_db, owfree_func);
 
 	/* Free port */
@@ -312,6 +321,7 @@ struct connection_in * AddtoPort( struct port_in * pin )
 
 	add_in->channel = pin->connections ;
 	++pin->connections ;
+	ParsedName_Cache_Invalidate() ;
 
 	return add_in ;
 }
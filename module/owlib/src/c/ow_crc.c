@@ -74,12 +74,10 @@ BYTE CRC8(const BYTE * bytes, const size_t length)
 BYTE CRC8seeded(const BYTE * bytes, const size_t length, const UINT seed)
 {
 	BYTE r = CRC8compute(bytes, length, seed);
-	STATLOCK;
-	++CRC8_tries;				/* statistics */
+	STAT_THREAD_ADD1(CRC8_tries);	/* statistics */
 	if (r) {
-		++CRC8_errors;			/* statistics */
+		STAT_THREAD_ADD1(CRC8_errors);	/* statistics */
 	}
-	STATUNLOCK;
 	return r;
 }
 
@@ -114,14 +112,12 @@ int CRC16seeded(const BYTE * bytes, const size_t length, const UINT seed)
 	uint16_t crc = CRC16compute(bytes, length, seed);
 	int ret;
 
-	STATLOCK;
-	++CRC16_tries;				/* statistics */
+	STAT_THREAD_ADD1(CRC16_tries);	/* statistics */
 	if (crc == 0xB001) {
 		ret = 0;				/* good */
 	} else {
 		ret = -1;				/* error */
-		++CRC16_errors;			/* statistics */
+		STAT_THREAD_ADD1(CRC16_errors);	/* statistics */
 	}
-	STATUNLOCK;
 	return ret;
 }
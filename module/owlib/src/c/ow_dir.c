@@ -38,6 +38,9 @@ static void FS_alarm_entry(void (*dirfunc) (void *, const struct parsedname *),
 static void FS_simultaneous_entry(void (*dirfunc) (void *, const struct parsedname *), void *v, const struct parsedname *pn_root_directory);
 static void FS_uncached_dir(void (*dirfunc) (void *, const struct parsedname *), void *v, const struct parsedname *pn_root_directory);
 static ZERO_OR_ERROR FS_dir_plus(void (*dirfunc) (void *, const struct parsedname *), void *v, uint32_t * flags, const struct parsedname *pn_directory, const char *file) ;
+static ZERO_OR_ERROR FS_dir_device(void (*dirfunc) (void *, const struct parsedname *), void *v, uint32_t * flags, const struct parsedname *pn_directory, const BYTE * sn) ;
+static int FS_dir_property(void (*dirfunc) (void *, const struct parsedname *), void *v, const struct parsedname *pn_device_directory, struct filetype * ft, int extension) ;
+static int FS_dir_show(void (*dirfunc) (void *, const struct parsedname *), void *v, uint32_t * flags, struct parsedname *pn_entry) ;
 
 /* Calls dirfunc() for each element in directory */
 /* void * data is arbitrary user data passed along -- e.g. output file descriptor */
@@ -103,10 +106,8 @@ static ZERO_OR_ERROR FS_dir_both(void (*dirfunc) (void *, const struct parsednam
 	
 	LEVEL_CALL("path=%s", SAFESTRING(pn_raw_directory->path));
 
-	STATLOCK;
-	AVERAGE_IN(&dir_avg);
-	AVERAGE_IN(&all_avg);
-	STATUNLOCK;
+	STAT_AVERAGE_IN(dir_avg);
+	STAT_AVERAGE_IN(all_avg);
 
 	FSTATLOCK;
 	StateInfo.dir_time = NOW_TIME;	// protected by mutex
@@ -191,10 +192,8 @@ static ZERO_OR_ERROR FS_dir_both(void (*dirfunc) (void *, const struct parsednam
 
 	}
 
-	STATLOCK;
-	AVERAGE_OUT(&dir_avg);
-	AVERAGE_OUT(&all_avg);
-	STATUNLOCK;
+	STAT_AVERAGE_OUT(dir_avg);
+	STAT_AVERAGE_OUT(all_avg);
 
 	LEVEL_DEBUG("ret=%d", ret);
 	return ret;
@@ -246,107 +245,146 @@ static void FS_simultaneous_entry(void (*dirfunc) (void *, const struct parsedna
 /* path is the path which "pn_directory" parses */
 /* FS_dir_all_connections produces the data that can vary: device lists, etc. */
 
+/* Entries from ports listed in parallel are passed on one at a time,
+ * so dirfunc needn't be thread-safe */
+struct dir_all_connections_serial {
+	pthread_mutex_t mutex ;
+	void (*dirfunc) (void *, const struct parsedname *);
+	void *v;
+};
+
+static void FS_dir_all_connections_serial( void * v, const struct parsedname * pn_entry )
+{
+	struct dir_all_connections_serial * dacserial = v ;
+
+	_MUTEX_LOCK( dacserial->mutex ) ;
+	dacserial->dirfunc( dacserial->v, pn_entry ) ;
+	_MUTEX_UNLOCK( dacserial->mutex ) ;
+}
+
+/* One task per port -- ports are listed in parallel, a port's channels in turn */
 struct dir_all_connections_struct {
 	struct port_in * pin ;
-	struct connection_in * cin ;
 	struct parsedname pn_directory;
 	void (*dirfunc) (void *, const struct parsedname *);
 	void *v;
 	uint32_t flags;
-	ZERO_OR_ERROR ret;
+	int good ; // channels listed
+	ZERO_OR_ERROR ret; // first error
 };
 
-/* Embedded function */
-/* Directory on a particular port's channel */
-static void FS_dir_all_connections_callback_conn( struct dir_all_connections_struct * dacs )
+/* Count this bus listing in the latency histogram */
+static void FS_dir_bus_latency( const struct timeval * start )
 {
-	if ( dacs->cin == NO_CONNECTION ) {
-		return ;
+	struct timeval now ;
+	long elapsed_ms ;
+	int bucket = 0 ;
+	long limit_ms ;
+
+	timernow( &now ) ;
+	timersub( &now, start, &now ) ;
+	elapsed_ms = now.tv_sec * 1000 + now.tv_usec / 1000 ;
+	for ( limit_ms = 1 ; bucket < DIR_LATENCY_BUCKETS - 1 && elapsed_ms >= limit_ms ; limit_ms *= 10 ) {
+		++bucket ;
 	}
+	STAT_THREAD_ADD1(dir_bus_latency[bucket]) ;
+}
 
-	SetKnownBus(dacs->cin->index, &(dacs->pn_directory) );
+/* Directory on a particular port's channel */
+static ZERO_OR_ERROR FS_dir_all_connections_conn( struct connection_in * cin, struct dir_all_connections_struct * dacs )
+{
+	SetKnownBus(cin->index, &(dacs->pn_directory) );
 
 	if ( BAD(TestConnection( &(dacs->pn_directory) )) ) {	// reconnect ok?
-		dacs->ret = -ECONNABORTED;
+		return -ECONNABORTED;
 	} else if (BusIsServer(dacs->pn_directory.selected_connection)) {	/* is this a remote bus? */
-		//printf("FS_dir_all_connections: Call ServerDir %s\n", dacs->pn_directory->path);
-		dacs->ret = ServerDir(dacs->dirfunc, dacs->v, &(dacs->pn_directory), &(dacs->flags));
+		return ServerDir(dacs->dirfunc, dacs->v, &(dacs->pn_directory), &(dacs->flags));
 	} else if (IsAlarmDir( &(dacs->pn_directory) ) ) {	/* root or branch directory -- alarm state */
-		//printf("FS_dir_all_connections: Call FS_alarmdir %s\n", dacs->pn_directory->path);
-		dacs->ret = FS_alarmdir(dacs->dirfunc, dacs->v, &(dacs->pn_directory) );
-	} else {
-		dacs->ret = FS_cache_or_real(dacs->dirfunc, dacs->v, &(dacs->pn_directory), &(dacs->flags));
+		return FS_alarmdir(dacs->dirfunc, dacs->v, &(dacs->pn_directory) );
 	}
-	
-	// next channel
-	dacs->cin = dacs->cin->next ;
-	FS_dir_all_connections_callback_conn( dacs ) ;
+	return FS_cache_or_real(dacs->dirfunc, dacs->v, &(dacs->pn_directory), &(dacs->flags));
 }
 
-/* Callback (thread) once per port */
-/* Will need  to probe each connection (channel) on this port */
-static void *FS_dir_all_connections_callback_port(void *v)
+/* Task (pool thread or caller) once per port */
+static void FS_dir_all_connections_port( void * v )
 {
 	struct dir_all_connections_struct *dacs = v;
-	struct dir_all_connections_struct dacs_next ;
-	pthread_t thread;
-	int threadbad = 0;
-	
-	if ( dacs->pin == NULL ) {
-		return VOID_RETURN;
-	}
+	struct connection_in * cin ;
 
-	// set up structure
-	dacs_next.pin = dacs->pin->next ;
+	for ( cin = dacs->pin->first ; cin != NO_CONNECTION ; cin = cin->next ) {
+		struct timeval start ;
+		ZERO_OR_ERROR ret ;
 
-	if ( dacs_next.pin == NULL ) {
-		threadbad = 1 ;
-	} else {
-		dacs_next.dirfunc = dacs->dirfunc ;
-		memcpy( &(dacs_next.pn_directory), &(dacs->pn_directory), sizeof(struct parsedname));	// shallow copy
-		dacs_next.v = dacs->v ;
-		dacs_next.flags = dacs->flags ;
-		dacs_next.ret = dacs->ret ;
-		threadbad = pthread_create(&thread, DEFAULT_THREAD_ATTR, FS_dir_all_connections_callback_port, (void *) (&dacs_next));
-	}
+		timernow( &start ) ;
+		STAT_AVERAGE_IN(dir_bus_avg);
+		ret = FS_dir_all_connections_conn( cin, dacs ) ;
+		STAT_AVERAGE_OUT(dir_bus_avg);
+		FS_dir_bus_latency( &start ) ;
 
-	// First channel
-	dacs->cin = dacs->pin->first ;
-	FS_dir_all_connections_callback_conn( v ) ;
-		
-	//printf("FS_dir_all_connections4 pid=%ld adapter=%d ret=%d\n",pthread_self(), dacs->pn_directory->selected_connection->index,ret);
-	/* See if next bus was also queried */
-	if (threadbad == 0) {		/* was a thread created? */
-		if (pthread_join(thread, NULL)!= 0) {
-			return VOID_RETURN ;			/* cannot join, so return only this result */
+		if ( ret == 0 ) {
+			++dacs->good ;
+		} else if ( dacs->ret == 0 ) {
+			dacs->ret = ret ;
 		}
-		if (dacs_next.ret >= 0) {
-			dacs->ret = dacs_next.ret;	/* is it an error return? Then return this one */
-		} else {
-			dacs->flags |= dacs_next.flags ;
-		}		
 	}
-	return VOID_RETURN;
 }
 
+/* Lists every bus, in parallel on the task pool.
+ * Succeeds if any bus could be listed, else returns the first error. */
 static ZERO_OR_ERROR
 FS_dir_all_connections(void (*dirfunc) (void *, const struct parsedname *), void *v, const struct parsedname *pn_directory, uint32_t * flags)
 {
-	struct dir_all_connections_struct dacs ;
-		
-	// set up structure
-	dacs.pin = Inbound_Control.head_port ; 
-	dacs.dirfunc = dirfunc ;
-	memcpy( &(dacs.pn_directory), pn_directory, sizeof(struct parsedname));	// shallow copy
-	dacs.v = v ;
-	dacs.flags = 0 ;
-	dacs.ret = 0 ;
+	struct dir_all_connections_struct * dacs ;
+	struct dir_all_connections_serial dacserial ;
+	struct port_in * pin ;
+	int ports = 0 ;
+	int port_index ;
+	int good = 0 ;
+	ZERO_OR_ERROR ret = 0 ;
+
+	for ( pin = Inbound_Control.head_port ; pin != NULL ; pin = pin->next ) {
+		++ports ;
+	}
+	*flags = 0 ;
+	if ( ports == 0 ) {
+		return 0 ;
+	}
+
+	dacs = owcalloc( ports, sizeof(struct dir_all_connections_struct) ) ;
+	if ( dacs == NULL ) {
+		return -ENOMEM ;
+	}
+	if ( ports > 1 ) {
+		_MUTEX_INIT( dacserial.mutex ) ;
+		dacserial.dirfunc = dirfunc ;
+		dacserial.v = v ;
+		dirfunc = FS_dir_all_connections_serial ;
+		v = &dacserial ;
+	}
 	
-	// Start iterating through buses
-	FS_dir_all_connections_callback_port(  (void *) (& dacs) ) ;
+	// set up one task per port
+	for ( pin = Inbound_Control.head_port, port_index = 0 ; pin != NULL ; pin = pin->next, ++port_index ) {
+		dacs[port_index].pin = pin ;
+		dacs[port_index].dirfunc = dirfunc ;
+		memcpy( &(dacs[port_index].pn_directory), pn_directory, sizeof(struct parsedname));	// shallow copy
+		dacs[port_index].v = v ;
+	}
+
+	TaskPool_Run( FS_dir_all_connections_port, dacs, sizeof(struct dir_all_connections_struct), ports ) ;
+
+	for ( port_index = 0 ; port_index < ports ; ++port_index ) {
+		*flags |= dacs[port_index].flags ;
+		good += dacs[port_index].good ;
+		if ( ret == 0 ) {
+			ret = dacs[port_index].ret ;
+		}
+	}
+	owfree( dacs ) ;
+	if ( ports > 1 ) {
+		_MUTEX_DESTROY( dacserial.mutex ) ;
+	}
 	
-	*flags = dacs.flags ;	
-	return dacs.ret ;
+	return good > 0 ? 0 : ret ;
 }
 
 /* Device directory (i.e. show the properties) -- all from memory */
@@ -358,9 +396,8 @@ static ZERO_OR_ERROR FS_devdir(void (*dirfunc) (void *, const struct parsedname
 	struct filetype *ft_pointer;	/* first filetype struct */
 	char subdir_name[OW_FULLNAME_MAX + 1];
 	size_t subdir_len;
-	uint32_t ignoreflag = 0;
 
-	STAT_ADD1(dir_dev.calls);
+	STAT_THREAD_ADD1(dir_dev.calls);
 
 	// Add subdir to name (SubDirectory is within a device, but an extra layer of grouping of properties)
 	if (pn_device_directory->subdir == NO_SUBDIR) {
@@ -392,59 +429,18 @@ static ZERO_OR_ERROR FS_devdir(void (*dirfunc) (void *, const struct parsedname
 		}
 
 		if (ft_pointer->ag==NON_AGGREGATE) {
-			FS_dir_plus(dirfunc, v, &ignoreflag, pn_device_directory, namepart);
-			STAT_ADD1(dir_dev.entries);
+			FS_dir_property(dirfunc, v, pn_device_directory, ft_pointer, 0);
+			STAT_THREAD_ADD1(dir_dev.entries);
 		} else if (ft_pointer->ag->combined==ag_sparse) {
-			struct parsedname s_pn_file_entry;
-			struct parsedname *pn_file_entry = &s_pn_file_entry;
-			
-			
-			if (ft_pointer->ag->letters==ag_letters) {
-				if (FS_ParsedNamePlusText(pn_device_directory->path, namepart, "xxx", pn_file_entry) == 0) {
-					pn_file_entry->extension = EXTENSION_UNKNOWN ; // unspecified (for owhttpd)
-					switch ( FS_visible(pn_file_entry) ) { // hide hidden properties
-						case visible_now :
-						case visible_always:
-							FS_dir_entry_aliased( dirfunc, v, pn_file_entry) ;
-							STAT_ADD1(dir_dev.entries);
-							break ;
-						default:
-							break ;
-					}
-					FS_ParsedName_destroy(pn_file_entry);
-				}
-			} else {
-				if (FS_ParsedNamePlusText(pn_device_directory->path, namepart, "000", pn_file_entry) == 0) {
-					pn_file_entry->extension = EXTENSION_UNKNOWN ; // unspecified (for owhttpd)
-					switch ( FS_visible(pn_file_entry) ) { // hide hidden properties
-						case visible_now :
-						case visible_always:
-							FS_dir_entry_aliased( dirfunc, v, pn_file_entry) ;
-							STAT_ADD1(dir_dev.entries);
-							break ;
-						default:
-							break ;
-					}
-					FS_ParsedName_destroy(pn_file_entry);
-				}
+			if ( FS_dir_property(dirfunc, v, pn_device_directory, ft_pointer, EXTENSION_UNKNOWN) ) {
+				STAT_THREAD_ADD1(dir_dev.entries);
 			}
 		} else {
 			int extension;
 			int first_extension = (ft_pointer->format == ft_bitfield) ? EXTENSION_BYTE : EXTENSION_ALL;
-			struct parsedname s_pn_file_entry;
-			struct parsedname *pn_file_entry = &s_pn_file_entry;
 			for (extension = first_extension; extension < ft_pointer->ag->elements; ++extension) {
-				if (FS_ParsedNamePlusExt(pn_device_directory->path, namepart, extension, ft_pointer->ag->letters, pn_file_entry) == 0) {
-					switch ( FS_visible(pn_file_entry) ) { // hide hidden properties
-						case visible_now :
-						case visible_always:
-							FS_dir_entry_aliased( dirfunc, v, pn_file_entry) ;
-							STAT_ADD1(dir_dev.entries);
-							break ;
-						default:
-							break ;
-					}
-					FS_ParsedName_destroy(pn_file_entry);
+				if ( FS_dir_property(dirfunc, v, pn_device_directory, ft_pointer, extension) ) {
+					STAT_THREAD_ADD1(dir_dev.entries);
 				}
 			}
 		}
@@ -568,15 +564,13 @@ static ZERO_OR_ERROR FS_alarmdir(void (*dirfunc) (void *, const struct parsednam
 	}
 
 	/* STATISCTICS */
-	STAT_ADD1(dir_main.calls);
+	STAT_THREAD_ADD1(dir_main.calls);
 
 	ret = PossiblyLockedBusCall( BUS_first_alarm, &ds, pn_alarm_directory) ;
 
 	while ( ret == search_good ) {
-		char dev[PROPERTY_LENGTH_ALIAS + 1];
-		STAT_ADD1(dir_main.entries);
-		FS_devicename(dev, PROPERTY_LENGTH_ALIAS, ds.sn, pn_alarm_directory);
-		FS_dir_plus(dirfunc, v, &ignoreflag, pn_alarm_directory, dev);
+		STAT_THREAD_ADD1(dir_main.entries);
+		FS_dir_device(dirfunc, v, &ignoreflag, pn_alarm_directory, ds.sn);
 
 		ret = PossiblyLockedBusCall( BUS_next, &ds, pn_alarm_directory) ;
 	}
@@ -629,7 +623,7 @@ static ZERO_OR_ERROR FS_realdir(void (*dirfunc) (void *, const struct parsedname
 	}
 
 	/* STATISTICS */
-	STAT_ADD1(dir_main.calls);
+	STAT_THREAD_ADD1(dir_main.calls);
 
 	DirblobInit(&db);			// set up a fresh dirblob
 
@@ -639,16 +633,11 @@ static ZERO_OR_ERROR FS_realdir(void (*dirfunc) (void *, const struct parsedname
 		db.allocated = pn_whole_directory->selected_connection->last_root_devs;	// root dir estimated length
 	}
 	while ( ret == search_good ) {
-		char dev[PROPERTY_LENGTH_ALIAS + 1];
-
 		/* Add to device cache */
 		Cache_Add_Device(pn_whole_directory->selected_connection->index,ds.sn) ;
 		
-		/* Get proper device name (including alias subst) */
-		FS_devicename(dev, PROPERTY_LENGTH_ALIAS, ds.sn, pn_whole_directory);
-		
 		/* Execute callback function */
-		if ( FS_dir_plus(dirfunc, v, flags, pn_whole_directory, dev) != 0 ) {
+		if ( FS_dir_device(dirfunc, v, flags, pn_whole_directory, ds.sn) != 0 ) {
 			DirblobPoison(&db);
 			break ;
 		}
@@ -658,9 +647,7 @@ static ZERO_OR_ERROR FS_realdir(void (*dirfunc) (void *, const struct parsedname
 		ret = PossiblyLockedBusCall( BUS_next, &ds, pn_whole_directory) ;
 	} 
 
-	STATLOCK;
-	dir_main.entries += devices;
-	STATUNLOCK;
+	STAT_THREAD_ADD(dir_main.entries, devices);
 
 	switch ( ret ) {
 		case search_done:
@@ -729,22 +716,15 @@ static ZERO_OR_ERROR FS_cache_or_real(void (*dirfunc) (void *, const struct pars
 	// Use cached version of directory
 
 	/* STATISTICS */
-	STAT_ADD1(dir_main.calls);
+	STAT_THREAD_ADD1(dir_main.calls);
 
 	/* Get directory from the cache */
 	for (dindex = 0; DirblobGet(dindex, sn, &db) == 0; ++dindex) {
-		char dev[PROPERTY_LENGTH_ALIAS + 1];
-
-		FS_devicename(dev, PROPERTY_LENGTH_ALIAS, sn, pn_real_directory);
-		FS_dir_plus(dirfunc, v, flags, pn_real_directory, dev);
+		FS_dir_device(dirfunc, v, flags, pn_real_directory, sn);
 	}
 	DirblobClear(&db);			/* allocated in Cache_Get_Dir */
 
-	STATLOCK;
-
-	dir_main.entries += dindex;
-
-	STATUNLOCK;
+	STAT_THREAD_ADD(dir_main.entries, dindex);
 	return 0;
 }
 
@@ -874,19 +854,57 @@ static ZERO_OR_ERROR FS_dir_plus(void (*dirfunc) (void *, const struct parsednam
 	struct parsedname *pn_plus_directory = &s_pn_plus_directory;
 
 	if (FS_ParsedNamePlus(pn_directory->path, file, pn_plus_directory) == 0) {
- 		switch ( FS_visible(pn_plus_directory) ) { // hide hidden properties
-			case visible_now :
-			case visible_always:
-				FS_dir_entry_aliased( dirfunc, v, pn_plus_directory) ;
-				if ( pn_plus_directory->selected_device ){
-					flags[0] |= pn_plus_directory->selected_device->flags;
-				}
-				break ;
-			default:
-				break ;
-		}
-		FS_ParsedName_destroy(pn_plus_directory) ;
+		FS_dir_show(dirfunc, v, flags, pn_plus_directory) ;
+		return 0;
+	}
+	return -ENOENT;
+}
+
+/* Device found on the bus -- built from the directory, no parsing */
+static ZERO_OR_ERROR FS_dir_device(void (*dirfunc) (void *, const struct parsedname *), void *v, uint32_t * flags, const struct parsedname *pn_directory, const BYTE * sn)
+{
+	struct parsedname s_pn_device;
+	struct parsedname *pn_device = &s_pn_device;
+
+	if (FS_ParsedNameDevice(pn_directory, sn, pn_device) == 0) {
+		FS_dir_show(dirfunc, v, flags, pn_device) ;
 		return 0;
 	}
 	return -ENOENT;
 }
+
+/* Property of a device directory -- built from the directory, no parsing */
+/* Returns non-zero if shown */
+static int FS_dir_property(void (*dirfunc) (void *, const struct parsedname *), void *v, const struct parsedname *pn_device_directory, struct filetype * ft, int extension)
+{
+	struct parsedname s_pn_file_entry;
+	struct parsedname *pn_file_entry = &s_pn_file_entry;
+	uint32_t ignoreflag = 0;
+
+	if (FS_ParsedNameProperty(pn_device_directory, ft, extension, pn_file_entry) == 0) {
+		return FS_dir_show(dirfunc, v, &ignoreflag, pn_file_entry) ;
+	}
+	return 0;
+}
+
+/* Show the entry unless hidden, then destroy it */
+/* Returns non-zero if shown */
+static int FS_dir_show(void (*dirfunc) (void *, const struct parsedname *), void *v, uint32_t * flags, struct parsedname *pn_entry)
+{
+	int shown = 0 ;
+
+	switch ( FS_visible(pn_entry) ) { // hide hidden properties
+		case visible_now :
+		case visible_always:
+			FS_dir_entry_aliased( dirfunc, v, pn_entry) ;
+			if ( pn_entry->selected_device ){
+				flags[0] |= pn_entry->selected_device->flags;
+			}
+			shown = 1 ;
+			break ;
+		default:
+			break ;
+	}
+	FS_ParsedName_destroy(pn_entry) ;
+	return shown ;
+}
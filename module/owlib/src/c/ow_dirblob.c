@@ -43,11 +43,15 @@
     It is used for directory caches, and some "all at once" adapters types
 
     Most interestingly, it allocates memory dynamically.
+    (from the slab allocator -- dirblobs are short lived and of similar sizes)
 */
 
 void DirblobClear(struct dirblob *db)
 {
-	SAFEFREE(db->snlist) ;
+	if ( db->snlist != NULL ) {
+		owslab_free(db->snlist) ;
+		db->snlist = NULL ;
+	}
 	db->allocated = db->devices;
 	db->devices = 0;
 	db->troubled = 0;
@@ -84,7 +88,7 @@ int DirblobAdd(const BYTE * sn, struct dirblob *db)
 	// make more room? -- blocks of 10 devices (80byte)
 	if ((db->devices >= db->allocated) || (db->snlist == NULL)) {
 		int newalloc = db->allocated + DIRBLOB_ALLOCATION_INCREMENT;
-		BYTE *try_bigger_block = owrealloc(db->snlist, DIRBLOB_ELEMENT_LENGTH * newalloc);
+		BYTE *try_bigger_block = owslab_realloc(db->snlist, DIRBLOB_ELEMENT_LENGTH * newalloc);
 		if (try_bigger_block != NULL) {
 			db->allocated = newalloc;
 			db->snlist = try_bigger_block;
@@ -135,7 +139,7 @@ int DirblobRecreate( BYTE * snlist, int size, struct dirblob *db)
 		return 0 ;
 	}
 
-	db->snlist = (BYTE *) owmalloc(size) ;
+	db->snlist = (BYTE *) owslab_malloc(size) ;
 
 	if ( db->snlist == NULL ) {
 		db->troubled = 1 ;
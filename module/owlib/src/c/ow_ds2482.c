@@ -44,6 +44,9 @@
 // specifically lm-sensors-2.10.0
 #include "i2c-dev.h"
 
+/* Which learned count of status reads (see DS2482_command) */
+enum ds2482_poll { ds2482_poll_reset, ds2482_poll_byte, ds2482_poll_triplet, } ;
+
 enum ds2482_address {
 	ds2482_any=-2,
 	ds2482_all=-1,
@@ -56,8 +59,8 @@ static GOOD_OR_BAD DS2482_detect_sys( int any, enum ds2482_address chip_num, str
 static GOOD_OR_BAD DS2482_detect_dir( int any, enum ds2482_address chip_num, struct port_in *pin) ;
 static GOOD_OR_BAD DS2482_detect_single(int lowindex, int highindex, char * i2c_device, struct port_in *pin) ;
 static enum search_status DS2482_next_both(struct device_search *ds, const struct parsedname *pn);
-static GOOD_OR_BAD DS2482_triple(BYTE * bits, int direction, FILE_DESCRIPTOR_OR_ERROR file_descriptor);
-static GOOD_OR_BAD DS2482_send_and_get(FILE_DESCRIPTOR_OR_ERROR file_descriptor, const BYTE wr, BYTE * rd);
+static GOOD_OR_BAD DS2482_triple(BYTE * bits, int direction, struct connection_in * in);
+static GOOD_OR_BAD DS2482_send_and_get(const BYTE * wr, BYTE * rd, const size_t len, struct connection_in * in);
 static RESET_TYPE DS2482_reset(const struct parsedname *pn);
 static GOOD_OR_BAD DS2482_sendback_data(const BYTE * data, BYTE * resp, const size_t len, const struct parsedname *pn);
 static GOOD_OR_BAD DS2483_test(FILE_DESCRIPTOR_OR_ERROR file_descriptor);
@@ -66,10 +69,59 @@ static GOOD_OR_BAD HeadChannel(struct connection_in *head);
 static GOOD_OR_BAD CreateChannels(struct connection_in *head);
 static GOOD_OR_BAD DS2482_channel_select(struct connection_in * in);
 static GOOD_OR_BAD DS2482_readstatus(BYTE * c, FILE_DESCRIPTOR_OR_ERROR file_descriptor, unsigned long int min_usec, unsigned long int max_usec);
+static GOOD_OR_BAD DS2482_command(BYTE * status, BYTE * command, int command_length, enum ds2482_poll poll, unsigned long int min_usec, unsigned long int max_usec, struct connection_in * in);
 static GOOD_OR_BAD SetConfiguration(BYTE c, struct connection_in *in);
 static void DS2482_close(struct connection_in *in);
 static GOOD_OR_BAD DS2482_redetect(const struct parsedname *pn);
 static GOOD_OR_BAD DS2482_PowerByte(const BYTE byte, BYTE * resp, const UINT delay, const struct parsedname *pn);
+static GOOD_OR_BAD DS2482_send_and_get_smbus(const BYTE * wr, BYTE * rd, const size_t len, struct connection_in * in);
+static int DS2482_plain_i2c(FILE_DESCRIPTOR_OR_ERROR file_descriptor);
+
+/* i2c system calls, through DS2482_i2c so a test can put a mock adapter there */
+static FILE_DESCRIPTOR_OR_ERROR DS2482_sys_open(const char * path, int flags)
+{
+	return open(path, flags);
+}
+
+static int DS2482_sys_ioctl(FILE_DESCRIPTOR_OR_ERROR file_descriptor, unsigned long request, void * arg)
+{
+	return ioctl(file_descriptor, request, arg);
+}
+
+struct ds2482_i2c_calls DS2482_i2c = { DS2482_sys_open, DS2482_sys_ioctl, } ;
+
+/* The SMBus calls of i2c-dev.h, but through DS2482_i2c */
+static int DS2482_smbus_access(FILE_DESCRIPTOR_OR_ERROR file_descriptor, char read_write, BYTE command, int size, union i2c_smbus_data *data)
+{
+	struct i2c_smbus_ioctl_data args;
+
+	args.read_write = read_write;
+	args.command = command;
+	args.size = size;
+	args.data = data;
+	return DS2482_i2c.ioctl(file_descriptor, I2C_SMBUS, &args);
+}
+
+static int DS2482_smbus_read_byte(FILE_DESCRIPTOR_OR_ERROR file_descriptor)
+{
+	union i2c_smbus_data data;
+	if (DS2482_smbus_access(file_descriptor, I2C_SMBUS_READ, 0, I2C_SMBUS_BYTE, &data)) {
+		return -1;
+	}
+	return 0x0FF & data.byte;
+}
+
+static int DS2482_smbus_write_byte(FILE_DESCRIPTOR_OR_ERROR file_descriptor, BYTE value)
+{
+	return DS2482_smbus_access(file_descriptor, I2C_SMBUS_WRITE, value, I2C_SMBUS_BYTE, NULL);
+}
+
+static int DS2482_smbus_write_byte_data(FILE_DESCRIPTOR_OR_ERROR file_descriptor, BYTE command, BYTE value)
+{
+	union i2c_smbus_data data;
+	data.byte = value;
+	return DS2482_smbus_access(file_descriptor, I2C_SMBUS_WRITE, command, I2C_SMBUS_BYTE_DATA, &data);
+}
 
 /**
  * The DS2482 registers - there are 3 registers that are addressed by a read
@@ -125,6 +177,19 @@ static GOOD_OR_BAD DS2482_PowerByte(const BYTE byte, BYTE * resp, const UINT del
 #define DS2482_1wire_write_usec   530, 585
 #define DS2482_1wire_triplet_usec   198, 219
 
+/* Combined transfers
+   A 1-Wire command goes out in the same I2C_RDWR transfer as the polling for
+   its completion: the status register is refreshed for every byte of a read,
+   so one read of several bytes is a busy-wait without sleeping or extra calls.
+   How many bytes that takes depends on the i2c clock, so it is learned,
+   starting from the longest time at 400kHz (22.5 usec a byte).
+   Adapters that only do SMBus (no I2C_FUNC_I2C) get one command per call
+   and timed polling instead. */
+#define DS2482_max_status_reads   255
+
+/* The kernel allows 42 messages in a transfer, each 1-Wire byte needs 4 */
+#define DS2482_batch_bytes   10
+
 /* Defines for making messages more explicit */
 #define I2Cformat "I2C bus %s, channel %d/%d"
 #define I2Cvar(in)  DEVICENAME(in), (in)->master.i2c.index, (in)->master.i2c.channels
@@ -377,7 +442,7 @@ static GOOD_OR_BAD DS2482_detect_single(int lowindex, int highindex, char * i2c_
 	}
 	
 	/* open the i2c port */
-	file_descriptor = open(i2c_device, O_RDWR);
+	file_descriptor = DS2482_i2c.open(i2c_device, O_RDWR);
 	if ( FILE_DESCRIPTOR_NOT_VALID(file_descriptor) ) {
 		ERROR_CONNECT("Could not open i2c device %s", i2c_device);
 		return gbBAD;
@@ -389,7 +454,7 @@ static GOOD_OR_BAD DS2482_detect_single(int lowindex, int highindex, char * i2c_
 	for (i2c_index = lowindex; i2c_index <= highindex; ++i2c_index) {
 		int trial_address = test_address[i2c_index] ;
 		/* set the candidate address */
-		if (ioctl(file_descriptor, I2C_SLAVE, trial_address) < 0) {
+		if (DS2482_i2c.ioctl(file_descriptor, I2C_SLAVE, (void *) (long) trial_address) < 0) {
 			ERROR_CONNECT("Cound not set trial i2c address to %.2X", trial_address);
 		} else {
 			BYTE c;
@@ -415,7 +480,7 @@ static GOOD_OR_BAD DS2482_detect_single(int lowindex, int highindex, char * i2c_
 			in->Adapter = adapter_DS2482_100;
 
 			/* write the RESET code */
-			if (i2c_smbus_write_byte(file_descriptor, DS2482_CMD_RESET)	// reset
+			if (DS2482_smbus_write_byte(file_descriptor, DS2482_CMD_RESET)	// reset
 				|| BAD(DS2482_readstatus(&c, file_descriptor, DS2482_Chip_reset_usec))	// pause .5 usec then read status
 				|| (c != (DS2482_REG_STS_LL | DS2482_REG_STS_RST))	// make sure status is properly set
 				) {
@@ -425,6 +490,7 @@ static GOOD_OR_BAD DS2482_detect_single(int lowindex, int highindex, char * i2c_
 			}
 			LEVEL_CONNECT("i2c device at %s address %.2X appears to be DS2482-x00", i2c_device, trial_address);
 			in->master.i2c.configchip = 0x00;	// default configuration register after RESET
+			in->master.i2c.plain_i2c = DS2482_plain_i2c(file_descriptor) ;
 			// Note, only the lower nibble of the device config stored
 			
 			// Create name
@@ -456,7 +522,7 @@ static GOOD_OR_BAD DS2482_redetect(const struct parsedname *pn)
 
 	/* open the i2c port */
 	Parse_Address( DEVICENAME(head), &ap ) ;
-	file_descriptor = open(ap.first.alpha, O_RDWR );
+	file_descriptor = DS2482_i2c.open(ap.first.alpha, O_RDWR );
 	Free_Address( &ap ) ;
 	if ( FILE_DESCRIPTOR_NOT_VALID(file_descriptor) ) {
 		ERROR_CONNECT("Could not open i2c device %s", DEVICENAME(head));
@@ -464,12 +530,12 @@ static GOOD_OR_BAD DS2482_redetect(const struct parsedname *pn)
 	}
 	
 	/* address is known */
-	if (ioctl(file_descriptor, I2C_SLAVE, address) < 0) {
+	if (DS2482_i2c.ioctl(file_descriptor, I2C_SLAVE, (void *) (long) address) < 0) {
 		ERROR_CONNECT("Cound not set i2c address to %.2X", address);
 	} else {
 		BYTE c;
 		/* write the RESET code */
-		if (i2c_smbus_write_byte(file_descriptor, DS2482_CMD_RESET)	// reset
+		if (DS2482_smbus_write_byte(file_descriptor, DS2482_CMD_RESET)	// reset
 			|| BAD(DS2482_readstatus(&c, file_descriptor, DS2482_Chip_reset_usec))	// pause .5 usec then read status
 			|| (c != (DS2482_REG_STS_LL | DS2482_REG_STS_RST))	// make sure status is properly set
 			) {
@@ -481,6 +547,7 @@ static GOOD_OR_BAD DS2482_redetect(const struct parsedname *pn)
 			head->pown->state = cs_deflowered ;
 			head->pown->type = ct_i2c ;
 			head->master.i2c.configchip = 0x00;	// default configuration register after RESET	
+			head->master.i2c.plain_i2c = DS2482_plain_i2c(file_descriptor) ;
 			LEVEL_CONNECT("i2c device at %s address %d reset successfully", DEVICENAME(head), address);
 			for ( next = head->pown->first; next; next = next->next ) {
 				/* loop through devices, matching those that have the same "head" */
@@ -506,7 +573,7 @@ static GOOD_OR_BAD DS2482_readstatus(BYTE * c, FILE_DESCRIPTOR_OR_ERROR file_des
 	int i = 0;
 	UT_delay_us(min_usec);		// at least get minimum out of the way
 	do {
-		int ret = i2c_smbus_read_byte(file_descriptor);
+		int ret = DS2482_smbus_read_byte(file_descriptor);
 		if (ret < 0) {
 			LEVEL_DEBUG("problem min=%lu max=%lu i=%d ret=%d", min_usec, max_usec, i, ret);
 			return gbBAD;
@@ -524,13 +591,123 @@ static GOOD_OR_BAD DS2482_readstatus(BYTE * c, FILE_DESCRIPTOR_OR_ERROR file_des
 	} while (1);
 }
 
+static int DS2482_first_status_reads(unsigned long int min_usec, unsigned long int max_usec)
+{
+	(void) min_usec ;
+	return max_usec * 10 / 225 + 1 ;
+}
+
+static int * DS2482_status_reads(enum ds2482_poll poll, struct connection_in * in)
+{
+	int speed = (in->master.i2c.configreg & DS2482_REG_CFG_1WS) ? 1 : 0 ;
+	return &(in->master.i2c.head->master.i2c.status_reads[speed][poll]) ;
+}
+
+/* Number of status bytes read before the 1-Wire command was done */
+static int DS2482_busy_reads(const BYTE * status, int reads)
+{
+	int busy ;
+	for (busy = 0; busy < reads; ++busy) {
+		if ((status[busy] & DS2482_REG_STS_1WB) == 0x00) {
+			break;
+		}
+	}
+	return busy ;
+}
+
+/* Status reads to queue: 0 is not yet known, negative is a trial count not yet
+   seen to be enough (so don't batch bytes on it) */
+static int DS2482_queued_reads(int status_reads, int first_reads)
+{
+	if (status_reads == 0) {
+		return first_reads ;
+	}
+	return (status_reads < 0) ? -status_reads : status_reads ;
+}
+
+/* reads status bytes were read, the longest command kept busy for busy of them */
+static void DS2482_learn(int * status_reads, int reads, int busy)
+{
+	int wanted = busy + busy / 4 + 2 ; // margin for jitter
+
+	if (busy >= reads) {
+		// never done (or the transfer failed) -- try more
+		wanted = 2 * reads ;
+		*status_reads = (wanted > DS2482_max_status_reads) ? -DS2482_max_status_reads : -wanted ;
+		return ;
+	}
+	if (wanted < reads) {
+		// ease down
+		wanted = (reads + wanted) / 2 ;
+	}
+	*status_reads = (wanted > DS2482_max_status_reads) ? DS2482_max_status_reads : wanted ;
+}
+
+static void DS2482_msg(struct i2c_msg * msg, unsigned short flags, BYTE * buf, int len, struct connection_in * in)
+{
+	msg->addr = in->master.i2c.head->master.i2c.i2c_address ;
+	msg->flags = flags ;
+	msg->len = len ;
+	msg->buf = (char *) buf ;
+}
+
+static GOOD_OR_BAD DS2482_transfer(struct i2c_msg * msgs, int nmsgs, struct connection_in * in)
+{
+	struct i2c_rdwr_ioctl_data rdwr ;
+
+	rdwr.msgs = msgs ;
+	rdwr.nmsgs = nmsgs ;
+	if (DS2482_i2c.ioctl(in->pown->file_descriptor, I2C_RDWR, &rdwr) < 0) {
+		ERROR_DEBUG("Combined i2c transfer of %d messages failed "I2Cformat" ", nmsgs, I2Cvar(in));
+		return gbBAD;
+	}
+	return gbGOOD;
+}
+
+/* 1-Wire command (reset or triplet) and its final status in one transfer.
+   If the learned status reads fall short, finish with timed polling */
+static GOOD_OR_BAD DS2482_command(BYTE * status, BYTE * command, int command_length, enum ds2482_poll poll, unsigned long int min_usec, unsigned long int max_usec, struct connection_in * in)
+{
+	int * status_reads = DS2482_status_reads(poll, in) ;
+	int reads = DS2482_queued_reads(*status_reads, DS2482_first_status_reads(min_usec, max_usec)) ;
+	BYTE read_back[DS2482_max_status_reads] ;
+	struct i2c_msg msgs[2] ;
+	int busy ;
+
+	if ( ! in->master.i2c.head->master.i2c.plain_i2c ) {
+		// SMBus only -- the command, then timed polling
+		int ret = (command_length == 1)
+			? DS2482_smbus_write_byte(in->pown->file_descriptor, command[0])
+			: DS2482_smbus_write_byte_data(in->pown->file_descriptor, command[0], command[1]) ;
+		if (ret < 0) {
+			return gbBAD;
+		}
+		return DS2482_readstatus(status, in->pown->file_descriptor, min_usec, max_usec) ;
+	}
+
+	DS2482_msg(&msgs[0], 0, command, command_length, in) ;
+	DS2482_msg(&msgs[1], I2C_M_RD, read_back, reads, in) ;
+	if ( BAD( DS2482_transfer(msgs, 2, in) ) ) {
+		DS2482_learn(status_reads, reads, reads) ;
+		return gbBAD;
+	}
+
+	busy = DS2482_busy_reads(read_back, reads) ;
+	DS2482_learn(status_reads, reads, busy) ;
+	if (busy < reads) {
+		status[0] = read_back[busy] ;
+		return gbGOOD;
+	}
+	// the read pointer is still on the status register
+	return DS2482_readstatus(status, in->pown->file_descriptor, min_usec, max_usec) ;
+}
+
 /* uses the "Triple" primative for faster search */
 static enum search_status DS2482_next_both(struct device_search *ds, const struct parsedname *pn)
 {
 	int search_direction = 0;	/* initialization just to forestall incorrect compiler warning */
 	int bit_number;
 	int last_zero = -1;
-	FILE_DESCRIPTOR_OR_ERROR file_descriptor = pn->selected_connection->pown->file_descriptor;
 	BYTE bits[3];
 
 	// initialize for search
@@ -564,7 +741,7 @@ static enum search_status DS2482_next_both(struct device_search *ds, const struc
 			search_direction = (bit_number == ds->LastDiscrepancy) ? 1 : 0;
 		}
 		/* Appropriate search command */
-		if ( BAD( DS2482_triple(bits, search_direction, file_descriptor) ) )  {
+		if ( BAD( DS2482_triple(bits, search_direction, pn->selected_connection) ) )  {
 			return search_error;
 		}
 		if (bits[0] || bits[1] || bits[2]) {
@@ -595,24 +772,17 @@ static enum search_status DS2482_next_both(struct device_search *ds, const struc
 static RESET_TYPE DS2482_reset(const struct parsedname *pn)
 {
 	BYTE status_byte;
+	BYTE reset[] = { DS2482_CMD_1WIRE_RESET, } ;
 	struct connection_in * in = pn->selected_connection ;
-	FILE_DESCRIPTOR_OR_ERROR file_descriptor = in->pown->file_descriptor;
 
 	/* Make sure we're using the correct channel */
 	if ( BAD(DS2482_channel_select(in)) ) {
 		return BUS_RESET_ERROR;
 	}
 
-	/* write the RESET code */
-	if (i2c_smbus_write_byte(file_descriptor, DS2482_CMD_1WIRE_RESET)) {
-		return BUS_RESET_ERROR;
-	}
-
-	/* wait */
+	/* write the RESET code and read status */
 	// rstl+rsth+.25 usec
-
-	/* read status */
-	if ( BAD( DS2482_readstatus(&status_byte, file_descriptor, DS2482_1wire_reset_usec) ) ) {
+	if ( BAD( DS2482_command(&status_byte, reset, 1, ds2482_poll_reset, DS2482_1wire_reset_usec, in) ) ) {
 		return BUS_RESET_ERROR;			// 8 * Tslot
 	}
 
@@ -624,55 +794,152 @@ static RESET_TYPE DS2482_reset(const struct parsedname *pn)
 static GOOD_OR_BAD DS2482_sendback_data(const BYTE * data, BYTE * resp, const size_t len, const struct parsedname *pn)
 {
 	struct connection_in * in = pn->selected_connection ;
-	FILE_DESCRIPTOR_OR_ERROR file_descriptor = in->pown->file_descriptor;
-	size_t i;
 
 	/* Make sure we're using the correct channel */
 	RETURN_BAD_IF_BAD(DS2482_channel_select(in)) ;
 
 	TrafficOut( "write", data, len, in ) ;
-	for (i = 0; i < len; ++i) {
-		RETURN_BAD_IF_BAD(DS2482_send_and_get(file_descriptor, data[i], &resp[i])) ;
-	}
+	RETURN_BAD_IF_BAD(DS2482_send_and_get(data, resp, len, in)) ;
 	TrafficOut( "response", resp, len, in ) ;
 	return gbGOOD;
 }
 
-/* Single byte -- assumes channel selection already done */
-static GOOD_OR_BAD DS2482_send_and_get(FILE_DESCRIPTOR_OR_ERROR file_descriptor, const BYTE wr, BYTE * rd)
+/* Up to DS2482_batch_bytes per transfer -- assumes channel selection already done */
+/* Each byte is a write byte command, the status polls, and a read of the data register */
+static GOOD_OR_BAD DS2482_send_and_get(const BYTE * wr, BYTE * rd, const size_t len, struct connection_in * in)
 {
-	int read_back;
-	BYTE c;
+	FILE_DESCRIPTOR_OR_ERROR file_descriptor = in->pown->file_descriptor;
+	int * status_reads = DS2482_status_reads(ds2482_poll_byte, in) ;
+	BYTE read_data[] = { DS2482_CMD_SET_READ_PTR, DS2482_READ_DATA_REGISTER, } ;
+	size_t start ;
 
-	/* Write data byte */
-	if (i2c_smbus_write_byte_data(file_descriptor, DS2482_CMD_1WIRE_WRITE_BYTE, wr) < 0) {
-		return gbBAD;
+	if ( ! in->master.i2c.head->master.i2c.plain_i2c ) {
+		return DS2482_send_and_get_smbus(wr, rd, len, in) ;
 	}
 
-	/* read status for done */
-	RETURN_BAD_IF_BAD( DS2482_readstatus(&c, file_descriptor, DS2482_1wire_write_usec) ) ;
+	for (start = 0; start < len; ) {
+		BYTE command[DS2482_batch_bytes][2] ;
+		BYTE read_back[DS2482_batch_bytes][DS2482_max_status_reads] ;
+		struct i2c_msg msgs[4 * DS2482_batch_bytes] ;
+		size_t batch = len - start ;
+		int reads = DS2482_queued_reads(*status_reads, DS2482_first_status_reads(DS2482_1wire_write_usec)) ;
+		int busy = 0 ;
+		size_t i ;
+
+		if (*status_reads <= 0) {
+			// one byte at a time until the timing is known
+			batch = 1 ;
+		} else if (batch > DS2482_batch_bytes) {
+			batch = DS2482_batch_bytes ;
+		}
 
-	/* Select the data register */
-	if (i2c_smbus_write_byte_data(file_descriptor, DS2482_CMD_SET_READ_PTR, DS2482_READ_DATA_REGISTER) < 0) {
-		return gbBAD;
+		for (i = 0; i < batch; ++i) {
+			command[i][0] = DS2482_CMD_1WIRE_WRITE_BYTE ;
+			command[i][1] = wr[start + i] ;
+			DS2482_msg(&msgs[4 * i + 0], 0, command[i], 2, in) ;
+			DS2482_msg(&msgs[4 * i + 1], I2C_M_RD, read_back[i], reads, in) ;
+			DS2482_msg(&msgs[4 * i + 2], 0, read_data, 2, in) ;
+			DS2482_msg(&msgs[4 * i + 3], I2C_M_RD, &rd[start + i], 1, in) ;
+		}
+		if ( BAD( DS2482_transfer(msgs, 4 * batch, in) ) ) {
+			DS2482_learn(status_reads, reads, reads) ;
+			return gbBAD;
+		}
+
+		for (i = 0; i < batch; ++i) {
+			int busy_byte = DS2482_busy_reads(read_back[i], reads) ;
+			if (busy_byte > busy) {
+				busy = busy_byte ;
+			}
+		}
+		DS2482_learn(status_reads, reads, busy) ;
+
+		if (busy == reads) {
+			BYTE c;
+			int read_back_data;
+
+			if (batch > 1) {
+				// later bytes went out while the 1-Wire bus was still busy
+				LEVEL_DEBUG("1-Wire byte outlasted %d status reads", reads);
+				return gbBAD;
+			}
+
+			/* The lone byte: back to the status register and wait */
+			if (DS2482_smbus_write_byte_data(file_descriptor, DS2482_CMD_SET_READ_PTR, DS2482_STATUS_REGISTER) < 0) {
+				return gbBAD;
+			}
+			RETURN_BAD_IF_BAD( DS2482_readstatus(&c, file_descriptor, DS2482_1wire_write_usec) ) ;
+			if (DS2482_smbus_write_byte_data(file_descriptor, DS2482_CMD_SET_READ_PTR, DS2482_READ_DATA_REGISTER) < 0) {
+				return gbBAD;
+			}
+			read_back_data = DS2482_smbus_read_byte(file_descriptor);
+			if (read_back_data < 0) {
+				return gbBAD;
+			}
+			rd[start] = (BYTE) read_back_data;
+		}
+		start += batch ;
 	}
 
-	/* Read the data byte */
-	read_back = i2c_smbus_read_byte(file_descriptor);
+	return gbGOOD;
+}
+
+/* SMBus only adapter -- each byte is a write byte command, timed polling of
+   the status, and a read of the data register -- assumes channel selection already done */
+static GOOD_OR_BAD DS2482_send_and_get_smbus(const BYTE * wr, BYTE * rd, const size_t len, struct connection_in * in)
+{
+	FILE_DESCRIPTOR_OR_ERROR file_descriptor = in->pown->file_descriptor;
+	size_t i ;
 
-	if (read_back < 0) {
-		return gbBAD;
+	for (i = 0; i < len; ++i) {
+		int read_back;
+		BYTE c;
+
+		/* Write data byte */
+		if (DS2482_smbus_write_byte_data(file_descriptor, DS2482_CMD_1WIRE_WRITE_BYTE, wr[i]) < 0) {
+			return gbBAD;
+		}
+
+		/* read status for done */
+		RETURN_BAD_IF_BAD( DS2482_readstatus(&c, file_descriptor, DS2482_1wire_write_usec) ) ;
+
+		/* Select the data register */
+		if (DS2482_smbus_write_byte_data(file_descriptor, DS2482_CMD_SET_READ_PTR, DS2482_READ_DATA_REGISTER) < 0) {
+			return gbBAD;
+		}
+
+		/* Read the data byte */
+		read_back = DS2482_smbus_read_byte(file_descriptor);
+		if (read_back < 0) {
+			return gbBAD;
+		}
+		rd[i] = (BYTE) read_back;
 	}
-	rd[0] = (BYTE) read_back;
 
 	return gbGOOD;
 }
 
+/* Can the i2c adapter do plain i2c transfers (I2C_RDWR) or only SMBus? */
+static int DS2482_plain_i2c(FILE_DESCRIPTOR_OR_ERROR file_descriptor)
+{
+	unsigned long funcs = 0 ;
+
+	if (DS2482_i2c.ioctl(file_descriptor, I2C_FUNCS, &funcs) < 0) {
+		LEVEL_DEBUG("Cannot get the i2c adapter functions -- use SMBus");
+		return 0 ;
+	}
+	if ((funcs & I2C_FUNC_I2C) == 0) {
+		LEVEL_CONNECT("i2c adapter does SMBus only -- no combined transfers");
+		return 0 ;
+	}
+	return 1 ;
+}
+
 /* Is this a DS2483? Try to set to new register */
 static GOOD_OR_BAD DS2483_test(FILE_DESCRIPTOR_OR_ERROR file_descriptor)
 {
 	/* Select the data register */
-	if (i2c_smbus_write_byte_data(file_descriptor, DS2482_CMD_SET_READ_PTR, DS2482_PORT_CONFIGURATION_REGISTER) < 0) {
+	if (DS2482_smbus_write_byte_data(file_descriptor, DS2482_CMD_SET_READ_PTR, DS2482_PORT_CONFIGURATION_REGISTER) < 0) {
 		LEVEL_DEBUG("Cannot set to port configuration -- not a DS2483");
 		return gbBAD;
 	}
@@ -735,19 +1002,15 @@ static GOOD_OR_BAD CreateChannels(struct connection_in *head)
 	return gbGOOD;
 }
 
-static GOOD_OR_BAD DS2482_triple(BYTE * bits, int direction, FILE_DESCRIPTOR_OR_ERROR file_descriptor)
+static GOOD_OR_BAD DS2482_triple(BYTE * bits, int direction, struct connection_in * in)
 {
 	/* 3 bits in bits */
 	BYTE c;
+	BYTE triplet[] = { DS2482_CMD_1WIRE_TRIPLET, direction ? 0xFF : 0, } ;
 
 	LEVEL_DEBUG("-> TRIPLET attempt direction %d", direction);
-	/* Write TRIPLE command */
-	if (i2c_smbus_write_byte_data(file_descriptor, DS2482_CMD_1WIRE_TRIPLET, direction ? 0xFF : 0) < 0) {
-		return gbBAD;
-	}
-
-	/* read status */
-	RETURN_BAD_IF_BAD(DS2482_readstatus(&c, file_descriptor, DS2482_1wire_triplet_usec)) ;
+	/* Write TRIPLE command and read status */
+	RETURN_BAD_IF_BAD(DS2482_command(&c, triplet, 2, ds2482_poll_triplet, DS2482_1wire_triplet_usec, in)) ;
 
 	bits[0] = (c & DS2482_REG_STS_SBR) != 0;
 	bits[1] = (c & DS2482_REG_STS_TSB) != 0;
@@ -781,13 +1044,13 @@ static GOOD_OR_BAD DS2482_channel_select(struct connection_in * in)
 		int read_back;
 
 		/* Select command */
-		if (i2c_smbus_write_byte_data(file_descriptor, DS2482_CMD_CHANNEL_SELECT, W_chan[chan]) < 0) {
+		if (DS2482_smbus_write_byte_data(file_descriptor, DS2482_CMD_CHANNEL_SELECT, W_chan[chan]) < 0) {
 			LEVEL_DEBUG("Channel select set error");
 			return gbBAD;
 		}
 
 		/* Read back and confirm */
-		read_back = i2c_smbus_read_byte(file_descriptor);
+		read_back = DS2482_smbus_read_byte(file_descriptor);
 		if (read_back < 0) {
 			LEVEL_DEBUG("Channel select get error");
 			return gbBAD; // flag for DS2482-100 vs -800 detection
@@ -820,8 +1083,8 @@ static GOOD_OR_BAD SetConfiguration(BYTE c, struct connection_in *in)
 
 	/* Write, readback, and compare configuration register */
 	/* Logic error fix from Uli Raich */
-	if (i2c_smbus_write_byte_data(file_descriptor, DS2482_CMD_WRITE_CONFIG, c | ((~c) << 4))
-		|| (read_back = i2c_smbus_read_byte(file_descriptor)) < 0 || ((BYTE) read_back != c)
+	if (DS2482_smbus_write_byte_data(file_descriptor, DS2482_CMD_WRITE_CONFIG, c | ((~c) << 4))
+		|| (read_back = DS2482_smbus_read_byte(file_descriptor)) < 0 || ((BYTE) read_back != c)
 		) {
 		head->master.i2c.configchip = 0xFF;	// bad value to trigger retry
 		LEVEL_CONNECT("Trouble changing DS2482 configuration register "I2Cformat" ",I2Cvar(in));
@@ -844,7 +1107,7 @@ static GOOD_OR_BAD DS2482_PowerByte(const BYTE byte, BYTE * resp, const UINT del
 	RETURN_BAD_IF_BAD(SetConfiguration(  in->master.i2c.configreg | DS2482_REG_CFG_SPU, in)) ;
 
 	/* send and get byte (and trigger strong pull-up */
-	RETURN_BAD_IF_BAD(DS2482_send_and_get( in->pown->file_descriptor, byte, resp)) ;
+	RETURN_BAD_IF_BAD(DS2482_send_and_get( &byte, resp, 1, in)) ;
 	TrafficOut("power response", resp, 1, in ) ;
 
 	UT_delay(delay);
@@ -850,12 +850,45 @@ static GOOD_OR_BAD DS9490_open_and_name( libusb_device * dev, struct connection_
 /* ------------------------------------------------------------ */
 /* --- USB read and write --------------------------------------*/
 
-static GOOD_OR_BAD DS9490_sendback_data(const BYTE * const_data, BYTE * resp, size_t len, const struct parsedname *pn)
+struct block_io {
+	BYTE * data ;
+	size_t len ;
+} ;
+
+/* Fill EP2 and start a block command for each bulk packet's worth.
+   Later blocks are written while earlier ones are still on the 1-Wire bus
+   (the adapter holds off a write until its FIFO has room) */
+static GOOD_OR_BAD DS9490_block_start(void * v, const struct parsedname *pn)
 {
-	size_t location = 0 ;
-	BYTE data[len] ; // to avoid const problem
+	struct block_io * bio = v ;
+	size_t location ;
 
-	memcpy( data, const_data, len ) ;
+	for ( location = 0 ; location < bio->len ; location += USB_FIFO_EACH ) {
+		size_t block = bio->len - location ;
+		if ( block > USB_FIFO_EACH ) {
+			block = USB_FIFO_EACH ;
+		}
+
+		if ( DS9490_write( &bio->data[location], block, pn) < (int) block) {
+			LEVEL_DATA("USBsendback bulk write problem");
+			return gbBAD;
+		}
+
+		// COMM_BLOCK_IO | COMM_IM | COMM_F == 0x0075
+		if ( BAD( USB_Control_Msg(COMM_CMD, COMM_BLOCK_IO | COMM_IM | COMM_F, block, pn)) ) {
+			LEVEL_DATA("USBsendback control error");
+			STAT_ADD1_BUS(e_bus_errors, pn->selected_connection);
+			return gbBAD;
+		}
+	}
+	return gbGOOD;
+}
+
+/* One bulk packet at a time: write, block command, wait for idle, read
+   (--usb_sync, the default) */
+static GOOD_OR_BAD DS9490_sendback_sync(BYTE * data, BYTE * resp, size_t len, const struct parsedname *pn)
+{
+	size_t location = 0 ;
 
 	while ( location < len ) {
 		BYTE buffer[ DS9490_getstatus_BUFFER_LENGTH + 1 ];
@@ -891,6 +924,28 @@ static GOOD_OR_BAD DS9490_sendback_data(const BYTE * const_data, BYTE * resp, si
 	return gbGOOD;
 }
 
+static GOOD_OR_BAD DS9490_sendback_data(const BYTE * const_data, BYTE * resp, size_t len, const struct parsedname *pn)
+{
+	BYTE data[len+1] ; // to avoid const problem
+	struct block_io bio = { data, len, } ;
+
+	if ( len == 0 ) {
+		return gbGOOD;
+	}
+	memcpy( data, const_data, len ) ;
+
+	if ( Globals.usb_sync ) {
+		return DS9490_sendback_sync( data, resp, len, pn ) ;
+	}
+
+	// the responses are read as they come in
+	if ( DS9490_read_while( resp, len, DS9490_block_start, &bio, pn) < (int) len ) {
+		LEVEL_DATA("USBsendback bulk read error");
+		return gbBAD;
+	}
+	return gbGOOD;
+}
+
 
 /* ------------------------------------------------------------ */
 /* --- USB Power byte for temperature conversion ---------------*/
@@ -136,3 +136,142 @@ SIZE_OR_ERROR FS_get(const char *path, char **return_buffer, size_t * buffer_len
 	}
 	return size ;
 }
+
+/* Can this query go to its owserver in a GETMANY message? */
+static int getmany_remote( struct one_wire_query * owq )
+{
+	struct parsedname * pn = PN(owq) ;
+
+	if ( pn->selected_filetype == NO_FILETYPE || IsDir(pn) ) {
+		return 0 ;
+	}
+	if ( ! KnownBus(pn) || ! BusIsServer(pn->selected_connection) ) {
+		return 0 ;
+	}
+	// Alias should show local understanding except if bus.x specified
+	if ( pn->selected_filetype->format == ft_alias && ! SpecifiedRemoteBus(pn) ) {
+		return 0 ;
+	}
+	return 1 ;
+}
+
+/* Send the remote values of a getmany, one batch per owserver
+ * answered[i] is set for every path the owserver gave a value or an error for
+ * */
+static void getmany_remote_batches(const char **paths, int count, char **return_buffers, SIZE_OR_ERROR * sizes, char * answered)
+{
+	struct one_wire_query ** owq_list = owcalloc( count, sizeof(struct one_wire_query *) ) ;
+	struct one_wire_query ** batch = owcalloc( count, sizeof(struct one_wire_query *) ) ;
+	SIZE_OR_ERROR * batch_results = owcalloc( count, sizeof(SIZE_OR_ERROR) ) ;
+	int * batch_index = owcalloc( count, sizeof(int) ) ;
+	int i ;
+
+	if ( owq_list == NULL || batch == NULL || batch_results == NULL || batch_index == NULL ) {
+		// no batching, the values will be read one at a time
+		SAFEFREE( owq_list ) ;
+		SAFEFREE( batch ) ;
+		SAFEFREE( batch_results ) ;
+		SAFEFREE( batch_index ) ;
+		return ;
+	}
+
+	for ( i = 0 ; i < count ; ++i ) {
+		owq_list[i] = OWQ_create_from_path( paths[i] == NULL ? "/" : paths[i] ) ;
+		if ( owq_list[i] == NO_ONE_WIRE_QUERY ) {
+			continue ;
+		}
+		if ( ! getmany_remote( owq_list[i] ) || BAD( OWQ_allocate_read_buffer(owq_list[i]) ) ) {
+			OWQ_destroy( owq_list[i] ) ;
+			owq_list[i] = NO_ONE_WIRE_QUERY ;
+		}
+	}
+
+	for ( i = 0 ; i < count ; ++i ) {
+		int batch_count = 0 ;
+		int j ;
+
+		if ( owq_list[i] == NO_ONE_WIRE_QUERY ) {
+			continue ;
+		}
+		for ( j = i ; j < count ; ++j ) {
+			if ( owq_list[j] == NO_ONE_WIRE_QUERY ) {
+				continue ;
+			}
+			if ( PN(owq_list[j])->selected_connection != PN(owq_list[i])->selected_connection ) {
+				continue ;
+			}
+			batch[batch_count] = owq_list[j] ;
+			batch_index[batch_count] = j ;
+			++batch_count ;
+		}
+
+		switch ( ServerReadMany( batch, batch_count, batch_results ) ) {
+			case -ENOMSG:
+			case -ENOMEM:
+			case -EMSGSIZE:
+				// GETMANY unsupported or not possible -- read these one at a time
+				break ;
+			default:
+				for ( j = 0 ; j < batch_count ; ++j ) {
+					int k = batch_index[j] ;
+					if ( batch_results[j] >= 0 ) {
+						return_buffers[k] = copy_buffer( OWQ_buffer(owq_list[k]), batch_results[j] ) ;
+						sizes[k] = ( return_buffers[k] == NULL ) ? -ENOMEM : batch_results[j] ;
+					} else {
+						sizes[k] = batch_results[j] ;
+					}
+					answered[k] = 1 ;
+				}
+				break ;
+		}
+
+		for ( j = 0 ; j < batch_count ; ++j ) {
+			int k = batch_index[j] ;
+			OWQ_destroy( owq_list[k] ) ;
+			owq_list[k] = NO_ONE_WIRE_QUERY ;
+		}
+	}
+
+	owfree( owq_list ) ;
+	owfree( batch ) ;
+	owfree( batch_results ) ;
+	owfree( batch_index ) ;
+}
+
+/*
+  Get several values, like FS_get for each path
+  return_buffers[i] is a copy of the contents (or NULL) which must be free-ed elsewhere
+  sizes[i] is the length of that string, or <0 for error
+  Values on the same owserver are fetched together in one message
+ */
+ZERO_OR_ERROR FS_getmany(const char **paths, int count, char **return_buffers, SIZE_OR_ERROR * sizes)
+{
+	char * answered ;
+	int i ;
+
+	/* Check the parameters */
+	if ( paths == NULL || return_buffers == NULL || sizes == NULL || count < 0 ) {
+		return -EINVAL;
+	}
+
+	for ( i = 0 ; i < count ; ++i ) {
+		return_buffers[i] = NULL ;
+		sizes[i] = -EINVAL ;
+	}
+
+	answered = owcalloc( count + 1, sizeof(char) ) ;
+	if ( answered != NULL && count > 0 ) {
+		getmany_remote_batches( paths, count, return_buffers, sizes, answered ) ;
+	}
+
+	// Everything else (local values, or an owserver without GETMANY) one at a time
+	// Errors the owserver already answered are not asked again
+	for ( i = 0 ; i < count ; ++i ) {
+		if ( answered == NULL || ! answered[i] ) {
+			sizes[i] = FS_get( paths[i], &return_buffers[i], NULL ) ;
+		}
+	}
+
+	SAFEFREE( answered ) ;
+	return 0 ;
+}
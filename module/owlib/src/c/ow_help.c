@@ -65,6 +65,7 @@ void ow_help_job(void)
 	"  --foreground\n"
 	"  --background\n"
 	"  --pid_file name  file to store pid number (for control scripts)\n"
+	"  --pool_threads n Threads listing separate buses in parallel (default 8)\n"
 	"\n"
 	" Configuration\n"
 	"  -c --configuration filename\n"
@@ -114,6 +115,7 @@ void ow_help_cache(void)
 	"  --uncached          Implicit /uncached in all requests\n"
 	"  --cached            Explicit /uncached needed. (Default action)\n"
 	"  --cache_size n   Size in bytes of max cache memory. 0 for no limit.\n"
+	"  --cache_policy clock|reject  When full, evict cold entries (default) or refuse new ones\n"
 	"\n"
 	" Cache timing         [default] (in seconds)\n"
 	"  --timeout_volatile  [%3d] Expiration time for changing data (e.g. temperature)\n"
@@ -161,6 +163,7 @@ void ow_help_program(void)
 	"  --fuse_open_opt args  Special arguments to pass to FUSE (Quoted and escaped)\n"
 	"  --allow_other         Allow other users to see owfs file system\n"
 	"                         needs /etc/fuse.conf setting\n"
+	"  --bus_requests n      Filesystem requests working on one bus at once (default 0, no limit)\n"
 	"\n"
 	" owhttpd (web server)\n"
 	"  -p --port [ip:]port   TCP address and port number for access\n"
@@ -170,6 +173,7 @@ void ow_help_program(void)
 	"\n"
 	" owserver (OWFS server)\n"
 	"  -p --port [ip:]port   TCP address and port number for access\n"
+	"  --server_threads n    Threads handling requests (default 16)\n"
 	"\n"
 	" Development tests (owserver only)\n"
 	"  --pingcrazy      Add lots of keep-alive messages to the owserver protocol\n"
@@ -225,9 +229,12 @@ void ow_help_device(void)
 	"  --masterhub=/dev/ttyUSB0 Link-USB\n"
 	"  --altUSB        Change some settings for DS9490 bus master (especially for AAG and DS2423)\n"
 	"  --usb_flextime | --usb_regulartime     Needed for Louis Swart's LCD module\n"
+	"  --usb_sync | --usb_async     DS9490 block I/O one packet at a time (default), or queued (experimental)\n"
 	"\n"
 	" Network (address is form [ip:]port, ip DNS name or n.n.n.n, port is port number)\n"
 	"  -s address      owserver\n"
+	"  --server_pool n       Persistent connections kept per owserver (default 4)\n"
+	"  --server_pool_idle s  Close pooled connections unused for s seconds (default 60)\n"
 	"  --LINK=address  LINK-HUB-E network LINK\n"
 	"  --HA7NET=address HA7NET bus master\n"
 	"  --HA7NET        HA7NET bus master address auto-discovered\n"
@@ -23,6 +23,10 @@ void LibClose(void)
 	PIDstop();
 	DeviceDestroy();
 	Detail_Close() ;
+	// the caches themselves are left to process exit:
+	// detached server threads may still be looking things up
+	Cache_Housekeeping_Stop() ;
+	TaskPool_Close() ;
 	ArgFree() ;
 
 	_MUTEX_ATTR_DESTROY(Mutex.mattr);
@@ -28,6 +28,8 @@ void LibSetup(enum enum_program_type program_type)
 
 	Cache_Open();
 	Detail_Init();
+	ParsedName_Cache_Open();
+	TaskPool_Open();
 
 	StateInfo.start_time = NOW_TIME;
 	SetLocalControlFlags() ; // reset by every option and other change.
@@ -32,6 +32,8 @@ struct mutexes Mutex ;
 /* Essentially sets up mutexes to protect global data/devices */
 void LockSetup(void)
 {
+	int slab_class ;
+
 	/* global mutex attribute */
 	_MUTEX_ATTR_INIT(Mutex.mattr);
 
@@ -79,6 +81,9 @@ void LockSetup(void)
 	_MUTEX_INIT(Mutex.externalcount_mutex);
 	_MUTEX_INIT(Mutex.timegm_mutex);
 	_MUTEX_INIT(Mutex.detail_mutex);
+	for ( slab_class = 0 ; slab_class < OWSLAB_CLASSES ; ++slab_class ) {
+		_MUTEX_INIT(Mutex.slab_mutex[slab_class]);
+	}
 
 	RWLOCK_INIT(Mutex.lib);
 	RWLOCK_INIT(Mutex.cache);
@@ -18,6 +18,11 @@
 #include "ow_counters.h"
 #include "ow_connection.h"
 
+#ifdef HAVE_SYS_EPOLL_H
+#include <sys/epoll.h>
+#endif							/* HAVE_SYS_EPOLL_H */
+#include <netinet/tcp.h>			// TCP_NODELAY
+
 /* Locking for thread work */
 /* Variables only used in this particular file */
 /* i.e. "locally global" */
@@ -33,6 +38,7 @@ static GOOD_OR_BAD ServerAddr(const char * default_port, struct connection_out *
 static GOOD_OR_BAD ServerListen(struct connection_out *out);
 
 static FILE_DESCRIPTOR_OR_ERROR SetupListenSet( fd_set * listenset ) ;
+static void ServerNoDelay( FILE_DESCRIPTOR_OR_ERROR file_descriptor ) ;
 static GOOD_OR_BAD SetupListenSockets( void (*HandlerRoutine) (FILE_DESCRIPTOR_OR_ERROR file_descriptor) ) ;
 static void CloseListenSockets( void ) ;
 static void ProcessListenSocket( struct connection_out * out ) ;
@@ -40,6 +46,8 @@ static void *ProcessAcceptSocket(void *arg) ;
 static void ProcessListenSet( fd_set * listenset ) ;
 static GOOD_OR_BAD ListenCycle( void ) ;
 
+static void RequestHandler( FILE_DESCRIPTOR_OR_ERROR file_descriptor ) ;
+
 static GOOD_OR_BAD ServerAddr(const char * default_port, struct connection_out *out)
 {
 	struct addrinfo hint;
@@ -273,6 +281,16 @@ static void *ProcessAcceptSocket(void *arg)
 	return VOID_RETURN;
 }
 
+/* A reply goes out in pieces -- a header, then each directory element --
+ * send each as it's ready, not after the client's delayed ack of the last.
+ * (Fails harmlessly on a unix socket) */
+static void ServerNoDelay( FILE_DESCRIPTOR_OR_ERROR file_descriptor )
+{
+	int tcp_nodelay = 1 ;
+
+	setsockopt(file_descriptor, IPPROTO_TCP, TCP_NODELAY, &tcp_nodelay, sizeof(tcp_nodelay));
+}
+
 static void ProcessListenSocket( struct connection_out * out )
 {
 	FILE_DESCRIPTOR_OR_ERROR acceptfd;
@@ -283,6 +301,7 @@ static void ProcessListenSocket( struct connection_out * out )
 	if ( FILE_DESCRIPTOR_NOT_VALID( acceptfd ) ) {
 		return ;
 	}
+	ServerNoDelay( acceptfd ) ;
 
 	// allocate space to pass variables to thread 
 	// MUST be cleaned up in thread handler, not in this routine
@@ -364,6 +383,585 @@ void ServerProcess(void (*HandlerRoutine) (FILE_DESCRIPTOR_OR_ERROR file_descrip
 	return;
 }
 
+/* Request-at-a-time server (owserver)
+ * The LengthRoutine says how much of the request to read, given what has been
+ * read so far (sc->request, sc->request_read): the header first, then all of it.
+ * The RequestRoutine handles the single whole request read into sc->request
+ * and sets sc->idle if the connection should be kept for another one.
+ * The CloseRoutine is called once, just before the connection is closed.
+ *
+ * With epoll, a fixed pool of worker threads handles the requests and the idle
+ * connections wait in epoll (parked) rather than each holding a thread.
+ * Requests are read as they arrive, without waiting, so a slow client
+ * parks again rather than holding a worker.
+ * Otherwise each connection gets its own thread, as ServerProcess does.
+ * */
+static void (*Server_RequestRoutine) (struct server_connection * sc) ;
+static ssize_t (*Server_LengthRoutine) (struct server_connection * sc) ;
+static void (*Server_CloseRoutine) (struct server_connection * sc) ;
+
+/* Make room for the request, as far as its length is known */
+static GOOD_OR_BAD RequestRoom( struct server_connection * sc, size_t needed )
+{
+	if ( needed > sc->request_size ) {
+		BYTE * request = owrealloc( sc->request, needed ) ;
+		if ( request == NULL ) {
+			LEVEL_DEBUG("Could not allocate memory for this request");
+			return gbBAD ;
+		}
+		sc->request = request ;
+		sc->request_size = needed ;
+	}
+	return gbGOOD ;
+}
+
+/* Read the whole next request, waiting for it (thread-per-connection version) */
+static GOOD_OR_BAD RequestRead( struct server_connection * sc )
+{
+	struct timeval tv = { Globals.timeout_server, 0, } ;
+
+	sc->request_read = 0 ;
+	while ( 1 ) {
+		ssize_t needed = Server_LengthRoutine( sc ) ;
+		size_t actual_read ;
+
+		if ( needed < 0 ) {
+			return gbBAD ;
+		}
+		if ( (size_t) needed <= sc->request_read ) {
+			return gbGOOD ;
+		}
+		RETURN_BAD_IF_BAD( RequestRoom( sc, needed ) ) ;
+		tcp_read( sc->file_descriptor, &(sc->request[sc->request_read]), needed - sc->request_read, &tv, &actual_read ) ;
+		if ( actual_read != needed - sc->request_read ) {
+			return gbBAD ;
+		}
+		sc->request_read = needed ;
+	}
+}
+
+/* Thread-per-connection version (no epoll, or no worker threads) */
+static void RequestHandler( FILE_DESCRIPTOR_OR_ERROR file_descriptor )
+{
+	struct server_connection sc ;
+
+	memset( &sc, 0, sizeof(struct server_connection) ) ;
+	sc.file_descriptor = file_descriptor ;
+
+	do {
+		if ( BAD( RequestRead( &sc ) ) ) {
+			break ;
+		}
+		timerclear( &(sc.idle) ) ;
+		Server_RequestRoutine( &sc ) ;
+	} while ( timerisset( &(sc.idle) ) && GOOD( tcp_wait( file_descriptor, &(sc.idle) ) ) ) ;
+
+	if ( Server_CloseRoutine != NULL ) {
+		Server_CloseRoutine( &sc ) ;
+	}
+	if ( sc.request != NULL ) {
+		owfree( sc.request ) ;
+	}
+	// file descriptor closed by ProcessAcceptSocket
+}
+
+#ifdef HAVE_SYS_EPOLL_H
+
+#define SERVER_EVENTS_PER_WAIT 64
+#define SERVER_EVENTS_TICK_MS 1000
+
+/* Other work for the worker threads (e.g. pipelined owserver requests) */
+struct server_task {
+	void (*routine) (void * arg) ;
+	void * arg ;
+	struct server_task * next ;
+} ;
+
+static struct {
+	pthread_mutex_t mutex ; // work queues and parked list
+	pthread_cond_t ready ; // work queued, or shutdown
+	struct server_connection * queue_head ;
+	struct server_connection * queue_tail ;
+	struct server_task * task_head ;
+	struct server_task * task_tail ;
+	struct server_connection * parked ;
+	FILE_DESCRIPTOR_OR_ERROR epoll_fd ;
+	int shutdown ;
+	int running ; // workers are taking tasks (only changed while no requests are handled)
+} Events ;
+
+#define EVENTSLOCK    _MUTEX_LOCK(   Events.mutex )
+#define EVENTSUNLOCK  _MUTEX_UNLOCK( Events.mutex )
+
+enum request_fill {
+	request_complete ,
+	request_partial , // the rest is still to come
+	request_closed , // by the client, or garbled
+} ;
+
+/* Called with Events locked */
+static void EventsUnpark( struct server_connection * sc )
+{
+	if ( sc->prev != NULL ) {
+		sc->prev->next = sc->next ;
+	} else {
+		Events.parked = sc->next ;
+	}
+	if ( sc->next != NULL ) {
+		sc->next->prev = sc->prev ;
+	}
+	sc->next = sc->prev = NULL ;
+	sc->parked = 0 ;
+}
+
+/* Called with Events locked */
+static void EventsQueue( struct server_connection * sc )
+{
+	sc->next = NULL ;
+	if ( Events.queue_tail != NULL ) {
+		Events.queue_tail->next = sc ;
+	} else {
+		Events.queue_head = sc ;
+	}
+	Events.queue_tail = sc ;
+	my_pthread_cond_signal( &Events.ready ) ;
+}
+
+static void EventsClose( struct server_connection * sc )
+{
+	if ( sc->registered ) {
+		epoll_ctl( Events.epoll_fd, EPOLL_CTL_DEL, sc->file_descriptor, NULL ) ;
+	}
+	if ( Server_CloseRoutine != NULL ) {
+		Server_CloseRoutine( sc ) ;
+	}
+	Test_and_Close( &(sc->file_descriptor) ) ;
+	if ( sc->request != NULL ) {
+		owfree( sc->request ) ;
+	}
+	owfree( sc ) ;
+}
+
+/* Park until this long from now */
+static void EventsDeadline( struct server_connection * sc, const struct timeval * wait )
+{
+	struct timeval now ;
+
+	timernow( &now ) ;
+	timeradd( &now, wait, &(sc->idle_until) ) ;
+}
+
+/* Wait (without a thread) for more of this connection, until sc->idle_until
+ * Once armed, the connection belongs to the event loop -- it may already be
+ * handled, or even closed, by another thread when epoll_ctl returns.
+ * So it is armed under the Events lock, which the event loop and the sweep
+ * take before touching a parked connection, and left alone afterwards. */
+static void EventsPark( struct server_connection * sc )
+{
+	struct epoll_event event ;
+	int operation = sc->registered ? EPOLL_CTL_MOD : EPOLL_CTL_ADD ;
+
+	memset( &event, 0, sizeof(struct epoll_event) ) ;
+	event.events = EPOLLIN | EPOLLONESHOT ;
+	event.data.ptr = sc ;
+
+	EVENTSLOCK ;
+	if ( Events.shutdown ) {
+		EVENTSUNLOCK ;
+		EventsClose( sc ) ;
+		return ;
+	}
+	sc->prev = NULL ;
+	sc->next = Events.parked ;
+	if ( sc->next != NULL ) {
+		sc->next->prev = sc ;
+	}
+	Events.parked = sc ;
+	sc->parked = 1 ;
+	sc->registered = 1 ;
+	if ( epoll_ctl( Events.epoll_fd, operation, sc->file_descriptor, &event ) == 0 ) {
+		EVENTSUNLOCK ;
+		return ;
+	}
+	EventsUnpark( sc ) ;
+	EVENTSUNLOCK ;
+
+	ERROR_DEBUG("Cannot wait for the next request on this connection") ;
+	EventsClose( sc ) ;
+}
+
+/* Read what has arrived of the request, without waiting for the rest */
+static enum request_fill EventsRead( struct server_connection * sc )
+{
+	while ( 1 ) {
+		ssize_t needed = Server_LengthRoutine( sc ) ;
+		ssize_t got ;
+
+		if ( needed < 0 ) {
+			return request_closed ;
+		}
+		if ( (size_t) needed <= sc->request_read ) {
+			return request_complete ;
+		}
+		if ( BAD( RequestRoom( sc, needed ) ) ) {
+			return request_closed ;
+		}
+		got = recv( sc->file_descriptor, &(sc->request[sc->request_read]), needed - sc->request_read, MSG_DONTWAIT ) ;
+		if ( got > 0 ) {
+			sc->request_read += got ;
+		} else if ( got < 0 && errno == EINTR ) {
+			continue ;
+		} else if ( got < 0 && ( errno == EAGAIN || errno == EWOULDBLOCK ) ) {
+			return request_partial ;
+		} else {
+			return request_closed ;
+		}
+	}
+}
+
+/* One event on a client connection: read, and handle the request if it is all here */
+static void EventsRequest( struct server_connection * sc )
+{
+	size_t already_read = sc->request_read ;
+
+	switch ( EventsRead( sc ) ) {
+		case request_complete:
+			break ;
+		case request_partial:
+			if ( already_read == 0 ) {
+				// the whole request has timeout_server from its first byte
+				struct timeval wait = { Globals.timeout_server, 0, } ;
+				EventsDeadline( sc, &wait ) ;
+			}
+			EventsPark( sc ) ;
+			return ;
+		case request_closed:
+		default:
+			EventsClose( sc ) ;
+			return ;
+	}
+
+	timerclear( &(sc->idle) ) ;
+	Server_RequestRoutine( sc ) ;
+	sc->request_read = 0 ;
+	if ( timerisset( &(sc->idle) ) ) {
+		EventsDeadline( sc, &(sc->idle) ) ;
+		EventsPark( sc ) ;
+	} else {
+		EventsClose( sc ) ;
+	}
+}
+
+static void * EventsWorker( void * v )
+{
+	(void) v ;
+
+	while ( 1 ) {
+		struct server_connection * sc ;
+		struct server_task * task ;
+
+		EVENTSLOCK ;
+		while ( Events.queue_head == NULL && Events.task_head == NULL && ! Events.shutdown ) {
+			my_pthread_cond_wait( &Events.ready, &Events.mutex ) ;
+		}
+		// requests already read come before reading new ones
+		task = Events.task_head ;
+		if ( task != NULL ) {
+			Events.task_head = task->next ;
+			if ( Events.task_head == NULL ) {
+				Events.task_tail = NULL ;
+			}
+			EVENTSUNLOCK ;
+
+			task->routine( task->arg ) ;
+			owfree( task ) ;
+			continue ;
+		}
+		sc = Events.queue_head ;
+		if ( sc == NULL ) {
+			// shutdown and nothing left to do
+			EVENTSUNLOCK ;
+			break ;
+		}
+		Events.queue_head = sc->next ;
+		if ( Events.queue_head == NULL ) {
+			Events.queue_tail = NULL ;
+		}
+		EVENTSUNLOCK ;
+
+		EventsRequest( sc ) ;
+	}
+	return VOID_RETURN ;
+}
+
+static void EventsAccept( struct server_connection * listener )
+{
+	struct server_connection * sc ;
+	FILE_DESCRIPTOR_OR_ERROR acceptfd = accept( listener->file_descriptor, NULL, NULL ) ;
+
+	if ( FILE_DESCRIPTOR_NOT_VALID( acceptfd ) ) {
+		return ;
+	}
+	ServerNoDelay( acceptfd ) ;
+	sc = owcalloc( 1, sizeof(struct server_connection) ) ;
+	if ( sc == NULL ) {
+		LEVEL_DEBUG("Could not allocate memory to handle this request");
+		close( acceptfd ) ;
+		return ;
+	}
+	sc->file_descriptor = acceptfd ;
+	// nothing to read yet -- wait for the first request like any other
+	sc->idle.tv_sec = Globals.timeout_server ;
+	EventsDeadline( sc, &(sc->idle) ) ;
+	EventsPark( sc ) ;
+}
+
+/* Close connections that have been idle too long */
+static void EventsSweep( void )
+{
+	struct server_connection * expired = NULL ;
+	struct server_connection * sc ;
+	struct server_connection * next ;
+	struct timeval now ;
+
+	timernow( &now ) ;
+	EVENTSLOCK ;
+	for ( sc = Events.parked ; sc != NULL ; sc = next ) {
+		next = sc->next ;
+		if ( timercmp( &(sc->idle_until), &now, < ) ) {
+			EventsUnpark( sc ) ;
+			sc->next = expired ;
+			expired = sc ;
+		}
+	}
+	EVENTSUNLOCK ;
+
+	for ( sc = expired ; sc != NULL ; sc = next ) {
+		next = sc->next ;
+		LEVEL_DEBUG("Idle connection closed") ;
+		EventsClose( sc ) ;
+	}
+}
+
+static int EventsStopping( void )
+{
+	int stop ;
+	RWLOCK_RLOCK( shutdown_mutex_rw ) ;
+	stop = shutdown_in_progress ;
+	RWLOCK_RUNLOCK( shutdown_mutex_rw ) ;
+	return stop ;
+}
+
+/* The listener loop -- accepts connections and hands ready ones to the workers */
+static void EventsLoop( void )
+{
+	struct epoll_event events[SERVER_EVENTS_PER_WAIT] ;
+
+	while ( ! EventsStopping() ) {
+		int event_count = epoll_wait( Events.epoll_fd, events, SERVER_EVENTS_PER_WAIT, SERVER_EVENTS_TICK_MS ) ;
+		int event_index ;
+
+		if ( event_count < 0 ) {
+			// interrupted (signal) -- time to leave, as with select
+			break ;
+		}
+		for ( event_index = 0 ; event_index < event_count ; ++event_index ) {
+			struct server_connection * sc = events[event_index].data.ptr ;
+			if ( sc->listener ) {
+				EventsAccept( sc ) ;
+				continue ;
+			}
+			EVENTSLOCK ;
+			if ( sc->parked ) {
+				EventsUnpark( sc ) ;
+				EventsQueue( sc ) ;
+			}
+			EVENTSUNLOCK ;
+		}
+		EventsSweep() ;
+	}
+}
+
+static pthread_t * Events_workers ;
+static int Events_started ;
+
+/* Create the event loop and start the workers
+ * Returns gbBAD if the event loop can't be used at all */
+static GOOD_OR_BAD EventsSetup( void )
+{
+	int threads = Globals.server_threads > 0 ? Globals.server_threads : 1 ;
+
+	Events.epoll_fd = epoll_create( SERVER_EVENTS_PER_WAIT ) ;
+	if ( FILE_DESCRIPTOR_NOT_VALID( Events.epoll_fd ) ) {
+		ERROR_DEBUG("Cannot create the epoll event loop");
+		return gbBAD ;
+	}
+	Events_workers = owcalloc( threads, sizeof(pthread_t) ) ;
+	if ( Events_workers == NULL ) {
+		close( Events.epoll_fd ) ;
+		return gbBAD ;
+	}
+
+	_MUTEX_INIT( Events.mutex ) ;
+	my_pthread_cond_init( &Events.ready, NULL ) ;
+	Events.queue_head = Events.queue_tail = Events.parked = NULL ;
+	Events.task_head = Events.task_tail = NULL ;
+	Events.shutdown = 0 ;
+
+	for ( Events_started = 0 ; Events_started < threads ; ++Events_started ) {
+		if ( pthread_create( &Events_workers[Events_started], DEFAULT_THREAD_ATTR, EventsWorker, NULL ) != 0 ) {
+			break ;
+		}
+	}
+	if ( Events_started == 0 ) {
+		LEVEL_DEBUG("Cannot start worker threads");
+		my_pthread_cond_destroy( &Events.ready ) ;
+		_MUTEX_DESTROY( Events.mutex ) ;
+		close( Events.epoll_fd ) ;
+		owfree( Events_workers ) ;
+		return gbBAD ;
+	}
+	LEVEL_DEBUG("%d worker threads for requests", Events_started) ;
+	Events.running = 1 ;
+	return gbGOOD ;
+}
+
+/* Let the workers finish what's queued, then close the idle connections */
+static void EventsTeardown( void )
+{
+	struct server_connection * sc ;
+
+	EVENTSLOCK ;
+	Events.shutdown = 1 ;
+	my_pthread_cond_broadcast( &Events.ready ) ;
+	EVENTSUNLOCK ;
+	while ( Events_started > 0 ) {
+		pthread_join( Events_workers[--Events_started], NULL ) ;
+	}
+	owfree( Events_workers ) ;
+	// the last worker emptied the task queue
+	Events.running = 0 ;
+
+	while ( Events.parked != NULL ) {
+		sc = Events.parked ;
+		EventsUnpark( sc ) ;
+		EventsClose( sc ) ;
+	}
+
+	close( Events.epoll_fd ) ;
+	my_pthread_cond_destroy( &Events.ready ) ;
+	_MUTEX_DESTROY( Events.mutex ) ;
+}
+
+/* Add the listening sockets to the event loop and run it */
+static void EventsListen( void )
+{
+	struct connection_out * out ;
+	struct server_connection * listeners = NULL ;
+	struct server_connection * sc ;
+
+	for (out = Outbound_Control.head; out; out = out->next) {
+		if ( FILE_DESCRIPTOR_VALID( out->file_descriptor ) ) {
+			struct epoll_event event ;
+			sc = owcalloc( 1, sizeof(struct server_connection) ) ;
+			if ( sc == NULL ) {
+				continue ;
+			}
+			sc->file_descriptor = out->file_descriptor ;
+			sc->listener = 1 ;
+			memset( &event, 0, sizeof(struct epoll_event) ) ;
+			event.events = EPOLLIN ;
+			event.data.ptr = sc ;
+			if ( epoll_ctl( Events.epoll_fd, EPOLL_CTL_ADD, sc->file_descriptor, &event ) != 0 ) {
+				ERROR_CONNECT("Cannot listen on [%s]", SAFESTRING(out->name));
+				owfree( sc ) ;
+				continue ;
+			}
+			sc->next = listeners ;
+			listeners = sc ;
+		}
+	}
+
+	if ( listeners != NULL ) {
+		EventsLoop() ;
+	}
+
+	while ( listeners != NULL ) {
+		sc = listeners ;
+		listeners = sc->next ;
+		owfree( sc ) ; // the listening socket itself belongs to connection_out
+	}
+}
+#endif							/* HAVE_SYS_EPOLL_H */
+
+/* Run routine(arg) on one of the worker threads, for a request that
+ * shouldn't hold up its connection (owserver pipelining)
+ * Returns gbBAD if there are no worker threads (thread-per-connection)
+ * and the caller should do the work itself */
+GOOD_OR_BAD ServerRequestTask( void (*routine) (void * arg), void * arg )
+{
+#ifdef HAVE_SYS_EPOLL_H
+	struct server_task * task ;
+
+	if ( ! Events.running ) {
+		return gbBAD ;
+	}
+	task = owmalloc( sizeof(struct server_task) ) ;
+	if ( task == NULL ) {
+		return gbBAD ;
+	}
+	task->routine = routine ;
+	task->arg = arg ;
+	task->next = NULL ;
+
+	EVENTSLOCK ;
+	// still taken at shutdown -- the workers empty this queue before they stop
+	if ( Events.task_tail != NULL ) {
+		Events.task_tail->next = task ;
+	} else {
+		Events.task_head = task ;
+	}
+	Events.task_tail = task ;
+	my_pthread_cond_signal( &Events.ready ) ;
+	EVENTSUNLOCK ;
+	return gbGOOD ;
+#else							/* HAVE_SYS_EPOLL_H */
+	(void) routine ;
+	(void) arg ;
+	return gbBAD ;
+#endif							/* HAVE_SYS_EPOLL_H */
+}
+
+/* Main loop for owserver -- see above */
+void ServerProcessRequests(void (*RequestRoutine) (struct server_connection * sc), ssize_t (*LengthRoutine) (struct server_connection * sc), void (*CloseRoutine) (struct server_connection * sc))
+{
+	Server_RequestRoutine = RequestRoutine ;
+	Server_LengthRoutine = LengthRoutine ;
+	Server_CloseRoutine = CloseRoutine ;
+
+#ifdef HAVE_SYS_EPOLL_H
+	if ( GOOD( EventsSetup() ) ) {
+		shutdown_in_progress = 0 ;
+		RWLOCK_INIT( shutdown_mutex_rw ) ;
+
+		if ( GOOD( SetupListenSockets( RequestHandler ) ) ) {
+			Announce_Systemd() ; // systemd mode -- ready for business
+			EventsListen() ;
+		} else {
+			LEVEL_DEFAULT("Isolated from any control -- exit") ;
+		}
+
+		EventsTeardown() ;
+		RWLOCK_DESTROY(shutdown_mutex_rw) ;
+		CloseListenSockets() ;
+		return ;
+	}
+	LEVEL_DEBUG("Falling back to a thread per connection") ;
+#endif							/* HAVE_SYS_EPOLL_H */
+
+	ServerProcess( RequestHandler ) ;
+}
+
 /* Call from elseware
  * specifically the configuration monitoring code
  * to stop the loops
@@ -114,6 +114,9 @@ const struct option owopts_long[] = {
 	{"cache_size", required_argument, NO_LINKED_VAR, e_cache_size},	/* max cache size */
 	{"cache-size", required_argument, NO_LINKED_VAR, e_cache_size},	/* max cache size */
 	{"cachesize", required_argument, NO_LINKED_VAR, e_cache_size},	/* max cache size */
+	{"cache_policy", required_argument, NO_LINKED_VAR, e_cache_policy},	/* replacement when full */
+	{"cache-policy", required_argument, NO_LINKED_VAR, e_cache_policy},	/* replacement when full */
+	{"cachepolicy", required_argument, NO_LINKED_VAR, e_cache_policy},	/* replacement when full */
 	{"fuse_opt", required_argument, NO_LINKED_VAR, e_fuse_opt},	/* owfs, fuse mount option */
 	{"fuse-opt", required_argument, NO_LINKED_VAR, e_fuse_opt},	/* owfs, fuse mount option */
 	{"fuseopt", required_argument, NO_LINKED_VAR, e_fuse_opt},	/* owfs, fuse mount option */
@@ -197,6 +200,10 @@ const struct option owopts_long[] = {
 	{"USB_flextime", no_argument, &Globals.usb_flextime, 1},
 	{"usb_regulartime", no_argument, &Globals.usb_flextime, 0},
 	{"USB_regulartime", no_argument, &Globals.usb_flextime, 0},
+	{"usb_sync", no_argument, &Globals.usb_sync, 1},
+	{"USB_sync", no_argument, &Globals.usb_sync, 1},
+	{"usb_async", no_argument, &Globals.usb_sync, 0},
+	{"USB_async", no_argument, &Globals.usb_sync, 0},
 	{"serial_flex", no_argument, &Globals.serial_flextime, 1},
 	{"serial_flextime", no_argument, &Globals.serial_flextime, 1},
 	{"serial_regulartime", no_argument, &Globals.serial_flextime, 0},
@@ -238,6 +245,16 @@ const struct option owopts_long[] = {
 	{"timeout_persistent_high", required_argument, NO_LINKED_VAR, e_timeout_persistent_high,},
 	{"clients_persistent_low", required_argument, NO_LINKED_VAR, e_clients_persistent_low,},
 	{"clients_persistent_high", required_argument, NO_LINKED_VAR, e_clients_persistent_high,},
+	{"server_threads", required_argument, NO_LINKED_VAR, e_server_threads,},	// owserver request workers
+	{"server-threads", required_argument, NO_LINKED_VAR, e_server_threads,},	// owserver request workers
+	{"server_pool", required_argument, NO_LINKED_VAR, e_server_pool,},	// persistent connections per owserver
+	{"server-pool", required_argument, NO_LINKED_VAR, e_server_pool,},	// persistent connections per owserver
+	{"server_pool_idle", required_argument, NO_LINKED_VAR, e_server_pool_idle,},	// idle time before closing
+	{"server-pool-idle", required_argument, NO_LINKED_VAR, e_server_pool_idle,},	// idle time before closing
+	{"pool_threads", required_argument, NO_LINKED_VAR, e_pool_threads,},	// parallel bus task workers
+	{"pool-threads", required_argument, NO_LINKED_VAR, e_pool_threads,},	// parallel bus task workers
+	{"bus_requests", required_argument, NO_LINKED_VAR, e_bus_requests_limit,},	// filesystem requests per bus at once
+	{"bus-requests", required_argument, NO_LINKED_VAR, e_bus_requests_limit,},	// filesystem requests per bus at once
 
 	{"temperature_low", required_argument, NO_LINKED_VAR, e_templow,},
 	{"low_temperature", required_argument, NO_LINKED_VAR, e_templow,},
@@ -753,6 +770,19 @@ GOOD_OR_BAD owopt(const int option_char, const char *arg)
 		RETURN_BAD_IF_BAD(OW_parsevalue_I(&arg_to_integer, arg)) ;
 		Globals.cache_size = (size_t) arg_to_integer;
 		break;
+	case e_cache_policy:
+		if (arg == NULL) {
+			LEVEL_DEFAULT("No cache policy specified");
+			return gbBAD;
+		} else if (!strcasecmp(arg, "clock") || !strcasecmp(arg, "lru")) {
+			Globals.cache_policy = cache_policy_clock ;
+		} else if (!strcasecmp(arg, "reject") || !strcasecmp(arg, "none")) {
+			Globals.cache_policy = cache_policy_reject ;
+		} else {
+			LEVEL_DEFAULT("Unrecognized cache policy %s (clock or reject)", arg);
+			return gbBAD;
+		}
+		break;
 	case e_fuse_opt:			/* fuse_opt, handled in owfs.c */
 		break;
 	case e_fuse_open_opt:		/* fuse_open_opt, handled in owfs.c */
@@ -875,6 +905,26 @@ GOOD_OR_BAD owopt(const int option_char, const char *arg)
 		// Using the character as a numeric value -- convenient but risky
 		(&Globals.timeout_volatile)[option_char - e_timeout_volatile] = (int) arg_to_integer;
 		break;
+	case e_server_threads:
+		RETURN_BAD_IF_BAD(OW_parsevalue_I(&arg_to_integer, arg)) ;
+		Globals.server_threads = (int) arg_to_integer;
+		break;
+	case e_server_pool:
+		RETURN_BAD_IF_BAD(OW_parsevalue_I(&arg_to_integer, arg)) ;
+		Globals.server_pool = (int) arg_to_integer;
+		break;
+	case e_server_pool_idle:
+		RETURN_BAD_IF_BAD(OW_parsevalue_I(&arg_to_integer, arg)) ;
+		Globals.server_pool_idle = (int) arg_to_integer;
+		break;
+	case e_pool_threads:
+		RETURN_BAD_IF_BAD(OW_parsevalue_I(&arg_to_integer, arg)) ;
+		Globals.pool_threads = (int) arg_to_integer;
+		break;
+	case e_bus_requests_limit:
+		RETURN_BAD_IF_BAD(OW_parsevalue_I(&arg_to_integer, arg)) ;
+		Globals.bus_requests = (int) arg_to_integer;
+		break;
 	case e_baud:
 		RETURN_BAD_IF_BAD(OW_parsevalue_I(&arg_to_integer, arg)) ;
 		Globals.baud = COM_MakeBaud( arg_to_integer ) ;
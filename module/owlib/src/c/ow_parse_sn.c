@@ -8,61 +8,68 @@
     1wire/iButton system from Dallas Semiconductor
 */
 
-// regex
-
 #include <config.h>
 #include "owfs_config.h"
 #include "ow.h"
 
-static regex_t rx_sn_parse;
-
-static void regex_fini(void)
-{
-	regfree(&rx_sn_parse);
-}
-
-static pthread_once_t regex_init_once = PTHREAD_ONCE_INIT;
-
-static void regex_init(void)
+/* Decode count bytes of hex (2 characters each) -- returns pointer past them, or NULL */
+static const char * Parse_Hex( const char * hex, BYTE * bytes, int count )
 {
-	ow_regcomp(&rx_sn_parse, "^([[:xdigit:]]{2})\\.?([[:xdigit:]]{12})\\.?([[:xdigit:]]{2}){0,1}$", 0);
+	int i ;
 
-	atexit(regex_fini);
+	for ( i = 0 ; i < count ; ++i ) {
+		if ( ! isxdigit( hex[0] ) || ! isxdigit( hex[1] ) ) {
+			return NULL ;
+		}
+		bytes[i] = string2num( hex ) ;
+		hex += 2 ;
+	}
+	return hex ;
 }
 
 /* Fill get serikal number from a character string */ 
+/* Form: FF.IIIIIIIIIIII.CC with both dots and the CRC optional */
 enum parse_serialnumber Parse_SerialNumber(char *sn_char, BYTE * sn)
 {
-	pthread_once(&regex_init_once,regex_init);
+	const char * hex = sn_char ;
+	BYTE id[SERIAL_NUMBER_SIZE] ; // sn is untouched unless this is a serial number
+	BYTE crc ;
 
-	struct ow_regmatch orm ;
-	orm.number = 3 ;
-	
 	if ( sn_char == NULL ) {
 		return sn_null ;
 	}
 
-	if ( ow_regexec( &rx_sn_parse, sn_char, &orm ) != 0 ) {
+	// family code
+	hex = Parse_Hex( hex, &id[0], 1 ) ;
+	if ( hex == NULL ) {
 		return sn_not_sn ;
 	}
-		
-	sn[0] = string2num(orm.match[1]);
-	sn[1] = string2num(&orm.match[2][0]);
-	sn[2] = string2num(&orm.match[2][2]);
-	sn[3] = string2num(&orm.match[2][4]);
-	sn[4] = string2num(&orm.match[2][6]);
-	sn[5] = string2num(&orm.match[2][8]);
-	sn[6] = string2num(&orm.match[2][10]);
-	sn[7] = CRC8compute(sn, SERIAL_NUMBER_SIZE-1, 0);
-	if (orm.match[3] != NULL) {
-		// CRC given
-		if ( string2num(orm.match[3]) != sn[7] ) {
-			ow_regexec_free( &orm ) ;
-			return sn_invalid;
-		}
+	if ( hex[0] == '.' ) {
+		++hex ;
+	}
+
+	// ID
+	hex = Parse_Hex( hex, &id[1], 6 ) ;
+	if ( hex == NULL ) {
+		return sn_not_sn ;
+	}
+	if ( hex[0] == '.' ) {
+		++hex ;
+	}
+
+	id[7] = CRC8compute(id, SERIAL_NUMBER_SIZE-1, 0);
+	if ( hex[0] == '\0' ) {
+		memcpy( sn, id, SERIAL_NUMBER_SIZE ) ;
+		return sn_valid ;
+	}
+
+	// CRC given
+	hex = Parse_Hex( hex, &crc, 1 ) ;
+	if ( hex == NULL || hex[0] != '\0' ) {
+		return sn_not_sn ;
 	}
-	ow_regexec_free( &orm ) ;
-	return sn_valid ;
+	memcpy( sn, id, SERIAL_NUMBER_SIZE ) ;
+	return ( crc == id[7] ) ? sn_valid : sn_invalid ;
 }
 
 // returns number of valid bytes in serial number
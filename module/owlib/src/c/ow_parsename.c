@@ -8,8 +8,6 @@
     1wire/iButton system from Dallas Semiconductor
 */
 
-// regex
-
 #include <config.h>
 #include "owfs_config.h"
 #include "ow_devices.h"
@@ -50,76 +48,180 @@ static ZERO_OR_ERROR FS_ParsedName_anywhere(const char *path, enum parse_pass re
 static ZERO_OR_ERROR FS_ParsedName_setup(struct parsedname_pointers *pp, const char *path, struct parsedname *pn);
 static char * find_segment_in_path( char * segment, char * path ) ;
 
+enum path_cache_result {
+	path_cache_miss,
+	path_cache_hit,
+	path_cache_stale,	// bus is gone -- parse again
+	path_cache_absent,	// device failed the presence check
+};
+
+static enum path_cache_result PathCache_Get( enum parse_pass remote_status, struct parsedname * pn, UINT * generation ) ;
+static void PathCache_Add( enum parse_pass remote_status, enum ePS_state initial_state, UINT generation, const struct parsedname * pn ) ;
+
 #define BRANCH_INCR (9)
 
-static regex_t rx_bus;
-static regex_t rx_set;
-static regex_t rx_sta;
-static regex_t rx_str;
-static regex_t rx_sys;
-static regex_t rx_int;
-static regex_t rx_tex;
-static regex_t rx_jso;
-static regex_t rx_unc;
-static regex_t rx_una;
-static regex_t rx_ala;
-static regex_t rx_sim;
-static regex_t rx_the;
-static regex_t rx_p_bus;
-static regex_t rx_extension;
-static regex_t rx_all;
-static regex_t rx_byte;
-static regex_t rx_number;
-static regex_t rx_letter;
-
-static void regex_fini(void)
-{
-	regfree(&rx_bus);
-	regfree(&rx_set);
-	regfree(&rx_sta);
-	regfree(&rx_str);
-	regfree(&rx_sys);
-	regfree(&rx_int);
-	regfree(&rx_tex);
-	regfree(&rx_jso);
-	regfree(&rx_unc);
-	regfree(&rx_una);
-	regfree(&rx_ala);
-	regfree(&rx_sim);
-	regfree(&rx_the);
-	regfree(&rx_p_bus);
-	regfree(&rx_extension);
-	regfree(&rx_all);
-	regfree(&rx_byte);
-	regfree(&rx_number);
-	regfree(&rx_letter);
-}
-
-static pthread_once_t regex_init_once = PTHREAD_ONCE_INIT;
-
-static void regex_init(void)
-{
-	ow_regcomp(&rx_bus, "^bus\\.([[:digit:]]+)/?", REG_ICASE);
-	ow_regcomp(&rx_set, "^settings/?", REG_ICASE | REG_NOSUB);
-	ow_regcomp(&rx_sta, "^statistics/?", REG_ICASE | REG_NOSUB);
-	ow_regcomp(&rx_str, "^structure/?", REG_ICASE | REG_NOSUB);
-	ow_regcomp(&rx_sys, "^system/?", REG_ICASE | REG_NOSUB);
-	ow_regcomp(&rx_int, "^interface/?", REG_ICASE | REG_NOSUB);
-	ow_regcomp(&rx_tex, "^text/?", REG_ICASE | REG_NOSUB);
-	ow_regcomp(&rx_jso, "^json/?", REG_ICASE | REG_NOSUB);
-	ow_regcomp(&rx_unc, "^uncached/?", REG_ICASE | REG_NOSUB);
-	ow_regcomp(&rx_una, "^unaliased/?", REG_ICASE | REG_NOSUB);
-	ow_regcomp(&rx_ala, "^alarm\?", REG_ICASE | REG_NOSUB);
-	ow_regcomp(&rx_sim, "^simultaneous/?", REG_ICASE | REG_NOSUB);
-	ow_regcomp(&rx_the, "^thermostat/?", REG_ICASE | REG_NOSUB);
-	ow_regcomp(&rx_p_bus, "^/bus\\.[[:digit:]]+/?", REG_ICASE);
-	ow_regcomp(&rx_extension, "\\.", 0);
-	ow_regcomp(&rx_all, "\\.all$", REG_ICASE);
-	ow_regcomp(&rx_byte, "\\.byte$", REG_ICASE);
-	ow_regcomp(&rx_number, "\\.[[:digit:]]+$", 0);
-	ow_regcomp(&rx_letter, "\\.[[:alpha:]]$", REG_ICASE);
-
-	atexit(regex_fini);
+/* Parsed-path cache
+ * The same few paths are parsed for every request, so a successful parse is
+ * kept, keyed by the path string. A hit copies what the parse derived from the
+ * path (type, state, serial number, device, property, extension) and skips the
+ * keyword, alias and property lookups.
+ * Bus pointers are not kept: the bus is attached again by index, and the
+ * presence check is repeated, just as a fresh parse would do.
+ *
+ * Slots are direct-mapped and split into shards, each with a reader/writer
+ * lock. Alias and bus changes call ParsedName_Cache_Invalidate, which bumps
+ * every shard generation so older entries just miss.
+ * */
+#define PATH_CACHE_SHARDS	16	/* must be a power of 2 */
+#define PATH_CACHE_SLOTS	64	/* per shard, must be a power of 2 */
+#define PATH_CACHE_LENGTH	128	/* longer paths aren't cached */
+
+struct path_cache_entry {
+	UINT generation ;			// shard generation when stored (0 = empty)
+	UINT hash ;
+	enum parse_pass remote_status ;
+	enum ePS_state initial_state ;	// from --uncached and --unaliased
+	char path[PATH_CACHE_LENGTH+1] ;
+	char path_to_server[PATH_CACHE_LENGTH+16] ; // an alias replaced by serial number can be longer
+	enum ePN_type type ;
+	enum ePS_state state ;
+	BYTE sn[SERIAL_NUMBER_SIZE] ;
+	struct device * selected_device ;
+	struct filetype * selected_filetype ;
+	struct filetype * subdir ;
+	int extension ;
+	char * sparse_name ;
+	int dirlength ;
+	int device_name_offset ;		// into path, -1 for none
+	INDEX_OR_ERROR bus_index ;		// INDEX_BAD if no bus chosen
+	int bus_list ;				// SHOULD_RETURN_BUS_LIST still set
+	int presence ;				// repeat CheckPresence on each hit
+};
+
+struct path_cache_shard {
+	my_rwlock_t lock ;
+	UINT generation ;
+	struct path_cache_entry slot[PATH_CACHE_SLOTS] ;
+};
+
+static struct path_cache_shard path_cache[PATH_CACHE_SHARDS] ;
+
+/* Reserved directory names -- matched whole and case-insensitive
+ * Called for every path segment, so a switch on the first letter rather than a search
+ * */
+enum parse_keyword {
+	pk_none,
+	pk_bus,
+	pk_settings,
+	pk_statistics,
+	pk_structure,
+	pk_system,
+	pk_interface,
+	pk_text,
+	pk_json,
+	pk_uncached,
+	pk_unaliased,
+	pk_alarm,
+	pk_simultaneous,
+	pk_thermostat,
+} ;
+
+#define KEYWORD_IS(name,keyword) if ( strcasecmp( segment, name ) == 0 ) { return keyword ; }
+
+static enum parse_keyword Parse_Keyword( const char * segment, INDEX_OR_ERROR * bus_number )
+{
+	switch ( segment[0] ) {
+		case 'a':
+		case 'A':
+			KEYWORD_IS( "alarm", pk_alarm ) ;
+			break ;
+		case 'b':
+		case 'B':
+			// bus.n
+			if ( strncasecmp( segment, "bus.", 4 ) == 0 && isdigit( segment[4] ) ) {
+				const char * digit = &segment[4] ;
+				while ( isdigit( *digit ) ) {
+					++digit ;
+				}
+				if ( *digit == '\0' ) {
+					*bus_number = (INDEX_OR_ERROR) atoi( &segment[4] ) ;
+					return pk_bus ;
+				}
+			}
+			break ;
+		case 'i':
+		case 'I':
+			KEYWORD_IS( "interface", pk_interface ) ;
+			break ;
+		case 'j':
+		case 'J':
+			KEYWORD_IS( "json", pk_json ) ;
+			break ;
+		case 's':
+		case 'S':
+			KEYWORD_IS( "settings", pk_settings ) ;
+			KEYWORD_IS( "statistics", pk_statistics ) ;
+			KEYWORD_IS( "structure", pk_structure ) ;
+			KEYWORD_IS( "system", pk_system ) ;
+			KEYWORD_IS( "simultaneous", pk_simultaneous ) ;
+			break ;
+		case 't':
+		case 'T':
+			KEYWORD_IS( "text", pk_text ) ;
+			KEYWORD_IS( "thermostat", pk_thermostat ) ;
+			break ;
+		case 'u':
+		case 'U':
+			KEYWORD_IS( "uncached", pk_uncached ) ;
+			KEYWORD_IS( "unaliased", pk_unaliased ) ;
+			break ;
+		default:
+			break ;
+	}
+	return pk_none ;
+}
+
+/* Property extensions (the part after '.') */
+
+/* ".name" ends the filename (case-insensitive) */
+static int Parse_Suffix( const char * filename, const char * name )
+{
+	size_t filename_length = strlen( filename ) ;
+	size_t name_length = strlen( name ) ;
+
+	if ( filename_length <= name_length ) {
+		return 0 ;
+	}
+	return filename[filename_length-name_length-1] == '.'
+		&& strcasecmp( &filename[filename_length-name_length], name ) == 0 ;
+}
+
+/* ".123" ends the filename -- returns the number or -1 */
+static int Parse_Number_Suffix( const char * filename )
+{
+	const char * dot = strrchr( filename, '.' ) ;
+	const char * digit ;
+
+	if ( dot == NULL || dot[1] == '\0' ) {
+		return -1 ;
+	}
+	for ( digit = &dot[1] ; *digit != '\0' ; ++digit ) {
+		if ( ! isdigit( *digit ) ) {
+			return -1 ;
+		}
+	}
+	return atoi( &dot[1] ) ;
+}
+
+/* ".A" ends the filename -- returns the letter index (A=0) or -1 */
+static int Parse_Letter_Suffix( const char * filename )
+{
+	size_t filename_length = strlen( filename ) ;
+
+	if ( filename_length < 2 || filename[filename_length-2] != '.' || ! isalpha( filename[filename_length-1] ) ) {
+		return -1 ;
+	}
+	return toupper( filename[filename_length-1] ) - 'A' ;
 }
 
 /* ---------------------------------------------- */
@@ -166,6 +268,8 @@ static ZERO_OR_ERROR FS_ParsedName_anywhere(const char *path, enum parse_pass re
 	struct parsedname_pointers *pp = &s_pp;
 	ZERO_OR_ERROR parse_error_status = 0;
 	enum parse_enum pe = parse_first;
+	enum ePS_state initial_state ;
+	UINT generation = 0 ;
 
 	// To make the debug output useful it's cleared here.
 	// Even on normal glibc, errno isn't cleared on good system calls
@@ -179,6 +283,25 @@ static ZERO_OR_ERROR FS_ParsedName_anywhere(const char *path, enum parse_pass re
 		RETURN_CODE_RETURN( 0 ) ; // success (by default)
 	}
 
+	initial_state = pn->state ;
+	switch ( PathCache_Get( remote_status, pn, &generation ) ) {
+		case path_cache_hit:
+			Detail_Test( pn ) ;
+			return 0 ;
+		case path_cache_absent:
+			RETURN_CODE_SET_SCALAR( parse_error_status, 27 ) ; // bad path syntax
+			FS_ParsedName_destroy(pn);
+			return parse_error_status ;
+		case path_cache_stale:
+			// start over from a clean parsedname
+			FS_ParsedName_destroy(pn);
+			RETURN_CODE_ERROR_RETURN( FS_ParsedName_setup(pp, path, pn) );
+			break ;
+		case path_cache_miss:
+		default:
+			break ;
+	}
+
 	while (1) {
 		// Check for extreme conditions (done, error)
 		switch (pe) {
@@ -226,6 +349,7 @@ static ZERO_OR_ERROR FS_ParsedName_anywhere(const char *path, enum parse_pass re
 					break ;
 			}
 			//printf("%s: Parse %s after  corrections: %.4X -- state = %d\n\n",(back_from_remote)?"BACK":"FORE",pn->path,pn->state,pn->type) ;
+			PathCache_Add( remote_status, initial_state, generation, pn ) ;
 			// set up detail debugging
 			Detail_Test( pn ) ; // turns on debug mode only during this device's query
 			return 0;
@@ -391,6 +515,194 @@ static ZERO_OR_ERROR FS_ParsedName_setup(struct parsedname_pointers *pp, const c
 	return 0 ; // success
 }
 
+void ParsedName_Cache_Open( void )
+{
+	int shard_index ;
+
+	memset( path_cache, 0, sizeof(path_cache) ) ;
+	for ( shard_index = 0 ; shard_index < PATH_CACHE_SHARDS ; ++shard_index ) {
+		RWLOCK_INIT( path_cache[shard_index].lock ) ;
+		path_cache[shard_index].generation = 1 ;
+	}
+}
+
+/* Only when no other thread can be parsing (e.g. test teardown) */
+void ParsedName_Cache_Close( void )
+{
+	int shard_index ;
+
+	for ( shard_index = 0 ; shard_index < PATH_CACHE_SHARDS ; ++shard_index ) {
+		struct path_cache_shard * shard = &path_cache[shard_index] ;
+		int slot_index ;
+
+		for ( slot_index = 0 ; slot_index < PATH_CACHE_SLOTS ; ++slot_index ) {
+			SAFEFREE( shard->slot[slot_index].sparse_name ) ;
+		}
+		RWLOCK_DESTROY( shard->lock ) ;
+	}
+}
+
+/* Forget every cached parse -- aliases or buses have changed */
+void ParsedName_Cache_Invalidate( void )
+{
+	int shard_index ;
+
+	for ( shard_index = 0 ; shard_index < PATH_CACHE_SHARDS ; ++shard_index ) {
+		struct path_cache_shard * shard = &path_cache[shard_index] ;
+
+		RWLOCK_WLOCK( shard->lock ) ;
+		if ( ++shard->generation == 0 ) {
+			// 0 marks an empty slot
+			shard->generation = 1 ;
+		}
+		RWLOCK_WUNLOCK( shard->lock ) ;
+	}
+}
+
+/* FNV-1a hash of the path and parse direction */
+static UINT PathCache_Hash( const char * path, enum parse_pass remote_status )
+{
+	UINT hash = 2166136261U ^ (UINT) remote_status ;
+
+	for ( ; *path != '\0' ; ++path ) {
+		hash ^= (BYTE) *path ;
+		hash *= 16777619U ;
+	}
+	return hash ;
+}
+
+static struct path_cache_shard * PathCache_Shard( UINT hash )
+{
+	return &path_cache[ hash & (PATH_CACHE_SHARDS-1) ] ;
+}
+
+static struct path_cache_entry * PathCache_Slot( struct path_cache_shard * shard, UINT hash )
+{
+	return &shard->slot[ (hash / PATH_CACHE_SHARDS) & (PATH_CACHE_SLOTS-1) ] ;
+}
+
+/* Fill pn (fresh from FS_ParsedName_setup) from the cache
+ * On a miss, generation is set for PathCache_Add */
+static enum path_cache_result PathCache_Get( enum parse_pass remote_status, struct parsedname * pn, UINT * generation )
+{
+	UINT hash = PathCache_Hash( pn->path, remote_status ) ;
+	struct path_cache_shard * shard = PathCache_Shard( hash ) ;
+	struct path_cache_entry * entry = PathCache_Slot( shard, hash ) ;
+	INDEX_OR_ERROR bus_index ;
+	int presence ;
+
+	STAT_THREAD_ADD1(cache_path.tries) ;
+	RWLOCK_RLOCK( shard->lock ) ;
+	*generation = shard->generation ;
+	if ( entry->generation != shard->generation
+		|| entry->hash != hash
+		|| entry->remote_status != remote_status
+		|| entry->initial_state != pn->state
+		|| strcmp( entry->path, pn->path ) != 0 ) {
+		RWLOCK_RUNLOCK( shard->lock ) ;
+		return path_cache_miss ;
+	}
+
+	strcpy( pn->path_to_server, entry->path_to_server ) ;
+	pn->type = entry->type ;
+	pn->state = entry->state & ~ePS_bus ; // SetKnownBus restores
+	memcpy( pn->sn, entry->sn, SERIAL_NUMBER_SIZE ) ;
+	pn->selected_device = entry->selected_device ;
+	pn->selected_filetype = entry->selected_filetype ;
+	pn->subdir = entry->subdir ;
+	pn->extension = entry->extension ;
+	pn->sparse_name = ( entry->sparse_name == NULL ) ? NULL : owstrdup( entry->sparse_name ) ;
+	pn->dirlength = entry->dirlength ;
+	pn->device_name = ( entry->device_name_offset < 0 ) ? NULL : &( pn->path[entry->device_name_offset] ) ;
+	if ( ! entry->bus_list ) {
+		pn->control_flags &= ~SHOULD_RETURN_BUS_LIST ;
+	}
+	bus_index = entry->bus_index ;
+	presence = entry->presence ;
+	RWLOCK_RUNLOCK( shard->lock ) ;
+
+	STAT_THREAD_ADD1(cache_path.hits) ;
+
+	// Bus given in the path (or the only one for the device)
+	if ( bus_index != INDEX_BAD && ( SpecifiedBus(pn) || ! presence ) ) {
+		if ( SetKnownBus( bus_index, pn ) ) {
+			return path_cache_stale ;
+		}
+	}
+
+	if ( presence ) {
+		if ( INDEX_NOT_VALID( CheckPresence(pn) ) ) {
+			return path_cache_absent ;
+		}
+	}
+
+	LEVEL_DEBUG("Path %s from parse cache", pn->path ) ;
+	return path_cache_hit ;
+}
+
+/* Remember a successful parse */
+static void PathCache_Add( enum parse_pass remote_status, enum ePS_state initial_state, UINT generation, const struct parsedname * pn )
+{
+	static const BYTE no_sn[SERIAL_NUMBER_SIZE] = { 0, } ;
+	UINT hash ;
+	struct path_cache_shard * shard ;
+	struct path_cache_entry * entry ;
+	char * sparse_name = NULL ;
+
+	if ( pn->ds2409_depth > 0 || pn->selected_device == &RemoteDevice ) {
+		// branch routes and remote aliases are looked up each time
+		return ;
+	}
+	if ( strlen( pn->path ) > PATH_CACHE_LENGTH || strlen( pn->path_to_server ) >= sizeof( entry->path_to_server ) ) {
+		return ;
+	}
+	if ( pn->sparse_name != NULL ) {
+		sparse_name = owstrdup( pn->sparse_name ) ;
+		if ( sparse_name == NULL ) {
+			return ;
+		}
+	}
+
+	hash = PathCache_Hash( pn->path, remote_status ) ;
+	shard = PathCache_Shard( hash ) ;
+	entry = PathCache_Slot( shard, hash ) ;
+
+	RWLOCK_WLOCK( shard->lock ) ;
+	if ( shard->generation != generation ) {
+		// invalidated while this path was being parsed
+		RWLOCK_WUNLOCK( shard->lock ) ;
+		SAFEFREE( sparse_name ) ;
+		return ;
+	}
+	SAFEFREE( entry->sparse_name ) ;	// previous occupant
+	entry->generation = generation ;
+	entry->hash = hash ;
+	entry->remote_status = remote_status ;
+	entry->initial_state = initial_state ;
+	strcpy( entry->path, pn->path ) ;
+	strcpy( entry->path_to_server, pn->path_to_server ) ;
+	entry->type = pn->type ;
+	entry->state = pn->state ;
+	memcpy( entry->sn, pn->sn, SERIAL_NUMBER_SIZE ) ;
+	entry->selected_device = pn->selected_device ;
+	entry->selected_filetype = pn->selected_filetype ;
+	entry->subdir = pn->subdir ;
+	entry->extension = pn->extension ;
+	entry->sparse_name = sparse_name ;
+	entry->dirlength = pn->dirlength ;
+	entry->device_name_offset = ( pn->device_name == NULL ) ? -1 : ( pn->device_name - pn->path ) ;
+	entry->bus_index = KnownBus(pn) ? pn->known_bus->index : INDEX_BAD ;
+	entry->bus_list = ( ( pn->control_flags & SHOULD_RETURN_BUS_LIST ) != 0 ) ;
+	// Same test as Parse_RealDeviceSN
+	entry->presence = ( remote_status == parse_pass_pre_remote )
+		&& ! Globals.one_device
+		&& ( pn->type == ePN_real )
+		&& ( memcmp( pn->sn, no_sn, SERIAL_NUMBER_SIZE ) != 0 ) ;
+	RWLOCK_WUNLOCK( shard->lock ) ;
+
+	STAT_THREAD_ADD1(cache_path.adds) ;
+}
+
 /* Used for virtual directories like settings and statistics
  * If local, applies to all local (this program) and not a
  * specific local bus.
@@ -411,51 +723,49 @@ static enum parse_enum set_type( enum ePN_type epntype, struct parsedname * pn )
 // Early parsing -- only bus entries, uncached and text may have preceeded
 static enum parse_enum Parse_Unspecified(char *pathnow, enum parse_pass remote_status, struct parsedname *pn)
 {
-	pthread_once(&regex_init_once, regex_init);
-
-	struct ow_regmatch orm ;
-	orm.number = 1 ; // for bus
+	INDEX_OR_ERROR bus_number = INDEX_BAD ;
 
-	if ( ow_regexec( &rx_bus, pathnow, &orm ) == 0) {
-		INDEX_OR_ERROR bus_number = (INDEX_OR_ERROR) atoi(orm.match[1]) ;
-		ow_regexec_free( &orm ) ;
-		return Parse_Bus( bus_number, pn);
+	switch ( Parse_Keyword( pathnow, &bus_number ) ) {
+		case pk_bus:
+			return Parse_Bus( bus_number, pn);
 
-	} else if (ow_regexec( &rx_set, pathnow, NULL ) == 0) {
-		return set_type( ePN_settings, pn ) ;
+		case pk_settings:
+			return set_type( ePN_settings, pn ) ;
 
-	} else if (ow_regexec( &rx_sta, pathnow, NULL ) == 0) {
-		return set_type( ePN_statistics, pn ) ;
+		case pk_statistics:
+			return set_type( ePN_statistics, pn ) ;
 
-	} else if (ow_regexec( &rx_str, pathnow, NULL ) == 0) {
-		return set_type( ePN_structure, pn ) ;
+		case pk_structure:
+			return set_type( ePN_structure, pn ) ;
 
-	} else if (ow_regexec( &rx_sys, pathnow, NULL ) == 0) {
-		return set_type( ePN_system, pn ) ;
+		case pk_system:
+			return set_type( ePN_system, pn ) ;
 
-	} else if (ow_regexec( &rx_int, pathnow, NULL ) == 0) {
-		if (!SpecifiedBus(pn)) {
-			return parse_error;
-		}
-		pn->type = ePN_interface;
-		return parse_nonreal;
+		case pk_interface:
+			if (!SpecifiedBus(pn)) {
+				return parse_error;
+			}
+			pn->type = ePN_interface;
+			return parse_nonreal;
 
-	} else if (ow_regexec( &rx_tex, pathnow, NULL ) == 0) {
-		pn->state |= ePS_text;
-		return parse_first;
+		case pk_text:
+			pn->state |= ePS_text;
+			return parse_first;
 
-	} else if (ow_regexec( &rx_jso, pathnow, NULL ) == 0) {
-		pn->state |= ePS_json;
-		return parse_first;
+		case pk_json:
+			pn->state |= ePS_json;
+			return parse_first;
 
-	} else if (ow_regexec( &rx_unc, pathnow, NULL ) == 0) {
-		pn->state |= ePS_uncached;
-		return parse_first;
+		case pk_uncached:
+			pn->state |= ePS_uncached;
+			return parse_first;
 
-	} else if (ow_regexec( &rx_una, pathnow, NULL ) == 0) {
-		pn->state |= ePS_unaliased;
-		return parse_first;
+		case pk_unaliased:
+			pn->state |= ePS_unaliased;
+			return parse_first;
 
+		default:
+			break ;
 	}
 
 	pn->type = ePN_real;
@@ -464,9 +774,9 @@ static enum parse_enum Parse_Unspecified(char *pathnow, enum parse_pass remote_s
 
 static enum parse_enum Parse_Branch(char *pathnow, enum parse_pass remote_status, struct parsedname *pn)
 {
-	pthread_once(&regex_init_once, regex_init);
+	INDEX_OR_ERROR bus_number ;
 
-	if (ow_regexec( &rx_ala, pathnow, NULL ) == 0) {
+	if ( Parse_Keyword( pathnow, &bus_number ) == pk_alarm ) {
 		pn->state |= ePS_alarm;
 		pn->type = ePN_real;
 		return parse_real;
@@ -476,72 +786,67 @@ static enum parse_enum Parse_Branch(char *pathnow, enum parse_pass remote_status
 
 static enum parse_enum Parse_Real(char *pathnow, enum parse_pass remote_status, struct parsedname *pn)
 {
-	pthread_once(&regex_init_once, regex_init);
+	INDEX_OR_ERROR bus_number ;
 
-	if (ow_regexec( &rx_sim, pathnow, NULL ) == 0) {
-		pn->selected_device = DeviceSimultaneous;
-		return parse_prop;
+	switch ( Parse_Keyword( pathnow, &bus_number ) ) {
+		case pk_simultaneous:
+			pn->selected_device = DeviceSimultaneous;
+			return parse_prop;
 
-	} else if (ow_regexec( &rx_tex, pathnow, NULL ) == 0) {
-		pn->state |= ePS_text;
-		return parse_real;
+		case pk_text:
+			pn->state |= ePS_text;
+			return parse_real;
 
-	} else if (ow_regexec( &rx_jso, pathnow, NULL ) == 0) {
-		pn->state |= ePS_json;
-		return parse_real;
+		case pk_json:
+			pn->state |= ePS_json;
+			return parse_real;
 
-	} else if (ow_regexec( &rx_the, pathnow, NULL ) == 0) {
-		pn->selected_device = DeviceThermostat;
-		return parse_prop;
+		case pk_thermostat:
+			pn->selected_device = DeviceThermostat;
+			return parse_prop;
 
-	} else if (ow_regexec( &rx_unc, pathnow, NULL ) == 0) {
-		pn->state |= ePS_uncached;
-		return parse_real;
+		case pk_uncached:
+			pn->state |= ePS_uncached;
+			return parse_real;
 
-	} else if (ow_regexec( &rx_una, pathnow, NULL ) == 0) {
-		pn->state |= ePS_unaliased;
-		return parse_real;
+		case pk_unaliased:
+			pn->state |= ePS_unaliased;
+			return parse_real;
 
-	} else {
-		return Parse_RealDevice(pathnow, remote_status, pn);
+		default:
+			return Parse_RealDevice(pathnow, remote_status, pn);
 	}
 }
 
 static enum parse_enum Parse_NonReal(char *pathnow, struct parsedname *pn)
 {
-	pthread_once(&regex_init_once, regex_init);
+	INDEX_OR_ERROR bus_number ;
 
-	if (ow_regexec( &rx_tex, pathnow, NULL )  == 0) {
-		pn->state |= ePS_text;
-		return parse_nonreal;
+	switch ( Parse_Keyword( pathnow, &bus_number ) ) {
+		case pk_text:
+			pn->state |= ePS_text;
+			return parse_nonreal;
 
-	} else if (ow_regexec( &rx_jso, pathnow, NULL )  == 0) {
-		pn->state |= ePS_json;
-		return parse_nonreal;
+		case pk_json:
+			pn->state |= ePS_json;
+			return parse_nonreal;
 
-	} else if (ow_regexec( &rx_unc, pathnow, NULL )  == 0) {
-		pn->state |= ePS_uncached;
-		return parse_nonreal;
+		case pk_uncached:
+			pn->state |= ePS_uncached;
+			return parse_nonreal;
 
-	} else if (ow_regexec( &rx_una, pathnow, NULL )  == 0) {
-		pn->state |= ePS_unaliased;
-		return parse_nonreal;
+		case pk_unaliased:
+			pn->state |= ePS_unaliased;
+			return parse_nonreal;
 
-	} else {
-		return Parse_NonRealDevice(pathnow, pn);
+		default:
+			return Parse_NonRealDevice(pathnow, pn);
 	}
-
-	return parse_error;
 }
 
 /* We've reached a /bus.n entry */
 static enum parse_enum Parse_Bus( INDEX_OR_ERROR bus_number, struct parsedname *pn)
 {
-	pthread_once(&regex_init_once, regex_init);
-
-	struct ow_regmatch orm ;
-	orm.number = 0 ;
-
 	/* Processing for bus.X directories -- eventually will make this more generic */
 	if ( INDEX_NOT_VALID(bus_number) ) {
 		return parse_error;
@@ -572,11 +877,16 @@ static enum parse_enum Parse_Bus( INDEX_OR_ERROR bus_number, struct parsedname *
 	}
 
 	/* Create the path without the "bus.x" part in pn->path_to_server */
-	if ( ow_regexec( &rx_p_bus, pn->path, &orm ) == 0 ) {
-		strcpy( pn->path_to_server, orm.pre[0] ) ;
-		strcat( pn->path_to_server, "/" ) ;
-		strcat( pn->path_to_server, orm.post[0] ) ;
-		ow_regexec_free( &orm ) ;
+	if ( strncasecmp( pn->path, "/bus.", 5 ) == 0 && isdigit( pn->path[5] ) ) {
+		const char * rest = &(pn->path[5]) ;
+		while ( isdigit( *rest ) ) {
+			++rest ;
+		}
+		if ( *rest == '/' ) {
+			++rest ;
+		}
+		strcpy( pn->path_to_server, "/" ) ;
+		strcat( pn->path_to_server, rest ) ;
 	}
 	return parse_first;
 }
@@ -755,15 +1065,10 @@ static enum parse_enum Parse_NonRealDevice(char *filename, struct parsedname *pn
 
 static enum parse_enum Parse_Property(char *filename, struct parsedname *pn)
 {
-	pthread_once(&regex_init_once, regex_init);
-
 	struct device * pdev = pn->selected_device ;
 	struct filetype * ft ;
 	
-	int extension_given ;
-
-	struct ow_regmatch orm ;
-	orm.number = 0 ;
+	char * dot ;
 
 	//printf("FilePart: %s %s\n", filename, pn->path);
 
@@ -774,20 +1079,16 @@ static enum parse_enum Parse_Property(char *filename, struct parsedname *pn)
 	}
 
 	// separate filename.dot
-//	filename = strsep(&dot, ".");
-	if ( ow_regexec( &rx_extension, filename, &orm ) == 0 ) {
-		// extension given
-		extension_given = 1 ;
-		ft =
-			 bsearch(orm.pre[0], pdev->filetype_array,
-					 (size_t) pdev->count_of_filetypes, sizeof(struct filetype), filetype_cmp) ;
-		ow_regexec_free( &orm ) ;
-	} else {
-		// no extension given
-		extension_given = 0 ;
-		ft =
-			 bsearch(filename, pdev->filetype_array,
-					 (size_t) pdev->count_of_filetypes, sizeof(struct filetype), filetype_cmp) ;
+	dot = strchr( filename, '.' ) ;
+	if ( dot != NULL ) {
+		// extension given -- look up the name alone
+		dot[0] = '\0' ;
+	}
+	ft =
+		 bsearch(filename, pdev->filetype_array,
+				 (size_t) pdev->count_of_filetypes, sizeof(struct filetype), filetype_cmp) ;
+	if ( dot != NULL ) {
+		dot[0] = '.' ;
 	}
 	
 	pn->selected_filetype = ft ;			 
@@ -798,7 +1099,7 @@ static enum parse_enum Parse_Property(char *filename, struct parsedname *pn)
 		
 	//printf("FP known filetype %s\n",pn->selected_filetype->name) ;
 	/* Filetype found, now process extension */
-	if (extension_given==0) {	/* no extension */
+	if (dot == NULL) {	/* no extension */
 		if (ft->ag != NON_AGGREGATE) {
 			return parse_error;	/* aggregate filetypes need an extension */
 		}
@@ -812,14 +1113,11 @@ static enum parse_enum Parse_Property(char *filename, struct parsedname *pn)
 	} else if (ft->ag->combined==ag_sparse)  { /* Sparse */
 		if (ft->ag->letters == ag_letters) {	/* text string */
 			pn->extension = 0;	/* text extension, not number */
-			ow_regexec( &rx_extension, filename, &orm ) ; // don't need to test -- already succesful
-			pn->sparse_name = owstrdup(orm.post[0]) ;
-			ow_regexec_free( &orm ) ;
+			pn->sparse_name = owstrdup( &dot[1] ) ;
 			LEVEL_DEBUG("Sparse alpha extension found: <%s>",pn->sparse_name);
 		} else {			/* Numbers */
-			if ( ow_regexec( &rx_number, filename, &orm ) == 0 ) { 
-				pn->extension = atoi( &orm.match[0][1] );	/* Number conversion */
-				ow_regexec_free( &orm ) ;
+			pn->extension = Parse_Number_Suffix( filename ) ;	/* Number conversion */
+			if ( pn->extension >= 0 ) {
 				LEVEL_DEBUG("Sparse numeric extension found: <%ld>",(long int) pn->extension);
 			} else {
 				LEVEL_DEBUG("Non numeric extension for %s",filename ) ;
@@ -828,12 +1126,12 @@ static enum parse_enum Parse_Property(char *filename, struct parsedname *pn)
 		}
 
 	// Non-sparse "ALL"
-	} else if (ow_regexec( &rx_all, filename, NULL ) == 0) {
+	} else if ( Parse_Suffix( filename, "all" ) ) {
 		//printf("FP ALL\n");
 		pn->extension = EXTENSION_ALL;	/* ALL */
 	
 	// Non-sparse "BYTE"
-	} else if (ft->format == ft_bitfield && ow_regexec( &rx_byte, filename, NULL) == 0) {
+	} else if (ft->format == ft_bitfield && Parse_Suffix( filename, "byte" ) ) {
 		pn->extension = EXTENSION_BYTE;	/* BYTE */
 		//printf("FP BYTE\n") ;
 
@@ -841,19 +1139,9 @@ static enum parse_enum Parse_Property(char *filename, struct parsedname *pn)
 	} else {				/* specific extension */
 		if (ft->ag->letters == ag_letters) {	/* Letters */
 			//printf("FP letters\n") ;
-			if ( ow_regexec( &rx_letter, filename, &orm ) == 0 ) {
-				pn->extension = toupper(orm.match[0][1]) - 'A';	/* Letter extension */
-				ow_regexec_free( &orm ) ;
-			} else {
-				return parse_error;
-			}
+			pn->extension = Parse_Letter_Suffix( filename ) ;	/* Letter extension */
 		} else {			/* Numbers */
-			if ( ow_regexec( &rx_number, filename, &orm ) == 0 ) { 
-				pn->extension = atoi( &orm.match[0][1] );	/* Number conversion */
-				ow_regexec_free( &orm ) ;
-			} else {
-				return parse_error;
-			}
+			pn->extension = Parse_Number_Suffix( filename ) ;	/* Number conversion */
 		}
 		//printf("FP ext=%d nr_elements=%d\n", pn->extension, pn->selected_filetype->ag->elements) ;
 		/* Now check range */
@@ -978,6 +1266,180 @@ ZERO_OR_ERROR FS_ParsedNamePlusText(const char *path, const char *file, const ch
 	return FS_ParsedNamePlus(path, name, pn);
 }
 
+/* Directory entries are built from the parent directory rather than by
+ * parsing "parent path/entry" again. The result is what that parse would
+ * give, without the keyword, serial number, presence and property lookups.
+ * */
+
+/* Copy the parent and append one path segment -- in place of FS_ParsedName_setup */
+static ZERO_OR_ERROR FS_ParsedName_child( const struct parsedname * pn_parent, const char * segment, struct parsedname * pn )
+{
+	size_t path_length = strlen( pn_parent->path ) ;
+	size_t server_length = strlen( pn_parent->path_to_server ) ;
+
+	if ( path_length + strlen(segment) + 1 > PATH_MAX ) {
+		RETURN_CODE_RETURN( 26 ) ; // path too long
+	}
+
+	memcpy( pn, pn_parent, sizeof(struct parsedname) ) ; // shallow copy
+	RETURN_CODE_INIT(pn);
+
+	if ( path_length == 0 || pn->path[path_length-1] != '/' ) {
+		pn->path[path_length++] = '/' ;
+	}
+	strcpy( &(pn->path[path_length]), segment ) ;
+	if ( server_length == 0 || pn->path_to_server[server_length-1] != '/' ) {
+		pn->path_to_server[server_length++] = '/' ;
+	}
+	strcpy( &(pn->path_to_server[server_length]), segment ) ;
+	pn->dirlength = path_length ; // start of the new segment
+
+	// device_name points into the path
+	if ( pn_parent->device_name >= pn_parent->path && pn_parent->device_name < pn_parent->path + path_length ) {
+		pn->device_name = &( pn->path[ pn_parent->device_name - pn_parent->path ] ) ;
+	}
+
+	// owned by the parent
+	pn->sparse_name = NULL ;
+	pn->bp = NULL ;
+	if ( pn_parent->ds2409_depth > 0 ) {
+		size_t hubs = ( (pn_parent->ds2409_depth + BRANCH_INCR - 1) / BRANCH_INCR ) * BRANCH_INCR ;
+		pn->bp = owmalloc( hubs * sizeof(struct ds2409_hubs) ) ;
+		if ( pn->bp == NULL ) {
+			RETURN_CODE_RETURN( 79 ) ; // unable to allocate memory
+		}
+		memcpy( pn->bp, pn_parent->bp, pn_parent->ds2409_depth * sizeof(struct ds2409_hubs) ) ;
+	}
+	pn->lock = NULL ;
+	pn->detail_flag = 0 ;
+	pn->tokens = 0 ;
+	pn->tokenstring = NULL ;
+
+	/* Same control flags as a fresh parse */
+	CONTROLFLAGSLOCK;
+	pn->control_flags = LocalControlFlags | SHOULD_RETURN_BUS_LIST;
+	CONTROLFLAGSUNLOCK;
+	if (SpecifiedLocalBus(pn)) {
+		pn->control_flags &= (~SHOULD_RETURN_BUS_LIST);
+	}
+
+	/* Released by FS_ParsedName_destroy */
+	CONNIN_RLOCK;
+	return 0 ;
+}
+
+/* A device found while listing a bus (or branch) directory */
+ZERO_OR_ERROR FS_ParsedNameDevice(const struct parsedname *pn_directory, const BYTE * sn, struct parsedname *pn)
+{
+	char name[PROPERTY_LENGTH_ALIAS + 1];
+	ZERO_OR_ERROR ret ;
+
+	FS_devicename(name, PROPERTY_LENGTH_ALIAS, sn, pn_directory);
+
+	if ( NotRealDir(pn_directory)
+		|| pn_directory->selected_device != NO_DEVICE
+		|| pn_directory->selected_filetype != NO_FILETYPE
+		|| BusIsServer(pn_directory->selected_connection) ) {
+		// not a plain local directory of devices
+		return FS_ParsedNamePlus(pn_directory->path, name, pn);
+	}
+
+	ret = FS_ParsedName_child( pn_directory, name, pn ) ;
+	if ( ret != 0 ) {
+		return ret ;
+	}
+
+	pn->device_name = &( pn->path[pn->dirlength] ) ;
+	pn->dirlength = strlen( pn->path ) ;
+	memcpy( pn->sn, sn, SERIAL_NUMBER_SIZE ) ;
+	pn->selected_device = FS_devicefindhex( sn[0], pn ) ;
+	pn->selected_filetype = NO_FILETYPE ;
+	pn->subdir = NO_SUBDIR ;
+	pn->extension = 0 ;
+
+	// just found on this bus -- no presence check needed
+	pn->state |= ePS_bus ;
+	pn->known_bus = pn->selected_connection = pn_directory->selected_connection ;
+
+	Detail_Test( pn ) ;
+	return 0 ;
+}
+
+/* A property (or subdirectory) of the device directory
+ * Sparse properties get EXTENSION_UNKNOWN */
+ZERO_OR_ERROR FS_ParsedNameProperty(const struct parsedname *pn_device_directory, struct filetype * ft, int extension, struct parsedname *pn)
+{
+	char name[OW_FULLNAME_MAX];
+	const char * namepart = ft->name ;
+	char * sparse_name = NULL ;
+	ZERO_OR_ERROR ret ;
+
+	if ( pn_device_directory->subdir != NO_SUBDIR ) {
+		// name relative to the subdirectory
+		namepart += strlen( pn_device_directory->subdir->name ) + 1 ;
+	}
+
+	UCLIBCLOCK;
+	if ( ft->ag == NON_AGGREGATE ) {
+		snprintf(name, OW_FULLNAME_MAX, "%s", namepart );
+	} else if ( ft->ag->combined == ag_sparse ) {
+		snprintf(name, OW_FULLNAME_MAX, "%s.%s", namepart, (ft->ag->letters == ag_letters) ? "xxx" : "000" );
+	} else if ( extension == EXTENSION_BYTE ) {
+		snprintf(name, OW_FULLNAME_MAX, "%s.BYTE", namepart );
+	} else if ( extension == EXTENSION_ALL ) {
+		snprintf(name, OW_FULLNAME_MAX, "%s.ALL", namepart );
+	} else if ( ft->ag->letters == ag_letters ) {
+		snprintf(name, OW_FULLNAME_MAX, "%s.%c", namepart, 'A'+extension );
+	} else {
+		snprintf(name, OW_FULLNAME_MAX, "%s.%d", namepart, extension );
+	}
+	UCLIBCUNLOCK;
+
+	if ( ft->format == ft_directory || pn_device_directory->selected_device == &RemoteDevice ) {
+		// branch and remote properties need the full parse
+		ret = FS_ParsedNamePlus(pn_device_directory->path, name, pn) ;
+		if ( ret == 0 && ft->ag != NON_AGGREGATE && ft->ag->combined == ag_sparse ) {
+			pn->extension = EXTENSION_UNKNOWN ;
+		}
+		return ret ;
+	}
+
+	if ( ft->ag != NON_AGGREGATE && ft->ag->combined == ag_sparse && ft->ag->letters == ag_letters ) {
+		sparse_name = owstrdup( "xxx" ) ;
+		if ( sparse_name == NULL ) {
+			RETURN_CODE_RETURN( 79 ) ; // unable to allocate memory
+		}
+	}
+
+	ret = FS_ParsedName_child( pn_device_directory, name, pn ) ;
+	if ( ret != 0 ) {
+		SAFEFREE( sparse_name ) ;
+		return ret ;
+	}
+
+	if ( pn_device_directory->subdir != NO_SUBDIR ) {
+		// still the start of the subdirectory
+		pn->dirlength = pn_device_directory->dirlength ;
+	}
+	if ( ft->format == ft_subdir ) {
+		pn->subdir = ft ;
+		pn->selected_filetype = NO_FILETYPE ;
+	} else {
+		pn->selected_filetype = ft ;
+	}
+	if ( ft->ag == NON_AGGREGATE ) {
+		pn->extension = 0 ;
+	} else if ( ft->ag->combined == ag_sparse ) {
+		pn->extension = EXTENSION_UNKNOWN ; // unspecified (for owhttpd)
+		pn->sparse_name = sparse_name ;
+	} else {
+		pn->extension = extension ;
+	}
+
+	Detail_Test( pn ) ;
+	return 0 ;
+}
+
 void FS_ParsedName_Placeholder( struct parsedname * pn )
 {
 	FS_ParsedName( NULL, pn ) ; // minimal parsename -- no destroy needed
@@ -13,6 +13,7 @@
 #include "ow.h"
 #include "ow_counters.h"
 #include "ow_connection.h"
+#include "ow_simultaneous.h"
 
 /* ------- Prototypes ----------- */
 static SIZE_OR_ERROR FS_r_virtual(struct one_wire_query *owq);
@@ -29,6 +30,8 @@ static SIZE_OR_ERROR FS_read_distribute(struct one_wire_query *owq) ;
 static ZERO_OR_ERROR FS_read_all( struct one_wire_query *owq_all ); 
 static ZERO_OR_ERROR FS_read_a_part( struct one_wire_query *owq_part );
 static ZERO_OR_ERROR FS_read_in_parts( struct one_wire_query *owq_all );
+static SIZE_OR_ERROR FS_r_given_bus_flight(struct one_wire_query *owq);
+static int FS_flight_match( const struct one_wire_query * owq_a, const struct one_wire_query * owq_b ) ;
 
 /*
 Change in strategy 6/2006:
@@ -70,13 +73,11 @@ SIZE_OR_ERROR FS_read_postparse(struct one_wire_query *owq)
 
 	/* Normal read. Try three times */
 	LEVEL_DEBUG("%s", pn->path);
-	STATLOCK;
-	AVERAGE_IN(&read_avg);
-	AVERAGE_IN(&all_avg);
-	STATUNLOCK;
+	STAT_AVERAGE_IN(read_avg);
+	STAT_AVERAGE_IN(all_avg);
 
 	/* First try */
-	STAT_ADD1(read_tries[0]);
+	STAT_THREAD_ADD1(read_tries[0]);
 
 	/* Check file type. */
 	if (pn->selected_device == NO_DEVICE || pn->selected_filetype == NO_FILETYPE) {
@@ -92,14 +93,12 @@ SIZE_OR_ERROR FS_read_postparse(struct one_wire_query *owq)
 		read_or_error = (pn->type == ePN_real) ? FS_read_real(owq) : FS_r_virtual(owq);
 	}
 
-	STATLOCK;
 	if (read_or_error >= 0) {
-		++read_success;			/* statistics */
-		read_bytes += read_or_error;	/* statistics */
+		STAT_THREAD_ADD1(read_success);	/* statistics */
+		STAT_THREAD_ADD(read_bytes, read_or_error);	/* statistics */
 	}
-	AVERAGE_OUT(&read_avg);
-	AVERAGE_OUT(&all_avg);
-	STATUNLOCK;
+	STAT_AVERAGE_OUT(read_avg);
+	STAT_AVERAGE_OUT(all_avg);
 	LEVEL_DEBUG("%s return %d", pn->path, read_or_error);
 	return read_or_error;
 }
@@ -117,14 +116,14 @@ static SIZE_OR_ERROR FS_read_real(struct one_wire_query *owq)
 	/* Second Try */
 	/* if not a specified bus, relook for chip location */
 	if (read_or_error < 0) {	//error
-		STAT_ADD1(read_tries[1]);
+		STAT_THREAD_ADD1(read_tries[1]);
 		if (SpecifiedBus(pn)) {	// this bus or bust!
 			if ( BAD(TestConnection(pn)) ) {
 				read_or_error = -ECONNABORTED;
 			} else {
 				read_or_error = FS_read_distribute(owq);	// 2nd try
 				if (read_or_error < 0) {	// third try
-					STAT_ADD1(read_tries[2]);
+					STAT_THREAD_ADD1(read_tries[2]);
 					read_or_error = FS_read_distribute(owq);
 				}
 			}
@@ -140,7 +139,7 @@ static SIZE_OR_ERROR FS_read_real(struct one_wire_query *owq)
 				} else {
 					read_or_error = FS_read_distribute(owq);
 					if (read_or_error < 0) {	// third try
-						STAT_ADD1(read_tries[2]);
+						STAT_THREAD_ADD1(read_tries[2]);
 						read_or_error = FS_read_distribute(owq);
 					}
 				}
@@ -152,7 +151,7 @@ static SIZE_OR_ERROR FS_read_real(struct one_wire_query *owq)
 			} else {
 				read_or_error = FS_read_distribute(owq);
 				if (read_or_error < 0) {	// third try
-					STAT_ADD1(read_tries[2]);
+					STAT_THREAD_ADD1(read_tries[2]);
 					read_or_error = FS_read_distribute(owq);
 				}
 			}
@@ -172,6 +171,11 @@ static SIZE_OR_ERROR FS_r_simultaneous(struct one_wire_query *owq)
 		return FS_r_given_bus(owq);
 	}
 
+	if (PN(owq)->selected_filetype->read == FS_r_temperature_all) {
+		// goes through every bus itself, local and remote
+		return FS_r_temperature_all(owq);
+	}
+
 	memcpy(owq_given, owq, sizeof(struct one_wire_query));	// shallow copy
 
 	// it's hard to know what we should return when reading /simultaneous/temperature
@@ -202,10 +206,8 @@ static SIZE_OR_ERROR FS_read_distribute(struct one_wire_query *owq)
 	SIZE_OR_ERROR read_or_error = 0;
 
 	LEVEL_DEBUG("%s", PN(owq)->path);
-	STATLOCK;
-	AVERAGE_IN(&read_avg);
-	AVERAGE_IN(&all_avg);
-	STATUNLOCK;
+	STAT_AVERAGE_IN(read_avg);
+	STAT_AVERAGE_IN(all_avg);
 
 	/* handle DeviceSimultaneous */
 	if (PN(owq)->selected_device == DeviceSimultaneous) {
@@ -214,22 +216,138 @@ static SIZE_OR_ERROR FS_read_distribute(struct one_wire_query *owq)
 		read_or_error = FS_r_given_bus(owq);
 	}
 
-	STATLOCK;
 	if (read_or_error >= 0) {
-		++read_success;			/* statistics */
-		read_bytes += read_or_error;		/* statistics */
+		STAT_THREAD_ADD1(read_success);	/* statistics */
+		STAT_THREAD_ADD(read_bytes, read_or_error);	/* statistics */
 	}
-	AVERAGE_OUT(&read_avg);
-	AVERAGE_OUT(&all_avg);
-	STATUNLOCK;
+	STAT_AVERAGE_OUT(read_avg);
+	STAT_AVERAGE_OUT(all_avg);
 
 	LEVEL_DEBUG("%s returns %d", PN(owq)->path, read_or_error);
 	//printf("FS_read_distribute: pid=%ld return %d\n", pthread_self(), read_or_error);
 	return read_or_error;
 }
 
+/* Single-flight reads
+ * Concurrent reads of the same property (same bus, device, property, extension,
+ * flags, and buffer window) share one bus transaction.
+ * The first reader does the work, the others wait for it and copy its result.
+ * Reads in progress are listed per bus (connection_in), under that bus's own lock.
+ * */
+struct read_flight {
+	struct read_flight * next ;
+	struct one_wire_query * owq ; // leader's query -- key, and the result when done
+	SIZE_OR_ERROR read_or_error ;
+	int done ;
+	int waiters ;
+	pthread_cond_t cond ; // done (for waiters) or last waiter gone (for leader)
+} ;
+
+#define FLIGHTLOCK(in)    _MUTEX_LOCK(   (in)->read_flight_mutex )
+#define FLIGHTUNLOCK(in)  _MUTEX_UNLOCK( (in)->read_flight_mutex )
+
+static int FS_flight_match( const struct one_wire_query * owq_a, const struct one_wire_query * owq_b )
+{
+	const struct parsedname * pn_a = PN(owq_a) ;
+	const struct parsedname * pn_b = PN(owq_b) ;
+
+	return pn_a->selected_filetype == pn_b->selected_filetype
+		&& pn_a->extension == pn_b->extension
+		&& memcmp( pn_a->sn, pn_b->sn, SERIAL_NUMBER_SIZE ) == 0
+		&& pn_a->type == pn_b->type
+		&& pn_a->state == pn_b->state
+		&& pn_a->control_flags == pn_b->control_flags
+		&& OWQ_offset(owq_a) == OWQ_offset(owq_b)
+		&& OWQ_size(owq_a) == OWQ_size(owq_b) ;
+}
+
+/* Copy the leader's result -- called with the flight list locked */
+static void FS_flight_copy( struct one_wire_query * owq, const struct one_wire_query * owq_leader, SIZE_OR_ERROR read_or_error )
+{
+	struct parsedname * pn = PN(owq) ;
+
+	if ( read_or_error > 0 ) {
+		memcpy( OWQ_buffer(owq), OWQ_buffer(owq_leader), read_or_error ) ;
+	}
+	if ( pn->extension != EXTENSION_ALL ) {
+		OWQ_val(owq) = OWQ_val(owq_leader) ;
+	} else if ( OWQ_array(owq) != NULL && OWQ_array(owq_leader) != NULL && pn->type != ePN_structure ) {
+		// each query has its own array
+		memcpy( OWQ_array(owq), OWQ_array(owq_leader), (size_t) pn->selected_filetype->ag->elements * sizeof(union value_object) ) ;
+	}
+}
+
 // This function should return number of bytes read... not status.
 static SIZE_OR_ERROR FS_r_given_bus(struct one_wire_query *owq)
+{
+	struct connection_in * in = PN(owq)->selected_connection ;
+	struct read_flight * flight ;
+	struct read_flight leader ;
+
+	if ( in == NO_CONNECTION ) {
+		return FS_r_given_bus_flight(owq) ;
+	}
+
+	FLIGHTLOCK(in) ;
+	for ( flight = in->read_flights ; flight != NULL ; flight = flight->next ) {
+		if ( FS_flight_match( owq, flight->owq ) ) {
+			break ;
+		}
+	}
+
+	if ( flight != NULL ) {
+		// Someone is already reading this -- wait and share
+		SIZE_OR_ERROR read_or_error ;
+
+		++flight->waiters ;
+		while ( ! flight->done ) {
+			my_pthread_cond_wait( &(flight->cond), &(in->read_flight_mutex) ) ;
+		}
+		read_or_error = flight->read_or_error ;
+		FS_flight_copy( owq, flight->owq, read_or_error ) ;
+		if ( --flight->waiters == 0 ) {
+			my_pthread_cond_broadcast( &(flight->cond) ) ;
+		}
+		FLIGHTUNLOCK(in) ;
+		LEVEL_DEBUG("Shared the read of %s (bytes or error %d)", SAFESTRING(PN(owq)->path), read_or_error);
+		STAT_THREAD_ADD1(read_coalesced);
+		return read_or_error ;
+	}
+
+	// We're the leader
+	leader.owq = owq ;
+	leader.done = 0 ;
+	leader.waiters = 0 ;
+	my_pthread_cond_init( &(leader.cond), NULL ) ;
+	leader.next = in->read_flights ;
+	in->read_flights = &leader ;
+	FLIGHTUNLOCK(in) ;
+
+	leader.read_or_error = FS_r_given_bus_flight(owq) ;
+
+	FLIGHTLOCK(in) ;
+	// no new waiters once off the list
+	if ( in->read_flights == &leader ) {
+		in->read_flights = leader.next ;
+	} else {
+		for ( flight = in->read_flights ; flight->next != &leader ; flight = flight->next ) {
+		}
+		flight->next = leader.next ;
+	}
+	leader.done = 1 ;
+	my_pthread_cond_broadcast( &(leader.cond) ) ;
+	// our buffer must outlast the copies
+	while ( leader.waiters > 0 ) {
+		my_pthread_cond_wait( &(leader.cond), &(in->read_flight_mutex) ) ;
+	}
+	FLIGHTUNLOCK(in) ;
+	my_pthread_cond_destroy( &(leader.cond) ) ;
+
+	return leader.read_or_error ;
+}
+
+// This function should return number of bytes read... not status.
+static SIZE_OR_ERROR FS_r_given_bus_flight(struct one_wire_query *owq)
 {
 	// Device locking occurs here
 	struct parsedname *pn = PN(owq);
@@ -246,7 +364,7 @@ static SIZE_OR_ERROR FS_r_given_bus(struct one_wire_query *owq)
 		LEVEL_DEBUG("back from server");
 		//printf("FS_r_given_bus pid=%ld r=%d\n",pthread_self(), read_or_error);
 	} else {
-		STAT_ADD1(read_calls);	/* statistics */
+		STAT_THREAD_ADD1(read_calls);	/* statistics */
 		if (DeviceLockGet(pn) == 0) {
 			read_or_error = FS_r_local(owq);	// this returns status
 			DeviceLockRelease(pn);
@@ -281,7 +399,7 @@ static SIZE_OR_ERROR FS_r_virtual(struct one_wire_query *owq)
 		Debug_OWQ(owq);
 	} else {
 		/* local bus -- any special locking needs? */
-		STAT_ADD1(read_calls);	/* statistics */
+		STAT_THREAD_ADD1(read_calls);	/* statistics */
 		switch (pn->type) {
 		case ePN_structure:
 			read_status = FS_structure(owq);
@@ -293,10 +411,7 @@ static SIZE_OR_ERROR FS_r_virtual(struct one_wire_query *owq)
 			break;
 		case ePN_statistics:
 			// reading /statistics/read/tries.ALL
-			// will cause a deadlock since it calls STAT_ADD1(read_array);
-			// Should perhaps create a new mutex for this.
-			// Comment out this STATLOCK until it's solved.
-			// STATLOCK now done at time of actual read in ow_stats.c
+			// No STATLOCK here -- taken at the time of the actual read in ow_stats.c
 			read_status = FS_r_local(owq);	// this returns status
 			break;
 		default:
@@ -815,3 +930,42 @@ SIZE_OR_ERROR FS_read_local( struct one_wire_query *owq)
 {
 	return FS_r_local(owq);
 }
+
+/* Answer a read from the cache alone -- no bus traffic
+   Returns the formatted length, or -ENOENT if the value must come from the bus
+   Used by owserver to answer the cached paths of a batched read first
+*/
+SIZE_OR_ERROR FS_read_fromcache( struct one_wire_query *owq)
+{
+	struct parsedname *pn = PN(owq);
+	struct filetype * ft = pn->selected_filetype ;
+
+	if ( pn->type != ePN_real || pn->selected_device == NO_DEVICE || pn->selected_device == DeviceSimultaneous || ft == NO_FILETYPE ) {
+		return -ENOENT ;
+	}
+	if ( ft->read == NO_READ_FUNCTION || ft->format == ft_alias || ft->ag != NON_AGGREGATE ) {
+		return -ENOENT ;
+	}
+	if ( ! KnownBus(pn) || BusIsServer(pn->selected_connection) ) {
+		// remote values are cached on the remote side
+		return -ENOENT ;
+	}
+	switch (pn->selected_connection->Adapter) {
+		case adapter_fake:
+		case adapter_tester:
+		case adapter_mock:
+			return -ENOENT ;
+		default:
+			break ;
+	}
+
+	adjust_file_size(owq) ;
+	if ( OWQ_size(owq) == 0 ) {
+		return -ENOENT ;
+	}
+	if ( BAD( OWQ_Cache_Get(owq) ) ) {
+		return -ENOENT ;
+	}
+	LEVEL_DEBUG("%s answered from cache", pn->path) ;
+	return OWQ_parse_output(owq) ;
+}
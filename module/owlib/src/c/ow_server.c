@@ -73,6 +73,7 @@ GOOD_OR_BAD Zero_detect(struct port_in *pin)
 	}
 
 	RETURN_BAD_IF_BAD( COM_open(in) ) ;
+	ServerPoolSetup(in) ;
 	in->Adapter = adapter_tcp;
 	in->adapter_name = "tcp";
 	Zero_setroutines(&(in->iroutines));
@@ -92,6 +93,7 @@ GOOD_OR_BAD Server_detect(struct port_in *pin)
 	pin->type = ct_tcp ;
 	pin->state = cs_virgin ;
 	RETURN_BAD_IF_BAD( COM_open(in) ) ;
+	ServerPoolSetup(in) ;
 	in->Adapter = adapter_tcp;
 	in->adapter_name = "tcp";
 	pin->busmode = bus_server;
@@ -103,6 +105,7 @@ GOOD_OR_BAD Server_detect(struct port_in *pin)
 // actual connections opened and closed independently
 static void Server_close(struct connection_in *in)
 {
+	ServerPoolClose(in) ;
 	SAFEFREE(in->master.server.type) ;
 	SAFEFREE(in->master.server.domain) ;
 	SAFEFREE(in->master.server.name) ;
@@ -31,6 +31,7 @@ struct directory_element_structure {
 } ;
 
 static uint32_t SetupControlFlags(const struct parsedname *pn);
+static ZERO_OR_ERROR ServerReadManyFlags(struct one_wire_query ** owq_list, int count, SIZE_OR_ERROR * results, uint32_t control_flags);
 
 static ZERO_OR_ERROR ServerDIRALL(void (*dirfunc) (void *, const struct parsedname * const), void *v, const struct parsedname *pn_whole_directory, uint32_t * flags);
 static ZERO_OR_ERROR ServerDIR(void (*dirfunc) (void *, const struct parsedname * const), void *v, const struct parsedname *pn_whole_directory, uint32_t * flags);
@@ -92,6 +93,173 @@ SIZE_OR_ERROR ServerRead(struct one_wire_query *owq)
 	return cm.ret;
 }
 
+// Send to an owserver using the GETMANY message
+// All the queries must be for the same owserver connection
+// The control flags go with the whole message, so paths that need different flags
+// (e.g. /bus.n or /uncached) are sent in separate messages
+// results[i] gets the length read for owq_list[i] or an error
+// Returns 0, or an error for the whole request (-ENOMSG if the owserver doesn't know GETMANY)
+ZERO_OR_ERROR ServerReadMany(struct one_wire_query ** owq_list, int count, SIZE_OR_ERROR * results)
+{
+	struct one_wire_query ** group ;
+	SIZE_OR_ERROR * group_results ;
+	int * group_index ;
+	char * sent ;
+	ZERO_OR_ERROR ret = 0 ;
+	int i ;
+
+	for ( i = 0 ; i < count ; ++i ) {
+		results[i] = -EIO ; // unless answered
+	}
+
+	group = owcalloc( count, sizeof(struct one_wire_query *) ) ;
+	group_results = owcalloc( count, sizeof(SIZE_OR_ERROR) ) ;
+	group_index = owcalloc( count, sizeof(int) ) ;
+	sent = owcalloc( count, sizeof(char) ) ;
+	if ( group == NULL || group_results == NULL || group_index == NULL || sent == NULL ) {
+		SAFEFREE( group ) ;
+		SAFEFREE( group_results ) ;
+		SAFEFREE( group_index ) ;
+		SAFEFREE( sent ) ;
+		return -ENOMEM ;
+	}
+
+	for ( i = 0 ; i < count && ret == 0 ; ++i ) {
+		uint32_t control_flags ;
+		int group_count = 0 ;
+		int j ;
+
+		if ( sent[i] ) {
+			continue ;
+		}
+		control_flags = SetupControlFlags( PN(owq_list[i]) ) ;
+		for ( j = i ; j < count ; ++j ) {
+			if ( ! sent[j] && SetupControlFlags( PN(owq_list[j]) ) == control_flags ) {
+				group[group_count] = owq_list[j] ;
+				group_index[group_count] = j ;
+				++group_count ;
+				sent[j] = 1 ;
+			}
+		}
+
+		ret = ServerReadManyFlags( group, group_count, group_results, control_flags ) ;
+
+		for ( j = 0 ; j < group_count ; ++j ) {
+			results[group_index[j]] = group_results[j] ;
+		}
+	}
+
+	owfree( group ) ;
+	owfree( group_results ) ;
+	owfree( group_index ) ;
+	owfree( sent ) ;
+	return ret ;
+}
+
+// One GETMANY message, all the queries with the same control flags
+static ZERO_OR_ERROR ServerReadManyFlags(struct one_wire_query ** owq_list, int count, SIZE_OR_ERROR * results, uint32_t control_flags)
+{
+	struct server_msg sm;
+	struct client_msg cm;
+	struct parsedname *pn_first = PN(owq_list[0]);
+	struct serverpackage sp = { NULL, NULL, 0, pn_first->tokenstring, pn_first->tokens, };
+	struct connection_in * in = pn_first->selected_connection ;
+	struct server_connection_state scs ;
+	BYTE * path_list ;
+	size_t path_list_length = 0 ;
+	char * data ;
+	int i ;
+
+	for ( i = 0 ; i < count ; ++i ) {
+		results[i] = -EIO ; // unless answered
+	}
+
+	// Do we know this server doesn't support GETMANY?
+	if ( in->master.server.no_getmany ) {
+		return -ENOMSG ;
+	}
+
+	// initialization
+	scs.in = in ;
+	memset(&sm, 0, sizeof(struct server_msg));
+	memset(&cm, 0, sizeof(struct client_msg));
+	sm.type = msg_getmany;
+	sm.offset = 0 ;
+
+	// paths, each null-terminated, one after another
+	for ( i = 0 ; i < count ; ++i ) {
+		path_list_length += strlen( PN(owq_list[i])->path_to_server ) + 1 ;
+		if ( OWQ_size(owq_list[i]) > (size_t) sm.size ) {
+			sm.size = OWQ_size(owq_list[i]) ;
+		}
+	}
+	if ( path_list_length > MAX_OWSERVER_PROTOCOL_PAYLOAD_SIZE ) {
+		return -EMSGSIZE ;
+	}
+	path_list = owmalloc( path_list_length ) ;
+	if ( path_list == NULL ) {
+		return -ENOMEM ;
+	}
+	sp.data = path_list ;
+	sp.datasize = path_list_length ;
+	for ( i = 0 ; i < count ; ++i ) {
+		size_t length = strlen( PN(owq_list[i])->path_to_server ) + 1 ;
+		memcpy( path_list, PN(owq_list[i])->path_to_server, length ) ;
+		path_list += length ;
+	}
+
+	LEVEL_CALL("SERVER(%d) %d paths, first=%s", in->index, count, SAFESTRING(pn_first->path_to_server));
+
+	// Send to owserver
+	sm.control_flags = control_flags;
+	if ( BAD( To_Server( &scs, &sm, &sp) ) ) {
+		owfree( sp.data ) ;
+		Release_Persistent( &scs, 0);
+		return -EIO ;
+	}
+	owfree( sp.data ) ;
+
+	// Receive from owserver -- one message per path (tagged by offset) then a final one (offset 0)
+	while ( 1 ) {
+		data = From_ServerAlloc( &scs, &cm ) ;
+		if ( cm.offset <= 0 || cm.offset > count ) {
+			// final message, or an error
+			SAFEFREE( data ) ;
+			break ;
+		}
+		i = cm.offset - 1 ;
+		if ( data == NULL && cm.payload > 0 && cm.ret >= 0 ) {
+			// payload not read -- can't stay in step with the owserver
+			cm.ret = -EIO ;
+			break ;
+		}
+		if ( cm.ret < 0 ) {
+			results[i] = cm.ret ;
+		} else {
+			size_t length = (data == NULL) ? 0 : (size_t) cm.payload ;
+			if ( length > OWQ_size(owq_list[i]) ) {
+				length = OWQ_size(owq_list[i]) ;
+			}
+			if ( length > 0 ) {
+				memcpy( OWQ_buffer(owq_list[i]), data, length ) ;
+			}
+			results[i] = length ;
+		}
+		SAFEFREE( data ) ;
+	}
+
+	if ( cm.ret == -ENOMSG ) {
+		LEVEL_DEBUG("Server %s doesn't support GETMANY", SAFESTRING(DEVICENAME(in))) ;
+		in->master.server.no_getmany = 1 ;
+	}
+	if ( cm.ret < 0 ) {
+		Release_Persistent( &scs, 0);
+		return cm.ret ;
+	}
+	Release_Persistent( &scs, cm.control_flags & PERSISTENT_MASK);
+	return 0 ;
+}
+
 // Send to an owserver using the PRESENT message
 INDEX_OR_ERROR ServerPresence( struct parsedname *pn_file_entry)
 {
@@ -512,62 +680,109 @@ static SIZE_OR_ERROR From_Server( struct server_connection_state * scs, struct c
 	return cm->payload;
 }
 
-static GOOD_OR_BAD To_Server( struct server_connection_state * scs, struct server_msg * sm, struct serverpackage *sp)
+/* Connection pool
+ * Each owserver keeps up to Globals.server_pool persistent connections.
+ * Idle ones wait in master.server.pool (oldest first), and are closed after
+ * Globals.server_pool_idle seconds unused. pool_busy counts the ones lent out.
+ * Once the bus is closing, released connections are closed instead, and the
+ * last one back frees the pool.
+ * Protected by BUSLOCKIN
+ * */
+
+static void Pool_Done( struct master_server * ms ) ;
+
+// Take over the connection made when the owserver was detected
+void ServerPoolSetup( struct connection_in * in )
 {
-	struct connection_in * in = scs->in ; // for convenience
+	struct master_server * ms = &(in->master.server) ;
 	struct port_in * pin = in->pown ;
+
+	ms->pool_idle = 0 ;
+	ms->pool_busy = 0 ;
+	ms->pool_closing = 0 ;
+	ms->pool = NULL ;
+	if ( Globals.server_pool > 0 ) {
+		ms->pool = owcalloc( Globals.server_pool, sizeof(struct server_pool_slot) ) ;
+	}
+
+	if ( FILE_DESCRIPTOR_VALID( pin->file_descriptor ) ) {
+		if ( ms->pool == NULL ) {
+			Test_and_Close( &(pin->file_descriptor) ) ;
+		} else {
+			ms->pool[0].file_descriptor = pin->file_descriptor ;
+			timernow( &(ms->pool[0].idle_until) ) ;
+			ms->pool[0].idle_until.tv_sec += Globals.server_pool_idle ;
+			ms->pool_idle = 1 ;
+		}
+	}
+	pin->file_descriptor = FILE_DESCRIPTOR_BAD ;
+}
+
+// Close all the idle connections (the busy ones close on release)
+void ServerPoolClose( struct connection_in * in )
+{
+	struct master_server * ms = &(in->master.server) ;
+
+	BUSLOCKIN(in);
+	ms->pool_closing = 1 ;
+	while ( ms->pool_idle > 0 ) {
+		--ms->pool_idle ;
+		Test_and_Close( &(ms->pool[ms->pool_idle].file_descriptor) ) ;
+	}
+	if ( ms->pool_busy == 0 ) {
+		SAFEFREE( ms->pool ) ;
+	}
+	BUSUNLOCKIN(in);
+}
+
+// A lent-out connection is no longer in use -- called with BUSLOCKIN
+static void Pool_Done( struct master_server * ms )
+{
+	--ms->pool_busy ;
+	if ( ms->pool_closing && ms->pool_busy == 0 ) {
+		SAFEFREE( ms->pool ) ;
+	}
+}
+
+// Close idle connections that have waited too long -- called with BUSLOCKIN
+static void Pool_Reap( struct connection_in * in )
+{
+	struct master_server * ms = &(in->master.server) ;
+	struct timeval now ;
+	int expired = 0 ;
+
+	timernow( &now ) ;
+	while ( expired < ms->pool_idle && timercmp( &(ms->pool[expired].idle_until), &now, <) ) {
+		Test_and_Close( &(ms->pool[expired].file_descriptor) ) ;
+		++expired ;
+	}
+	if ( expired > 0 ) {
+		LEVEL_DEBUG("Closed %d idle connections to %s", expired, SAFESTRING(DEVICENAME(in)));
+		ms->pool_idle -= expired ;
+		memmove( &(ms->pool[0]), &(ms->pool[expired]), ms->pool_idle * sizeof(struct server_pool_slot) ) ;
+	}
+}
+
+// Check if the server closed the connection
+// This is contributed by Jacob Joseph to fix a timeout problem.
+// http://permalink.gmane.org/gmane.comp.file-systems.owfs.devel/7306
+static GOOD_OR_BAD Pool_Healthy( FILE_DESCRIPTOR_OR_ERROR file_descriptor )
+{
 	BYTE test_read[1] ;
 	int old_flags ;
 	ssize_t rcv_value ;
-	int saved_errno ;
-	
-	// initialize the variables
-	scs->file_descriptor = FILE_DESCRIPTOR_BAD ;
-	scs->persistence = Globals.no_persistence ? persistent_no : persistent_yes ;
+	int saved_errno = 0 ;
 
-	// First set up the file descriptor based on persistent state
-	if (scs->persistence == persistent_no) {		
-		// no persistence wanted
-		scs->file_descriptor = ClientConnect(in);
-	} else {
-		// Persistence desired
-		BUSLOCKIN(in);
-		switch ( pin->file_descriptor ) {
-			case FILE_DESCRIPTOR_PERSISTENT_IN_USE:
-				// Currently in use, so make new non-persistent connection
-				scs->file_descriptor = ClientConnect(in);
-				scs->persistence = persistent_no ;
-				break ;
-			case FILE_DESCRIPTOR_BAD:
-				// no conection currently, so make a new one
-				scs->file_descriptor = ClientConnect(in);
-				if ( FILE_DESCRIPTOR_VALID( scs->file_descriptor ) ) {
-					pin->file_descriptor = FILE_DESCRIPTOR_PERSISTENT_IN_USE ;
-				}	
-				break ;
-			default:
-				// persistent connection idle and waiting for use
-				// connection_in is locked so this is safe
-				scs->file_descriptor = pin->file_descriptor;
-				pin->file_descriptor = FILE_DESCRIPTOR_PERSISTENT_IN_USE;
-			break ;
-		}
-		BUSUNLOCKIN(in);
-	}
-	
-	// Check if the server closed the connection
-	// This is contributed by Jacob Joseph to fix a timeout problem.
-	// http://permalink.gmane.org/gmane.comp.file-systems.owfs.devel/7306
-	//rcv_value = recv(scs->file_descriptor, test_read, 1, MSG_DONTWAIT | MSG_PEEK) ;
-	old_flags = fcntl( scs->file_descriptor, F_GETFL, 0 ) ; // save socket flags
+	//rcv_value = recv(file_descriptor, test_read, 1, MSG_DONTWAIT | MSG_PEEK) ;
+	old_flags = fcntl( file_descriptor, F_GETFL, 0 ) ; // save socket flags
 	if ( old_flags == -1 ) {
 		rcv_value = -2 ;
-	} else if ( fcntl( scs->file_descriptor, F_SETFL, old_flags | O_NONBLOCK ) == -1 ) { // set non-blocking
+	} else if ( fcntl( file_descriptor, F_SETFL, old_flags | O_NONBLOCK ) == -1 ) { // set non-blocking
 		rcv_value = -2 ;
 	} else {
-		rcv_value = recv(scs->file_descriptor, test_read, 1, MSG_PEEK) ; // test read the socket to see if closed
+		rcv_value = recv(file_descriptor, test_read, 1, MSG_PEEK) ; // test read the socket to see if closed
 		saved_errno = errno ;
-		if ( fcntl( scs->file_descriptor, F_SETFL, old_flags ) == -1 ) { // restore  socket flags
+		if ( fcntl( file_descriptor, F_SETFL, old_flags ) == -1 ) { // restore  socket flags
 			rcv_value = -2 ;
 		}
 	}
@@ -576,25 +791,86 @@ static GOOD_OR_BAD To_Server( struct server_connection_state * scs, struct serve
 		case -1:
 			if ( saved_errno==EAGAIN || saved_errno==EWOULDBLOCK ) {
 				// No data to be read -- so connection healthy
-				break ;
+				return gbGOOD ;
 			}
-			// real error, fall through to close connection case
-			__attribute__ ((fallthrough));
+			// real error
+			return gbBAD ;
 		case -2:
-			// fnctl error, fall through again
-			;
-			__attribute__ ((fallthrough));
+			// fnctl error
 		case 0:
-			LEVEL_DEBUG("Server connection was closed.  Reconnecting.");
-			Close_Persistent( scs);
-			scs->file_descriptor = ClientConnect(in);
-			if ( FILE_DESCRIPTOR_VALID( scs->file_descriptor ) ) {
-				in->pown->file_descriptor = FILE_DESCRIPTOR_PERSISTENT_IN_USE ;
-			}
-			break ;
+			// closed by the server
+			return gbBAD ;
 		default:
 			// data to be read, so a good connection
+			return gbGOOD ;
+	}
+}
+
+// Get a connection from the pool, or make a new one
+static void Pool_Get( struct server_connection_state * scs )
+{
+	struct connection_in * in = scs->in ;
+	struct master_server * ms = &(in->master.server) ;
+
+	while (1) {
+		FILE_DESCRIPTOR_OR_ERROR file_descriptor ;
+
+		BUSLOCKIN(in);
+		if ( ms->pool_idle == 0 ) {
+			break ;
+		}
+		Pool_Reap( in ) ;
+		if ( ms->pool_idle == 0 ) {
 			break ;
+		}
+		// most recently used is least likely to have been dropped by the server
+		--ms->pool_idle ;
+		file_descriptor = ms->pool[ms->pool_idle].file_descriptor ;
+		++ms->pool_busy ;
+		BUSUNLOCKIN(in);
+
+		if ( GOOD( Pool_Healthy( file_descriptor ) ) ) {
+			STAT_ADD1_BUS(e_bus_pool_hits, in);
+			scs->file_descriptor = file_descriptor ;
+			scs->persistence = persistent_yes ;
+			return ;
+		}
+
+		LEVEL_DEBUG("Server connection was closed.  Reconnecting.");
+		Test_and_Close( &file_descriptor ) ;
+		BUSLOCKIN(in);
+		Pool_Done( ms ) ;
+		BUSUNLOCKIN(in);
+	}
+
+	// nothing idle -- make a new connection, persistent if there is room in the pool
+	if ( ms->pool != NULL && ! ms->pool_closing && ms->pool_busy < Globals.server_pool ) {
+		++ms->pool_busy ;
+		scs->persistence = persistent_yes ;
+	} else {
+		scs->persistence = persistent_no ;
+	}
+	BUSUNLOCKIN(in);
+
+	STAT_ADD1_BUS(e_bus_pool_misses, in);
+	scs->file_descriptor = ClientConnect(in);
+}
+
+static GOOD_OR_BAD To_Server( struct server_connection_state * scs, struct server_msg * sm, struct serverpackage *sp)
+{
+	struct connection_in * in = scs->in ; // for convenience
+
+	// initialize the variables
+	scs->file_descriptor = FILE_DESCRIPTOR_BAD ;
+
+	// First set up the file descriptor based on persistent state
+	if ( Globals.no_persistence ) {
+		// no persistence wanted
+		scs->persistence = persistent_no ;
+		scs->file_descriptor = ClientConnect(in);
+	} else {
+		// Persistence desired
+		Pool_Get( scs ) ;
 	}
 
 	// Now test
@@ -618,7 +894,8 @@ static GOOD_OR_BAD To_Server( struct server_connection_state * scs, struct serve
 	}
 	
 	// perhaps the persistent connection is stale?
-	// Make a new one
+	// Make a new one (keeping our place in the pool)
+	Test_and_Close( &(scs->file_descriptor) ) ;
 	scs->file_descriptor = ClientConnect(in) ;
 
 	// Now retest
@@ -629,8 +906,6 @@ static GOOD_OR_BAD To_Server( struct server_connection_state * scs, struct serve
 		return gbBAD ;
 	}
 	
-	// Leave in->file_descriptor = FILE_DESCRIPTOR_PERSISTENT_IN_USE
-
 	// Second attempt at the write, now with new connection
 	if (WriteToServer(scs->file_descriptor, sm, sp) >= 0) {
 		// successful message
@@ -644,11 +919,10 @@ static GOOD_OR_BAD To_Server( struct server_connection_state * scs, struct serve
 
 static void Close_Persistent( struct server_connection_state * scs)
 {
-	// First set up the file descriptor based on persistent state
+	// Give up our place in the pool
 	if (scs->persistence == persistent_yes) {
-		// no persistence wanted
 		BUSLOCKIN(scs->in);
-			scs->in->pown->file_descriptor = FILE_DESCRIPTOR_BAD ;
+			Pool_Done( &(scs->in->master.server) ) ;
 		BUSUNLOCKIN(scs->in);
 	}
 	
@@ -784,6 +1058,9 @@ static uint32_t SetupControlFlags(const struct parsedname *pn)
 	/* from owlib to owserver never wants alias */
 	control_flags &= ~ALIAS_REQUEST ;
 
+	/* pipelining belongs to the client's connection, not ours */
+	control_flags &= ~PIPELINE_MASK ;
+
 	control_flags &= ~SHOULD_RETURN_BUS_LIST;
 	if (SpecifiedBus(pn)) {
 		control_flags |= SHOULD_RETURN_BUS_LIST;
@@ -814,10 +1091,26 @@ static void Release_Persistent( struct server_connection_state * scs, int grante
 		return ;
 	}
 
-	// mark as available
+	// back in the pool as available
 	BUSLOCKIN(scs->in);
-	scs->in->pown->file_descriptor = scs->file_descriptor;
+	{
+		struct master_server * ms = &(scs->in->master.server) ;
+
+		if ( ms->pool == NULL || ms->pool_closing ) {
+			// no pool to go back to -- close it
+			Pool_Done( ms ) ;
+		} else {
+			struct server_pool_slot * slot = &(ms->pool[ms->pool_idle]) ;
+
+			--ms->pool_busy ;
+			++ms->pool_idle ;
+			slot->file_descriptor = scs->file_descriptor ;
+			timernow( &(slot->idle_until) ) ;
+			slot->idle_until.tv_sec += Globals.server_pool_idle ;
+			scs->file_descriptor = FILE_DESCRIPTOR_BAD ; // the pool owns it now
+		}
+	}
 	BUSUNLOCKIN(scs->in);
 	scs->persistence = persistent_no ; // we no longer own this connection
-	scs->file_descriptor = FILE_DESCRIPTOR_BAD ;
+	Test_and_Close( &(scs->file_descriptor) ) ;
 }
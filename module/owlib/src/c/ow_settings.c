@@ -29,6 +29,8 @@ READ_FUNCTION(FS_r_PS);
 WRITE_FUNCTION(FS_w_PS);
 READ_FUNCTION(FS_aliaslist);
 READ_FUNCTION(FS_return_code);
+READ_FUNCTION(FS_r_cache_policy);
+WRITE_FUNCTION(FS_w_cache_policy);
 
 /* -------- Structures ---------- */
 
@@ -66,6 +68,13 @@ struct device d_set_alias = { "alias", "alias", ePN_settings, COUNT_OF_FILETYPES
 	set_alias, NO_GENERIC_READ, NO_GENERIC_WRITE
 };
 
+static struct filetype set_cache[] = {
+ 	{"policy", 6, NON_AGGREGATE, ft_ascii, fc_static, FS_r_cache_policy, FS_w_cache_policy, VISIBLE, NO_FILETYPE_DATA, },
+};
+struct device d_set_cache = { "cache", "cache", ePN_settings, COUNT_OF_FILETYPES(set_cache),
+	set_cache, NO_GENERIC_READ, NO_GENERIC_WRITE
+};
+
 static struct aggregate Areturn_code = { N_RETURN_CODES, ag_numbers, ag_separate, };
 static struct filetype set_return_code[] = {
 	{"text", 128, &Areturn_code, ft_ascii, fc_static, FS_return_code, NO_WRITE_FUNCTION, VISIBLE, NO_FILETYPE_DATA, },
@@ -174,6 +183,33 @@ static ZERO_OR_ERROR FS_r_PS(struct one_wire_query *owq)
 	return OWQ_format_output_offset_and_size_z(PressureScaleName(Globals.pressure_scale), owq);
 }
 
+static ZERO_OR_ERROR FS_r_cache_policy(struct one_wire_query *owq)
+{
+	switch ( Globals.cache_policy ) {
+		case cache_policy_reject:
+			return OWQ_format_output_offset_and_size_z("reject", owq);
+		case cache_policy_clock:
+		default:
+			return OWQ_format_output_offset_and_size_z("clock", owq);
+	}
+}
+
+/* Takes effect for the next full shard -- /statistics/cache has hits by policy */
+static ZERO_OR_ERROR FS_w_cache_policy(struct one_wire_query *owq)
+{
+	if (OWQ_size(owq) < 1 || OWQ_offset(owq) > 0) {
+		return -EINVAL ;
+	}
+	if ( strncasecmp( OWQ_buffer(owq), "clock", 5 ) == 0 ) {
+		Globals.cache_policy = cache_policy_clock ;
+	} else if ( strncasecmp( OWQ_buffer(owq), "reject", 6 ) == 0 ) {
+		Globals.cache_policy = cache_policy_reject ;
+	} else {
+		return -EINVAL ;
+	}
+	return 0;
+}
+
 static ZERO_OR_ERROR FS_aliaslist( struct one_wire_query * owq )
 {
 	struct memblob mb ;
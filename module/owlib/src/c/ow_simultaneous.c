@@ -42,6 +42,10 @@
 
 /* Added "present" From Jan Kandziora to search for any devices */
 
+/* "temperature_all" converts once and then reads every thermometer on the bus,
+ * filling the cache of each device's temperature property
+ * Without /bus.n it does this on every bus, one after another */
+
 #include <config.h>
 #include "owfs_config.h"
 #include "ow_simultaneous.h"
@@ -69,6 +73,7 @@ static struct filetype simultaneous[] = {
 	{"present_ds2400", PROPERTY_LENGTH_YESNO, NON_AGGREGATE, ft_yesno, fc_volatile, FS_r_present, NO_WRITE_FUNCTION, VISIBLE, {.i=_1W_OLD_READ_ROM}, },
 	{"single", 18, NON_AGGREGATE, ft_ascii, fc_volatile, FS_r_single, NO_WRITE_FUNCTION, VISIBLE, {.i=_1W_READ_ROM}, },
 	{"single_ds2400", 18, NON_AGGREGATE, ft_ascii, fc_volatile, FS_r_single, NO_WRITE_FUNCTION, VISIBLE, {.i=_1W_OLD_READ_ROM}, },
+	{"temperature_all", MAX_OWSERVER_PROTOCOL_PAYLOAD_SIZE, NON_AGGREGATE, ft_ascii, fc_link, FS_r_temperature_all, NO_WRITE_FUNCTION, VISIBLE, NO_FILETYPE_DATA, },
 };
 
 DeviceEntry(simultaneous, simultaneous, NO_GENERIC_READ, NO_GENERIC_WRITE);
@@ -76,6 +81,14 @@ DeviceEntry(simultaneous, simultaneous, NO_GENERIC_READ, NO_GENERIC_WRITE);
 #define _1W_CONVERT_T             0x44
 #define _1W_READ_POWERMODE        0xB4
 #define _1W_CONVERT_IBLSS         0xB4
+#define _1W_READ_SCRATCHPAD       0xBE
+
+/* One thermometer of temperature_all */
+struct thermometer {
+	BYTE sn[SERIAL_NUMBER_SIZE];
+	BYTE scratchpad[9];
+	GOOD_OR_BAD read ;
+};
 
 /* ------- Functions ------------ */
 //static void OW_single2cache(BYTE * sn, const struct parsedname *pn2);
@@ -377,3 +390,332 @@ static ZERO_OR_ERROR FS_r_single(struct one_wire_query *owq)
 	}
 	return OWQ_format_output_offset_and_size_z(ad, owq);
 }
+
+/* Thermometer families -- DS18S20, DS1822, DS18B20, DS1825 and DS28EA00 */
+static int OW_is_thermometer( const BYTE * sn )
+{
+	switch ( sn[0] ) {
+		case 0x10:
+		case 0x22:
+		case 0x28:
+		case 0x3B:
+		case 0x42:
+			return 1 ;
+		default:
+			return 0 ;
+	}
+}
+
+/* Thermometers on this bus (or branch), from the cached directory or a new search
+ * Called with the bus locked
+ * Returns the number found (allocated list), or -1 */
+static int OW_thermometer_list( struct thermometer ** list, const struct parsedname * pn_bus )
+{
+	struct dirblob db ;
+	BYTE sn[SERIAL_NUMBER_SIZE] ;
+	int dindex ;
+	int count = 0 ;
+
+	if ( BAD( Cache_Get_Dir( &db, pn_bus ) ) ) {
+		struct device_search ds ;
+		enum search_status next ;
+
+		DirblobInit( &db ) ;
+		for ( next = BUS_first( &ds, pn_bus ) ; next == search_good ; next = BUS_next( &ds, pn_bus ) ) {
+			Cache_Add_Device( pn_bus->selected_connection->index, ds.sn ) ;
+			DirblobAdd( ds.sn, &db ) ;
+		}
+		if ( next != search_done || ! DirblobPure( &db ) ) {
+			DirblobClear( &db ) ;
+			return -1 ;
+		}
+		Cache_Add_Dir( &db, pn_bus ) ;
+	}
+
+	list[0] = owcalloc( DirblobElements( &db ) + 1, sizeof(struct thermometer) ) ;
+	if ( list[0] == NULL ) {
+		DirblobClear( &db ) ;
+		return -1 ;
+	}
+	for ( dindex = 0 ; DirblobGet( dindex, sn, &db ) == 0 ; ++dindex ) {
+		if ( OW_is_thermometer( sn ) ) {
+			memcpy( list[0][count].sn, sn, SERIAL_NUMBER_SIZE ) ;
+			list[0][count].read = gbBAD ;
+			++count ;
+		}
+	}
+	DirblobClear( &db ) ;
+	return count ;
+}
+
+/* Skip-ROM conversion of every thermometer, returns when all are done
+ * Called with the bus locked */
+static GOOD_OR_BAD OW_convert_all( const struct parsedname * pn_bus )
+{
+	const BYTE cmd_temp[] = { _1W_SKIP_ROM, _1W_CONVERT_T };
+	const BYTE cmd_powermode[] = { _1W_SKIP_ROM, _1W_READ_POWERMODE, };
+	BYTE pow[1] ;
+	BYTE done[1] ;
+	int poll ;
+	struct transaction_log tpower[] = {
+		TRXN_START,
+		TRXN_WRITE2(cmd_powermode),
+		TRXN_READ1(pow),
+		TRXN_END,
+	};
+	struct transaction_log t_powered_convert[] = {
+		TRXN_START,
+		TRXN_WRITE2(cmd_temp),
+		TRXN_END,
+	};
+	struct transaction_log t_unpowered_convert[] = {
+		TRXN_START,
+		TRXN_WRITE2(cmd_temp),
+		TRXN_DELAY(1000),
+		TRXN_END,
+	};
+	// thermometers still converting answer 0 to read slots
+	struct transaction_log tpoll[] = {
+		TRXN_DELAY(50),
+		TRXN_READ1(done),
+		TRXN_END,
+	};
+
+	RETURN_BAD_IF_BAD( BUS_transaction_nolock(tpower, pn_bus) ) ;
+	if ( pow[0] == 0 ) {
+		// some thermometer is parasite powered -- wait out the longest conversion
+		LEVEL_DEBUG("Unpowered conversion of all thermometers");
+		return BUS_transaction_nolock(t_unpowered_convert, pn_bus) ;
+	}
+
+	RETURN_BAD_IF_BAD( BUS_transaction_nolock(t_powered_convert, pn_bus) ) ;
+	for ( poll = 0 ; poll < 20 ; ++poll ) {
+		RETURN_BAD_IF_BAD( BUS_transaction_nolock(tpoll, pn_bus) ) ;
+		if ( done[0] != 0 ) {
+			LEVEL_DEBUG("Conversion of all thermometers done after %dms", (poll + 1) * 50 );
+			return gbGOOD ;
+		}
+	}
+	LEVEL_DEBUG("Conversion of all thermometers did not finish");
+	return gbBAD ;
+}
+
+/* Called with the bus locked */
+static GOOD_OR_BAD OW_r_thermometer( struct thermometer * thermometer, const struct parsedname * pn_bus )
+{
+	struct parsedname pn_device ;
+	BYTE be[] = { _1W_READ_SCRATCHPAD, };
+	struct transaction_log tread[] = {
+		TRXN_START,
+		TRXN_WRITE1(be),
+		TRXN_READ(thermometer->scratchpad, 9),
+		TRXN_CRC8(thermometer->scratchpad, 9),
+		TRXN_END,
+	};
+
+	memmove( &pn_device, pn_bus, sizeof(struct parsedname)) ; // shallow copy
+	memcpy( pn_device.sn, thermometer->sn, SERIAL_NUMBER_SIZE ) ;
+	pn_device.selected_device = FS_devicefindhex( thermometer->sn[0], &pn_device ) ;
+	return BUS_transaction_nolock(tread, &pn_device) ;
+}
+
+/* Cache this thermometer's reading and add it to the list */
+static void OW_thermometer_output( struct thermometer * thermometer, const char * directory, struct memblob * mb, const struct parsedname * pn )
+{
+	struct parsedname pn_device ;
+	const char * property ;
+	char name[PROPERTY_LENGTH_ALIAS + 1] ;
+	char line[PROPERTY_LENGTH_ALIAS + PROPERTY_LENGTH_TEMP + 16] ;
+	char file[PATH_MAX] ;
+	_FLOAT temperature ;
+	int len ;
+	OWQ_allocate_struct_and_pointer(owq_temperature);
+
+	FS_devicename( name, PROPERTY_LENGTH_ALIAS, thermometer->sn, pn ) ;
+	memmove( &pn_device, pn, sizeof(struct parsedname)) ; // shallow copy
+	memcpy( pn_device.sn, thermometer->sn, SERIAL_NUMBER_SIZE ) ;
+
+	if ( BAD( thermometer->read ) ) {
+		// failed scratchpad, ordinary read (using this conversion)
+		property = "temperature" ;
+	} else if ( BAD( OW_scratchpad_temperature( &temperature, &property, thermometer->scratchpad, &pn_device ) ) ) {
+		LEVEL_DEBUG("No temperature in scratchpad of "SNformat, SNvar(thermometer->sn));
+		return ;
+	}
+
+	UCLIBCLOCK;
+	snprintf( file, PATH_MAX, "%s/%s", name, property ) ;
+	UCLIBCUNLOCK;
+	if ( BAD( OWQ_create_plus( directory, file, owq_temperature ) ) ) {
+		return ;
+	}
+	if ( BAD( thermometer->read ) ) {
+		if ( FS_read_local( owq_temperature ) < 0 ) {
+			OWQ_destroy( owq_temperature ) ;
+			return ;
+		}
+		temperature = OWQ_F( owq_temperature ) ;
+	} else {
+		OWQ_F( owq_temperature ) = temperature ;
+		OWQ_Cache_Add( owq_temperature ) ;
+	}
+	OWQ_destroy( owq_temperature ) ;
+
+	UCLIBCLOCK;
+	len = snprintf( line, sizeof(line), "%s=%G\x0D\x0A", name, Temperature( temperature, pn ) ) ;
+	UCLIBCUNLOCK;
+	if ( len > 0 && (size_t) len < sizeof(line) ) {
+		MemblobAdd( (BYTE *) line, len, mb ) ;
+	}
+}
+
+/* Convert every thermometer on one local bus at once, then read them all in one pass
+ * Adds a line name=temperature to mb for each one read */
+static ZERO_OR_ERROR OW_temperature_all_bus( struct memblob * mb, const char * directory, const struct parsedname * pn )
+{
+	struct parsedname pn_bus ; // this bus (or branch) without a device
+	struct parsedname pn_directory ;
+	struct connection_in * in = pn->selected_connection ;
+	struct thermometer * list = NULL ;
+	int count ;
+	int index ;
+
+	switch (in->Adapter) {
+		case adapter_Bad:
+		case adapter_w1_monitor:
+		case adapter_browse_monitor:
+		case adapter_usb_monitor:
+		case adapter_fake:
+		case adapter_tester:
+		case adapter_mock:
+			/* Since reading /simultaneous/temperature_all goes through all
+			* adapters, these simply have no thermometers to add. */
+			return 0 ;
+		default:
+			break ;
+	}
+	if ( in->iroutines.flags & ADAP_FLAG_sham ) {
+		// monitors have no thermometers of their own
+		return 0 ;
+	}
+
+	memmove( &pn_bus, pn, sizeof(struct parsedname)) ; // shallow copy
+	pn_bus.selected_device = NO_DEVICE ;
+	pn_bus.selected_filetype = NO_FILETYPE ;
+	FS_LoadDirectoryOnly(&pn_directory, pn);
+
+	BUSLOCK(pn);
+	count = OW_thermometer_list( &list, &pn_bus ) ;
+	if ( count > 0 ) {
+		Cache_Add_Simul(SlaveSpecificTag(S_T), &pn_directory);	// Mark start time
+		if ( GOOD( OW_convert_all( &pn_bus ) ) ) {
+			for ( index = 0 ; index < count ; ++index ) {
+				list[index].read = OW_r_thermometer( &list[index], &pn_bus ) ;
+			}
+		} else {
+			Cache_Del_Simul(SlaveSpecificTag(S_T), &pn_directory);	// Clear start time
+			count = -1 ;
+		}
+	}
+	BUSUNLOCK(pn);
+
+	if ( count < 0 ) {
+		SAFEFREE( list ) ;
+		LEVEL_DEBUG("Trouble reading all temperatures on bus %d", in->index);
+		return -EINVAL ;
+	}
+
+	for ( index = 0 ; index < count ; ++index ) {
+		OW_thermometer_output( &list[index], directory, mb, pn ) ;
+	}
+	owfree( list ) ;
+	return 0 ;
+}
+
+/* temperature_all of a remote bus -- the owserver does its own buses */
+static ZERO_OR_ERROR OW_temperature_all_server( struct memblob * mb, struct one_wire_query * owq_bus )
+{
+	char * buffer = owmalloc( MAX_OWSERVER_PROTOCOL_PAYLOAD_SIZE ) ;
+	SIZE_OR_ERROR size ;
+
+	if ( buffer == NULL ) {
+		return -ENOMEM ;
+	}
+	OWQ_assign_read_buffer( buffer, MAX_OWSERVER_PROTOCOL_PAYLOAD_SIZE, 0, owq_bus ) ;
+	size = ServerRead( owq_bus ) ;
+	if ( size > 0 ) {
+		MemblobAdd( (BYTE *) buffer, size, mb ) ;
+	}
+	owfree( buffer ) ;
+	return size < 0 ? size : 0 ;
+}
+
+/* Convert every thermometer at once, then read them all in one pass
+ * On the given bus, or else on every bus in turn
+ * Output is a line name=temperature for each one read */
+ZERO_OR_ERROR FS_r_temperature_all(struct one_wire_query *owq)
+{
+	struct parsedname *pn = PN(owq);
+	char directory[PATH_MAX] ;
+	char * slash ;
+	struct memblob mb ;
+	int index ;
+	ZERO_OR_ERROR zoe ;
+
+	// device paths are relative to the directory holding "simultaneous"
+	strncpy( directory, pn->path, PATH_MAX-1 ) ;
+	directory[PATH_MAX-1] = '\0' ;
+	for ( index = 0 ; index < 2 ; ++index ) {
+		slash = strrchr( directory, '/' ) ;
+		if ( slash != NULL ) {
+			slash[0] = '\0' ;
+		}
+	}
+	if ( directory[0] == '\0' ) {
+		strcpy( directory, "/" ) ;
+	}
+
+	MemblobInit( &mb, PATH_MAX ) ;
+	if ( SpecifiedBus(pn) ) {
+		zoe = OW_temperature_all_bus( &mb, directory, pn ) ;
+	} else {
+		struct port_in * pin ;
+		int good = 0 ;
+
+		zoe = -ENODEV ;
+		for ( pin = Inbound_Control.head_port ; pin != NULL ; pin = pin->next ) {
+			struct connection_in * cin ;
+			for ( cin = pin->first ; cin != NO_CONNECTION ; cin = cin->next ) {
+				OWQ_allocate_struct_and_pointer(owq_bus);
+				ZERO_OR_ERROR zoe_bus ;
+
+				memcpy( owq_bus, owq, sizeof(struct one_wire_query) ) ; // shallow copy
+				SetKnownBus( cin->index, PN(owq_bus) ) ;
+				if ( BusIsServer( cin ) ) {
+					zoe_bus = OW_temperature_all_server( &mb, owq_bus ) ;
+				} else {
+					zoe_bus = OW_temperature_all_bus( &mb, directory, PN(owq_bus) ) ;
+				}
+				if ( zoe_bus == 0 ) {
+					++good ;
+				} else if ( good == 0 ) {
+					zoe = zoe_bus ;
+				}
+			}
+		}
+		if ( good > 0 ) {
+			// the buses that could be read
+			zoe = 0 ;
+		}
+	}
+
+	if ( zoe == 0 ) {
+		if ( MemblobPure( &mb ) ) {
+			zoe = OWQ_format_output_offset_and_size( (char *) MemblobData( &mb ), MemblobLength( &mb ), owq ) ;
+		} else {
+			zoe = -EINVAL ;
+		}
+	}
+	MemblobClear( &mb ) ;
+	return zoe ;
+}
@@ -50,36 +50,18 @@
 /* ---- Globalss ---- */
 /* ----------------- */
 UINT cache_flips = 0;
-UINT cache_adds = 0;
-struct average old_avg = { 0L, 0L, 0L, 0L, };
-struct average new_avg = { 0L, 0L, 0L, 0L, };
-struct average store_avg = { 0L, 0L, 0L, 0L, };
-struct cache_stats cache_ext = { 0L, 0L, 0L, 0L, 0L, };
-struct cache_stats cache_int = { 0L, 0L, 0L, 0L, 0L, };
-struct cache_stats cache_dir = { 0L, 0L, 0L, 0L, 0L, };
-struct cache_stats cache_pst = { 0L, 0L, 0L, 0L, 0L, };
-struct cache_stats cache_dev = { 0L, 0L, 0L, 0L, 0L, };
-
-UINT read_calls = 0;
-UINT read_cache = 0;
-UINT read_bytes = 0;
-UINT read_cachebytes = 0;
-UINT read_array = 0;
-UINT read_tries[3] = { 0, 0, 0, };
-UINT read_success = 0;
-struct average read_avg = { 0L, 0L, 0L, 0L, };
-
-UINT write_calls = 0;
-UINT write_bytes = 0;
-UINT write_array = 0;
-UINT write_tries[3] = { 0, 0, 0, };
-UINT write_success = 0;
-struct average write_avg = { 0L, 0L, 0L, 0L, };
-
-struct directory dir_main = { 0L, 0L, };
-struct directory dir_dev = { 0L, 0L, };
+UINT cache_purges = 0;
+UINT cache_purged = 0;
+UINT cache_evictions = 0;
+struct timeval cache_purge_time = { 0, 0, };
+struct timeval cache_purge_max = { 0, 0, };
+/* no second tree since entries expire individually -- stays 0, but the paths are kept for scripts */
+static struct average old_avg = { 0L, 0L, 0L, 0L, };
+
 UINT dir_depth = 0;
-struct average dir_avg = { 0L, 0L, 0L, 0L, };
+
+/* per-thread counters (ow_counters.h) -- totals of ended threads and the shared "current" */
+struct stat_counters stat_total ;
 
 /* max delay between a write and when reading first char */
 struct timeval max_delay = { 0, 0, };
@@ -88,12 +70,6 @@ struct timeval max_delay = { 0, 0, };
 UINT total_bus_locks = 0;
 UINT total_bus_unlocks = 0;
 
-// ow_crc.c
-UINT CRC8_tries = 0;
-UINT CRC8_errors = 0;
-UINT CRC16_tries = 0;
-UINT CRC16_errors = 0;
-
 // ow_net.c
 UINT NET_accept_errors = 0;
 UINT NET_connection_errors = 0;
@@ -120,24 +96,44 @@ UINT DS2480_read_read = 0;
 UINT DS2480_level_docheck_errors = 0;
 
 
-struct average all_avg = { 0L, 0L, 0L, 0L, };
-
 /* ------- Prototypes ----------- */
 /* Statistics reporting */
 READ_FUNCTION(FS_stat);
 READ_FUNCTION(FS_time);
 READ_FUNCTION(FS_return_code);
+READ_FUNCTION(FS_hit_ratio);
+READ_FUNCTION(FS_policy_hit_ratio);
+READ_FUNCTION(FS_cache_policy);
 
 /* -------- Structures ---------- */
 static struct filetype stats_cache[] = {
 	{"flips", PROPERTY_LENGTH_UNSIGNED, NON_AGGREGATE, ft_unsigned, fc_statistic, FS_stat, NO_WRITE_FUNCTION, VISIBLE, {.v=&cache_flips}, },
-	{"additions", PROPERTY_LENGTH_UNSIGNED, NON_AGGREGATE, ft_unsigned, fc_statistic, FS_stat, NO_WRITE_FUNCTION, VISIBLE, {.v=&cache_adds}, },
+	{"additions", PROPERTY_LENGTH_UNSIGNED, NON_AGGREGATE, ft_unsigned, fc_statistic, FS_stat, NO_WRITE_FUNCTION, VISIBLE, {.v=&stat_total.cache_adds}, },
+	{"evictions", PROPERTY_LENGTH_UNSIGNED, NON_AGGREGATE, ft_unsigned, fc_statistic, FS_stat, NO_WRITE_FUNCTION, VISIBLE, {.v=&cache_evictions}, },
+	{"policy", 6, NON_AGGREGATE, ft_ascii, fc_statistic, FS_cache_policy, NO_WRITE_FUNCTION, VISIBLE, NO_FILETYPE_DATA, },
+	{"hit_ratio", PROPERTY_LENGTH_FLOAT, NON_AGGREGATE, ft_float, fc_statistic, FS_hit_ratio, NO_WRITE_FUNCTION, VISIBLE, NO_FILETYPE_DATA, },
+
+	{"clock", PROPERTY_LENGTH_SUBDIR, NON_AGGREGATE, ft_subdir, fc_subdir, NO_READ_FUNCTION, NO_WRITE_FUNCTION, VISIBLE, NO_FILETYPE_DATA, },
+	{"clock/tries", PROPERTY_LENGTH_UNSIGNED, NON_AGGREGATE, ft_unsigned, fc_statistic, FS_stat, NO_WRITE_FUNCTION, VISIBLE, {.v=&stat_total.policy_tries[cache_policy_clock]}, },
+	{"clock/hits", PROPERTY_LENGTH_UNSIGNED, NON_AGGREGATE, ft_unsigned, fc_statistic, FS_stat, NO_WRITE_FUNCTION, VISIBLE, {.v=&stat_total.policy_hits[cache_policy_clock]}, },
+	{"clock/hit_ratio", PROPERTY_LENGTH_FLOAT, NON_AGGREGATE, ft_float, fc_statistic, FS_policy_hit_ratio, NO_WRITE_FUNCTION, VISIBLE, {.i=cache_policy_clock}, },
+
+	{"reject", PROPERTY_LENGTH_SUBDIR, NON_AGGREGATE, ft_subdir, fc_subdir, NO_READ_FUNCTION, NO_WRITE_FUNCTION, VISIBLE, NO_FILETYPE_DATA, },
+	{"reject/tries", PROPERTY_LENGTH_UNSIGNED, NON_AGGREGATE, ft_unsigned, fc_statistic, FS_stat, NO_WRITE_FUNCTION, VISIBLE, {.v=&stat_total.policy_tries[cache_policy_reject]}, },
+	{"reject/hits", PROPERTY_LENGTH_UNSIGNED, NON_AGGREGATE, ft_unsigned, fc_statistic, FS_stat, NO_WRITE_FUNCTION, VISIBLE, {.v=&stat_total.policy_hits[cache_policy_reject]}, },
+	{"reject/hit_ratio", PROPERTY_LENGTH_FLOAT, NON_AGGREGATE, ft_float, fc_statistic, FS_policy_hit_ratio, NO_WRITE_FUNCTION, VISIBLE, {.i=cache_policy_reject}, },
+
+	{"purge", PROPERTY_LENGTH_SUBDIR, NON_AGGREGATE, ft_subdir, fc_subdir, NO_READ_FUNCTION, NO_WRITE_FUNCTION, VISIBLE, NO_FILETYPE_DATA, },
+	{"purge/sweeps", PROPERTY_LENGTH_UNSIGNED, NON_AGGREGATE, ft_unsigned, fc_statistic, FS_stat, NO_WRITE_FUNCTION, VISIBLE, {.v=&cache_purges}, },
+	{"purge/entries", PROPERTY_LENGTH_UNSIGNED, NON_AGGREGATE, ft_unsigned, fc_statistic, FS_stat, NO_WRITE_FUNCTION, VISIBLE, {.v=&cache_purged}, },
+	{"purge/total_time", PROPERTY_LENGTH_FLOAT, NON_AGGREGATE, ft_float, fc_statistic, FS_time, NO_WRITE_FUNCTION, VISIBLE, {.v=&cache_purge_time}, },
+	{"purge/max_time", PROPERTY_LENGTH_FLOAT, NON_AGGREGATE, ft_float, fc_statistic, FS_time, NO_WRITE_FUNCTION, VISIBLE, {.v=&cache_purge_max}, },
 
 	{"primary", PROPERTY_LENGTH_SUBDIR, NON_AGGREGATE, ft_subdir, fc_subdir, NO_READ_FUNCTION, NO_WRITE_FUNCTION, VISIBLE, NO_FILETYPE_DATA, },
-	{"primary/now", PROPERTY_LENGTH_UNSIGNED, NON_AGGREGATE, ft_unsigned, fc_statistic, FS_stat, NO_WRITE_FUNCTION, VISIBLE, {.v=&new_avg.current}, },
-	{"primary/sum", PROPERTY_LENGTH_UNSIGNED, NON_AGGREGATE, ft_unsigned, fc_statistic, FS_stat, NO_WRITE_FUNCTION, VISIBLE, {.v=&new_avg.sum}, },
-	{"primary/num", PROPERTY_LENGTH_UNSIGNED, NON_AGGREGATE, ft_unsigned, fc_statistic, FS_stat, NO_WRITE_FUNCTION, VISIBLE, {.v=&new_avg.count}, },
-	{"primary/max", PROPERTY_LENGTH_UNSIGNED, NON_AGGREGATE, ft_unsigned, fc_statistic, FS_stat, NO_WRITE_FUNCTION, VISIBLE, {.v=&new_avg.max}, },
+	{"primary/now", PROPERTY_LENGTH_UNSIGNED, NON_AGGREGATE, ft_unsigned, fc_statistic, FS_stat, NO_WRITE_FUNCTION, VISIBLE, {.v=&stat_total.new_avg.current}, },
+	{"primary/sum", PROPERTY_LENGTH_UNSIGNED, NON_AGGREGATE, ft_unsigned, fc_statistic, FS_stat, NO_WRITE_FUNCTION, VISIBLE, {.v=&stat_total.new_avg.sum}, },
+	{"primary/num", PROPERTY_LENGTH_UNSIGNED, NON_AGGREGATE, ft_unsigned, fc_statistic, FS_stat, NO_WRITE_FUNCTION, VISIBLE, {.v=&stat_total.new_avg.count}, },
+	{"primary/max", PROPERTY_LENGTH_UNSIGNED, NON_AGGREGATE, ft_unsigned, fc_statistic, FS_stat, NO_WRITE_FUNCTION, VISIBLE, {.v=&stat_total.new_avg.max}, },
 
 	{"secondary", PROPERTY_LENGTH_SUBDIR, NON_AGGREGATE, ft_subdir, fc_subdir, NO_READ_FUNCTION, NO_WRITE_FUNCTION, VISIBLE, NO_FILETYPE_DATA, },
 	{"secondary/now", PROPERTY_LENGTH_UNSIGNED, NON_AGGREGATE, ft_unsigned, fc_statistic, FS_stat, NO_WRITE_FUNCTION, VISIBLE, {.v=&old_avg.current}, },
@@ -146,38 +142,43 @@ static struct filetype stats_cache[] = {
 	{"secondary/max", PROPERTY_LENGTH_UNSIGNED, NON_AGGREGATE, ft_unsigned, fc_statistic, FS_stat, NO_WRITE_FUNCTION, VISIBLE, {.v=&old_avg.max}, },
 
 	{"persistent", PROPERTY_LENGTH_SUBDIR, NON_AGGREGATE, ft_subdir, fc_subdir, NO_READ_FUNCTION, NO_WRITE_FUNCTION, VISIBLE, NO_FILETYPE_DATA, },
-	{"persistent/now", PROPERTY_LENGTH_UNSIGNED, NON_AGGREGATE, ft_unsigned, fc_statistic, FS_stat, NO_WRITE_FUNCTION, VISIBLE, {.v=&store_avg.current,}, },
-	{"persistent/sum", PROPERTY_LENGTH_UNSIGNED, NON_AGGREGATE, ft_unsigned, fc_statistic, FS_stat, NO_WRITE_FUNCTION, VISIBLE, {.v=&store_avg.sum}, },
-	{"persistent/num", PROPERTY_LENGTH_UNSIGNED, NON_AGGREGATE, ft_unsigned, fc_statistic, FS_stat, NO_WRITE_FUNCTION, VISIBLE, {.v=&store_avg.count}, },
-	{"persistent/max", PROPERTY_LENGTH_UNSIGNED, NON_AGGREGATE, ft_unsigned, fc_statistic, FS_stat, NO_WRITE_FUNCTION, VISIBLE, {.v=&store_avg.max}, },
+	{"persistent/now", PROPERTY_LENGTH_UNSIGNED, NON_AGGREGATE, ft_unsigned, fc_statistic, FS_stat, NO_WRITE_FUNCTION, VISIBLE, {.v=&stat_total.store_avg.current,}, },
+	{"persistent/sum", PROPERTY_LENGTH_UNSIGNED, NON_AGGREGATE, ft_unsigned, fc_statistic, FS_stat, NO_WRITE_FUNCTION, VISIBLE, {.v=&stat_total.store_avg.sum}, },
+	{"persistent/num", PROPERTY_LENGTH_UNSIGNED, NON_AGGREGATE, ft_unsigned, fc_statistic, FS_stat, NO_WRITE_FUNCTION, VISIBLE, {.v=&stat_total.store_avg.count}, },
+	{"persistent/max", PROPERTY_LENGTH_UNSIGNED, NON_AGGREGATE, ft_unsigned, fc_statistic, FS_stat, NO_WRITE_FUNCTION, VISIBLE, {.v=&stat_total.store_avg.max}, },
 
 	{"external", PROPERTY_LENGTH_SUBDIR, NON_AGGREGATE, ft_subdir, fc_subdir, NO_READ_FUNCTION, NO_WRITE_FUNCTION, VISIBLE, NO_FILETYPE_DATA, },
-	{"external/tries", PROPERTY_LENGTH_UNSIGNED, NON_AGGREGATE, ft_unsigned, fc_statistic, FS_stat, NO_WRITE_FUNCTION, VISIBLE, {.v=&cache_ext.tries}, },
-	{"external/hits", PROPERTY_LENGTH_UNSIGNED, NON_AGGREGATE, ft_unsigned, fc_statistic, FS_stat, NO_WRITE_FUNCTION, VISIBLE, {.v=&cache_ext.hits}, },
-	{"external/added", PROPERTY_LENGTH_UNSIGNED, NON_AGGREGATE, ft_unsigned, fc_statistic, FS_stat, NO_WRITE_FUNCTION, VISIBLE, {.v=&cache_ext.adds,}, },
-	{"external/expired", PROPERTY_LENGTH_UNSIGNED, NON_AGGREGATE, ft_unsigned, fc_statistic, FS_stat, NO_WRITE_FUNCTION, VISIBLE, {.v=&cache_ext.expires,}, },
-	{"external/deleted", PROPERTY_LENGTH_UNSIGNED, NON_AGGREGATE, ft_unsigned, fc_statistic, FS_stat, NO_WRITE_FUNCTION, VISIBLE, {.v=&cache_ext.deletes,}, },
+	{"external/tries", PROPERTY_LENGTH_UNSIGNED, NON_AGGREGATE, ft_unsigned, fc_statistic, FS_stat, NO_WRITE_FUNCTION, VISIBLE, {.v=&stat_total.cache_ext.tries}, },
+	{"external/hits", PROPERTY_LENGTH_UNSIGNED, NON_AGGREGATE, ft_unsigned, fc_statistic, FS_stat, NO_WRITE_FUNCTION, VISIBLE, {.v=&stat_total.cache_ext.hits}, },
+	{"external/added", PROPERTY_LENGTH_UNSIGNED, NON_AGGREGATE, ft_unsigned, fc_statistic, FS_stat, NO_WRITE_FUNCTION, VISIBLE, {.v=&stat_total.cache_ext.adds,}, },
+	{"external/expired", PROPERTY_LENGTH_UNSIGNED, NON_AGGREGATE, ft_unsigned, fc_statistic, FS_stat, NO_WRITE_FUNCTION, VISIBLE, {.v=&stat_total.cache_ext.expires,}, },
+	{"external/deleted", PROPERTY_LENGTH_UNSIGNED, NON_AGGREGATE, ft_unsigned, fc_statistic, FS_stat, NO_WRITE_FUNCTION, VISIBLE, {.v=&stat_total.cache_ext.deletes,}, },
 
 	{"internal", PROPERTY_LENGTH_SUBDIR, NON_AGGREGATE, ft_subdir, fc_subdir, NO_READ_FUNCTION, NO_WRITE_FUNCTION, VISIBLE, NO_FILETYPE_DATA, },
-	{"internal/tries", PROPERTY_LENGTH_UNSIGNED, NON_AGGREGATE, ft_unsigned, fc_statistic, FS_stat, NO_WRITE_FUNCTION, VISIBLE, {.v=&cache_int.tries}, },
-	{"internal/hits", PROPERTY_LENGTH_UNSIGNED, NON_AGGREGATE, ft_unsigned, fc_statistic, FS_stat, NO_WRITE_FUNCTION, VISIBLE, {.v=&cache_int.hits}, },
-	{"internal/added", PROPERTY_LENGTH_UNSIGNED, NON_AGGREGATE, ft_unsigned, fc_statistic, FS_stat, NO_WRITE_FUNCTION, VISIBLE, {.v=&cache_int.adds,}, },
-	{"internal/expired", PROPERTY_LENGTH_UNSIGNED, NON_AGGREGATE, ft_unsigned, fc_statistic, FS_stat, NO_WRITE_FUNCTION, VISIBLE, {.v=&cache_int.expires,}, },
-	{"internal/deleted", PROPERTY_LENGTH_UNSIGNED, NON_AGGREGATE, ft_unsigned, fc_statistic, FS_stat, NO_WRITE_FUNCTION, VISIBLE, {.v=&cache_int.deletes,}, },
+	{"internal/tries", PROPERTY_LENGTH_UNSIGNED, NON_AGGREGATE, ft_unsigned, fc_statistic, FS_stat, NO_WRITE_FUNCTION, VISIBLE, {.v=&stat_total.cache_int.tries}, },
+	{"internal/hits", PROPERTY_LENGTH_UNSIGNED, NON_AGGREGATE, ft_unsigned, fc_statistic, FS_stat, NO_WRITE_FUNCTION, VISIBLE, {.v=&stat_total.cache_int.hits}, },
+	{"internal/added", PROPERTY_LENGTH_UNSIGNED, NON_AGGREGATE, ft_unsigned, fc_statistic, FS_stat, NO_WRITE_FUNCTION, VISIBLE, {.v=&stat_total.cache_int.adds,}, },
+	{"internal/expired", PROPERTY_LENGTH_UNSIGNED, NON_AGGREGATE, ft_unsigned, fc_statistic, FS_stat, NO_WRITE_FUNCTION, VISIBLE, {.v=&stat_total.cache_int.expires,}, },
+	{"internal/deleted", PROPERTY_LENGTH_UNSIGNED, NON_AGGREGATE, ft_unsigned, fc_statistic, FS_stat, NO_WRITE_FUNCTION, VISIBLE, {.v=&stat_total.cache_int.deletes,}, },
 
 	{"directory", PROPERTY_LENGTH_SUBDIR, NON_AGGREGATE, ft_subdir, fc_subdir, NO_READ_FUNCTION, NO_WRITE_FUNCTION, VISIBLE, NO_FILETYPE_DATA, },
-	{"directory/tries", PROPERTY_LENGTH_UNSIGNED, NON_AGGREGATE, ft_unsigned, fc_statistic, FS_stat, NO_WRITE_FUNCTION, VISIBLE, {.v=&cache_dir.tries}, },
-	{"directory/hits", PROPERTY_LENGTH_UNSIGNED, NON_AGGREGATE, ft_unsigned, fc_statistic, FS_stat, NO_WRITE_FUNCTION, VISIBLE, {.v=&cache_dir.hits}, },
-	{"directory/added", PROPERTY_LENGTH_UNSIGNED, NON_AGGREGATE, ft_unsigned, fc_statistic, FS_stat, NO_WRITE_FUNCTION, VISIBLE, {.v=&cache_dir.adds}, },
-	{"directory/expired", PROPERTY_LENGTH_UNSIGNED, NON_AGGREGATE, ft_unsigned, fc_statistic, FS_stat, NO_WRITE_FUNCTION, VISIBLE, {.v=&cache_dir.expires,}, },
-	{"directory/deleted", PROPERTY_LENGTH_UNSIGNED, NON_AGGREGATE, ft_unsigned, fc_statistic, FS_stat, NO_WRITE_FUNCTION, VISIBLE, {.v=&cache_dir.deletes,}, },
+	{"directory/tries", PROPERTY_LENGTH_UNSIGNED, NON_AGGREGATE, ft_unsigned, fc_statistic, FS_stat, NO_WRITE_FUNCTION, VISIBLE, {.v=&stat_total.cache_dir.tries}, },
+	{"directory/hits", PROPERTY_LENGTH_UNSIGNED, NON_AGGREGATE, ft_unsigned, fc_statistic, FS_stat, NO_WRITE_FUNCTION, VISIBLE, {.v=&stat_total.cache_dir.hits}, },
+	{"directory/added", PROPERTY_LENGTH_UNSIGNED, NON_AGGREGATE, ft_unsigned, fc_statistic, FS_stat, NO_WRITE_FUNCTION, VISIBLE, {.v=&stat_total.cache_dir.adds}, },
+	{"directory/expired", PROPERTY_LENGTH_UNSIGNED, NON_AGGREGATE, ft_unsigned, fc_statistic, FS_stat, NO_WRITE_FUNCTION, VISIBLE, {.v=&stat_total.cache_dir.expires,}, },
+	{"directory/deleted", PROPERTY_LENGTH_UNSIGNED, NON_AGGREGATE, ft_unsigned, fc_statistic, FS_stat, NO_WRITE_FUNCTION, VISIBLE, {.v=&stat_total.cache_dir.deletes,}, },
 
 	{"device", PROPERTY_LENGTH_SUBDIR, NON_AGGREGATE, ft_subdir, fc_subdir, NO_READ_FUNCTION, NO_WRITE_FUNCTION, VISIBLE, NO_FILETYPE_DATA, },
-	{"device/tries", PROPERTY_LENGTH_UNSIGNED, NON_AGGREGATE, ft_unsigned, fc_statistic, FS_stat, NO_WRITE_FUNCTION, VISIBLE, {.v=&cache_dev.tries}, },
-	{"device/hits", PROPERTY_LENGTH_UNSIGNED, NON_AGGREGATE, ft_unsigned, fc_statistic, FS_stat, NO_WRITE_FUNCTION, VISIBLE, {.v=&cache_dev.hits}, },
-	{"device/added", PROPERTY_LENGTH_UNSIGNED, NON_AGGREGATE, ft_unsigned, fc_statistic, FS_stat, NO_WRITE_FUNCTION, VISIBLE, {.v=&cache_dev.adds}, },
-	{"device/expired", PROPERTY_LENGTH_UNSIGNED, NON_AGGREGATE, ft_unsigned, fc_statistic, FS_stat, NO_WRITE_FUNCTION, VISIBLE, {.v=&cache_dev.expires,}, },
-	{"device/deleted", PROPERTY_LENGTH_UNSIGNED, NON_AGGREGATE, ft_unsigned, fc_statistic, FS_stat, NO_WRITE_FUNCTION, VISIBLE, {.v=&cache_dev.deletes,}, },
+	{"device/tries", PROPERTY_LENGTH_UNSIGNED, NON_AGGREGATE, ft_unsigned, fc_statistic, FS_stat, NO_WRITE_FUNCTION, VISIBLE, {.v=&stat_total.cache_dev.tries}, },
+	{"device/hits", PROPERTY_LENGTH_UNSIGNED, NON_AGGREGATE, ft_unsigned, fc_statistic, FS_stat, NO_WRITE_FUNCTION, VISIBLE, {.v=&stat_total.cache_dev.hits}, },
+	{"device/added", PROPERTY_LENGTH_UNSIGNED, NON_AGGREGATE, ft_unsigned, fc_statistic, FS_stat, NO_WRITE_FUNCTION, VISIBLE, {.v=&stat_total.cache_dev.adds}, },
+	{"device/expired", PROPERTY_LENGTH_UNSIGNED, NON_AGGREGATE, ft_unsigned, fc_statistic, FS_stat, NO_WRITE_FUNCTION, VISIBLE, {.v=&stat_total.cache_dev.expires,}, },
+	{"device/deleted", PROPERTY_LENGTH_UNSIGNED, NON_AGGREGATE, ft_unsigned, fc_statistic, FS_stat, NO_WRITE_FUNCTION, VISIBLE, {.v=&stat_total.cache_dev.deletes,}, },
+
+	{"path", PROPERTY_LENGTH_SUBDIR, NON_AGGREGATE, ft_subdir, fc_subdir, NO_READ_FUNCTION, NO_WRITE_FUNCTION, VISIBLE, NO_FILETYPE_DATA, },
+	{"path/tries", PROPERTY_LENGTH_UNSIGNED, NON_AGGREGATE, ft_unsigned, fc_statistic, FS_stat, NO_WRITE_FUNCTION, VISIBLE, {.v=&stat_total.cache_path.tries}, },
+	{"path/hits", PROPERTY_LENGTH_UNSIGNED, NON_AGGREGATE, ft_unsigned, fc_statistic, FS_stat, NO_WRITE_FUNCTION, VISIBLE, {.v=&stat_total.cache_path.hits}, },
+	{"path/added", PROPERTY_LENGTH_UNSIGNED, NON_AGGREGATE, ft_unsigned, fc_statistic, FS_stat, NO_WRITE_FUNCTION, VISIBLE, {.v=&stat_total.cache_path.adds}, },
 };
 
 struct device d_stats_cache = { "cache", "cache", 0, COUNT_OF_FILETYPES(stats_cache), stats_cache, NO_GENERIC_READ, NO_GENERIC_WRITE };
@@ -186,35 +187,48 @@ struct device d_stats_cache = { "cache", "cache", 0, COUNT_OF_FILETYPES(stats_ca
 
 static struct aggregate Aread = { 3, ag_numbers, ag_separate, };
 static struct filetype stats_read[] = {
-	{"calls", PROPERTY_LENGTH_UNSIGNED, NON_AGGREGATE, ft_unsigned, fc_statistic, FS_stat, NO_WRITE_FUNCTION, VISIBLE, {.v=&read_calls}, },
-	{"cachesuccess", PROPERTY_LENGTH_UNSIGNED, NON_AGGREGATE, ft_unsigned, fc_statistic, FS_stat, NO_WRITE_FUNCTION, VISIBLE, {.v=&read_cache}, },
-	{"cachebytes", PROPERTY_LENGTH_UNSIGNED, NON_AGGREGATE, ft_unsigned, fc_statistic, FS_stat, NO_WRITE_FUNCTION, VISIBLE, {.v=&read_cachebytes}, },
-	{"success", PROPERTY_LENGTH_UNSIGNED, NON_AGGREGATE, ft_unsigned, fc_statistic, FS_stat, NO_WRITE_FUNCTION, VISIBLE, {.v=&read_success}, },
-	{"bytes", PROPERTY_LENGTH_UNSIGNED, NON_AGGREGATE, ft_unsigned, fc_statistic, FS_stat, NO_WRITE_FUNCTION, VISIBLE, {.v=&read_bytes}, },
-	{"tries", PROPERTY_LENGTH_UNSIGNED, &Aread, ft_unsigned, fc_statistic, FS_stat, NO_WRITE_FUNCTION, VISIBLE, {.v=&read_tries}, },
+	{"calls", PROPERTY_LENGTH_UNSIGNED, NON_AGGREGATE, ft_unsigned, fc_statistic, FS_stat, NO_WRITE_FUNCTION, VISIBLE, {.v=&stat_total.read_calls}, },
+	{"cachesuccess", PROPERTY_LENGTH_UNSIGNED, NON_AGGREGATE, ft_unsigned, fc_statistic, FS_stat, NO_WRITE_FUNCTION, VISIBLE, {.v=&stat_total.read_cache}, },
+	{"cachebytes", PROPERTY_LENGTH_UNSIGNED, NON_AGGREGATE, ft_unsigned, fc_statistic, FS_stat, NO_WRITE_FUNCTION, VISIBLE, {.v=&stat_total.read_cachebytes}, },
+	{"success", PROPERTY_LENGTH_UNSIGNED, NON_AGGREGATE, ft_unsigned, fc_statistic, FS_stat, NO_WRITE_FUNCTION, VISIBLE, {.v=&stat_total.read_success}, },
+	{"coalesced", PROPERTY_LENGTH_UNSIGNED, NON_AGGREGATE, ft_unsigned, fc_statistic, FS_stat, NO_WRITE_FUNCTION, VISIBLE, {.v=&stat_total.read_coalesced}, },
+	{"bytes", PROPERTY_LENGTH_UNSIGNED, NON_AGGREGATE, ft_unsigned, fc_statistic, FS_stat, NO_WRITE_FUNCTION, VISIBLE, {.v=&stat_total.read_bytes}, },
+	{"tries", PROPERTY_LENGTH_UNSIGNED, &Aread, ft_unsigned, fc_statistic, FS_stat, NO_WRITE_FUNCTION, VISIBLE, {.v=&stat_total.read_tries}, },
+
+	{"conversion", PROPERTY_LENGTH_SUBDIR, NON_AGGREGATE, ft_subdir, fc_subdir, NO_READ_FUNCTION, NO_WRITE_FUNCTION, VISIBLE, NO_FILETYPE_DATA, },
+	{"conversion/polled", PROPERTY_LENGTH_UNSIGNED, NON_AGGREGATE, ft_unsigned, fc_statistic, FS_stat, NO_WRITE_FUNCTION, VISIBLE, {.v=&stat_total.convert_polled}, },
+	{"conversion/learned", PROPERTY_LENGTH_UNSIGNED, NON_AGGREGATE, ft_unsigned, fc_statistic, FS_stat, NO_WRITE_FUNCTION, VISIBLE, {.v=&stat_total.convert_learned}, },
+	{"conversion/msec", PROPERTY_LENGTH_UNSIGNED, NON_AGGREGATE, ft_unsigned, fc_statistic, FS_stat, NO_WRITE_FUNCTION, VISIBLE, {.v=&stat_total.convert_msec}, },
+	{"conversion/max_msec", PROPERTY_LENGTH_UNSIGNED, NON_AGGREGATE, ft_unsigned, fc_statistic, FS_stat, NO_WRITE_FUNCTION, VISIBLE, {.v=&stat_total.convert_max}, },
 };
 
 struct device d_stats_read = { "read", "read", 0, COUNT_OF_FILETYPES(stats_read), stats_read, NO_GENERIC_READ, NO_GENERIC_WRITE };
 
 static struct filetype stats_write[] = {
-	{"calls", PROPERTY_LENGTH_UNSIGNED, NON_AGGREGATE, ft_unsigned, fc_statistic, FS_stat, NO_WRITE_FUNCTION, VISIBLE, {.v=&write_calls}, },
-	{"success", PROPERTY_LENGTH_UNSIGNED, NON_AGGREGATE, ft_unsigned, fc_statistic, FS_stat, NO_WRITE_FUNCTION, VISIBLE, {.v=&write_success}, },
-	{"bytes", PROPERTY_LENGTH_UNSIGNED, NON_AGGREGATE, ft_unsigned, fc_statistic, FS_stat, NO_WRITE_FUNCTION, VISIBLE, {.v=&write_bytes}, },
-	{"tries", PROPERTY_LENGTH_UNSIGNED, &Aread, ft_unsigned, fc_statistic, FS_stat, NO_WRITE_FUNCTION, VISIBLE, {.v=&write_tries}, },
+	{"calls", PROPERTY_LENGTH_UNSIGNED, NON_AGGREGATE, ft_unsigned, fc_statistic, FS_stat, NO_WRITE_FUNCTION, VISIBLE, {.v=&stat_total.write_calls}, },
+	{"success", PROPERTY_LENGTH_UNSIGNED, NON_AGGREGATE, ft_unsigned, fc_statistic, FS_stat, NO_WRITE_FUNCTION, VISIBLE, {.v=&stat_total.write_success}, },
+	{"bytes", PROPERTY_LENGTH_UNSIGNED, NON_AGGREGATE, ft_unsigned, fc_statistic, FS_stat, NO_WRITE_FUNCTION, VISIBLE, {.v=&stat_total.write_bytes}, },
+	{"tries", PROPERTY_LENGTH_UNSIGNED, &Aread, ft_unsigned, fc_statistic, FS_stat, NO_WRITE_FUNCTION, VISIBLE, {.v=&stat_total.write_tries}, },
 };
 
 struct device d_stats_write = { "write", "write", 0, COUNT_OF_FILETYPES(stats_write), stats_write, NO_GENERIC_READ, NO_GENERIC_WRITE };
 
+static struct aggregate Alatency = { DIR_LATENCY_BUCKETS, ag_numbers, ag_separate, };
 static struct filetype stats_directory[] = {
 	{"maxdepth", PROPERTY_LENGTH_UNSIGNED, NON_AGGREGATE, ft_unsigned, fc_statistic, FS_stat, NO_WRITE_FUNCTION, VISIBLE, {.v=&dir_depth}, },
 
 	{"bus", PROPERTY_LENGTH_SUBDIR, NON_AGGREGATE, ft_subdir, fc_subdir, NO_READ_FUNCTION, NO_WRITE_FUNCTION, VISIBLE, NO_FILETYPE_DATA, },
-	{"bus/calls", PROPERTY_LENGTH_UNSIGNED, NON_AGGREGATE, ft_unsigned, fc_statistic, FS_stat, NO_WRITE_FUNCTION, VISIBLE, {.v=&dir_main.calls}, },
-	{"bus/entries", PROPERTY_LENGTH_UNSIGNED, NON_AGGREGATE, ft_unsigned, fc_statistic, FS_stat, NO_WRITE_FUNCTION, VISIBLE, {.v=&dir_main.entries}, },
+	{"bus/calls", PROPERTY_LENGTH_UNSIGNED, NON_AGGREGATE, ft_unsigned, fc_statistic, FS_stat, NO_WRITE_FUNCTION, VISIBLE, {.v=&stat_total.dir_main.calls}, },
+	{"bus/entries", PROPERTY_LENGTH_UNSIGNED, NON_AGGREGATE, ft_unsigned, fc_statistic, FS_stat, NO_WRITE_FUNCTION, VISIBLE, {.v=&stat_total.dir_main.entries}, },
+	{"bus/now", PROPERTY_LENGTH_UNSIGNED, NON_AGGREGATE, ft_unsigned, fc_statistic, FS_stat, NO_WRITE_FUNCTION, VISIBLE, {.v=&stat_total.dir_bus_avg.current}, },
+	{"bus/sum", PROPERTY_LENGTH_UNSIGNED, NON_AGGREGATE, ft_unsigned, fc_statistic, FS_stat, NO_WRITE_FUNCTION, VISIBLE, {.v=&stat_total.dir_bus_avg.sum}, },
+	{"bus/num", PROPERTY_LENGTH_UNSIGNED, NON_AGGREGATE, ft_unsigned, fc_statistic, FS_stat, NO_WRITE_FUNCTION, VISIBLE, {.v=&stat_total.dir_bus_avg.count}, },
+	{"bus/max", PROPERTY_LENGTH_UNSIGNED, NON_AGGREGATE, ft_unsigned, fc_statistic, FS_stat, NO_WRITE_FUNCTION, VISIBLE, {.v=&stat_total.dir_bus_avg.max}, },
+	{"bus/latency", PROPERTY_LENGTH_UNSIGNED, &Alatency, ft_unsigned, fc_statistic, FS_stat, NO_WRITE_FUNCTION, VISIBLE, {.v=&stat_total.dir_bus_latency}, },
 
 	{"device", PROPERTY_LENGTH_SUBDIR, NON_AGGREGATE, ft_subdir, fc_subdir, NO_READ_FUNCTION, NO_WRITE_FUNCTION, VISIBLE, NO_FILETYPE_DATA, },
-	{"device/calls", PROPERTY_LENGTH_UNSIGNED, NON_AGGREGATE, ft_unsigned, fc_statistic, FS_stat, NO_WRITE_FUNCTION, VISIBLE, {.v=&dir_dev.calls}, },
-	{"device/entries", PROPERTY_LENGTH_UNSIGNED, NON_AGGREGATE, ft_unsigned, fc_statistic, FS_stat, NO_WRITE_FUNCTION, VISIBLE, {.v=&dir_dev.entries}, },
+	{"device/calls", PROPERTY_LENGTH_UNSIGNED, NON_AGGREGATE, ft_unsigned, fc_statistic, FS_stat, NO_WRITE_FUNCTION, VISIBLE, {.v=&stat_total.dir_dev.calls}, },
+	{"device/entries", PROPERTY_LENGTH_UNSIGNED, NON_AGGREGATE, ft_unsigned, fc_statistic, FS_stat, NO_WRITE_FUNCTION, VISIBLE, {.v=&stat_total.dir_dev.entries}, },
 }
 
 ;
@@ -224,28 +238,28 @@ struct device d_stats_directory = { "directory", "directory", 0, COUNT_OF_FILETY
 
 static struct filetype stats_thread[] = {
 	{"directory", PROPERTY_LENGTH_SUBDIR, NON_AGGREGATE, ft_subdir, fc_subdir, NO_READ_FUNCTION, NO_WRITE_FUNCTION, VISIBLE, NO_FILETYPE_DATA, },
-	{"directory/now", PROPERTY_LENGTH_UNSIGNED, NON_AGGREGATE, ft_unsigned, fc_statistic, FS_stat, NO_WRITE_FUNCTION, VISIBLE, {.v=&dir_avg.current}, },
-	{"directory/sum", PROPERTY_LENGTH_UNSIGNED, NON_AGGREGATE, ft_unsigned, fc_statistic, FS_stat, NO_WRITE_FUNCTION, VISIBLE, {.v=&dir_avg.sum}, },
-	{"directory/num", PROPERTY_LENGTH_UNSIGNED, NON_AGGREGATE, ft_unsigned, fc_statistic, FS_stat, NO_WRITE_FUNCTION, VISIBLE, {.v=&dir_avg.count}, },
-	{"directory/max", PROPERTY_LENGTH_UNSIGNED, NON_AGGREGATE, ft_unsigned, fc_statistic, FS_stat, NO_WRITE_FUNCTION, VISIBLE, {.v=&dir_avg.max}, },
+	{"directory/now", PROPERTY_LENGTH_UNSIGNED, NON_AGGREGATE, ft_unsigned, fc_statistic, FS_stat, NO_WRITE_FUNCTION, VISIBLE, {.v=&stat_total.dir_avg.current}, },
+	{"directory/sum", PROPERTY_LENGTH_UNSIGNED, NON_AGGREGATE, ft_unsigned, fc_statistic, FS_stat, NO_WRITE_FUNCTION, VISIBLE, {.v=&stat_total.dir_avg.sum}, },
+	{"directory/num", PROPERTY_LENGTH_UNSIGNED, NON_AGGREGATE, ft_unsigned, fc_statistic, FS_stat, NO_WRITE_FUNCTION, VISIBLE, {.v=&stat_total.dir_avg.count}, },
+	{"directory/max", PROPERTY_LENGTH_UNSIGNED, NON_AGGREGATE, ft_unsigned, fc_statistic, FS_stat, NO_WRITE_FUNCTION, VISIBLE, {.v=&stat_total.dir_avg.max}, },
 
 	{"overall", PROPERTY_LENGTH_SUBDIR, NON_AGGREGATE, ft_subdir, fc_subdir, NO_READ_FUNCTION, NO_WRITE_FUNCTION, VISIBLE, NO_FILETYPE_DATA, },
-	{"overall/now", PROPERTY_LENGTH_UNSIGNED, NON_AGGREGATE, ft_unsigned, fc_statistic, FS_stat, NO_WRITE_FUNCTION, VISIBLE, {.v=&all_avg.current}, },
-	{"overall/sum", PROPERTY_LENGTH_UNSIGNED, NON_AGGREGATE, ft_unsigned, fc_statistic, FS_stat, NO_WRITE_FUNCTION, VISIBLE, {.v=&all_avg.sum}, },
-	{"overall/num", PROPERTY_LENGTH_UNSIGNED, NON_AGGREGATE, ft_unsigned, fc_statistic, FS_stat, NO_WRITE_FUNCTION, VISIBLE, {.v=&all_avg.count}, },
-	{"overall/max", PROPERTY_LENGTH_UNSIGNED, NON_AGGREGATE, ft_unsigned, fc_statistic, FS_stat, NO_WRITE_FUNCTION, VISIBLE, {.v=&all_avg.max}, },
+	{"overall/now", PROPERTY_LENGTH_UNSIGNED, NON_AGGREGATE, ft_unsigned, fc_statistic, FS_stat, NO_WRITE_FUNCTION, VISIBLE, {.v=&stat_total.all_avg.current}, },
+	{"overall/sum", PROPERTY_LENGTH_UNSIGNED, NON_AGGREGATE, ft_unsigned, fc_statistic, FS_stat, NO_WRITE_FUNCTION, VISIBLE, {.v=&stat_total.all_avg.sum}, },
+	{"overall/num", PROPERTY_LENGTH_UNSIGNED, NON_AGGREGATE, ft_unsigned, fc_statistic, FS_stat, NO_WRITE_FUNCTION, VISIBLE, {.v=&stat_total.all_avg.count}, },
+	{"overall/max", PROPERTY_LENGTH_UNSIGNED, NON_AGGREGATE, ft_unsigned, fc_statistic, FS_stat, NO_WRITE_FUNCTION, VISIBLE, {.v=&stat_total.all_avg.max}, },
 
 	{"read", PROPERTY_LENGTH_SUBDIR, NON_AGGREGATE, ft_subdir, fc_subdir, NO_READ_FUNCTION, NO_WRITE_FUNCTION, VISIBLE, NO_FILETYPE_DATA, },
-	{"read/now", PROPERTY_LENGTH_UNSIGNED, NON_AGGREGATE, ft_unsigned, fc_statistic, FS_stat, NO_WRITE_FUNCTION, VISIBLE, {.v=&read_avg.current}, },
-	{"read/sum", PROPERTY_LENGTH_UNSIGNED, NON_AGGREGATE, ft_unsigned, fc_statistic, FS_stat, NO_WRITE_FUNCTION, VISIBLE, {.v=&read_avg.sum}, },
-	{"read/num", PROPERTY_LENGTH_UNSIGNED, NON_AGGREGATE, ft_unsigned, fc_statistic, FS_stat, NO_WRITE_FUNCTION, VISIBLE, {.v=&read_avg.count}, },
-	{"read/max", PROPERTY_LENGTH_UNSIGNED, NON_AGGREGATE, ft_unsigned, fc_statistic, FS_stat, NO_WRITE_FUNCTION, VISIBLE, {.v=&read_avg.max}, },
+	{"read/now", PROPERTY_LENGTH_UNSIGNED, NON_AGGREGATE, ft_unsigned, fc_statistic, FS_stat, NO_WRITE_FUNCTION, VISIBLE, {.v=&stat_total.read_avg.current}, },
+	{"read/sum", PROPERTY_LENGTH_UNSIGNED, NON_AGGREGATE, ft_unsigned, fc_statistic, FS_stat, NO_WRITE_FUNCTION, VISIBLE, {.v=&stat_total.read_avg.sum}, },
+	{"read/num", PROPERTY_LENGTH_UNSIGNED, NON_AGGREGATE, ft_unsigned, fc_statistic, FS_stat, NO_WRITE_FUNCTION, VISIBLE, {.v=&stat_total.read_avg.count}, },
+	{"read/max", PROPERTY_LENGTH_UNSIGNED, NON_AGGREGATE, ft_unsigned, fc_statistic, FS_stat, NO_WRITE_FUNCTION, VISIBLE, {.v=&stat_total.read_avg.max}, },
 
 	{"write", PROPERTY_LENGTH_SUBDIR, NON_AGGREGATE, ft_subdir, fc_subdir, NO_READ_FUNCTION, NO_WRITE_FUNCTION, VISIBLE, NO_FILETYPE_DATA, },
-	{"write/now", PROPERTY_LENGTH_UNSIGNED, NON_AGGREGATE, ft_unsigned, fc_statistic, FS_stat, NO_WRITE_FUNCTION, VISIBLE, {.v=&write_avg.current,}, },
-	{"write/sum", PROPERTY_LENGTH_UNSIGNED, NON_AGGREGATE, ft_unsigned, fc_statistic, FS_stat, NO_WRITE_FUNCTION, VISIBLE, {.v=&write_avg.sum}, },
-	{"write/num", PROPERTY_LENGTH_UNSIGNED, NON_AGGREGATE, ft_unsigned, fc_statistic, FS_stat, NO_WRITE_FUNCTION, VISIBLE, {.v=&write_avg.count}, },
-	{"write/max", PROPERTY_LENGTH_UNSIGNED, NON_AGGREGATE, ft_unsigned, fc_statistic, FS_stat, NO_WRITE_FUNCTION, VISIBLE, {.v=&write_avg.max}, },
+	{"write/now", PROPERTY_LENGTH_UNSIGNED, NON_AGGREGATE, ft_unsigned, fc_statistic, FS_stat, NO_WRITE_FUNCTION, VISIBLE, {.v=&stat_total.write_avg.current,}, },
+	{"write/sum", PROPERTY_LENGTH_UNSIGNED, NON_AGGREGATE, ft_unsigned, fc_statistic, FS_stat, NO_WRITE_FUNCTION, VISIBLE, {.v=&stat_total.write_avg.sum}, },
+	{"write/num", PROPERTY_LENGTH_UNSIGNED, NON_AGGREGATE, ft_unsigned, fc_statistic, FS_stat, NO_WRITE_FUNCTION, VISIBLE, {.v=&stat_total.write_avg.count}, },
+	{"write/max", PROPERTY_LENGTH_UNSIGNED, NON_AGGREGATE, ft_unsigned, fc_statistic, FS_stat, NO_WRITE_FUNCTION, VISIBLE, {.v=&stat_total.write_avg.max}, },
 };
 
 struct device d_stats_thread = { "threads", "threads", 0, COUNT_OF_FILETYPES(stats_thread),
@@ -262,6 +276,7 @@ struct device d_stats_return_code = { "return_codes", "return_codes", 0, COUNT_O
 };
 
 #define FS_stat_ROW(var) {"" #var "",PROPERTY_LENGTH_UNSIGNED, NON_AGGREGATE  , ft_unsigned, fc_statistic,   FS_stat, NO_WRITE_FUNCTION, VISIBLE, {.v= & var,}, }
+#define FS_stat_total_ROW(var) {"" #var "",PROPERTY_LENGTH_UNSIGNED, NON_AGGREGATE  , ft_unsigned, fc_statistic,   FS_stat, NO_WRITE_FUNCTION, VISIBLE, {.v= & stat_total.var,}, }
 
 static struct filetype stats_errors[] = {
 	{"max_delay", PROPERTY_LENGTH_FLOAT, NON_AGGREGATE, ft_float, fc_statistic, FS_time, NO_WRITE_FUNCTION, VISIBLE, {.v=&max_delay}, },
@@ -289,10 +304,10 @@ static struct filetype stats_errors[] = {
 	FS_stat_ROW(DS2480_read_read),
 	FS_stat_ROW(DS2480_level_docheck_errors),
 
-	FS_stat_ROW(CRC8_errors),
-	FS_stat_ROW(CRC8_tries),
-	FS_stat_ROW(CRC16_errors),
-	FS_stat_ROW(CRC16_tries),
+	FS_stat_total_ROW(CRC8_errors),
+	FS_stat_total_ROW(CRC8_tries),
+	FS_stat_total_ROW(CRC16_errors),
+	FS_stat_total_ROW(CRC16_tries),
 
 }
 
@@ -324,9 +339,7 @@ static ZERO_OR_ERROR FS_stat(struct one_wire_query *owq)
 	if (pn->selected_filetype->data.v == NULL) {
 		return -ENOENT;
 	}
-	STATLOCK;
-	OWQ_U(owq) = ((UINT *) pn->selected_filetype->data.v)[dindex];
-	STATUNLOCK;
+	OWQ_U(owq) = StatRead( &((UINT *) pn->selected_filetype->data.v)[dindex] );
 	return 0;
 }
 
@@ -352,8 +365,219 @@ static ZERO_OR_ERROR FS_time(struct one_wire_query *owq)
 	return 0;
 }
 
+/* Fraction of volatile cache lookups (all kinds) that were hits */
+static ZERO_OR_ERROR FS_hit_ratio(struct one_wire_query *owq)
+{
+	UINT tries ;
+	UINT hits ;
+
+	tries = StatRead( &stat_total.cache_ext.tries ) + StatRead( &stat_total.cache_int.tries )
+		+ StatRead( &stat_total.cache_dir.tries ) + StatRead( &stat_total.cache_dev.tries ) ;
+	hits = StatRead( &stat_total.cache_ext.hits ) + StatRead( &stat_total.cache_int.hits )
+		+ StatRead( &stat_total.cache_dir.hits ) + StatRead( &stat_total.cache_dev.hits ) ;
+	OWQ_F(owq) = ( tries > 0 ) ? ((_FLOAT) hits) / tries : 0. ;
+	return 0;
+}
+
+/* Hit ratio of the volatile lookups made while this policy was in effect */
+static ZERO_OR_ERROR FS_policy_hit_ratio(struct one_wire_query *owq)
+{
+	int policy = PN(owq)->selected_filetype->data.i ;
+	UINT tries = StatRead( &stat_total.policy_tries[policy] ) ;
+	UINT hits = StatRead( &stat_total.policy_hits[policy] ) ;
+
+	OWQ_F(owq) = ( tries > 0 ) ? ((_FLOAT) hits) / tries : 0. ;
+	return 0;
+}
+
+/* Replacement policy in effect now */
+static ZERO_OR_ERROR FS_cache_policy(struct one_wire_query *owq)
+{
+	switch ( Globals.cache_policy ) {
+		case cache_policy_reject:
+			return OWQ_format_output_offset_and_size_z("reject", owq);
+		case cache_policy_clock:
+		default:
+			return OWQ_format_output_offset_and_size_z("clock", owq);
+	}
+}
+
 static ZERO_OR_ERROR FS_return_code( struct one_wire_query * owq)
 {
 	OWQ_U(owq) = return_code_calls[PN(owq)->extension] ;
 	return 0 ;
 }
+
+/* ------- Per-thread counters ------------ */
+
+/* Each thread gets a block the first time it counts something.
+ * The blocks are listed (under STATLOCK) so a read can add them up, and a
+ * block is folded into stat_total when its thread ends.
+ * */
+struct stat_block {
+	struct stat_counters counters ; // must be first
+	struct stat_block * next ;
+	struct stat_block * prev ;
+} ;
+
+static struct stat_block * stat_blocks = NULL ;
+static pthread_key_t stat_key ;
+static pthread_once_t stat_key_once = PTHREAD_ONCE_INIT ;
+static int stat_key_good = 0 ;
+
+// shared by threads that couldn't get a block of their own (counts may be lost)
+static struct stat_counters stat_spare ;
+
+#define STAT_OFFSET(field) ( offsetof( struct stat_counters, field ) / sizeof(UINT) )
+
+// the fields that combine as a maximum rather than a sum
+static const size_t stat_max_fields[] = {
+	STAT_OFFSET(new_avg.max),
+	STAT_OFFSET(store_avg.max),
+	STAT_OFFSET(read_avg.max),
+	STAT_OFFSET(write_avg.max),
+	STAT_OFFSET(dir_avg.max),
+	STAT_OFFSET(dir_bus_avg.max),
+	STAT_OFFSET(convert_max),
+	STAT_OFFSET(all_avg.max),
+} ;
+
+static int StatIsMax( size_t field )
+{
+	size_t i ;
+	for ( i = 0 ; i < sizeof(stat_max_fields)/sizeof(size_t) ; ++i ) {
+		if ( stat_max_fields[i] == field ) {
+			return 1 ;
+		}
+	}
+	return 0 ;
+}
+
+/* Combine one field of a block into a total -- called with STATLOCK */
+static void StatCombine( UINT * total, const struct stat_counters * block, size_t field )
+{
+	UINT value = ((const UINT *) block)[field] ;
+
+	if ( StatIsMax( field ) ) {
+		if ( value > *total ) {
+			*total = value ;
+		}
+	} else {
+		*total += value ;
+	}
+}
+
+/* Thread is ending -- keep its counts */
+static void StatThreadEnd( void * v )
+{
+	struct stat_block * block = v ;
+	size_t field ;
+
+	STATLOCK;
+	for ( field = 0 ; field < sizeof(struct stat_counters)/sizeof(UINT) ; ++field ) {
+		StatCombine( &((UINT *) &stat_total)[field], &(block->counters), field ) ;
+	}
+	if ( block->prev != NULL ) {
+		block->prev->next = block->next ;
+	} else {
+		stat_blocks = block->next ;
+	}
+	if ( block->next != NULL ) {
+		block->next->prev = block->prev ;
+	}
+	STATUNLOCK;
+	owfree( block ) ;
+}
+
+static void StatKeyCreate( void )
+{
+	stat_key_good = ( pthread_key_create( &stat_key, StatThreadEnd ) == 0 ) ;
+}
+
+struct stat_counters * StatThread( void )
+{
+	struct stat_block * block ;
+
+	pthread_once( &stat_key_once, StatKeyCreate ) ;
+	if ( ! stat_key_good ) {
+		return &stat_spare ;
+	}
+
+	block = pthread_getspecific( stat_key ) ;
+	if ( block != NULL ) {
+		return &(block->counters) ;
+	}
+
+	// first count in this thread
+	block = owcalloc( 1, sizeof(struct stat_block) ) ;
+	if ( block == NULL ) {
+		return &stat_spare ;
+	}
+	if ( pthread_setspecific( stat_key, block ) != 0 ) {
+		owfree( block ) ;
+		return &stat_spare ;
+	}
+	STATLOCK;
+	block->prev = NULL ;
+	block->next = stat_blocks ;
+	if ( stat_blocks != NULL ) {
+		stat_blocks->prev = block ;
+	}
+	stat_blocks = block ;
+	STATUNLOCK;
+	return &(block->counters) ;
+}
+
+/* Value of a statistic -- adds up the threads for a counter in stat_total */
+UINT StatRead( const UINT * counter )
+{
+	const UINT * first = (const UINT *) &stat_total ;
+	size_t field = counter - first ;
+	UINT total ;
+	struct stat_block * block ;
+
+	if ( counter < first || field >= sizeof(struct stat_counters)/sizeof(UINT) ) {
+		// an ordinary counter
+		STATLOCK;
+		total = *counter ;
+		STATUNLOCK;
+		return total ;
+	}
+
+	STATLOCK;
+	total = *counter ;
+	for ( block = stat_blocks ; block != NULL ; block = block->next ) {
+		StatCombine( &total, &(block->counters), field ) ;
+	}
+	StatCombine( &total, &stat_spare, field ) ;
+	STATUNLOCK;
+	return total ;
+}
+
+/* Shared gauge (like requests in progress) -- returns the new value */
+UINT StatGauge( UINT * gauge, int change )
+{
+#if defined(__GNUC__)
+	return __sync_add_and_fetch( gauge, change ) ;
+#else
+	UINT now ;
+	STATLOCK;
+	now = ( *gauge += change ) ;
+	STATUNLOCK;
+	return now ;
+#endif
+}
+
+void StatAverageIn( struct average * mine, UINT * gauge )
+{
+	StatAverageMark( mine, StatGauge( gauge, 1 ) ) ;
+}
+
+void StatAverageMark( struct average * mine, UINT current )
+{
+	++mine->count ;
+	mine->sum += current ;
+	if ( current > mine->max ) {
+		mine->max = current ;
+	}
+}
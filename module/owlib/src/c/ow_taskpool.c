@@ -0,0 +1,188 @@
+/*
+    OWFS -- One-Wire filesystem
+    OWHTTPD -- One-Wire Web Server
+    Written 2003 Paul H Alfille
+    email: paul.alfille@gmail.com
+    Released under the GPL
+    See the header file: ow.h for full attribution
+    1wire/iButton system from Dallas Semiconductor
+*/
+
+/* Task pool -- run a batch of independent tasks (e.g. one per bus) in parallel
+ * on a bounded set of shared worker threads.
+ *
+ * The caller of TaskPool_Run works on its own batch too, so a batch always
+ * finishes even if every worker is busy (or none could be started), and a task
+ * may itself run a batch (nested directory listings).
+ * Workers are started on first use, after any daemon fork.
+ * */
+
+#include <config.h>
+#include "owfs_config.h"
+#include "ow.h"
+
+struct task_batch {
+	void (*task) (void *) ;
+	BYTE * tasks ; // array of task_count arguments, task_size each
+	size_t task_size ;
+	int task_count ;
+	int next_task ; // first not yet started
+	int done_tasks ;
+	pthread_cond_t done ; // signalled when done_tasks reaches task_count
+	struct task_batch * next ; // queue of batches with tasks not yet started
+} ;
+
+static struct {
+	pthread_mutex_t mutex ;
+	pthread_cond_t ready ; // batch queued, or shutdown
+	struct task_batch * head ;
+	struct task_batch * tail ;
+	int threads ; // workers started
+	int idle ; // workers waiting for a batch
+	int shutdown ;
+} TaskPool ;
+
+#define TASKPOOLLOCK    _MUTEX_LOCK(   TaskPool.mutex )
+#define TASKPOOLUNLOCK  _MUTEX_UNLOCK( TaskPool.mutex )
+
+/* Called with TaskPool locked */
+static void TaskPool_Dequeue( struct task_batch * batch )
+{
+	struct task_batch ** prior = &TaskPool.head ;
+	struct task_batch * last = NULL ;
+
+	while ( *prior != NULL ) {
+		if ( *prior == batch ) {
+			*prior = batch->next ;
+			if ( TaskPool.tail == batch ) {
+				TaskPool.tail = last ;
+			}
+			batch->next = NULL ;
+			return ;
+		}
+		last = *prior ;
+		prior = &((*prior)->next) ;
+	}
+}
+
+/* Called with TaskPool locked, returns with TaskPool locked
+ * Runs the next task of this batch (unlocked) */
+static void TaskPool_Work( struct task_batch * batch )
+{
+	int task_index = batch->next_task++ ;
+
+	if ( batch->next_task == batch->task_count ) {
+		// nothing left for anyone else to start
+		TaskPool_Dequeue( batch ) ;
+	}
+	TASKPOOLUNLOCK ;
+	batch->task( batch->tasks + task_index * batch->task_size ) ;
+	TASKPOOLLOCK ;
+	if ( ++batch->done_tasks == batch->task_count ) {
+		my_pthread_cond_signal( &batch->done ) ;
+	}
+}
+
+static void * TaskPool_Worker( void * v )
+{
+	(void) v ;
+	DETACH_THREAD;
+
+	TASKPOOLLOCK ;
+	while ( 1 ) {
+		while ( TaskPool.head == NULL && ! TaskPool.shutdown ) {
+			++TaskPool.idle ;
+			my_pthread_cond_wait( &TaskPool.ready, &TaskPool.mutex ) ;
+			--TaskPool.idle ;
+		}
+		if ( TaskPool.head == NULL ) {
+			// shutdown and nothing left to do
+			break ;
+		}
+		TaskPool_Work( TaskPool.head ) ;
+	}
+	--TaskPool.threads ;
+	TASKPOOLUNLOCK ;
+	return VOID_RETURN ;
+}
+
+/* Called with TaskPool locked
+ * Start workers (up to --pool_threads) until enough are idle for this batch */
+static void TaskPool_Start( int wanted )
+{
+	pthread_t thread ;
+
+	while ( TaskPool.idle < wanted && TaskPool.threads < Globals.pool_threads ) {
+		if ( pthread_create( &thread, DEFAULT_THREAD_ATTR, TaskPool_Worker, NULL ) != 0 ) {
+			LEVEL_DEBUG("Cannot start a task pool thread (%d running)", TaskPool.threads ) ;
+			return ;
+		}
+		++TaskPool.threads ;
+		// the new worker will pick up one of the wanted tasks
+		--wanted ;
+	}
+}
+
+/* Call task for each of the task_count elements (task_size bytes each) of tasks.
+ * Returns when all have finished. */
+void TaskPool_Run( void (*task) (void *), void * tasks, size_t task_size, int task_count )
+{
+	struct task_batch batch ;
+
+	if ( task_count < 2 || Globals.pool_threads < 1 ) {
+		// nothing to gain from other threads
+		int task_index ;
+		for ( task_index = 0 ; task_index < task_count ; ++task_index ) {
+			task( (BYTE *) tasks + task_index * task_size ) ;
+		}
+		return ;
+	}
+
+	batch.task = task ;
+	batch.tasks = tasks ;
+	batch.task_size = task_size ;
+	batch.task_count = task_count ;
+	batch.next_task = 0 ;
+	batch.done_tasks = 0 ;
+	batch.next = NULL ;
+	my_pthread_cond_init( &batch.done, NULL ) ;
+
+	TASKPOOLLOCK ;
+	if ( TaskPool.tail != NULL ) {
+		TaskPool.tail->next = &batch ;
+	} else {
+		TaskPool.head = &batch ;
+	}
+	TaskPool.tail = &batch ;
+	// the caller takes one task itself
+	TaskPool_Start( task_count - 1 ) ;
+	my_pthread_cond_broadcast( &TaskPool.ready ) ;
+
+	while ( batch.next_task < batch.task_count ) {
+		TaskPool_Work( &batch ) ;
+	}
+	while ( batch.done_tasks < batch.task_count ) {
+		my_pthread_cond_wait( &batch.done, &TaskPool.mutex ) ;
+	}
+	TASKPOOLUNLOCK ;
+
+	my_pthread_cond_destroy( &batch.done ) ;
+}
+
+void TaskPool_Open( void )
+{
+	_MUTEX_INIT( TaskPool.mutex ) ;
+	my_pthread_cond_init( &TaskPool.ready, NULL ) ;
+	TaskPool.head = TaskPool.tail = NULL ;
+	TaskPool.threads = TaskPool.idle = 0 ;
+	TaskPool.shutdown = 0 ;
+}
+
+/* Idle workers exit now, busy ones when their task is done */
+void TaskPool_Close( void )
+{
+	TASKPOOLLOCK ;
+	TaskPool.shutdown = 1 ;
+	my_pthread_cond_broadcast( &TaskPool.ready ) ;
+	TASKPOOLUNLOCK ;
+}
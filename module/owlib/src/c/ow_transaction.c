@@ -13,6 +13,7 @@
 #include "ow.h"
 #include "ow_counters.h"
 #include "ow_connection.h"
+#include "ow_codes.h"
 #include <assert.h>
 
 /* Transactions of a sequence of commands to the bus master
@@ -29,6 +30,30 @@ struct transaction_bundle {
 	int select_first;
 };
 
+/* Adapters without bundling still send a run of byte items (and the match ROM
+ * bytes of the select before them) as one sendback -- one adapter round trip
+ * instead of one per item */
+struct transaction_run {
+	const struct transaction_log *start;
+	int items;
+	size_t max_size;
+	struct memblob mb;
+	int select_first; // match ROM bytes lead the run
+	BYTE select[1 + SERIAL_NUMBER_SIZE];
+};
+
+/* A transaction waiting for the bus */
+struct transaction_request {
+	const struct transaction_log *tl;
+	const struct parsedname *pn;
+	GOOD_OR_BAD ret;
+	int finished;
+	struct transaction_request *next;
+};
+
+/* Transactions run by one thread for others in a single hold of the bus */
+#define TRANSACTION_COMBINE_MAX 32
+
 // static int BUS_transaction_length( const struct transaction_log * tl, const struct parsedname * pn ) ;
 static GOOD_OR_BAD BUS_transaction_single(const struct transaction_log *t, const struct parsedname *pn);
 
@@ -40,23 +65,140 @@ static GOOD_OR_BAD Bundle_unpack(struct transaction_bundle *tb);
 
 static void Bundle_init(struct transaction_bundle *tb, const struct parsedname *pn);
 
+static GOOD_OR_BAD Run_pack(const struct transaction_log *tl, const struct parsedname *pn);
+static GOOD_OR_BAD Run_item(const struct transaction_log *tl, struct transaction_run *tr);
+static GOOD_OR_BAD Run_select(struct transaction_run *tr, const struct parsedname *pn);
+static GOOD_OR_BAD Run_ship(struct transaction_run *tr, const struct parsedname *pn);
+static void Run_init(struct transaction_run *tr, const struct parsedname *pn);
+
 #define TRANSACTION_INCREMENT 1000
 
 /* Bus transaction */
 /* Encapsulates communication with a device, including locking the bus, reset and selection */
 /* Then a series of bytes is sent and returned, including sending data and reading the return data */
+/* Transactions for the same bus queue up. Whichever thread gets the bus runs
+   the queue in order (up to TRANSACTION_COMBINE_MAX) before letting it go */
 GOOD_OR_BAD BUS_transaction(const struct transaction_log *tl, const struct parsedname *pn)
 {
-	GOOD_OR_BAD ret ;
+	struct connection_in * in ;
+	struct transaction_queue * tq ;
+	struct transaction_request request = { tl, pn, gbGOOD, 0, NULL, } ;
 
 	if (tl == NULL) {
 		return gbGOOD;
 	}
-	BUSLOCK(pn);
-	ret = BUS_transaction_nolock(tl, pn);
-	BUSUNLOCK(pn);
+	in = pn->selected_connection ;
+	tq = &(in->transaction_queue) ;
 
-	return ret;
+	_MUTEX_LOCK( tq->mutex ) ;
+	if ( tq->tail != NULL ) {
+		tq->tail->next = &request ;
+	} else {
+		tq->head = &request ;
+	}
+	tq->tail = &request ;
+
+	while ( ! request.finished ) {
+		int combined = 0 ;
+
+		if ( tq->running ) {
+			my_pthread_cond_wait( &(tq->done), &(tq->mutex) ) ;
+			continue ;
+		}
+
+		// Our turn with the bus -- run what's queued, ours included
+		tq->running = 1 ;
+		_MUTEX_UNLOCK( tq->mutex ) ;
+		BUSLOCK(pn);
+		_MUTEX_LOCK( tq->mutex ) ;
+		while ( tq->head != NULL && combined < TRANSACTION_COMBINE_MAX ) {
+			struct transaction_request * next_request = tq->head ;
+			tq->head = next_request->next ;
+			if ( tq->head == NULL ) {
+				tq->tail = NULL ;
+			}
+			_MUTEX_UNLOCK( tq->mutex ) ;
+			next_request->ret = BUS_transaction_nolock( next_request->tl, next_request->pn ) ;
+			if ( next_request != &request ) {
+				STAT_ADD1_BUS( e_bus_combined, in ) ;
+			}
+			_MUTEX_LOCK( tq->mutex ) ;
+			next_request->finished = 1 ;
+			++combined ;
+		}
+		_MUTEX_UNLOCK( tq->mutex ) ;
+		BUSUNLOCK(pn);
+		_MUTEX_LOCK( tq->mutex ) ;
+		tq->running = 0 ;
+		// wakes those finished, and the next to take the bus
+		my_pthread_cond_broadcast( &(tq->done) ) ;
+	}
+	_MUTEX_UNLOCK( tq->mutex ) ;
+
+	return request.ret;
+}
+
+void Transaction_queue_init(struct connection_in *in)
+{
+	struct transaction_queue * tq = &(in->transaction_queue) ;
+
+	_MUTEX_INIT( tq->mutex ) ;
+	my_pthread_cond_init( &(tq->done), NULL ) ;
+	tq->head = tq->tail = NULL ;
+	tq->running = 0 ;
+	my_pthread_cond_init( &(tq->admit), NULL ) ;
+	tq->tickets = tq->admitted = 0 ;
+	tq->requests = 0 ;
+}
+
+void Transaction_queue_destroy(struct connection_in *in)
+{
+	struct transaction_queue * tq = &(in->transaction_queue) ;
+
+	my_pthread_cond_destroy( &(tq->done) ) ;
+	my_pthread_cond_destroy( &(tq->admit) ) ;
+	_MUTEX_DESTROY( tq->mutex ) ;
+}
+
+/* Filesystem requests (owfs reads and writes) for one bus.
+ * With --bus_requests set, up to that many work on the bus at once -- 4 is
+ * enough that their transactions still combine (see BUS_transaction) --
+ * the rest wait their turn here in arrival order. A burst aimed at one slow
+ * bus stays queued against that bus while requests for other buses go
+ * straight through. Callers skip this when there is no limit.
+ * The number waiting is the bus's requests/queue_depth statistic. */
+void BUS_request_begin(struct connection_in *in)
+{
+	struct transaction_queue * tq = &(in->transaction_queue) ;
+	UINT ticket ;
+
+	_MUTEX_LOCK( tq->mutex ) ;
+	ticket = tq->tickets++ ;
+	++in->bus_stat[e_bus_requests] ;
+	while ( ticket != tq->admitted || tq->requests >= Globals.bus_requests ) {
+		UINT waiting = tq->tickets - tq->admitted ;
+		in->bus_stat[e_bus_queue_depth] = waiting ;
+		if ( waiting > in->bus_stat[e_bus_queue_max] ) {
+			in->bus_stat[e_bus_queue_max] = waiting ;
+		}
+		my_pthread_cond_wait( &(tq->admit), &(tq->mutex) ) ;
+	}
+	++tq->admitted ;
+	++tq->requests ;
+	in->bus_stat[e_bus_queue_depth] = tq->tickets - tq->admitted ;
+	// the next in line may fit too
+	my_pthread_cond_broadcast( &(tq->admit) ) ;
+	_MUTEX_UNLOCK( tq->mutex ) ;
+}
+
+void BUS_request_end(struct connection_in *in)
+{
+	struct transaction_queue * tq = &(in->transaction_queue) ;
+
+	_MUTEX_LOCK( tq->mutex ) ;
+	--tq->requests ;
+	my_pthread_cond_broadcast( &(tq->admit) ) ;
+	_MUTEX_UNLOCK( tq->mutex ) ;
 }
 
 /* A few sequences start with teh bus already locked */
@@ -68,6 +210,10 @@ GOOD_OR_BAD BUS_transaction_nolock(const struct transaction_log *tl, const struc
 	if (pn->selected_connection->iroutines.flags & ADAP_FLAG_bundle) {
 		return Bundle_pack(tl, pn);
 	}
+	if (pn->selected_connection->iroutines.sendback_data != NO_SENDBACKDATA_ROUTINE
+		&& pn->selected_connection->bundling_length > 1) {
+		return Run_pack(tl, pn);
+	}
 
 	do {
 		//printf("Transact type=%d\n",t->type) ;
@@ -504,3 +650,191 @@ static GOOD_OR_BAD Bundle_unpack(struct transaction_bundle *tb)
 
 	return ret;
 }
+
+// initialize the run
+static void Run_init(struct transaction_run *tr, const struct parsedname *pn)
+{
+	memset(tr, 0, sizeof(struct transaction_run));
+	MemblobInit(&tr->mb, TRANSACTION_INCREMENT);
+	tr->max_size = pn->selected_connection->bundling_length;
+}
+
+static GOOD_OR_BAD Run_pack(const struct transaction_log *tl, const struct parsedname *pn)
+{
+	const struct transaction_log *t_index;
+	struct transaction_run s_tr;
+	struct transaction_run *tr = &s_tr;
+
+	Run_init(tr, pn);
+
+	for (t_index = tl; t_index->type != trxn_end; ++t_index) {
+		if (t_index->type == trxn_select) {
+			RETURN_BAD_IF_BAD(Run_ship(tr, pn)) ;
+			switch (Run_select(tr, pn)) {
+			case gbGOOD:
+				break;
+			case gbBAD:
+				return gbBAD;
+			case gbOTHER:
+				RETURN_BAD_IF_BAD(BUS_transaction_single(t_index, pn)) ;
+				break;
+			}
+			continue ;
+		}
+		switch (Run_item(t_index, tr)) {
+		case gbGOOD:
+			break;
+		case gbBAD:
+			// not a byte item -- it needs what came before
+			RETURN_BAD_IF_BAD(Run_ship(tr, pn)) ;
+			RETURN_BAD_IF_BAD(BUS_transaction_single(t_index, pn)) ;
+			break;
+		case gbOTHER:
+			// doesn't fit after the items so far
+			RETURN_BAD_IF_BAD(Run_ship(tr, pn)) ;
+			if ( GOOD( Run_item(t_index, tr) ) ) {
+				break;
+			}
+			RETURN_BAD_IF_BAD(BUS_transaction_single(t_index, pn)) ;
+			break;
+		}
+	}
+	return Run_ship(tr, pn);
+}
+
+/* Do the reset (and DS2409 branches) of a select now, and start the run with
+   the match ROM bytes.
+   return gbOTHER -- leave it to BUS_select (no device, or special select)
+   return gbBAD -- reset or branching failed */
+static GOOD_OR_BAD Run_select(struct transaction_run *tr, const struct parsedname *pn)
+{
+	struct connection_in * in = pn->selected_connection ;
+	struct parsedname pn_path ;
+
+	if ( Globals.one_device || in->iroutines.select != NO_SELECT_ROUTINE ) {
+		return gbOTHER ;
+	}
+	if ( pn->selected_device == NO_DEVICE || pn->selected_device == DeviceThermostat ) {
+		return gbOTHER ;
+	}
+	if ( 1 + SERIAL_NUMBER_SIZE > tr->max_size ) {
+		return gbOTHER ;
+	}
+
+	// BUS_select without a device does only the reset and branching
+	memcpy(&pn_path, pn, sizeof(struct parsedname));	//shallow copy
+	pn_path.selected_device = NO_DEVICE;
+	if ( BAD( BUS_select(&pn_path) ) ) {
+		return gbBAD ;
+	}
+
+	tr->select[0] = ( RootNotBranch(pn) && in->overdrive ) ? _1W_OVERDRIVE_MATCH_ROM : _1W_MATCH_ROM ;
+	memcpy(&tr->select[1], pn->sn, SERIAL_NUMBER_SIZE);
+	if (MemblobAdd(tr->select, 1 + SERIAL_NUMBER_SIZE, &tr->mb)) {
+		// send the match ROM on its own after all
+		return BUS_send_data(tr->select, 1 + SERIAL_NUMBER_SIZE, pn) ;
+	}
+	tr->select_first = 1 ;
+	return gbGOOD ;
+}
+
+/* See if the item can join the run
+   return gbBAD -- not a byte item (or too big for any run)
+   return gbOTHER -- should be at start
+   return gbGOOD       -- added successfully
+*/
+static GOOD_OR_BAD Run_item(const struct transaction_log *tl, struct transaction_run *tr)
+{
+	const struct transaction_log *t_prior;
+	int item_index;
+
+	switch (tl->type) {
+	case trxn_read:
+	case trxn_match:
+	case trxn_modify:
+	case trxn_blind:
+		break ;
+	default:
+		return gbBAD;
+	}
+	if (tl->size > tr->max_size) {
+		return gbBAD;		// too big for any run
+	}
+	if (tl->size + MemblobLength(&(tr->mb)) > tr->max_size) {
+		return gbOTHER;		// too big for this partial run
+	}
+	// data sent can't come from data still to be read in this run
+	for (item_index = 0, t_prior = tr->start; item_index < tr->items; ++item_index, ++t_prior) {
+		if ( tl->out != NULL && t_prior->in != NULL
+			&& tl->out < t_prior->in + t_prior->size && t_prior->in < tl->out + tl->size ) {
+			return gbOTHER;
+		}
+	}
+
+	if (tl->type == trxn_read) {
+		if (MemblobAddChar(0xFF, tl->size, &tr->mb)) {
+			return gbBAD;
+		}
+	} else if (MemblobAdd(tl->out, tl->size, &tr->mb)) {
+		return gbBAD;
+	}
+	if (tr->items == 0) {
+		tr->start = tl;
+	}
+	++tr->items;
+	return gbGOOD;
+}
+
+// Send the run as one sendback, unpack, and clear the memblob
+static GOOD_OR_BAD Run_ship(struct transaction_run *tr, const struct parsedname *pn)
+{
+	int item_index;
+	const struct transaction_log *tl;
+	BYTE *data = MemblobData(&(tr->mb));
+	GOOD_OR_BAD ret = gbGOOD;
+
+	if (MemblobLength(&(tr->mb)) == 0) {
+		tr->items = 0;
+		return gbGOOD;
+	}
+
+	LEVEL_DEBUG("Ship run of %d items, %d bytes", tr->items, (int) MemblobLength(&(tr->mb)));
+	if ( BAD( BUS_sendback_data(data, data, MemblobLength(&(tr->mb)), pn) ) ) {
+		STAT_ADD1_BUS(e_bus_errors, pn->selected_connection);
+		ret = gbBAD;
+	} else {
+		if (tr->select_first) {
+			if (memcmp(tr->select, data, 1 + SERIAL_NUMBER_SIZE) != 0) {
+				STAT_ADD1_BUS(e_bus_select_errors, pn->selected_connection);
+				LEVEL_CONNECT("Select error for %s on bus %s", pn->selected_device->readable_name, DEVICENAME(pn->selected_connection));
+				ret = gbBAD;
+			}
+			data += 1 + SERIAL_NUMBER_SIZE;
+		}
+		for (item_index = 0, tl = tr->start; GOOD(ret) && item_index < tr->items; ++item_index, ++tl) {
+			switch (tl->type) {
+			case trxn_match:
+				if (memcmp(tl->out, data, tl->size) != 0) {
+					LEVEL_DEBUG("Response doesn't match data sent");
+					STAT_ADD1_BUS(e_bus_errors, pn->selected_connection);
+					ret = gbBAD;
+				}
+				break;
+			case trxn_read:
+			case trxn_modify:
+				memmove(tl->in, data, tl->size);
+				break;
+			default:
+				break;
+			}
+			data += tl->size;
+		}
+	}
+
+	// clear the run
+	MemblobClear(&tr->mb);
+	tr->items = 0;
+	tr->select_first = 0;
+
+	return ret;
+}
@@ -183,6 +183,7 @@ void DeviceSort(void)
 
 	Device2Tree( & d_set_timeout,          ePN_settings);
 	Device2Tree( & d_set_units,            ePN_settings);
+	Device2Tree( & d_set_cache,            ePN_settings);
 	Device2Tree( & d_set_alias,            ePN_settings);
 	Device2Tree( & d_set_return_code,      ePN_settings);
 
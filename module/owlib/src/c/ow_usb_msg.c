@@ -40,6 +40,17 @@ char badUSBname[] = "-1:-1";
 
 static int usb_transfer( int (*transfer_function) (struct libusb_device_handle *dev_handle, unsigned char endpoint, BYTE *data, int length, int *transferred, unsigned int timeout),  unsigned char endpoint, BYTE * data, int length, int * transferred, struct connection_in * in ) ;
 static void usb_buffer_traffic( BYTE * buffer ) ;
+static RESET_TYPE usb_status_results( BYTE * buffer, int transferred ) ;
+
+/* A transfer submitted now and collected later */
+struct usb_async {
+	struct libusb_transfer * transfer ;
+	int completed ;
+	int * event ; // also set on completion, to end a wait on several transfers
+} ;
+
+static int usb_async_submit( struct usb_async * ua, unsigned char endpoint, BYTE * data, int length, int * event, struct connection_in * in ) ;
+static int usb_async_collect( struct usb_async * ua, int cancel, int * transferred ) ;
 
 /* ------------------------------------------------------------ */
 /* --- USB low-level communication -----------------------------*/
@@ -87,7 +98,6 @@ RESET_TYPE DS9490_getstatus(BYTE * buffer, int * readlen, const struct parsednam
 			LEVEL_DATA("Bad DS2490 status %d > 32",transferred) ;
 			return BUS_RESET_ERROR;
 		} else if ( transferred > DS9490_getstatus_BUFFER ) {
-			int i ;
 			if ( transferred == DS9490_getstatus_BUFFER_LENGTH ) {	// FreeBSD buffers the input, so this could just be two readings
 				if (!memcmp(buffer, &buffer[DS9490_getstatus_BUFFER], 6)) {
 					memmove(buffer, &buffer[DS9490_getstatus_BUFFER], DS9490_getstatus_BUFFER);
@@ -95,15 +105,8 @@ RESET_TYPE DS9490_getstatus(BYTE * buffer, int * readlen, const struct parsednam
 					LEVEL_DATA("Corrected buffer 32 byte read");
 				}
 			}
-			for (i = DS9490_getstatus_BUFFER; i < transferred; i++) {
-				BYTE val = buffer[i];
-				if (val != ONEWIREDEVICEDETECT) {
-					LEVEL_DATA("Status byte[%X]: %X", i - DS9490_getstatus_BUFFER, val);
-				}
-				if (val & COMMCMDERRORRESULT_SH) {	// short detected
-					LEVEL_DATA("short detected");
-					return BUS_RESET_SHORT;
-				}
+			if ( usb_status_results( buffer, transferred ) == BUS_RESET_SHORT ) {
+				return BUS_RESET_SHORT;
 			}
 		}
 
@@ -147,6 +150,23 @@ RESET_TYPE DS9490_getstatus(BYTE * buffer, int * readlen, const struct parsednam
 	return BUS_RESET_OK ;
 }
 
+/* Result codes follow the 16 status registers */
+static RESET_TYPE usb_status_results( BYTE * buffer, int transferred )
+{
+	int i ;
+	for (i = DS9490_getstatus_BUFFER; i < transferred; i++) {
+		BYTE val = buffer[i];
+		if (val != ONEWIREDEVICEDETECT) {
+			LEVEL_DATA("Status byte[%X]: %X", i - DS9490_getstatus_BUFFER, val);
+		}
+		if (val & COMMCMDERRORRESULT_SH) {	// short detected
+			LEVEL_DATA("short detected");
+			return BUS_RESET_SHORT;
+		}
+	}
+	return BUS_RESET_OK;
+}
+
 static void usb_buffer_traffic( BYTE * buffer )
 {
 	if (Globals.traffic) {
@@ -305,6 +325,101 @@ SIZE_OR_ERROR DS9490_write(BYTE * buf, size_t size, const struct parsedname *pn)
 	return transferred ;
 }
 
+/* Read size bytes from EP3 while start() sends the commands that produce them.
+   The read is queued first, and EP1 status reports are watched while waiting,
+   so the data is taken as soon as the DS2490 has it and a short ends the wait
+   -- no polling of the status with sleeps in between.
+   A short packet ends a bulk read early, so the rest is queued again until
+   all size bytes are in.
+   returns number of bytes (size)
+   or <0 for an error */
+SIZE_OR_ERROR DS9490_read_while(BYTE * buf, size_t size, GOOD_OR_BAD (*start) (void * v, const struct parsedname * pn), void * v, const struct parsedname *pn)
+{
+	struct connection_in * in = pn->selected_connection ;
+	struct usb_async data ;
+	struct usb_async status ;
+	BYTE status_buffer[ DS9490_getstatus_BUFFER_LENGTH ] ;
+	int watch_status = 1 ;
+	int short_detected = 0 ;
+	int event = 0 ;
+	size_t got = 0 ;
+	int transferred ;
+	int ret ;
+
+	ret = usb_async_submit( &data, DS2490_EP3, buf, size, &event, in ) ;
+	if ( ret != 0 ) {
+		LEVEL_DATA("<%s> Failed to queue DS9490 read", libusb_error_name(ret));
+		STAT_ADD1_BUS(e_bus_read_errors, in);
+		return ret ;
+	}
+
+	if ( BAD( start( v, pn ) ) ) {
+		usb_async_collect( &data, 1, &transferred ) ;
+		return LIBUSB_ERROR_IO ;
+	}
+
+	status.transfer = NULL ;
+	status.completed = 1 ;
+	while ( ret == 0 ) {
+		if ( data.completed ) {
+			ret = usb_async_collect( &data, 0, &transferred ) ;
+			got += transferred ;
+			if ( ret == LIBUSB_ERROR_TIMEOUT && transferred > 0 ) {
+				// partial transfer, as in usb_transfer
+				ret = 0 ;
+			}
+			if ( ret != 0 ) {
+				break ;
+			}
+			if ( got >= size ) {
+				break ;
+			}
+			// short packet -- the rest is still to come
+			ret = usb_async_submit( &data, DS2490_EP3, &buf[got], size - got, &event, in ) ;
+			continue ;
+		}
+		if ( status.completed && watch_status ) {
+			if ( status.transfer != NULL ) {
+				// a status report came in
+				int status_length ;
+				if ( usb_async_collect( &status, 0, &status_length ) == 0
+					&& usb_status_results( status_buffer, status_length ) == BUS_RESET_SHORT ) {
+					short_detected = 1 ;
+					ret = LIBUSB_ERROR_IO ;
+					break ;
+				}
+			}
+			if ( usb_async_submit( &status, DS2490_EP1, status_buffer, DS9490_getstatus_BUFFER_LENGTH, &event, in ) != 0 ) {
+				// the read still has its timeout
+				watch_status = 0 ;
+			}
+			continue ;
+		}
+		event = 0 ;
+		if ( data.completed || ( status.completed && watch_status ) ) {
+			continue ;
+		}
+		libusb_handle_events_completed( Globals.luc, &event ) ;
+	}
+
+	// both buffers are on this stack -- nothing may be left with libusb
+	usb_async_collect( &status, 1, &transferred ) ;
+	usb_async_collect( &data, 1, &transferred ) ;
+
+	if ( ret == 0 ) {
+		TrafficIn("read",buf,size,in) ;
+		return got;
+	}
+
+	if ( short_detected ) {
+		STAT_ADD1_BUS(e_bus_errors, in);
+		return ret ;
+	}
+	LEVEL_DATA("<%s> Failed DS9490 read", libusb_error_name(ret));
+	STAT_ADD1_BUS(e_bus_read_errors, in);
+	return ret;
+}
+
 // Notes from Michael Markstaller:
 /*
         Datasheet DS2490 page 29 table 16
@@ -371,6 +486,109 @@ static int usb_transfer( int (*transfer_function) (struct libusb_device_handle *
 	} while (1) ;
 }	
 
+/* Events are handled by whichever thread is waiting, libusb serialises that
+   between threads (one per bus) */
+static void LIBUSB_CALL usb_async_callback( struct libusb_transfer * transfer )
+{
+	struct usb_async * ua = transfer->user_data ;
+
+	ua->completed = 1 ;
+	if ( ua->event != NULL ) {
+		ua->event[0] = 1 ;
+	}
+}
+
+static int usb_async_submit( struct usb_async * ua, unsigned char endpoint, BYTE * data, int length, int * event, struct connection_in * in )
+{
+	libusb_device_handle *usb = in->master.usb.lusb_handle;
+	int ret ;
+
+	ua->completed = 0 ;
+	ua->event = event ;
+	ua->transfer = libusb_alloc_transfer( 0 ) ;
+	if ( ua->transfer == NULL ) {
+		ua->completed = 1 ;
+		return LIBUSB_ERROR_NO_MEM ;
+	}
+
+	if ( endpoint == DS2490_EP1 ) {
+		libusb_fill_interrupt_transfer( ua->transfer, usb, endpoint, data, length, usb_async_callback, ua, in->master.usb.timeout ) ;
+	} else {
+		libusb_fill_bulk_transfer( ua->transfer, usb, endpoint, data, length, usb_async_callback, ua, in->master.usb.timeout ) ;
+	}
+
+	ret = libusb_submit_transfer( ua->transfer ) ;
+	if ( ret != 0 ) {
+		libusb_free_transfer( ua->transfer ) ;
+		ua->transfer = NULL ;
+		ua->completed = 1 ;
+	}
+	return ret ;
+}
+
+/* Wait for (or cancel) the transfer and free it
+   returns 0 or a libusb error, and the bytes transferred */
+static int usb_async_collect( struct usb_async * ua, int cancel, int * transferred )
+{
+	int ret ;
+
+	transferred[0] = 0 ;
+	if ( ua->transfer == NULL ) {
+		// never submitted
+		return LIBUSB_ERROR_OTHER ;
+	}
+
+	if ( cancel && ! ua->completed ) {
+		libusb_cancel_transfer( ua->transfer ) ;
+	}
+	/* The buffer and ua belong to the caller's stack, so don't return while
+	   libusb still owns the transfer. A cancelled transfer, a timed out one
+	   and one on an unplugged adapter all still end in the callback */
+	while ( ! ua->completed ) {
+		ret = libusb_handle_events_completed( Globals.luc, &ua->completed ) ;
+		if ( ret < 0 && ret != LIBUSB_ERROR_INTERRUPTED && ! cancel ) {
+			LEVEL_DEBUG("<%s> Asynchronous IO error", libusb_error_name(ret)) ;
+			libusb_cancel_transfer( ua->transfer ) ;
+			cancel = 1 ;
+		}
+	}
+
+	transferred[0] = ua->transfer->actual_length ;
+	switch ( ua->transfer->status ) {
+		case LIBUSB_TRANSFER_COMPLETED:
+			ret = 0 ;
+			break ;
+		case LIBUSB_TRANSFER_TIMED_OUT:
+			ret = LIBUSB_ERROR_TIMEOUT ;
+			break ;
+		case LIBUSB_TRANSFER_CANCELLED:
+			ret = LIBUSB_ERROR_INTERRUPTED ;
+			break ;
+		case LIBUSB_TRANSFER_STALL:
+			ret = LIBUSB_ERROR_PIPE ;
+			break ;
+		case LIBUSB_TRANSFER_NO_DEVICE:
+			ret = LIBUSB_ERROR_NO_DEVICE ;
+			break ;
+		case LIBUSB_TRANSFER_OVERFLOW:
+			ret = LIBUSB_ERROR_OVERFLOW ;
+			break ;
+		default:
+			ret = LIBUSB_ERROR_IO ;
+			break ;
+	}
+	if ( ret != 0 && ret != LIBUSB_ERROR_INTERRUPTED ) {
+		// as for the synchronous transfers
+		int libusb_err = libusb_clear_halt( ua->transfer->dev_handle, ua->transfer->endpoint ) ;
+		if ( libusb_err != 0 ) {
+			LEVEL_DEBUG("<%s> Asynchronous IO error", libusb_error_name(libusb_err)) ;
+		}
+	}
+	libusb_free_transfer( ua->transfer ) ;
+	ua->transfer = NULL ;
+	return ret ;
+}
+
 void DS9490_port_setup( libusb_device * dev, struct port_in * pin )
 {
 	struct connection_in * in = pin->first ;
@@ -96,15 +96,12 @@ SIZE_OR_ERROR FS_write_postparse(struct one_wire_query *owq)
 		return -EISDIR;			// not a file
 	}
 
-	STATLOCK;
-	AVERAGE_IN(&write_avg);
-	AVERAGE_IN(&all_avg);
-	++write_calls;				/* statistics */
-	STATUNLOCK;
+	STAT_AVERAGE_IN(write_avg);
+	STAT_AVERAGE_IN(all_avg);
+	STAT_THREAD_ADD1(write_calls);	/* statistics */
 
 	write_or_error = FS_write_post_stats( owq ) ;
 
-	STATLOCK;
 	// write_or_error is still ZERO_OR_ERROR mode
 	if ( write_or_error == 0 ) {
 		LEVEL_DEBUG("Successful write to %s",pn->path) ;
@@ -112,14 +109,13 @@ SIZE_OR_ERROR FS_write_postparse(struct one_wire_query *owq)
 		LEVEL_DEBUG("Error writing to %s",pn->path) ;
 	}
 	if (write_or_error == 0) {
-		++write_success;		/* statistics */
-		write_bytes += OWQ_size(owq);	/* statistics */
+		STAT_THREAD_ADD1(write_success);	/* statistics */
+		STAT_THREAD_ADD(write_bytes, OWQ_size(owq));	/* statistics */
 		// write_or_error now SIZE_OR_ERROR mode
 		write_or_error = OWQ_size(owq);	/* here's where the size is used! */
 	}
-	AVERAGE_OUT(&write_avg);
-	AVERAGE_OUT(&all_avg);
-	STATUNLOCK;
+	STAT_AVERAGE_OUT(write_avg);
+	STAT_AVERAGE_OUT(all_avg);
 
 	return write_or_error;
 }
@@ -217,14 +213,14 @@ static ZERO_OR_ERROR FS_write_real(int depth, struct one_wire_query *owq)
 
 	/* First try */
 	/* in and bus_nr already set */
-	STAT_ADD1(write_tries[0]);
+	STAT_THREAD_ADD1(write_tries[0]);
 	write_or_error = FS_w_given_bus(owq);
 	if ( write_or_error ==0 ) {
 		return 0 ;
 	}
 
 	/* Second Try */
-	STAT_ADD1(write_tries[1]);
+	STAT_THREAD_ADD1(write_tries[1]);
 	if (SpecifiedBus(pn)) {
 		// The bus number casn't be changed -- it was specified in the path
 		write_or_error = FS_w_given_bus(owq);
@@ -233,7 +229,7 @@ static ZERO_OR_ERROR FS_write_real(int depth, struct one_wire_query *owq)
 		}
 
 		// The bus number casn't be changed -- it was specified in the path
-		STAT_ADD1(write_tries[2]);
+		STAT_THREAD_ADD1(write_tries[2]);
 		return FS_w_given_bus(owq);
 	}
 
@@ -253,13 +249,13 @@ static ZERO_OR_ERROR FS_write_real(int depth, struct one_wire_query *owq)
 			return write_or_error ;
 		}
 		// try again
-		STAT_ADD1(write_tries[1]);
+		STAT_THREAD_ADD1(write_tries[1]);
 		write_or_error = FS_w_given_bus(owq);
 		if ( write_or_error == 0 ) {
 			return 0 ;
 		}
 		// third try
-		STAT_ADD1(write_tries[2]);
+		STAT_THREAD_ADD1(write_tries[2]);
 		return FS_w_given_bus(owq);
 	}
 
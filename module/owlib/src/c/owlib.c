@@ -28,6 +28,9 @@ GOOD_OR_BAD LibStart(void* v)
 	/* Build device and filetype arrays (including externals) */
 	DeviceSort();
 
+	/* Free expired cache entries in the background */
+	Cache_Housekeeping_Start();
+
 	Globals.zero = zero_none ;
 #if OW_ZERO
 	if ( OW_Load_dnssd_library() == 0 ) {
@@ -329,6 +329,7 @@ enum  e_inet_type { inet_none, inet_systemd , inet_launchd, } ;
 /* predeclare connection_in/out */
 struct connection_in;
 struct connection_out;
+struct server_connection;
 
 /* Maximum length of a file or directory name, and extension */
 #define OW_NAME_MAX      (32)
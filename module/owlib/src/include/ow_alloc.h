@@ -64,6 +64,31 @@
 	#define owfree_func           free
 #endif  /* OW_ALLOC_DEBUG */
 
+/* Slab allocator for small, short-lived objects (cache nodes, dirblobs)
+ * Objects are carved from large chunks and recycled through per-size-class
+ * free lists, so the cache churn doesn't fragment the heap.
+ * Memory from owslab_* must be returned with owslab_free (or owslab_treefree for tdestroy)
+ * Requests larger than the biggest class fall through to malloc
+ * owslab_trim returns the chunks that have emptied
+ * Kept apart from owmalloc/owfree: owcapi and ownet hand owmalloc'ed buffers
+ * to the application, which releases them with free (3)
+ * */
+#define OWSLAB_CLASSES 5
+
+#if OW_ALLOC_DEBUG
+	#define owslab_malloc(size)      owmalloc(size)
+	#define owslab_free(ptr)         owfree(ptr)
+	#define owslab_realloc(ptr,size) owrealloc(ptr,size)
+	#define owslab_treefree          owfree_func
+	#define owslab_trim()            do { } while (0)
+#else  /* OW_ALLOC_DEBUG */
+	void *owslab_malloc(size_t size);
+	void  owslab_free(void *ptr);
+	void *owslab_realloc(void *ptr, size_t size);
+	void  owslab_treefree(void *ptr);
+	void  owslab_trim(void);
+#endif  /* OW_ALLOC_DEBUG */
+
 #define SAFEFREE(p)    do { if ( (p)!= NULL ) { owfree(p) ; p=NULL; } } while (0)
 #define SAFETDESTROY(p,f) do { if ( (p)!=NULL ) { tdestroy(p,f) ; p=NULL; } } while (0)
 
@@ -57,6 +57,8 @@ extern struct internal_prop ip_S_V ;
 void Cache_Open(void);
 void Cache_Close(void);
 void Cache_Clear(void);
+void Cache_Housekeeping_Start(void);
+void Cache_Housekeeping_Stop(void);
 
 GOOD_OR_BAD OWQ_Cache_Add(const struct one_wire_query *owq);
 GOOD_OR_BAD Cache_Add_Dir(const struct dirblob *db, const struct parsedname *pn);
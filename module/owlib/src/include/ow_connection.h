@@ -111,7 +111,7 @@ See: http://www.iana.org/assignments/port-numbers
 #define ENET2_FIFO_SIZE 128
 #define HA5_FIFO_SIZE UART_FIFO_SIZE
 #define LINKE_FIFO_SIZE 1500
-#define I2C_FIFO_SIZE 1
+#define I2C_FIFO_SIZE 32
 
 #if USB_FIFO_SIZE > UART_FIFO_SIZE
 #define MAX_FIFO_SIZE USB_FIFO_SIZE
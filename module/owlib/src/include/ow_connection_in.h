@@ -115,12 +115,38 @@ enum e_bus_stat {
 	e_bus_select_errors,
 	e_bus_try_overdrive,
 	e_bus_failed_overdrive,
+	e_bus_pool_hits,
+	e_bus_pool_misses,
+	e_bus_transfers,
+	e_bus_transfer_bytes,
+	e_bus_combined,
+	e_bus_requests,
+	e_bus_queue_depth,
+	e_bus_queue_max,
 	e_bus_stat_last_marker
 };
 
 // Add serial/tcp/telnet abstraction
 #include "ow_communication.h"
 
+/* Transactions waiting for the bus (see BUS_transaction) */
+struct transaction_request ;
+struct transaction_queue {
+	pthread_mutex_t mutex;
+	pthread_cond_t done; // a transaction finished, or the bus is free again
+	struct transaction_request *head;
+	struct transaction_request *tail;
+	int running; // a thread holds the bus and runs the queue
+	/* Filesystem requests for this bus (see BUS_request_begin) */
+	pthread_cond_t admit; // a request finished, or the next one may start
+	UINT tickets; // requests arrived
+	UINT admitted; // requests let in so far, in arrival order
+	int requests; // requests working on the bus now
+};
+
+/* Reads in progress, shared by concurrent readers (see FS_r_given_bus) */
+struct read_flight ;
+
 struct connection_in {
 	struct connection_in *next;
 	struct port_in * pown ; // pointer to port_in that owns us.
@@ -133,6 +159,9 @@ struct connection_in {
 
 	pthread_mutex_t bus_mutex;
 	pthread_mutex_t dev_mutex;
+	struct transaction_queue transaction_queue;
+	pthread_mutex_t read_flight_mutex;
+	struct read_flight *read_flights;	// reads in progress on this bus
 	void *dev_db;				// dev-lock tree
 	enum e_reconnect reconnect_state;
 	struct timeval last_lock;	/* statistics */
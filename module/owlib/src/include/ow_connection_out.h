@@ -24,6 +24,23 @@
 /* Outbound connections (to web address or ownet client) */
 /* Called in ow_connection.h */
 
+/* Client connection for the request-at-a-time server loop (owserver) */
+struct server_connection {
+	struct server_connection *next; // work queue or parked list
+	struct server_connection *prev; // parked list
+	FILE_DESCRIPTOR_OR_ERROR file_descriptor;
+	int persistent; // holds a persistent connection slot (owserver accounting)
+	struct timeval idle; // set by the request routine: wait this long for another request (0 = close)
+	struct timeval idle_until; // while parked
+	int listener; // listening socket rather than a client
+	int parked; // waiting for the next request
+	int registered; // known to the event loop
+	struct request_pipeline *pipeline; // owserver: pipelined requests on this connection
+	BYTE *request; // next request, read as it arrives
+	size_t request_read; // bytes of it so far
+	size_t request_size; // allocated
+};
+
 /* Network connection structure */
 struct connection_out {
 	struct connection_out *next;
@@ -75,44 +75,99 @@ struct directory {
 	UINT entries;
 };
 
+/* enum cache_policy values (clock, reject) */
+#define CACHE_POLICIES 2
+
+/* Listing time of one bus: <1ms <10ms <100ms <1s <10s longer */
+#define DIR_LATENCY_BUCKETS 6
+
 #define AVERAGE_IN(pA)  ++(pA)->current; ++(pA)->count; (pA)->sum+=(pA)->current; if ((pA)->current>(pA)->max)++(pA)->max;
 #define AVERAGE_OUT(pA) --(pA)->current;
 #define AVERAGE_MARK(pA)  ++(pA)->count; (pA)->sum+=(pA)->current;
 #define AVERAGE_CLEAR(pA)  (pA)->current=0;
 
+/* Counters bumped on every read, write, cache lookup and directory listing.
+ * Each thread counts in its own block without locking. stat_total holds the
+ * counts of threads that have ended, and StatRead() adds up the blocks when a
+ * statistic is read.
+ * For the averages, only "current" is shared (stat_total, changed atomically);
+ * count, sum and max are kept per thread.
+ * */
+struct stat_counters {
+	UINT cache_adds;
+	struct average new_avg;
+	struct average store_avg;
+	struct cache_stats cache_ext;
+	struct cache_stats cache_int;
+	struct cache_stats cache_dir;
+	struct cache_stats cache_dev;
+	struct cache_stats cache_pst;
+	struct cache_stats cache_path;
+	UINT policy_tries[CACHE_POLICIES]; // volatile lookups, by the replacement policy in effect
+	UINT policy_hits[CACHE_POLICIES];
+
+	UINT read_calls;
+	UINT read_cache;
+	UINT read_cachebytes;
+	UINT read_bytes;
+	UINT read_array;
+	UINT read_tries[3];
+	UINT read_success;
+	UINT read_coalesced;
+	struct average read_avg;
+
+	UINT convert_polled; // conversions polled until done
+	UINT convert_learned; // of those, polled from the chip's usual time
+	UINT convert_msec; // total time of the polled conversions
+	UINT convert_max;
+
+	UINT write_calls;
+	UINT write_bytes;
+	UINT write_array;
+	UINT write_tries[3];
+	UINT write_success;
+	struct average write_avg;
+
+	struct directory dir_main;
+	struct directory dir_dev;
+	struct average dir_avg;
+	struct average dir_bus_avg; // buses being listed at once
+	UINT dir_bus_latency[DIR_LATENCY_BUCKETS];
+
+	struct average all_avg;
+
+	UINT CRC8_tries;
+	UINT CRC8_errors;
+	UINT CRC16_tries;
+	UINT CRC16_errors;
+};
+
+extern struct stat_counters stat_total;
+
+struct stat_counters * StatThread( void ) ;
+UINT StatRead( const UINT * counter ) ;
+UINT StatGauge( UINT * gauge, int change ) ;
+void StatAverageIn( struct average * mine, UINT * gauge ) ;
+void StatAverageMark( struct average * mine, UINT current ) ;
+
+/* This thread's copy of a counter (a field of struct stat_counters) */
+#define STAT_THREAD(field)         ( StatThread()->field )
+#define STAT_THREAD_ADD1(field)    ++STAT_THREAD(field)
+#define STAT_THREAD_ADD(field,n)   STAT_THREAD(field) += (n)
+
+/* Averages (requests in progress) */
+#define STAT_AVERAGE_IN(field)     StatAverageIn( &STAT_THREAD(field), &(stat_total.field.current) )
+#define STAT_AVERAGE_OUT(field)    StatGauge( &(stat_total.field.current), -1 )
+#define STAT_AVERAGE_MARK(field)   StatAverageMark( &STAT_THREAD(field), stat_total.field.current )
+
 extern UINT cache_flips;
-extern UINT cache_adds;
-extern struct average new_avg;
-extern struct average old_avg;
-extern struct average store_avg;
-extern struct cache_stats cache_ext;
-extern struct cache_stats cache_int;
-extern struct cache_stats cache_dir;
-extern struct cache_stats cache_dev;
-extern struct cache_stats cache_pst;
-
-extern UINT read_calls;
-extern UINT read_cache;
-extern UINT read_cachebytes;
-extern UINT read_bytes;
-extern UINT read_array;
-extern UINT read_tries[3];
-extern UINT read_success;
-extern struct average read_avg;
-
-extern UINT write_calls;
-extern UINT write_bytes;
-extern UINT write_array;
-extern UINT write_tries[3];
-extern UINT write_success;
-extern struct average write_avg;
-
-extern struct directory dir_main;
-extern struct directory dir_dev;
-extern UINT dir_depth;
-extern struct average dir_avg;
+extern UINT cache_purges;
+extern UINT cache_purged;
+extern UINT cache_evictions;
+extern struct timeval cache_purge_time;
+extern struct timeval cache_purge_max;
 
-extern struct average all_avg;
+extern UINT dir_depth;
 
 extern struct timeval max_delay;
 
@@ -120,12 +175,6 @@ extern struct timeval max_delay;
 extern UINT total_bus_locks;	// total number of locks
 extern UINT total_bus_unlocks;	// total number of unlocks
 
-// ow_crc.c
-extern UINT CRC8_tries;
-extern UINT CRC8_errors;
-extern UINT CRC16_tries;
-extern UINT CRC16_errors;
-
 // ow_net.c
 extern UINT NET_accept_errors;
 extern UINT NET_connection_errors;
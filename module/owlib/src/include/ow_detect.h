@@ -102,6 +102,13 @@ GOOD_OR_BAD W1_Browse( void ) ;
 
 #if OW_I2C
 GOOD_OR_BAD DS2482_detect(struct port_in * pin);
+
+/* i2c system calls of the DS2482 driver -- the tests put a mock adapter here */
+struct ds2482_i2c_calls {
+	FILE_DESCRIPTOR_OR_ERROR (*open) (const char * path, int flags) ;
+	int (*ioctl) (FILE_DESCRIPTOR_OR_ERROR file_descriptor, unsigned long request, void * arg) ;
+} ;
+extern struct ds2482_i2c_calls DS2482_i2c ;
 #endif							/* OW_I2C */
 
 #if OW_USB
@@ -69,6 +69,16 @@ ZERO_OR_ERROR FS_ParsedName(const char *fn, struct parsedname *pn);
 ZERO_OR_ERROR FS_ParsedName_BackFromRemote(const char *fn, struct parsedname *pn);
 void FS_ParsedName_destroy(struct parsedname *pn);
 void FS_ParsedName_Placeholder( struct parsedname * pn ) ;
+ZERO_OR_ERROR FS_ParsedNameDevice(const struct parsedname *pn_directory, const BYTE * sn, struct parsedname *pn);
+ZERO_OR_ERROR FS_ParsedNameProperty(const struct parsedname *pn_device_directory, struct filetype * ft, int extension, struct parsedname *pn);
+void ParsedName_Cache_Open( void ) ;
+void ParsedName_Cache_Close( void ) ;
+void ParsedName_Cache_Invalidate( void ) ;
+
+/* Parallel tasks (e.g. one per bus) on shared worker threads */
+void TaskPool_Open( void ) ;
+void TaskPool_Close( void ) ;
+void TaskPool_Run( void (*task) (void *), void * tasks, size_t task_size, int task_count ) ;
 
 size_t FileLength(const struct parsedname *pn);
 size_t FullFileLength(const struct parsedname *pn);
@@ -116,6 +126,7 @@ void Init_Pipe( FILE_DESCRIPTOR_OR_ERROR * pipe_fd ) ;
 void FS_LoadDirectoryOnly(struct parsedname *pn_directory, const struct parsedname *pn_original);
 
 GOOD_OR_BAD FS_Test_Simultaneous( const struct internal_prop *ip, UINT delay, const struct parsedname * pn) ;
+GOOD_OR_BAD OW_scratchpad_temperature(_FLOAT * temp, const char ** property, BYTE * data, const struct parsedname *pn) ;
 
 // ow_locks.c
 void LockSetup(void);
@@ -136,6 +147,8 @@ FILE_DESCRIPTOR_OR_ERROR ClientConnect(struct connection_in *in);
 void FreeClientAddr(struct connection_in *in);
 
 void ServerProcess(void (*HandlerRoutine) (FILE_DESCRIPTOR_OR_ERROR file_descriptor));
+void ServerProcessRequests(void (*RequestRoutine) (struct server_connection * sc), ssize_t (*LengthRoutine) (struct server_connection * sc), void (*CloseRoutine) (struct server_connection * sc));
+GOOD_OR_BAD ServerRequestTask(void (*routine) (void * arg), void * arg);
 GOOD_OR_BAD ServerOutSetup(struct connection_out *out);
 void InterruptListening( void ) ;
 
@@ -153,6 +166,9 @@ void FS_help(const char *arg);
 
 INDEX_OR_ERROR ServerPresence( struct parsedname *pn);
 SIZE_OR_ERROR ServerRead(struct one_wire_query *owq);
+ZERO_OR_ERROR ServerReadMany(struct one_wire_query ** owq_list, int count, SIZE_OR_ERROR * results);
+void ServerPoolSetup(struct connection_in *in);
+void ServerPoolClose(struct connection_in *in);
 ZERO_OR_ERROR ServerWrite(struct one_wire_query *owq);
 ZERO_OR_ERROR ServerDir(void (*dirfunc) (void *, const struct parsedname *), void *v, const struct parsedname *pn, uint32_t * flags);
 
@@ -166,6 +182,7 @@ SIZE_OR_ERROR FS_write_postparse(struct one_wire_query *owq);
 ZERO_OR_ERROR FS_write_local(struct one_wire_query *owq);
 
 SIZE_OR_ERROR FS_get(const char *path, char **return_buffer, size_t * buffer_length) ;
+ZERO_OR_ERROR FS_getmany(const char **paths, int count, char **return_buffers, SIZE_OR_ERROR * sizes) ;
 
 SIZE_OR_ERROR FS_read(const char *path, char *buf, const size_t size, const off_t offset);
 SIZE_OR_ERROR FS_read_postparse(struct one_wire_query *owq);
@@ -173,6 +190,7 @@ ZERO_OR_ERROR FS_read_fake(struct one_wire_query *owq);
 ZERO_OR_ERROR FS_read_tester(struct one_wire_query *owq);
 ZERO_OR_ERROR FS_r_aggregate_all(struct one_wire_query *owq);
 SIZE_OR_ERROR FS_read_local( struct one_wire_query *owq);
+SIZE_OR_ERROR FS_read_fromcache( struct one_wire_query *owq);
 
 size_t FileLength_vascii(struct one_wire_query *owq);
 
@@ -60,6 +60,9 @@
 
 enum zero_support { zero_unknown, zero_none, zero_bonjour, zero_avahi, } ;
 
+/* What to do when the cache is full (cache_size reached) */
+enum cache_policy { cache_policy_clock, cache_policy_reject, } ;
+
 enum enum_program_type { 
 	program_type_filesystem, program_type_server, program_type_httpd, program_type_ftpd, program_type_external, 
 	program_type_tcl, program_type_swig, program_type_clibrary, 
@@ -100,10 +103,12 @@ struct global {
 	int readonly;
 	int max_clients;			// for ftp
 	size_t cache_size;			// max cache size (or 0 for no max) ;
+	enum cache_policy cache_policy ; // evict cold entries or refuse new ones when full
 	int one_device;				// Single device, use faster ROM comands
 	/* Special parameter to trigger William Robison <ibutton@n952.dyndns.ws> timings */
 	int altUSB;
 	int usb_flextime;
+	int usb_sync; // DS9490 block I/O one packet at a time, no asynchronous reads
 	int serial_flextime;
 	int serial_reverse; // reverse polarity ?
 	int serial_hardflow ; // hardware flow control
@@ -123,6 +128,11 @@ struct global {
 	int timeout_persistent_high;
 	int clients_persistent_low;
 	int clients_persistent_high;
+	int server_threads; // owserver request workers
+	int server_pool; // persistent connections kept per owserver
+	int server_pool_idle; // seconds before an unused pooled connection is closed
+	int pool_threads; // workers for parallel bus tasks (directory fan-out)
+	int bus_requests; // filesystem requests working on one bus at once
 	int pingcrazy;
 	int no_dirall;
 	int no_get;
@@ -25,11 +25,21 @@
 
 /* included in ow_connection.h as the bus-master specific portion of the connection_in structure */
 
+struct server_pool_slot {
+	FILE_DESCRIPTOR_OR_ERROR file_descriptor ;
+	struct timeval idle_until ; // close if still unused by then
+} ;
+
 struct master_server {
 	char *type;					// for zeroconf
 	char *domain;				// for zeroconf
 	char *name;					// zeroconf name
 	int no_dirall;				// flag that server doesn't support DIRALL
+	int no_getmany;				// flag that server doesn't support GETMANY
+	struct server_pool_slot * pool ; // idle persistent connections, oldest first
+	int pool_idle ;				// connections waiting in pool
+	int pool_busy ;				// persistent connections in use
+	int pool_closing ;			// bus closing: connections close on release, pool freed by the last
 } ;
 
 struct master_serial {
@@ -82,6 +92,11 @@ struct master_i2c {
 	/* only one per chip, the bus entries for the other 7 channels point to the first one */
 	int current;
 	struct connection_in *head;
+	/* status bytes read after each 1-Wire reset, byte and triplet,
+	   at standard and overdrive speed -- learned in ow_ds2482.c (head only) */
+	int status_reads[2][3];
+	/* adapter does plain i2c (I2C_RDWR), not just SMBus (head only) */
+	int plain_i2c;
 };
 
 // HobbyBoards Master Hub
@@ -70,6 +70,7 @@ extern struct mutexes {
 	pthread_mutex_t externalcount_mutex;
 	pthread_mutex_t timegm_mutex;
 	pthread_mutex_t detail_mutex;
+	pthread_mutex_t slab_mutex[OWSLAB_CLASSES];
 	
 	pthread_mutexattr_t mattr; // mutex attribute -- used for all mutexes
 	my_rwlock_t lib;
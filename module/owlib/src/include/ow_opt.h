@@ -57,7 +57,7 @@ GOOD_OR_BAD owopt_packed(const char *params);
 
 // All these command line arguments are after the printable ascii characters
 enum e_long_option { e_error_print = 257, e_error_level, e_debug,
-	e_cache_size,
+	e_cache_size, e_cache_policy,
 	e_fuse_opt, e_fuse_open_opt,
 	e_max_clients,
 	e_safemode,
@@ -70,6 +70,10 @@ enum e_long_option { e_error_print = 257, e_error_level, e_debug,
 	e_timeout_volatile, e_timeout_stable, e_timeout_directory, e_timeout_presence,
 	e_timeout_serial, e_timeout_usb, e_timeout_network, e_timeout_server, e_timeout_ftp, e_timeout_ha7, e_timeout_w1,
 	e_timeout_persistent_low, e_timeout_persistent_high, e_clients_persistent_low, e_clients_persistent_high,
+	e_server_threads,
+	e_server_pool, e_server_pool_idle,
+	e_pool_threads,
+	e_bus_requests_limit,
 	e_fatal_debug_file,
 	e_baud,
 	e_templow, e_temphigh,
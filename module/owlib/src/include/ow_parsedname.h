@@ -159,6 +159,7 @@ struct parsedname {
 #define UNCACHED                    ( (UINT) 0x00000020 )
 #define TRIM                        ( (UINT) 0x00000040 )
 #define OWNET                       ( (UINT) 0x00000100 )
+#define PIPELINE_MASK               ( (UINT) 0x00000200 )
 #define TEMPSCALE_MASK              ( (UINT) 0x00030000 )
 #define TEMPSCALE_BIT      16
 #define PRESSURESCALE_MASK          ( (UINT) 0x001C0000 )
@@ -19,6 +19,7 @@
 /* -------- Structures ---------- */
 DeviceHeader(set_timeout);
 DeviceHeader(set_units);
+DeviceHeader(set_cache);
 DeviceHeader(set_alias);
 DeviceHeader(set_return_code);
 
@@ -19,4 +19,7 @@
 /* -------- Structures ---------- */
 DeviceHeader(simultaneous);
 
+/* Every bus in turn unless /bus.n is given, so ow_read calls it directly */
+ZERO_OR_ERROR FS_r_temperature_all(struct one_wire_query *owq);
+
 #endif							/* OW_SIMULTANEOUS */
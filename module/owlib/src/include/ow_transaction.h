@@ -145,5 +145,9 @@ struct transaction_log {
 
 GOOD_OR_BAD BUS_transaction(const struct transaction_log *tl, const struct parsedname *pn);
 GOOD_OR_BAD BUS_transaction_nolock(const struct transaction_log *tl, const struct parsedname *pn);
+void Transaction_queue_init(struct connection_in *in);
+void Transaction_queue_destroy(struct connection_in *in);
+void BUS_request_begin(struct connection_in *in);
+void BUS_request_end(struct connection_in *in);
 
 #endif							/* OW_TRANSACTION_H */
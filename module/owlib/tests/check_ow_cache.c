@@ -0,0 +1,97 @@
+#include "ow_testhelper.h"
+
+// Threaded lookups in the volatile cache -- correctness, and lookups/sec on stdout
+#define CACHE_DEVICES 1024
+#define CACHE_LOOKUPS 200000 // per thread
+#define CACHE_MAX_THREADS 8
+
+struct cache_lookups {
+	pthread_t thread ;
+	int seed ;
+	int misses ;
+} ;
+
+static void cache_sn(BYTE * sn, int device)
+{
+	memset(sn, 0, SERIAL_NUMBER_SIZE) ;
+	sn[0] = 0x10 ;
+	sn[1] = device & 0xFF ;
+	sn[2] = (device >> 8) & 0xFF ;
+	sn[7] = 0x01 ;
+}
+
+static void * cache_lookup_loop(void * v)
+{
+	struct cache_lookups * cl = v ;
+	struct parsedname pn ;
+	int lookup ;
+
+	memset(&pn, 0, sizeof(struct parsedname)) ;
+	for ( lookup = 0 ; lookup < CACHE_LOOKUPS ; ++lookup ) {
+		int device = ( cl->seed + lookup * 7 ) % CACHE_DEVICES ;
+		int bus_nr = -1 ;
+
+		cache_sn(pn.sn, device) ;
+		if ( BAD( Cache_Get_Device(&bus_nr, &pn) ) || bus_nr != device % 4 ) {
+			++cl->misses ;
+		}
+	}
+	return NULL ;
+}
+
+// Same lookups from 1, 2, 4 and 8 threads at once
+START_TEST(test_Cache_lookup_threads)
+{
+	struct cache_lookups cl[CACHE_MAX_THREADS] ;
+	enum e_err_level error_level = Globals.error_level ;
+	int device ;
+	int threads ;
+
+	// a debug line per lookup would be the benchmark
+	Globals.error_level = e_err_default ;
+
+	for ( device = 0 ; device < CACHE_DEVICES ; ++device ) {
+		BYTE sn[SERIAL_NUMBER_SIZE] ;
+		cache_sn(sn, device) ;
+		ck_assert_int_eq(gbGOOD, Cache_Add_Device(device % 4, sn)) ;
+	}
+
+	for ( threads = 1 ; threads <= CACHE_MAX_THREADS ; threads *= 2 ) {
+		struct timeval start, end ;
+		double seconds ;
+		int thread ;
+
+		gettimeofday(&start, NULL) ;
+		for ( thread = 0 ; thread < threads ; ++thread ) {
+			cl[thread].seed = thread * 131 ;
+			cl[thread].misses = 0 ;
+			ck_assert_int_eq(0, pthread_create(&cl[thread].thread, DEFAULT_THREAD_ATTR, cache_lookup_loop, &cl[thread])) ;
+		}
+		for ( thread = 0 ; thread < threads ; ++thread ) {
+			pthread_join(cl[thread].thread, NULL) ;
+			ck_assert_int_eq(0, cl[thread].misses) ;
+		}
+		gettimeofday(&end, NULL) ;
+
+		seconds = (end.tv_sec - start.tv_sec) + (end.tv_usec - start.tv_usec) / 1000000.0 ;
+		printf("Cache lookups: %d thread%s %10.0f/sec\n", threads, threads == 1 ? " " : "s", threads * CACHE_LOOKUPS / seconds) ;
+	}
+
+	Cache_Clear() ;
+	Globals.error_level = error_level ;
+}
+END_TEST
+
+// Create test-suite
+Suite* ow_cache_suite(void) {
+	Suite *s;
+	TCase *tc;
+
+	s = suite_create("Owfs");
+	tc = tcase_create("cache");
+
+	tcase_add_checked_fixture(tc, owlib_test_setup, owlib_test_teardown);
+	suite_add_tcase (s, tc);
+	tcase_add_test(tc, test_Cache_lookup_threads);
+	return s;
+}
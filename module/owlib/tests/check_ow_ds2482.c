@@ -0,0 +1,272 @@
+#include "ow_testhelper.h"
+#include "ow_connection.h"
+
+#if OW_I2C
+
+#include "i2c-dev.h"
+
+// Mock DS2482-100 at i2c address 0x18 behind DS2482_i2c
+#define MOCK_ADDRESS 0x18
+
+#define MOCK_STATUS   0xF0
+#define MOCK_DATA     0xE1
+#define MOCK_CONFIG   0xC3
+
+static struct {
+	int plain_i2c ;	// adapter does I2C_RDWR (I2C_FUNC_I2C)
+	int busy ;		// status reads each 1-Wire command stays busy for
+	int address ;
+	int pointer ;
+	BYTE status ;
+	BYTE data ;
+	BYTE config ;
+	int busy_left ;
+	int rdwr_calls ;
+	int smbus_calls ;
+} mock ;
+
+static void mock_busy(BYTE status)
+{
+	mock.status = status ;
+	mock.busy_left = mock.busy ;
+	mock.pointer = MOCK_STATUS ;
+}
+
+// One byte written (a command, or command and parameter)
+static int mock_write(const BYTE * buf, int len)
+{
+	switch (buf[0]) {
+	case 0xF0: // device reset
+		mock.config = 0x00 ;
+		mock.status = 0x18 ; // LL | RST
+		mock.busy_left = 0 ;
+		mock.pointer = MOCK_STATUS ;
+		return 0 ;
+	case 0xE1: // set read pointer
+		if (len < 2 || (buf[1] != MOCK_STATUS && buf[1] != MOCK_DATA && buf[1] != MOCK_CONFIG)) {
+			return -1 ; // NACK -- not a DS2483 register
+		}
+		mock.pointer = buf[1] ;
+		return 0 ;
+	case 0xD2: // write configuration
+		if (len < 2 || ((buf[1] ^ (buf[1] >> 4)) & 0x0F) != 0x0F) {
+			return -1 ;
+		}
+		mock.config = buf[1] & 0x0F ;
+		mock.pointer = MOCK_CONFIG ;
+		return 0 ;
+	case 0xB4: // 1-Wire reset, one device present
+		mock_busy(0x02) ; // PPD
+		return 0 ;
+	case 0xA5: // 1-Wire write byte, read slots answer 0x5A
+		if (len < 2) {
+			return -1 ;
+		}
+		mock.data = (buf[1] == 0xFF) ? 0x5A : buf[1] ;
+		mock_busy(0x00) ;
+		return 0 ;
+	case 0x78: // triplet, a 0 bit read and the direction taken
+		if (len < 2) {
+			return -1 ;
+		}
+		mock_busy((buf[1] & 0x80) ? 0x80 : 0x00) ;
+		return 0 ;
+	default: // channel select and the rest -- not on a DS2482-100
+		return -1 ;
+	}
+}
+
+static BYTE mock_read(void)
+{
+	switch (mock.pointer) {
+	case MOCK_DATA:
+		return mock.data ;
+	case MOCK_CONFIG:
+		return mock.config ;
+	default:
+		if (mock.busy_left > 0) {
+			--mock.busy_left ;
+			return mock.status | 0x01 ; // 1WB
+		}
+		return mock.status ;
+	}
+}
+
+static FILE_DESCRIPTOR_OR_ERROR mock_open(const char * path, int flags)
+{
+	(void) path ;
+	(void) flags ;
+	return open("/dev/null", O_RDWR) ;
+}
+
+static int mock_ioctl(FILE_DESCRIPTOR_OR_ERROR file_descriptor, unsigned long request, void * arg)
+{
+	(void) file_descriptor ;
+	switch (request) {
+	case I2C_SLAVE:
+		mock.address = (int) (long) arg ;
+		return 0 ;
+	case I2C_FUNCS:
+		*(unsigned long *) arg = mock.plain_i2c ? (I2C_FUNC_I2C | 0x00060000) : 0x00060000 ;
+		return 0 ;
+	case I2C_SMBUS:
+		{
+			struct i2c_smbus_ioctl_data * smbus = arg ;
+			BYTE buf[2] = { smbus->command, smbus->data ? smbus->data->byte : 0, } ;
+			++mock.smbus_calls ;
+			if (mock.address != MOCK_ADDRESS) {
+				return -1 ;
+			}
+			if (smbus->read_write == I2C_SMBUS_READ) {
+				smbus->data->byte = mock_read() ;
+				return 0 ;
+			}
+			return mock_write(buf, (smbus->size == I2C_SMBUS_BYTE) ? 1 : 2) ;
+		}
+	case I2C_RDWR:
+		{
+			struct i2c_rdwr_ioctl_data * rdwr = arg ;
+			unsigned int m ;
+			++mock.rdwr_calls ;
+			if (!mock.plain_i2c) {
+				return -1 ;
+			}
+			for (m = 0; m < rdwr->nmsgs; ++m) {
+				struct i2c_msg * msg = &rdwr->msgs[m] ;
+				int i ;
+				if (msg->addr != MOCK_ADDRESS) {
+					return -1 ;
+				}
+				if (msg->flags & I2C_M_RD) {
+					for (i = 0; i < msg->len; ++i) {
+						msg->buf[i] = mock_read() ;
+					}
+				} else if (mock_write((BYTE *) msg->buf, msg->len) < 0) {
+					return -1 ;
+				}
+			}
+			return rdwr->nmsgs ;
+		}
+	default:
+		return -1 ;
+	}
+}
+
+static struct port_in * mock_pin ;
+
+static void setup_mock_ds2482(int plain_i2c, int busy, struct parsedname * pn)
+{
+	memset(&mock, 0, sizeof(mock)) ;
+	mock.plain_i2c = plain_i2c ;
+	mock.busy = busy ;
+	DS2482_i2c.open = mock_open ;
+	DS2482_i2c.ioctl = mock_ioctl ;
+
+	mock_pin = NewPort(NULL) ;
+	ck_assert(mock_pin != NULL) ;
+	mock_pin->busmode = bus_i2c ;
+	mock_pin->init_data = owstrdup("/dev/i2c-mock:0") ;
+	ck_assert_int_eq(gbGOOD, DS2482_detect(mock_pin)) ;
+
+	memset(pn, 0, sizeof(struct parsedname)) ;
+	pn->selected_connection = mock_pin->first ;
+}
+
+static void teardown_mock_ds2482(void)
+{
+	RemovePort(mock_pin) ;
+	mock_pin = NULL ;
+}
+
+// Reset and bytes in combined transfers, no SMBus calls for them
+START_TEST(test_DS2482_plain_i2c)
+{
+	struct parsedname pn ;
+	BYTE data[] = { 0x55, 0xCC, 0xBE, 0xFF, 0xFF, 0xFF, } ;
+	BYTE resp[sizeof(data)] ;
+	int smbus_calls ;
+
+	setup_mock_ds2482(1, 2, &pn) ;
+	ck_assert_int_eq(1, mock_pin->first->master.i2c.plain_i2c) ;
+	ck_assert_int_eq(adapter_DS2482_100, mock_pin->first->Adapter) ;
+
+	// the first channel select also writes the configuration register
+	ck_assert_int_eq(BUS_RESET_OK, mock_pin->first->iroutines.reset(&pn)) ;
+	ck_assert_int_eq(anydevices_yes, mock_pin->first->AnyDevices) ;
+	ck_assert_int_eq(1, mock.rdwr_calls) ;
+	smbus_calls = mock.smbus_calls ;
+
+	// timing not yet known -- a byte at a time, then batched
+	ck_assert_int_eq(gbGOOD, mock_pin->first->iroutines.sendback_data(data, resp, 1, &pn)) ;
+	ck_assert_int_eq(gbGOOD, mock_pin->first->iroutines.sendback_data(data, resp, sizeof(data), &pn)) ;
+	ck_assert_int_eq(0x55, resp[0]) ;
+	ck_assert_int_eq(0xBE, resp[2]) ;
+	ck_assert_int_eq(0x5A, resp[5]) ;
+	ck_assert_int_eq(3, mock.rdwr_calls) ;
+	ck_assert_int_eq(smbus_calls, mock.smbus_calls) ;
+
+	teardown_mock_ds2482() ;
+}
+END_TEST
+
+// SMBus only adapter -- the same traffic without I2C_RDWR
+START_TEST(test_DS2482_smbus_only)
+{
+	struct parsedname pn ;
+	BYTE data[] = { 0x55, 0xCC, 0xBE, 0xFF, } ;
+	BYTE resp[sizeof(data)] ;
+
+	setup_mock_ds2482(0, 2, &pn) ;
+	ck_assert_int_eq(0, mock_pin->first->master.i2c.plain_i2c) ;
+
+	ck_assert_int_eq(BUS_RESET_OK, mock_pin->first->iroutines.reset(&pn)) ;
+	ck_assert_int_eq(anydevices_yes, mock_pin->first->AnyDevices) ;
+	ck_assert_int_eq(gbGOOD, mock_pin->first->iroutines.sendback_data(data, resp, sizeof(data), &pn)) ;
+	ck_assert_int_eq(0x55, resp[0]) ;
+	ck_assert_int_eq(0xBE, resp[2]) ;
+	ck_assert_int_eq(0x5A, resp[3]) ;
+	ck_assert_int_eq(0, mock.rdwr_calls) ;
+
+	teardown_mock_ds2482() ;
+}
+END_TEST
+
+// A reset busy for longer than the first guess (56 reads) is finished by polling, and learned
+START_TEST(test_DS2482_learn_busy)
+{
+	struct parsedname pn ;
+	int * status_reads ;
+
+	setup_mock_ds2482(1, 58, &pn) ;
+	status_reads = mock_pin->first->master.i2c.status_reads[0] ;
+
+	ck_assert_int_eq(BUS_RESET_OK, mock_pin->first->iroutines.reset(&pn)) ;
+	ck_assert_int_eq(anydevices_yes, mock_pin->first->AnyDevices) ;
+	ck_assert(status_reads[0] < 0) ; // not enough -- a trial count
+
+	ck_assert_int_eq(BUS_RESET_OK, mock_pin->first->iroutines.reset(&pn)) ;
+	ck_assert(status_reads[0] > 58) ;
+
+	teardown_mock_ds2482() ;
+}
+END_TEST
+
+#endif							/* OW_I2C */
+
+// Create test-suite
+Suite* ow_ds2482_suite(void) {
+	Suite *s;
+	TCase *tc;
+
+	s = suite_create("Owfs");
+	tc = tcase_create("ds2482");
+
+	tcase_add_checked_fixture(tc, owlib_test_setup, owlib_test_teardown);
+	suite_add_tcase (s, tc);
+#if OW_I2C
+	tcase_add_test(tc, test_DS2482_plain_i2c);
+	tcase_add_test(tc, test_DS2482_smbus_only);
+	tcase_add_test(tc, test_DS2482_learn_busy);
+#endif							/* OW_I2C */
+	return s;
+}
@@ -0,0 +1,212 @@
+#include "ow_testhelper.h"
+
+// Same fake LCD device as check_ow_parseinput.c
+static void add_lcd_device() {
+	const BYTE addr[] = {0xFF,0xAA,0xAA,0xAA,0x00,0x00,0x00,0xA9};
+	ck_assert_int_eq(gbGOOD, Cache_Add_Device(0, addr));
+}
+
+// Serial number without dot, lower case and with the CRC byte
+START_TEST(test_FS_ParsedName_sn_forms)
+{
+	const BYTE addr[] = {0xFF,0xAA,0xAA,0xAA,0x00,0x00,0x00,0xA9};
+	struct parsedname pn;
+
+	add_lcd_device();
+	ck_assert_int_eq(0, FS_ParsedName("/ffaaaaaa000000a9/line20.3", &pn));
+	ck_assert(!memcmp(addr, pn.sn, SERIAL_NUMBER_SIZE));
+	ck_assert_int_eq(ePN_real, pn.type);
+	ck_assert_int_eq(3, pn.extension);
+	FS_ParsedName_destroy(&pn);
+
+	// Wrong CRC byte
+	ck_assert_int_ne(0, FS_ParsedName("/FF.AAAAAA000000.00/line20.3", &pn));
+}
+END_TEST
+
+// .ALL and .BYTE are matched case-insensitively, out-of-range index rejected
+START_TEST(test_FS_ParsedName_extensions)
+{
+	struct parsedname pn;
+
+	add_lcd_device();
+	ck_assert_int_eq(0, FS_ParsedName("/FF.AAAAAA000000/line20.all", &pn));
+	ck_assert_int_eq(EXTENSION_ALL, pn.extension);
+	FS_ParsedName_destroy(&pn);
+
+	ck_assert_int_ne(0, FS_ParsedName("/FF.AAAAAA000000/line20.4", &pn));
+}
+END_TEST
+
+// Top-level keywords must match the whole segment
+START_TEST(test_FS_ParsedName_keywords)
+{
+	struct parsedname pn;
+
+	ck_assert_int_eq(0, FS_ParsedName("/STRUCTURE", &pn));
+	ck_assert_int_eq(ePN_structure, pn.type);
+	FS_ParsedName_destroy(&pn);
+
+	ck_assert_int_eq(0, FS_ParsedName("/settings", &pn));
+	ck_assert_int_eq(ePN_settings, pn.type);
+	FS_ParsedName_destroy(&pn);
+
+	ck_assert_int_ne(0, FS_ParsedName("/settingsX", &pn));
+}
+END_TEST
+
+// A second parse of the same path comes from the path cache
+START_TEST(test_FS_ParsedName_cache_hit)
+{
+	const BYTE addr[] = {0xFF,0xAA,0xAA,0xAA,0x00,0x00,0x00,0xA9};
+	struct parsedname pn;
+	UINT hits;
+
+	add_lcd_device();
+	ck_assert_int_eq(0, FS_ParsedName("/FF.AAAAAA000000/line20.3", &pn));
+	FS_ParsedName_destroy(&pn);
+
+	hits = STAT_THREAD(cache_path.hits);
+	ck_assert_int_eq(0, FS_ParsedName("/FF.AAAAAA000000/line20.3", &pn));
+	ck_assert_int_eq(hits + 1, STAT_THREAD(cache_path.hits));
+	ck_assert(!memcmp(addr, pn.sn, SERIAL_NUMBER_SIZE));
+	ck_assert_int_eq(ePN_real, pn.type);
+	ck_assert_int_eq(3, pn.extension);
+	ck_assert_str_eq("line20", pn.selected_filetype->name);
+	FS_ParsedName_destroy(&pn);
+}
+END_TEST
+
+// The same alias again keeps cached parses, a changed one drops them
+START_TEST(test_FS_ParsedName_cache_alias)
+{
+	const BYTE addr[] = {0xFF,0xAA,0xAA,0xAA,0x00,0x00,0x00,0xA9};
+	const BYTE addr2[] = {0xFF,0xBB,0xBB,0xBB,0x00,0x00,0x00,0x3C};
+	struct parsedname pn;
+	UINT hits;
+
+	add_lcd_device();
+	ck_assert_int_eq(gbGOOD, Cache_Add_Device(0, addr2));
+	ck_assert_int_eq(gbGOOD, Cache_Add_Alias("display", addr));
+	ck_assert_int_eq(0, FS_ParsedName("/display/line20.3", &pn));
+	ck_assert(!memcmp(addr, pn.sn, SERIAL_NUMBER_SIZE));
+	FS_ParsedName_destroy(&pn);
+
+	ck_assert_int_eq(gbGOOD, Cache_Add_Alias("display", addr));
+	hits = STAT_THREAD(cache_path.hits);
+	ck_assert_int_eq(0, FS_ParsedName("/display/line20.3", &pn));
+	ck_assert_int_eq(hits + 1, STAT_THREAD(cache_path.hits));
+	FS_ParsedName_destroy(&pn);
+
+	Cache_Del_Alias(addr);
+	ck_assert_int_eq(gbGOOD, Cache_Add_Alias("display", addr2));
+	hits = STAT_THREAD(cache_path.hits);
+	ck_assert_int_eq(0, FS_ParsedName("/display/line20.3", &pn));
+	ck_assert_int_eq(hits, STAT_THREAD(cache_path.hits));
+	ck_assert(!memcmp(addr2, pn.sn, SERIAL_NUMBER_SIZE));
+	FS_ParsedName_destroy(&pn);
+	Cache_Del_Alias(addr2);
+}
+END_TEST
+
+// Adding or removing a bus drops cached parses
+START_TEST(test_FS_ParsedName_cache_bus)
+{
+	struct port_in * pin;
+	struct parsedname pn;
+	UINT hits;
+
+	add_lcd_device();
+	ck_assert_int_eq(0, FS_ParsedName("/FF.AAAAAA000000/line20.3", &pn));
+	FS_ParsedName_destroy(&pn);
+
+	pin = NewPort(NULL);
+	ck_assert(pin != NULL);
+	hits = STAT_THREAD(cache_path.hits);
+	ck_assert_int_eq(0, FS_ParsedName("/FF.AAAAAA000000/line20.3", &pn));
+	ck_assert_int_eq(hits, STAT_THREAD(cache_path.hits));
+	FS_ParsedName_destroy(&pn);
+
+	// cached again
+	ck_assert_int_eq(0, FS_ParsedName("/FF.AAAAAA000000/line20.3", &pn));
+	ck_assert_int_eq(hits + 1, STAT_THREAD(cache_path.hits));
+	FS_ParsedName_destroy(&pn);
+
+	RemovePort(pin);
+	ck_assert_int_eq(0, FS_ParsedName("/FF.AAAAAA000000/line20.3", &pn));
+	ck_assert_int_eq(hits + 1, STAT_THREAD(cache_path.hits));
+	FS_ParsedName_destroy(&pn);
+}
+END_TEST
+
+// Parses/sec over representative paths on stdout, each parsed in full and from the path cache
+#define PARSE_ROUNDS 20000
+
+static const char * parse_paths[] = {
+	"/",
+	"/FF.AAAAAA000000/line20.3",
+	"/ffaaaaaa000000a9/line20.ALL",
+	"/uncached/FF.AAAAAA000000/line20.1",
+	"/FF.AAAAAA000000",
+	"/structure/FF/line20.3",
+	"/settings/timeout/volatile",
+	"/statistics/read/calls",
+	"/simultaneous/temperature",
+	NULL,
+} ;
+
+static double parse_rate(int invalidate)
+{
+	struct timeval start, end ;
+	int parses = 0 ;
+	int round ;
+
+	gettimeofday(&start, NULL) ;
+	for ( round = 0 ; round < PARSE_ROUNDS ; ++round ) {
+		const char ** path ;
+		for ( path = parse_paths ; *path != NULL ; ++path ) {
+			struct parsedname pn ;
+			if ( invalidate ) {
+				ParsedName_Cache_Invalidate() ;
+			}
+			ck_assert_int_eq(0, FS_ParsedName(*path, &pn)) ;
+			FS_ParsedName_destroy(&pn) ;
+			++parses ;
+		}
+	}
+	gettimeofday(&end, NULL) ;
+	return parses / ( (end.tv_sec - start.tv_sec) + (end.tv_usec - start.tv_usec) / 1000000.0 ) ;
+}
+
+START_TEST(test_FS_ParsedName_rate)
+{
+	enum e_err_level error_level = Globals.error_level ;
+
+	// a debug line per parse would be the benchmark
+	Globals.error_level = e_err_default ;
+	add_lcd_device();
+	printf("Path parses: full %10.0f/sec\n", parse_rate(1)) ;
+	printf("Path parses: cached %8.0f/sec\n", parse_rate(0)) ;
+	Globals.error_level = error_level ;
+}
+END_TEST
+
+// Create test-suite
+Suite* ow_parsename_suite(void) {
+	Suite *s;
+	TCase *tc;
+
+	s = suite_create("Owfs");
+	tc = tcase_create("parsename");
+
+	tcase_add_checked_fixture(tc, owlib_test_setup, owlib_test_teardown);
+	suite_add_tcase (s, tc);
+	tcase_add_test(tc, test_FS_ParsedName_sn_forms);
+	tcase_add_test(tc, test_FS_ParsedName_extensions);
+	tcase_add_test(tc, test_FS_ParsedName_keywords);
+	tcase_add_test(tc, test_FS_ParsedName_cache_hit);
+	tcase_add_test(tc, test_FS_ParsedName_cache_alias);
+	tcase_add_test(tc, test_FS_ParsedName_cache_bus);
+	tcase_add_test(tc, test_FS_ParsedName_rate);
+	return s;
+}
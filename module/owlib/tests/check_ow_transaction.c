@@ -0,0 +1,121 @@
+#include "ow_testhelper.h"
+#include "ow_connection.h"
+
+// Bus master that counts resets, answers 0x5A to read slots and echoes the rest
+static int mock_resets ;
+static int mock_corrupt ; // change the echo of this byte (1-based, 0 for none)
+
+static RESET_TYPE mock_reset(const struct parsedname *pn) {
+	(void) pn ;
+	++mock_resets ;
+	return BUS_RESET_OK ;
+}
+
+static GOOD_OR_BAD mock_sendback_data(const BYTE * data, BYTE * resp, const size_t len, const struct parsedname *pn) {
+	size_t i ;
+	(void) pn ;
+	for ( i = 0 ; i < len ; ++i ) {
+		resp[i] = ( data[i] == 0xFF ) ? 0x5A : data[i] ;
+	}
+	if ( mock_corrupt > 0 && (size_t) mock_corrupt <= len ) {
+		resp[mock_corrupt-1] ^= 0x01 ;
+	}
+	return gbGOOD ;
+}
+
+static struct device d_mock = { "10", "DS18S20", 0, 0, NULL, NO_GENERIC_READ, NO_GENERIC_WRITE };
+static struct port_in mock_pin ;
+static struct connection_in mock_in ;
+
+static void setup_mock_bus(struct parsedname * pn) {
+	const BYTE sn[] = {0x10,0x01,0x02,0x03,0x04,0x05,0x06,0x00};
+
+	memset(&mock_pin, 0, sizeof(struct port_in));
+	mock_pin.busmode = bus_serial;
+	mock_pin.connections = 1;
+	memset(&mock_in, 0, sizeof(struct connection_in));
+	mock_in.pown = &mock_pin;
+	mock_in.iroutines.reset = mock_reset;
+	mock_in.iroutines.sendback_data = mock_sendback_data;
+	mock_in.iroutines.select = NO_SELECT_ROUTINE;
+	mock_in.bundling_length = UART_FIFO_SIZE;
+	mock_in.branch.branch = eBranch_cleared;
+	_MUTEX_INIT(mock_in.bus_mutex);
+	Transaction_queue_init(&mock_in);
+	mock_resets = mock_corrupt = 0;
+
+	memset(pn, 0, sizeof(struct parsedname));
+	pn->selected_connection = &mock_in;
+	pn->selected_device = &d_mock;
+	memcpy(pn->sn, sn, SERIAL_NUMBER_SIZE);
+}
+
+static void teardown_mock_bus(void) {
+	Transaction_queue_destroy(&mock_in);
+	_MUTEX_DESTROY(mock_in.bus_mutex);
+}
+
+// Select, command and scratchpad read: one reset and one sendback of 9+1+9 bytes
+START_TEST(test_BUS_transaction_run)
+{
+	struct parsedname pn;
+	BYTE cmd[] = { 0xBE, };
+	BYTE data[9];
+	struct transaction_log t[] = {
+		TRXN_START,
+		TRXN_WRITE1(cmd),
+		TRXN_READ(data, 9),
+		TRXN_END,
+	};
+	int i;
+
+	setup_mock_bus(&pn);
+	ck_assert_int_eq(gbGOOD, BUS_transaction(t, &pn));
+	ck_assert_int_eq(1, mock_resets);
+	ck_assert_int_eq(1, mock_in.bus_stat[e_bus_transfers]);
+	ck_assert_int_eq(19, mock_in.bus_stat[e_bus_transfer_bytes]);
+	for ( i = 0 ; i < 9 ; ++i ) {
+		ck_assert_int_eq(0x5A, data[i]);
+	}
+	teardown_mock_bus();
+}
+END_TEST
+
+// A wrong echo of the match ROM bytes or of a command fails the transaction
+START_TEST(test_BUS_transaction_run_mismatch)
+{
+	struct parsedname pn;
+	BYTE cmd[] = { 0xBE, };
+	BYTE data[9];
+	struct transaction_log t[] = {
+		TRXN_START,
+		TRXN_WRITE1(cmd),
+		TRXN_READ(data, 9),
+		TRXN_END,
+	};
+
+	setup_mock_bus(&pn);
+	mock_corrupt = 3 ; // serial number
+	ck_assert_int_eq(gbBAD, BUS_transaction(t, &pn));
+	ck_assert_int_eq(1, mock_in.bus_stat[e_bus_select_errors]);
+
+	mock_corrupt = 10 ; // command
+	ck_assert_int_eq(gbBAD, BUS_transaction(t, &pn));
+	teardown_mock_bus();
+}
+END_TEST
+
+// Create test-suite
+Suite* ow_transaction_suite(void) {
+	Suite *s;
+	TCase *tc;
+
+	s = suite_create("Owfs");
+	tc = tcase_create("transaction");
+
+	tcase_add_checked_fixture(tc, owlib_test_setup, owlib_test_teardown);
+	suite_add_tcase (s, tc);
+	tcase_add_test(tc, test_BUS_transaction_run);
+	tcase_add_test(tc, test_BUS_transaction_run_mismatch);
+	return s;
+}
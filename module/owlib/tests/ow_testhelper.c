@@ -15,6 +15,8 @@ void owlib_test_setup(void) {
 	LockSetup();
 	Cache_Open();
 	Detail_Init();
+	ParsedName_Cache_Open();
+	TaskPool_Open();
 	DeviceSort();
 	SetLocalControlFlags() ; // reset by every option and other change.
 
@@ -28,6 +30,8 @@ void owlib_test_teardown(void) {
 	}
 	LockTeardown();
 	Detail_Close();
+	ParsedName_Cache_Close();
+	TaskPool_Close();
 }
 
 static void LockTeardown() {
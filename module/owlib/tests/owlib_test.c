@@ -8,9 +8,17 @@
  */
 
 _DEFINE_SUITE(ow_parseinput_suite);
+_DEFINE_SUITE(ow_parsename_suite);
+_DEFINE_SUITE(ow_transaction_suite);
+_DEFINE_SUITE(ow_ds2482_suite);
+_DEFINE_SUITE(ow_cache_suite);
 
 static void setup_test_suites(SRunner *runner) {
 	_INCLUDE_SUITE(ow_parseinput_suite);
+	_INCLUDE_SUITE(ow_parsename_suite);
+	_INCLUDE_SUITE(ow_transaction_suite);
+	_INCLUDE_SUITE(ow_ds2482_suite);
+	_INCLUDE_SUITE(ow_cache_suite);
 }
 
 int main(void)
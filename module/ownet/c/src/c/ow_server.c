@@ -98,6 +98,123 @@ int ServerRead(struct request_packet *rp)
 	return cm.ret;
 }
 
+// Send to an owserver using the GETMANY message
+// return_strings[i] is malloc-ed (with a terminating null) or NULL
+// return_lengths[i] is its length or <0 for error
+// returns 0, or <0 for an error on the whole request (-ENOMSG if the owserver doesn't know GETMANY)
+int ServerReadMany(struct request_packet *rp, const char **paths, int count, char **return_strings, int *return_lengths)
+{
+	struct server_msg sm;
+	struct client_msg cm;
+	struct serverpackage sp = { NULL, NULL, 0, rp->tokenstring, rp->tokens, };
+	int persistent = 1;
+	struct server_connection_state scs ;
+	size_t path_list_length = 0 ;
+	BYTE * path_list ;
+	char * data ;
+	int i ;
+
+	for ( i = 0 ; i < count ; ++i ) {
+		return_strings[i] = NULL ;
+		return_lengths[i] = -EIO ; // unless answered
+	}
+
+	// Do we know this server doesn't support GETMANY?
+	if (rp->owserver->tcp.no_getmany) {
+		return -ENOMSG;
+	}
+
+	memset(&sm, 0, sizeof(struct server_msg));
+	memset(&cm, 0, sizeof(struct client_msg));
+	sm.type = msg_getmany;
+	sm.size = rp->data_length;
+	sm.offset = 0;
+	scs.persistence = persistent_yes ;
+	scs.in =rp->owserver ;
+
+	// paths, each null-terminated, one after another
+	for ( i = 0 ; i < count ; ++i ) {
+		path_list_length += strlen( paths[i]==NULL ? "/" : paths[i] ) + 1 ;
+	}
+	if ( path_list_length > MAX_OWSERVER_PROTOCOL_PAYLOAD_SIZE ) {
+		return -EMSGSIZE ;
+	}
+	path_list = malloc( path_list_length ) ;
+	if ( path_list == NULL ) {
+		return -ENOMEM ;
+	}
+	sp.data = path_list ;
+	sp.datasize = path_list_length ;
+	for ( i = 0 ; i < count ; ++i ) {
+		const char * path = (paths[i]==NULL) ? "/" : paths[i] ;
+		size_t length = strlen( path ) + 1 ;
+		memcpy( path_list, path, length ) ;
+		path_list += length ;
+	}
+
+	LEVEL_CALL("SERVER GETMANY %d paths\n", count);
+
+	// Send to owserver
+	sm.control_flags = SetupSemi(persistent);
+	if ( To_Server( &scs, &sm, &sp) == 1 ) {
+		free( sp.data ) ;
+		Release_Persistent( &scs, 0);
+		return -EIO ;
+	}
+	free( sp.data ) ;
+
+	// Receive from owserver -- one message per path (tagged by offset) then a final one (offset 0)
+	while ( 1 ) {
+		data = From_ServerAlloc( &scs, &cm ) ;
+		if ( cm.offset <= 0 || cm.offset > count ) {
+			// final message, or an error
+			if ( data != NULL ) {
+				free( data ) ;
+			}
+			break ;
+		}
+		i = cm.offset - 1 ;
+		if ( data == NULL && cm.payload > 0 && cm.ret >= 0 ) {
+			// payload not read -- can't stay in step with the owserver
+			cm.ret = -EIO ;
+			break ;
+		}
+		if ( return_strings[i] != NULL ) {
+			free( return_strings[i] ) ;
+			return_strings[i] = NULL ;
+		}
+		if ( cm.ret < 0 ) {
+			return_lengths[i] = cm.ret ;
+			if ( data != NULL ) {
+				free( data ) ;
+			}
+		} else if ( data == NULL ) {
+			// empty value
+			return_strings[i] = malloc( 1 ) ;
+			if ( return_strings[i] == NULL ) {
+				return_lengths[i] = -ENOMEM ;
+			} else {
+				return_strings[i][0] = '\0' ;
+				return_lengths[i] = 0 ;
+			}
+		} else {
+			// From_ServerAlloc already added the terminating null
+			return_strings[i] = data ;
+			return_lengths[i] = cm.payload ;
+		}
+	}
+
+	if ( cm.ret == -ENOMSG ) {
+		rp->owserver->tcp.no_getmany = 1;
+	}
+	if ( cm.ret < 0 ) {
+		Release_Persistent( &scs, 0);
+		return cm.ret ;
+	}
+	Release_Persistent( &scs, cm.control_flags & PERSISTENT_MASK);
+	return 0;
+}
+
 // Send to an owserver using the PRESENT message
 int ServerPresence(struct request_packet *rp)
 {
@@ -75,3 +75,44 @@ int OWNET_lread(OWNET_HANDLE h, const char *onewire_path, char *return_string, s
 	CONNIN_RUNLOCK;
 	return return_value;
 }
+
+int OWNET_getmany(OWNET_HANDLE h, const char **onewire_paths, int count, char **return_strings, int *return_lengths)
+{
+	struct request_packet s_request_packet;
+	struct request_packet *rp = &s_request_packet;
+	int ret;
+	int i;
+
+	if (onewire_paths == NULL || return_strings == NULL || return_lengths == NULL || count < 0) {
+		return -EINVAL;
+	}
+	memset(rp, 0, sizeof(struct request_packet));
+
+	CONNIN_RLOCK;
+	rp->owserver = find_connection_in(h);
+	if (rp->owserver == NULL) {
+		CONNIN_RUNLOCK;
+		return -EBADF;
+	}
+
+	rp->data_length = MAX_READ_BUFFER_SIZE;
+	rp->data_offset = 0;
+
+	ret = ServerReadMany(rp, onewire_paths, count, return_strings, return_lengths);
+	CONNIN_RUNLOCK;
+
+	switch (ret) {
+	case -ENOMSG:
+	case -ENOMEM:
+	case -EMSGSIZE:
+		// older owserver (or too many paths for one message) -- read them one at a time
+		LEVEL_DEBUG("GETMANY not possible, reading paths separately\n");
+		for (i = 0; i < count; ++i) {
+			return_lengths[i] = OWNET_read(h, onewire_paths[i], &return_strings[i]);
+		}
+		return 0;
+	default:
+		// errors for single paths were answered by the owserver, and stand
+		return ret;
+	}
+}
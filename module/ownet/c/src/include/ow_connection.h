@@ -84,6 +84,7 @@ struct connin_tcp {
 	char *domain;				// for zeroconf
 	char *fqdn;					// fully qualified domain name
 	int no_dirall;				// flag that server doesn't support DIRALL
+	int no_getmany;				// flag that server doesn't support GETMANY
 };
 
 //enum server_type { srv_unknown, srv_direct, srv_client, src_
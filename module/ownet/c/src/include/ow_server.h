@@ -63,6 +63,7 @@ extern struct ow_global {
 
 int ServerPresence(struct request_packet *rp);
 int ServerRead(struct request_packet *rp);
+int ServerReadMany(struct request_packet *rp, const char **paths, int count, char **return_strings, int *return_lengths);
 int ServerWrite(struct request_packet *rp);
 int ServerDir(void (*dirfunc) (void *, const char *), void *v, struct request_packet *rp);
 
@@ -102,6 +102,18 @@ extern "C" {
 */
 	int OWNET_lread(OWNET_HANDLE h, const char *onewire_path, char *return_string, size_t size, off_t offset);
 
+/* int OWNET_getmany( OWNET_HANDLE h, const char ** onewire_paths, int count,
+        char ** return_strings, int * return_lengths )
+   Read values from several one-wire device properties in one message
+   return_strings[i] has the result for onewire_paths[i] (or NULL) and must be free-ed by the calling program.
+   return_lengths[i] is the length of that result, or <0 for an error on that path
+   Older owservers are read one path at a time. Errors on single paths are not retried.
+
+   returns 0 on success,
+   returns <0 on an error for the whole message
+*/
+	int OWNET_getmany(OWNET_HANDLE h, const char **onewire_paths, int count, char **return_strings, int *return_lengths);
+
 /* int OWNET_put( OWNET_HANDLE h, const char * onewire_path, 
         const unsigned char * value_string, size_t size)
    Write a value to a one-wire device property,
@@ -69,6 +69,15 @@ class OWMsg:
     presence = 6
 
 
+class OWFlag:
+    """
+    Constants for the owserver api control flags.
+    """
+    default    = 258     # bus list, ownet
+    persistent = 0x004   # keep the connection for another request
+    pipeline   = 0x200   # tagged requests, answered as they finish
+
+
 class Connection(object):
     """
     A Connection provides access to a owserver without the standard
@@ -203,7 +212,118 @@ class Connection(object):
         return fields
 
 
-    def pack(self, function, payload_len, data_len):
+    def read_many(self, paths):
+        """
+        Read several paths over one connection.
+
+        If the owserver grants pipelining, all the reads are sent at once,
+        each with a tag (its index in paths), and the answers are matched
+        by tag as they come back in whatever order they finish. Otherwise
+        the paths are read one at a time.
+
+        Returns a list of values, in the order of paths, with None for
+        a path that could not be read.
+        """
+
+        #print 'Connection.read_many(%s)' % str(paths)
+        s = socket.socket(socket.AF_INET, socket.SOCK_STREAM)
+        s.connect((self._server, self._port))
+
+        try:
+            if not self.pipeline_open(s):
+                s.close()
+                s = None
+                return [self.read_one(path) for path in paths]
+
+            for tag, path in enumerate(paths):
+                s.sendall(self.pack(OWMsg.read, len(path) + 1, 8192,
+                                    OWFlag.default | OWFlag.persistent))
+                s.sendall(struct.pack('!i', tag))
+                s.sendall(path + '\x00')
+
+            values = [None] * len(paths)
+            for i in range(len(paths)):
+                tag, value = self.read_reply(s, True)
+                if tag < 0 or tag >= len(paths):
+                    raise exInvalidMessage, tag
+                values[tag] = value
+            return values
+        finally:
+            if s is not None:
+                s.close()
+
+
+    def pipeline_open(self, s):
+        """
+        Ask for a pipelined connection on socket s.
+
+        Granted only if the reply has the pipeline flag AND a non-zero
+        size (the number of requests the owserver runs at once). An older
+        owserver answers the NOP, possibly with the flags copied back, but
+        size 0, and knows nothing of tags.
+        """
+
+        s.sendall(self.pack(OWMsg.nop, 0, 0,
+                            OWFlag.default | OWFlag.persistent | OWFlag.pipeline))
+        val = struct.unpack('!iiiiii', self.recv_all(s, 24))
+        if val[1] > 0:
+            self.recv_all(s, val[1])
+        return (val[3] & OWFlag.pipeline) != 0 and val[4] > 0
+
+
+    def read_one(self, path):
+        """
+        read() on its own connection, but None for a path that can't be read.
+        """
+
+        s = socket.socket(socket.AF_INET, socket.SOCK_STREAM)
+        s.connect((self._server, self._port))
+        try:
+            s.sendall(self.pack(OWMsg.read, len(path) + 1, 8192))
+            s.sendall(path + '\x00')
+            return self.read_reply(s, False)[1]
+        finally:
+            s.close()
+
+
+    def read_reply(self, s, tagged):
+        """
+        The answer to a read, skipping pings.
+
+        Returns (tag, value) -- tag is None unless tagged, value is None
+        for an error.
+        """
+
+        while 1:
+            val = struct.unpack('!iiiiii', self.recv_all(s, 24))
+            payload_len, ret, data_len = val[1], val[2], val[4]
+            tag = None
+            if tagged:
+                tag = struct.unpack('!i', self.recv_all(s, 4))[0]
+            if payload_len < 0:
+                # ping -- the request is still running
+                continue
+            data = self.recv_all(s, payload_len)
+            if ret < 0:
+                return tag, None
+            return tag, self.toNumber(data[:data_len])
+
+
+    def recv_all(self, s, length):
+        """
+        Exactly length bytes from socket s.
+        """
+
+        data = ''
+        while len(data) < length:
+            more = s.recv(length - len(data))
+            if not more:
+                raise exShortRead
+            data += more
+        return data
+
+
+    def pack(self, function, payload_len, data_len, flags = OWFlag.default):
         """
         """
 
@@ -212,7 +332,7 @@ class Connection(object):
                            socket.htonl(0),           #version
                            socket.htonl(payload_len), #payload length
                            socket.htonl(function),    #type of function call
-                           socket.htonl(258),         #format flags -- 266 for alias upport
+                           socket.htonl(flags),       #format flags -- 266 for alias upport
                            socket.htonl(data_len),    #size of data element for read or write
                            socket.htonl(0),           #offset for read or write
                            )
@@ -0,0 +1,160 @@
+#! /usr/bin/env python
+"""
+::BOH
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or (at
+your option) any later version.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+::EOH
+
+Tests of the pipelined (tagged) owserver framing in Connection.read_many.
+
+A small fake owserver on a local socket checks the requests and answers
+them out of order. Set OWSERVER=host:port (an owserver started with
+--fake=10) to run the same reads against a real owserver as well.
+
+    cd module/ownet/python && python tests/pipeline_test.py
+"""
+
+
+import os
+import sys
+import socket
+import struct
+import threading
+import unittest
+
+sys.path.insert(0, os.path.join(os.path.dirname(os.path.abspath(__file__)), '..'))
+from ownet.connection import Connection, OWMsg, OWFlag
+
+
+def recv_all(s, length):
+    data = ''
+    while len(data) < length:
+        more = s.recv(length - len(data))
+        if not more:
+            raise EOFError
+        data += more
+    return data
+
+
+def reply(ret, payload, flags, size, offset = 0):
+    return struct.pack('!iiiiii', 0, payload, ret, flags, size, offset)
+
+
+class FakeServer(threading.Thread):
+    """
+    One connection, one NOP, then reads.
+
+    pipelined -- grant the pipeline and answer the reads in reverse order
+                 (with a ping first), otherwise answer the NOP like an older
+                 owserver: flags copied back, size 0, one read per connection.
+    """
+
+    def __init__(self, pipelined, values):
+        threading.Thread.__init__(self)
+        self.daemon = True
+        self.pipelined = pipelined
+        self.values = values
+        self.tags = []
+        self.listener = socket.socket(socket.AF_INET, socket.SOCK_STREAM)
+        self.listener.bind(('127.0.0.1', 0))
+        self.listener.listen(5)
+        self.port = self.listener.getsockname()[1]
+
+
+    def request(self, s, tagged):
+        version, payload, function, flags, size, offset = struct.unpack('!iiiiii', recv_all(s, 24))
+        tag = None
+        if tagged:
+            tag = struct.unpack('!i', recv_all(s, 4))[0]
+        path = recv_all(s, payload)
+        return function, flags, size, tag, path.rstrip('\x00')
+
+
+    def answer(self, path, tag = None):
+        value = self.values.get(path, '')
+        if path in self.values:
+            header = reply(0, len(value), 0, len(value))
+        else:
+            header = reply(-2, 0, 0, 0)
+        if tag is not None:
+            header += struct.pack('!i', tag)
+        return header + value
+
+
+    def run(self):
+        s = self.listener.accept()[0]
+        function, flags, size, tag, path = self.request(s, False)
+        if self.pipelined:
+            s.sendall(reply(0, 0, flags, 16))
+            answers = []
+            for i in range(len(self.values) + 1):
+                function, flags, size, tag, path = self.request(s, True)
+                self.tags.append(tag)
+                answers.append((tag, path))
+            s.sendall(reply(0, -1, flags, 0) + struct.pack('!i', answers[0][0]))
+            for tag, path in reversed(answers):
+                s.sendall(self.answer(path, tag))
+            s.close()
+            return
+        # older owserver -- NOP answered with the flags copied back, no tags
+        s.sendall(reply(0, 0, flags, 0))
+        s.close()
+        while True:
+            s = self.listener.accept()[0]
+            function, flags, size, tag, path = self.request(s, False)
+            self.tags.append(tag)
+            s.sendall(self.answer(path))
+            s.close()
+
+
+class PipelineTest(unittest.TestCase):
+    values = { '/10.000000000001/temperature': '     25.5',
+               '/10.000000000001/type': 'DS18S20', }
+    paths = [ '/10.000000000001/temperature', '/10.000000000001/type', '/nonexistent' ]
+
+
+    def testPipelined(self):
+        server = FakeServer(True, self.values)
+        server.start()
+        result = Connection('127.0.0.1', server.port).read_many(self.paths)
+        self.assertEqual(result, [25.5, 'DS18S20', None])
+        self.assertEqual(server.tags, [0, 1, 2])
+
+
+    def testOlderServer(self):
+        server = FakeServer(False, self.values)
+        server.start()
+        result = Connection('127.0.0.1', server.port).read_many(self.paths)
+        self.assertEqual(result, [25.5, 'DS18S20', None])
+        self.assertEqual(server.tags, [None, None, None])
+
+
+    def testOwserver(self):
+        if 'OWSERVER' not in os.environ:
+            return
+        host, port = os.environ['OWSERVER'].split(':')
+        c = Connection(host, int(port))
+        devices = [ d for d in c.dir('/') if d.startswith('/10.') ]
+        self.failUnless(devices)
+        paths = [ d + '/type' for d in devices ] + [ '/nonexistent' ]
+        result = c.read_many(paths)
+        self.assertEqual(result, [ 'DS18S20' ] * len(devices) + [ None ])
+
+
+def Suite( ):
+    return unittest.makeSuite(PipelineTest, 'test')
+
+
+if __name__ == '__main__':
+    unittest.main()
@@ -44,6 +44,7 @@ void *DataHandler(void *v)
 {
 	struct handlerdata *hd = v;
 	char *retbuffer = NULL;
+	struct reply_chunks chunks; // directory listings
 	struct client_msg cm; // the return message
 
 #if OW_CYGWIN
@@ -58,6 +59,7 @@ void *DataHandler(void *v)
 #endif
 
 	memset(&cm, 0, sizeof(struct client_msg));
+	ReplyChunksInit(&chunks);
 	cm.version = MakeServerprotocol(OWSERVER_PROTOCOL_VERSION);
 	cm.control_flags = hd->sm.control_flags;			// default flag return -- includes persistence state
 
@@ -72,6 +74,7 @@ void *DataHandler(void *v)
 		break;
 	case msg_get:
 	case msg_getslash:
+	case msg_getmany:
 		if (Globals.no_get) {
 			LEVEL_DEBUG("GET message rejected.") ;
 			hd->sm.type = msg_error;
@@ -161,16 +164,16 @@ void *DataHandler(void *v)
 				break;
 			case msg_dirall:
 				LEVEL_CALL("Directory message (all at once)");
-				retbuffer = DirallHandler(hd, &cm, pn);
+				DirallHandler(hd, &cm, pn, &chunks);
 				break;
 			case msg_dirallslash:
 				LEVEL_CALL("Directory message (all at once, with directory /)");
-				retbuffer = DirallslashHandler(hd, &cm, pn);
+				DirallslashHandler(hd, &cm, pn, &chunks);
 				break;
 			case msg_get:
 				if (IsDir(pn)) {
 					LEVEL_CALL("Get -> Directory message (all at once)");
-					retbuffer = DirallHandler(hd, &cm, pn);
+					DirallHandler(hd, &cm, pn, &chunks);
 				} else {
 					LEVEL_CALL("Get -> Read message");
 					retbuffer = ReadHandler(hd, &cm, owq);
@@ -179,7 +182,7 @@ void *DataHandler(void *v)
 			case msg_getslash:
 				if (IsDir(pn)) {
 					LEVEL_CALL("Get -> Directory message (all at once)");
-					retbuffer = DirallslashHandler(hd, &cm, pn);
+					DirallslashHandler(hd, &cm, pn, &chunks);
 				} else {
 					LEVEL_CALL("Get -> Read message");
 					retbuffer = ReadHandler(hd, &cm, owq);
@@ -193,6 +196,10 @@ void *DataHandler(void *v)
 			LEVEL_DEBUG("DataHandler: FS_ParsedName_destroy done");
 		}
 		break;
+	case msg_getmany:			// good message -- a list of paths, not one
+		LEVEL_CALL("Getmany message");
+		GetmanyHandler(hd, &cm);
+		break;
 	case msg_nop:				// "bad" message
 		LEVEL_CALL("NOP message");
 		cm.ret = 0;
@@ -207,22 +214,22 @@ void *DataHandler(void *v)
 	LEVEL_DEBUG("DataHandler: cm.ret=%d", cm.ret);
 
 	TOCLIENTLOCK(hd);
-	if (cm.ret != -EIO) {
-		ToClient(hd->file_descriptor, &cm, retbuffer);
+	if (cm.ret != -EIO && chunks.count > 0) {
+		ToClientChunks(hd, &cm, &chunks);
+	} else if (cm.ret != -EIO) {
+		ToClient(hd, &cm, retbuffer);
 	} else {
 		ErrorToClient(hd, &cm) ;
 	}
 
-	// Signal to PingLoop that we're done.
+	// Signal to the ping thread that we're done.
 	hd->toclient = toclient_complete ;
-	if ( hd->ping_pipe[fd_pipe_write] != FILE_DESCRIPTOR_BAD ) {
-		ignore_result = write( hd->ping_pipe[fd_pipe_write],"X",1) ; //dummy payload
-	}
 	TOCLIENTUNLOCK(hd);
 
 	if (retbuffer) {
 		owfree(retbuffer);
 	}
+	ReplyChunksClear(&chunks);
 	LEVEL_DEBUG("Finished with client request");
 	return VOID_RETURN;
 }
@@ -60,7 +60,7 @@ static void DirHandlerCallback(void *v, const struct parsedname *pn_entry)
 	dhs->cm->ret = 0;
 
 	TOCLIENTLOCK(dhs->hd);
-	ToClient(dhs->hd->file_descriptor, dhs->cm, path);	// send this directory element
+	ToClient(dhs->hd, dhs->cm, path);	// send this directory element
 	dhs->hd->toclient = toclient_postmessage ;
 	TOCLIENTUNLOCK(dhs->hd);
 }
@@ -47,22 +47,20 @@
 
 static void DirallslashHandlerCallback(void *v, const struct parsedname *pn_entry)
 {
-	struct charblob *cb = v;
-	CharblobAdd(pn_entry->path, strlen(pn_entry->path), cb);
+	struct reply_chunks *rc = v;
+	if (rc->length > 0) {
+		ReplyChunksAdd(",", 1, rc);
+	}
+	ReplyChunksAdd(pn_entry->path, strlen(pn_entry->path), rc);
 	if (IsDir(pn_entry)) {
-		CharblobAddChar('/',cb);
+		ReplyChunksAdd("/", 1, rc);
 	}
 }
 
-void *DirallslashHandler(struct handlerdata *hd, struct client_msg *cm, const struct parsedname *pn)
+/* The listing is left in rc, to be sent by ToClientChunks */
+void DirallslashHandler(struct handlerdata *hd, struct client_msg *cm, const struct parsedname *pn, struct reply_chunks *rc)
 {
 	uint32_t flags = 0;
-	struct charblob cb;
-	char *ret = NULL;
-
-	(void) hd;
-
-	CharblobInit(&cb);
 
 	// Now generate the directory (using the embedded callback function above for each element
 	LEVEL_DEBUG("OWSERVER Dir-All SpecifiedBus=%d path = %s", SpecifiedBus(pn), SAFESTRING(pn->path));
@@ -71,21 +69,15 @@ void *DirallslashHandler(struct handlerdata *hd, struct client_msg *cm, const st
 		cm->ret = -EMSGSIZE;
 	} else {
 		// Now generate the directory using the callback function above for each element
-		cm->ret = FS_dir_remote(DirallslashHandlerCallback, &cb, pn, &flags);
+		cm->ret = FS_dir_remote(DirallslashHandlerCallback, rc, pn, &flags);
 	}
 
-	if (cm->ret < 0) {			// error
-		cm->size = cm->payload = 0;
-	} else if (CharblobData(&cb) == NO_CHARBLOB) {	// empty
-		cm->size = cm->payload = 0;
-	} else if ((ret = owstrdup(CharblobData(&cb))) != NULL) {	// try to copy
-		cm->payload = CharblobLength(&cb) + 1;
-		cm->size = CharblobLength(&cb);
-	} else {					// couldn't copy
+	if (cm->ret >= 0 && rc->troubled) {	// couldn't hold it all
 		cm->ret = -ENOMEM;
-		cm->size = cm->payload = 0;
 	}
+	if (cm->ret < 0) {			// error
+		ReplyChunksClear(rc);
+	}
+	cm->size = cm->payload = 0;	// set when sent
 	cm->offset = flags;			/* send the flags in the offset slot */
-	CharblobClear(&cb);
-	return ret;
 }
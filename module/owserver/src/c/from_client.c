@@ -36,23 +36,57 @@
 
 #include "owserver.h"
 
-/* read from client, free return pointer if not Null */
+/* How much of the request to read, given what has arrived (sc->request_read):
+   the header (and tag) first, then the whole message.
+   Returns <0 if the header can't be valid */
+ssize_t FromClientLength(struct server_connection *sc)
+{
+	struct server_msg sm;
+	size_t header = sizeof(struct server_msg);
+	ssize_t trueload;
+
+	if (sc->pipeline != NULL) {
+		header += sizeof(int32_t);	// tag
+	}
+	if (sc->request_read < header) {
+		return header;
+	}
+
+	memcpy(&sm, sc->request, sizeof(struct server_msg));
+	sm.version = ntohl(sm.version);
+	sm.payload = ntohl(sm.payload);
+
+	trueload = sm.payload;
+	if (isServermessage(sm.version)) {
+		trueload += sizeof(struct antiloop) * Servertokens(sm.version);
+	}
+	if (trueload == 0) {
+		return header;
+	}
+	if ((sm.payload < 0) || (trueload > MAX_OWSERVER_PROTOCOL_PAYLOAD_SIZE)) {
+		LEVEL_DEBUG("Bad request size payload=%d", sm.payload);
+		return -1;
+	}
+	return header + trueload;
+}
+
+/* Parse the request (read whole by the server loop), free return pointer if not Null */
 int FromClient(struct handlerdata *hd)
 {
 	BYTE *msg;
 	ssize_t trueload;
-	size_t actual_read ;
-	struct timeval tv = { Globals.timeout_server, 0, };
+	const BYTE *request = hd->request;
 
 	/* Clear return structure */
 	memset(&hd->sp, 0, sizeof(struct serverpackage));
 
-	/* read header */
-	tcp_read(hd->file_descriptor, (BYTE *) &hd->sm, sizeof(struct server_msg), &tv, &actual_read) ;
-	if (actual_read != sizeof(struct server_msg)) {
+	/* header */
+	if (hd->request_length < sizeof(struct server_msg)) {
 		hd->sm.type = msg_error;
 		return -EIO;
 	}
+	memcpy(&hd->sm, request, sizeof(struct server_msg));
+	request += sizeof(struct server_msg);
 
 	/* translate endian state */
 	hd->sm.version = ntohl(hd->sm.version);
@@ -64,6 +98,18 @@ int FromClient(struct handlerdata *hd)
 
 	LEVEL_DEBUG("FromClient payload=%d size=%d type=%d sg=0x%X offset=%d", hd->sm.payload, hd->sm.size, hd->sm.type, hd->sm.control_flags, hd->sm.offset);
 
+	/* pipelined connection -- request tag follows the header */
+	if ( hd->pipeline != NULL ) {
+		int32_t tag ;
+		if (hd->request_length < sizeof(struct server_msg) + sizeof(int32_t)) {
+			hd->sm.type = msg_error;
+			return -EIO;
+		}
+		memcpy(&tag, request, sizeof(int32_t));
+		request += sizeof(int32_t);
+		hd->tag = ntohl(tag) ;
+	}
+
 	/* figure out length of rest of message: payload plus tokens */
 	trueload = hd->sm.payload;
 	if (isServermessage(hd->sm.version)) {
@@ -89,12 +135,12 @@ int FromClient(struct handlerdata *hd)
 		return -ENOMEM;
 	}
 
-	/* read in data */
-	tcp_read(hd->file_descriptor, msg, trueload, &tv, &actual_read) ;
-	if ((ssize_t)actual_read != trueload) {	/* read in the expected data */
+	/* copy the data */
+	if ((size_t) (request - hd->request) + trueload > hd->request_length) {
 		hd->sm.type = msg_error;
 		goto BADDATA ;
 	}
+	memcpy(msg, request, trueload);
 
 	/* New algorithm as of 2.9p4 -- no longer use terminating null as path length
 	 * now use payload length and data size (for writes)
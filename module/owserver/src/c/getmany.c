@@ -0,0 +1,214 @@
+/*
+    OW_HTML -- OWFS used for the web
+    OW -- One-Wire filesystem
+
+    Written 2004 Paul H Alfille
+
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+/* owserver -- responds to requests over a network socket, and processes them on the 1-wire bus/
+         Basic idea: control the 1-wire bus and answer queries over a network socket
+         Clients can be owperl, owfs, owhttpd, etc...
+         Clients can be local or remote
+                 Eventually will also allow bounce servers.
+
+         syntax:
+                 owserver
+                 -u (usb)
+                 -d /dev/ttyS1 (serial)
+                 -p tcp port
+                 e.g. 3001 or 10.183.180.101:3001 or /tmp/1wire
+*/
+
+#include "owserver.h"
+
+/* Getmany, called from DataHandler with the following caveats: */
+/* payload is a list of null-terminated paths (already null-terminated at the end) */
+/* sm.size is the largest result wanted for any single path */
+/* Getmany will send: */
+/* one message per path, in completion order, tagged with offset = path index + 1 */
+/*   ret and payload as for a read */
+/* cm fully constructed for the final (offset = 0) message, ret is 0 or an error for the whole request */
+
+/* Cached values are answered first, then the rest are read with one task per bus on the task pool */
+
+struct getmany_item {
+	struct one_wire_query * owq ; // NO_ONE_WIRE_QUERY if the path didn't parse
+	int index ; // position in the request
+	struct getmany_item * next ; // next on the same bus
+} ;
+
+struct getmany_bus {
+	struct handlerdata * hd ;
+	struct connection_in * in ; // grouping key
+	struct getmany_item * first ; // in request order
+	struct getmany_item * last ;
+} ;
+
+static void GetmanyToClient( struct handlerdata * hd, int index, SIZE_OR_ERROR read_or_error, const char * data )
+{
+	struct client_msg cm ;
+
+	memset(&cm, 0, sizeof(struct client_msg));
+	cm.version = MakeServerprotocol(OWSERVER_PROTOCOL_VERSION);
+	cm.control_flags = hd->sm.control_flags;
+	cm.offset = index + 1 ;
+	cm.ret = read_or_error ;
+	if ( read_or_error > 0 ) {
+		cm.payload = cm.size = read_or_error ;
+	}
+
+	TOCLIENTLOCK(hd);
+	ToClient(hd, &cm, data);	// send this result
+	hd->toclient = toclient_postmessage ;
+	TOCLIENTUNLOCK(hd);
+}
+
+static struct one_wire_query * GetmanyCreate( struct handlerdata * hd, const char * path )
+{
+	struct one_wire_query * owq = OWQ_create_from_path( path ) ;
+	struct parsedname * pn ;
+
+	if ( owq == NO_ONE_WIRE_QUERY ) {
+		return NO_ONE_WIRE_QUERY ;
+	}
+	if ( BAD( OWQ_allocate_read_buffer(owq) ) ) {
+		OWQ_destroy(owq) ;
+		return NO_ONE_WIRE_QUERY ;
+	}
+	if ( OWQ_size(owq) > (size_t) hd->sm.size ) {
+		OWQ_size(owq) = hd->sm.size ;
+	}
+	OWQ_offset(owq) = 0 ;
+
+	/* Same settings DataHandler gives a single read */
+	pn = PN(owq) ;
+	pn->control_flags = hd->sm.control_flags;
+	if ( (pn->control_flags & UNCACHED) != 0 ) {
+		pn->state |= ePS_uncached;
+	}
+	if ( (pn->control_flags & ALIAS_REQUEST) == 0 ) {
+		pn->state |= ePS_unaliased;
+	}
+	pn->tokens = hd->sp.tokens;
+	pn->tokenstring = hd->sp.tokenstring;
+
+	return owq ;
+}
+
+/* Task (pool thread or caller) once per bus */
+static void GetmanyBus( void * v )
+{
+	struct getmany_bus * gb = (struct getmany_bus *) v ;
+	struct getmany_item * gi ;
+
+	for ( gi = gb->first ; gi != NULL ; gi = gi->next ) {
+		SIZE_OR_ERROR read_or_error = FS_read_postparse( gi->owq ) ;
+		LEVEL_DEBUG("Getmany %s return = %d", PN(gi->owq)->path, read_or_error);
+		GetmanyToClient( gb->hd, gi->index, read_or_error, OWQ_buffer(gi->owq) ) ;
+	}
+}
+
+void GetmanyHandler(struct handlerdata *hd, struct client_msg *cm)
+{
+	struct getmany_item * items ;
+	struct getmany_bus * buses ;
+	const char * path ;
+	const char * end ;
+	int count = 0 ;
+	int bus_count = 0 ;
+	int index ;
+
+	LEVEL_DEBUG("GetmanyHandler: From Client sm->payload=%d sm->size=%d", hd->sm.payload, hd->sm.size);
+
+	if ( hd->sm.payload <= 0 || hd->sp.path == NULL ) {
+		cm->ret = -EBADMSG;
+		return ;
+	}
+	if ((hd->sm.size <= 0) || (hd->sm.size > MAX_OWSERVER_PROTOCOL_PAYLOAD_SIZE)) {
+		LEVEL_DEBUG("GetmanyHandler: error hd->sm.size == %d", hd->sm.size);
+		cm->ret = -EMSGSIZE;
+		return ;
+	}
+
+	// count the paths (payload was null-terminated by FromClient)
+	end = &(hd->sp.path[hd->sm.payload]) ;
+	for ( path = hd->sp.path ; path < end ; path += strlen(path) + 1 ) {
+		++count ;
+	}
+
+	items = owcalloc( count, sizeof(struct getmany_item) ) ;
+	buses = owcalloc( count, sizeof(struct getmany_bus) ) ; // at most one bus per path
+	if ( items == NULL || buses == NULL ) {
+		SAFEFREE( items ) ;
+		SAFEFREE( buses ) ;
+		cm->ret = -ENOMEM;
+		return ;
+	}
+
+	// parse each path, answer from cache if possible, else queue on its bus
+	for ( index = 0, path = hd->sp.path ; index < count ; ++index, path += strlen(path) + 1 ) {
+		struct getmany_item * gi = &items[index] ;
+		struct getmany_bus * gb ;
+		int bus_index ;
+		SIZE_OR_ERROR read_or_error ;
+
+		gi->index = index ;
+		gi->owq = GetmanyCreate( hd, path ) ;
+		if ( gi->owq == NO_ONE_WIRE_QUERY ) {
+			LEVEL_DEBUG("GetmanyHandler: can't parse %s", path);
+			GetmanyToClient( hd, index, -ENOENT, NULL ) ;
+			continue ;
+		}
+
+		read_or_error = FS_read_fromcache( gi->owq ) ;
+		if ( read_or_error >= 0 ) {
+			GetmanyToClient( hd, index, read_or_error, OWQ_buffer(gi->owq) ) ;
+			continue ;
+		}
+
+		for ( bus_index = 0 ; bus_index < bus_count ; ++bus_index ) {
+			if ( buses[bus_index].in == PN(gi->owq)->selected_connection ) {
+				break ;
+			}
+		}
+		gb = &buses[bus_index] ;
+		if ( bus_index == bus_count ) {
+			gb->hd = hd ;
+			gb->in = PN(gi->owq)->selected_connection ;
+			++bus_count ;
+		}
+		if ( gb->last == NULL ) {
+			gb->first = gi ;
+		} else {
+			gb->last->next = gi ;
+		}
+		gb->last = gi ;
+	}
+
+	// now the bus work, in parallel across buses
+	TaskPool_Run( GetmanyBus, buses, sizeof(struct getmany_bus), bus_count ) ;
+	owfree( buses ) ;
+	for ( index = 0 ; index < count ; ++index ) {
+		OWQ_destroy( items[index].owq ) ;
+	}
+	owfree( items ) ;
+
+	/* final null message marks the end of the results */
+	cm->payload = cm->size = cm->offset = 0 ;
+	cm->ret = 0 ;
+}
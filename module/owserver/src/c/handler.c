@@ -41,100 +41,129 @@ int persistent_connections = 0;
 int handler_count = 0 ;
 
 static void SingleHandler(struct handlerdata *hd);
+static void HandlerIdle(struct server_connection *sc);
+static void HandlerFreePath(struct handlerdata *hd);
+static void PipelineOpen(struct server_connection *sc, struct handlerdata *hd);
+static void PipelineHandler(struct server_connection *sc);
+static void PipelineTask(void *v);
+static void PipelineDone(struct request_pipeline *rp);
+static void PipelineFree(struct request_pipeline *rp);
 
 /*
  * Main routine for actually handling a request
- * deals with a connection
+ * deals with one request on a connection
+ * sets sc->idle if the connection should wait for another (persistence)
  */
-void Handler(FILE_DESCRIPTOR_OR_ERROR file_descriptor)
+void Handler(struct server_connection *sc)
 {
 	struct handlerdata hd;
-	struct timeval tv_low = { Globals.timeout_persistent_low, 0, };
-	struct timeval tv_high = { Globals.timeout_persistent_high, 0, };
-	int persistent = 0;
+	int loop_persistent ;
 
-	hd.file_descriptor = file_descriptor;
-	_MUTEX_INIT(hd.to_client);
+	if (sc->pipeline != NULL) {
+		PipelineHandler(sc);
+		return;
+	}
 
-	timersub(&tv_high, &tv_low, &tv_high);	// just the delta
+	hd.file_descriptor = sc->file_descriptor;
+	hd.request = sc->request;
+	hd.request_length = sc->request_read;
+	hd.pipeline = NULL;
+	hd.tag = 0;
 
-	while (FromClient(&hd) == 0) {
-		// Was persistence requested?
-		int loop_persistent = ((hd.sm.control_flags & PERSISTENT_MASK) != 0);
+	if (FromClient(&hd) != 0) {
+		return ; // connection closed or garbled
+	}
 
-		/* Persistence suppression? */
-		if (Globals.no_persistence) {
-			loop_persistent = 0;
-		}
+	_MUTEX_INIT(hd.to_client);
 
-		/* Persistence logic */
-		if (loop_persistent) {	/* Requested persistence */
-			LEVEL_DEBUG("Persistence requested");
-			if (persistent) {	/* already had persistence granted */
-				hd.persistent = 1;	/* so keep it */
-			} else {			/* See if available */
+	// Was persistence requested?
+	loop_persistent = ((hd.sm.control_flags & PERSISTENT_MASK) != 0);
 
-				PERSISTENCELOCK;
+	/* Persistence suppression? */
+	if (Globals.no_persistence) {
+		loop_persistent = 0;
+	}
 
-				if (persistent_connections < Globals.clients_persistent_high) {	/* ok */
-					++persistent_connections;	/* global count */
-					persistent = 1;	/* connection toggle */
-					hd.persistent = 1;	/* for responses */
-				} else {
-					loop_persistent = 0;	/* denied! */
-					hd.persistent = 0;	/* for responses */
-				}
+	/* Persistence logic */
+	if (loop_persistent) {	/* Requested persistence */
+		LEVEL_DEBUG("Persistence requested");
+		if (sc->persistent) {	/* already had persistence granted */
+			hd.persistent = 1;	/* so keep it */
+		} else {			/* See if available */
 
-				PERSISTENCEUNLOCK;
+			PERSISTENCELOCK;
 
+			if (persistent_connections < Globals.clients_persistent_high) {	/* ok */
+				++persistent_connections;	/* global count */
+				sc->persistent = 1;	/* connection toggle */
+				hd.persistent = 1;	/* for responses */
+			} else {
+				loop_persistent = 0;	/* denied! */
+				hd.persistent = 0;	/* for responses */
 			}
-		} else {				/* No persistence requested this time */
-			hd.persistent = 0;	/* for responses */
-		}
 
-		/* now set the sg flag because it usually is copied back to the client */
-		if (loop_persistent) {
-			hd.sm.control_flags |= PERSISTENT_MASK;
-		} else {
-			hd.sm.control_flags &= ~PERSISTENT_MASK;
+			PERSISTENCEUNLOCK;
+
 		}
+	} else {				/* No persistence requested this time */
+		hd.persistent = 0;	/* for responses */
+	}
+
+	/* now set the sg flag because it usually is copied back to the client */
+	if (loop_persistent) {
+		hd.sm.control_flags |= PERSISTENT_MASK;
+	} else {
+		hd.sm.control_flags &= ~PERSISTENT_MASK;
+	}
 
-		/* Do the real work */
+	/* Do the real work */
+	if (hd.sm.type == msg_nop && (hd.sm.control_flags & PIPELINE_MASK) != 0) {
+		PipelineOpen(sc, &hd);
+	} else {
 		SingleHandler(&hd);
+	}
+	_MUTEX_DESTROY(hd.to_client);
 
-		/* Now see if we should reloop */
-		if (loop_persistent == 0) {
-			break;				/* easiest one */
-		}
+	/* Now see if we should wait for another request */
+	if (loop_persistent) {
+		HandlerIdle(sc);
+	}
+}
 
-		/* Shorter wait */
-		if ( BAD(tcp_wait(file_descriptor, &tv_low)) ) {	// timed out
-			/* test if below threshold for longer wait */
+/* Keep the connection for the next request */
+static void HandlerIdle(struct server_connection *sc)
+{
+	/* longer wait if below the threshold of persistent connections */
 
-			PERSISTENCELOCK;
+	PERSISTENCELOCK;
 
-			/* store the test because the mutex locks the variable */
-			loop_persistent = (persistent_connections < Globals.clients_persistent_low);
+	sc->idle.tv_sec = (persistent_connections < Globals.clients_persistent_low) ? Globals.timeout_persistent_high : Globals.timeout_persistent_low ;
 
-			PERSISTENCEUNLOCK;
+	PERSISTENCEUNLOCK;
 
-			if (loop_persistent == 0) {
-				break;			/* too many connections and we're slow */
-			}
+	LEVEL_DEBUG("OWSERVER tcp connection persistence -- keep connection for the next request.");
+}
 
-			/*  longer wait */
-			if ( BAD(tcp_wait(file_descriptor, &tv_high)) ) {
-				break;
-			}
+/* Connection is closing -- restore the persistent count */
+void HandlerClose(struct server_connection *sc)
+{
+	LEVEL_DEBUG("OWSERVER handler done");
+	if (sc->pipeline != NULL) {
+		struct request_pipeline *rp = sc->pipeline;
+		int last;
+
+		// requests still running get their answers out first, and the last one frees the pipeline
+		_MUTEX_LOCK(rp->mutex);
+		rp->closing = 1;
+		last = (rp->in_flight == 0);
+		_MUTEX_UNLOCK(rp->mutex);
+
+		if (last) {
+			PipelineFree(rp);
 		}
-
-		LEVEL_DEBUG("OWSERVER tcp connection persistence -- reusing connection now.");
+		sc->pipeline = NULL;
 	}
-
-	LEVEL_DEBUG("OWSERVER handler done");
-	_MUTEX_DESTROY(hd.to_client);
-	// restore the persistent count
-	if (persistent) {
+	if (sc->persistent) {
 
 		PERSISTENCELOCK;
 
@@ -142,6 +171,7 @@ void Handler(FILE_DESCRIPTOR_OR_ERROR file_descriptor)
 
 		PERSISTENCEUNLOCK;
 
+		sc->persistent = 0 ;
 	}
 }
 
@@ -160,6 +190,11 @@ static void SingleHandler(struct handlerdata *hd)
 
 	PingLoop( hd ) ;
 
+	HandlerFreePath(hd);
+}
+
+static void HandlerFreePath(struct handlerdata *hd)
+{
 	if (hd->sp.path) {
 #if ( __GNUC__ > 4 ) || (__GNUC__ == 4 && __GNUC_MINOR__ > 4 )
 #pragma GCC diagnostic push
@@ -174,3 +209,128 @@ static void SingleHandler(struct handlerdata *hd)
 		hd->sp.path = NULL;
 	}
 }
+
+/* NOP with PIPELINE_MASK asks for a pipelined connection
+ * Granted only to a persistent connection, and shown by PIPELINE_MASK in the
+ * reply with size set to the number of requests that can run at once.
+ * This reply is still untagged.
+ * */
+static void PipelineOpen(struct server_connection *sc, struct handlerdata *hd)
+{
+	struct client_msg cm;
+
+	memset(&cm, 0, sizeof(struct client_msg));
+	cm.version = MakeServerprotocol(OWSERVER_PROTOCOL_VERSION);
+	cm.control_flags = hd->sm.control_flags & ~PIPELINE_MASK;
+
+	if (hd->persistent) {
+		struct request_pipeline *rp = owcalloc(1, sizeof(struct request_pipeline));
+		if (rp != NULL) {
+			// replies can outlive the connection's own file descriptor
+			rp->file_descriptor = dup(sc->file_descriptor);
+			if (FILE_DESCRIPTOR_NOT_VALID(rp->file_descriptor)) {
+				ERROR_DEBUG("Cannot open a pipelined connection");
+				owfree(rp);
+				rp = NULL;
+			}
+		}
+		if (rp != NULL) {
+			_MUTEX_INIT(rp->mutex);
+			sc->pipeline = rp;
+			cm.control_flags |= PIPELINE_MASK;
+			cm.size = PIPELINE_DEPTH;
+			LEVEL_DEBUG("Pipelined connection opened");
+		}
+	} else {
+		LEVEL_DEBUG("Pipelining refused -- not a persistent connection");
+	}
+
+	ToClient(hd, &cm, NULL);
+	HandlerFreePath(hd);
+}
+
+/* One request on a pipelined connection
+ * It is queued for the server worker threads so the next request can be read
+ * right away, and answers (with its tag) whenever it finishes.
+ * */
+static void PipelineHandler(struct server_connection *sc)
+{
+	struct request_pipeline *rp = sc->pipeline;
+	struct handlerdata *hd = owcalloc(1, sizeof(struct handlerdata));
+	int queued = 0;
+
+	if (hd == NULL) {
+		return;				// close the connection
+	}
+	hd->file_descriptor = rp->file_descriptor;
+	hd->request = sc->request;
+	hd->request_length = sc->request_read;
+	hd->pipeline = rp;
+
+	if (FromClient(hd) != 0) {
+		owfree(hd);
+		return;				// connection closed or garbled
+	}
+	// parsed and copied -- the connection's buffer takes the next request
+	hd->request = NULL;
+	hd->request_length = 0;
+
+	_MUTEX_INIT(hd->to_client);
+	hd->persistent = 1;
+	hd->sm.control_flags |= PERSISTENT_MASK;
+
+	_MUTEX_LOCK(rp->mutex);
+	if (rp->in_flight < PIPELINE_DEPTH) {
+		++rp->in_flight;
+		queued = 1;
+	}
+	_MUTEX_UNLOCK(rp->mutex);
+
+	if (queued && BAD(ServerRequestTask(PipelineTask, hd))) {
+		PipelineDone(rp);
+		queued = 0;
+	}
+
+	if (!queued) {
+		// too many running already (or no worker threads) -- this one holds up reading the next
+		LEVEL_DEBUG("Pipelined request %d handled in line", hd->tag);
+		SingleHandler(hd);
+		_MUTEX_DESTROY(hd->to_client);
+		owfree(hd);
+	}
+
+	HandlerIdle(sc);
+}
+
+static void PipelineTask(void *v)
+{
+	struct handlerdata *hd = v;
+	struct request_pipeline *rp = hd->pipeline;
+
+	SingleHandler(hd);
+	_MUTEX_DESTROY(hd->to_client);
+	owfree(hd);
+
+	PipelineDone(rp);
+}
+
+static void PipelineDone(struct request_pipeline *rp)
+{
+	int last;
+
+	_MUTEX_LOCK(rp->mutex);
+	last = (--rp->in_flight == 0) && rp->closing;
+	_MUTEX_UNLOCK(rp->mutex);
+
+	if (last) {
+		PipelineFree(rp);
+	}
+}
+
+static void PipelineFree(struct request_pipeline *rp)
+{
+	LEVEL_DEBUG("Pipelined connection closed");
+	Test_and_Close(&(rp->file_descriptor));
+	_MUTEX_DESTROY(rp->mutex);
+	owfree(rp);
+}
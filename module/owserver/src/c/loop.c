@@ -36,123 +36,159 @@
 
 #include "owserver.h"
 
-static void LoopCleanup(struct handlerdata *hd);
-static enum toclient_state Ping_or_Send( enum toclient_state last_toclient, struct handlerdata * hd );
-static GOOD_OR_BAD LoopSetup(struct handlerdata *hd) ;
+/* Keep-alive pings
+ * A single thread serves every request in progress. Each request registers its
+ * handlerdata while it is being processed, and gets a ping if nothing has been
+ * sent to the client for a while (a directory element counts).
+ *
+ * The due requests are collected under the ping lock, and pinged after it is
+ * released, so a slow client doesn't hold up requests registering and
+ * leaving. The pings themselves go out one after another from this thread:
+ * a client that stops reading (or a request in the middle of a long reply)
+ * delays the rest of that round's pings. A ping is only a header, so it takes
+ * a stalled client, not just a slow one. A request being pinged is marked,
+ * and leaving waits for its ping to finish.
+ * */
+
+static struct handlerdata * ping_head = NULL ;
+static pthread_mutex_t ping_mutex ;
+static pthread_cond_t ping_done ; // a ping outside the lock has finished
+static int ping_thread_running = 0 ;
+
+#define PINGLOCK    _MUTEX_LOCK(   ping_mutex )
+#define PINGUNLOCK  _MUTEX_UNLOCK( ping_mutex )
+
+struct timeval tv_long  = { 1 , 000000 } ; // 1 second
+struct timeval tv_short = { 0 , 500000 } ; // 1/2 second
+
+static void * PingThread( void * v ) ;
+static void PingRegister( struct handlerdata * hd ) ;
+static void PingUnregister( struct handlerdata * hd ) ;
+static void PingCheck( struct handlerdata * hd, const struct timeval * now ) ;
 
-static GOOD_OR_BAD LoopSetup(struct handlerdata *hd)
+void PingSetup( void )
 {
-	if ( pipe(hd->ping_pipe) != 0 ) {
-		ERROR_DEBUG("Cannot create pipe pair for keep-alive pulses") ;
-		return gbBAD ;
+	pthread_t thread ;
+
+	_MUTEX_INIT( ping_mutex ) ;
+	my_pthread_cond_init( &ping_done, NULL ) ;
+	if ( pthread_create( &thread, DEFAULT_THREAD_ATTR, PingThread, NULL ) != 0 ) {
+		LEVEL_DEBUG("OWSERVER can't create keep-alive thread -- no pings");
+		return ;
 	}
-//	fcntl (hd->ping_pipe[fd_pipe_read], F_SETFD, FD_CLOEXEC); // for safe forking
-//	fcntl (hd->ping_pipe[fd_pipe_write], F_SETFD, FD_CLOEXEC); // for safe forking
-	hd->toclient = toclient_postping ;
-	return gbGOOD ;
+	ping_thread_running = 1 ;
 }
 
-static void LoopCleanup(struct handlerdata *hd)
+/* Checked every half second */
+static void * PingThread( void * v )
 {
-	if (hd->ping_pipe[fd_pipe_read] > -1 ) {
-		close(hd->ping_pipe[fd_pipe_read]) ;
-	}
-	if (hd->ping_pipe[fd_pipe_write] > -1 ) {
-		close(hd->ping_pipe[fd_pipe_write]) ;
+	(void) v ;
+	DETACH_THREAD;
+
+	while (1) {
+		struct handlerdata * hd ;
+		struct handlerdata * due = NULL ;
+		struct timeval now ;
+		struct timeval tv = tv_short ;
+
+		select( 0, NULL, NULL, NULL, &tv ) ; // just a delay
+
+		timernow( &now ) ;
+		PINGLOCK ;
+		for ( hd = ping_head ; hd != NULL ; hd = hd->ping_next ) {
+			// ping_time belongs to this thread once registered
+			if ( timercmp( &now, &(hd->ping_time), >= ) ) {
+				hd->ping_pending = 1 ;
+				hd->ping_due = due ;
+				due = hd ;
+			}
+		}
+		PINGUNLOCK ;
+
+		if ( due == NULL ) {
+			continue ;
+		}
+		for ( hd = due ; hd != NULL ; hd = hd->ping_due ) {
+			PingCheck( hd, &now ) ;
+		}
+
+		PINGLOCK ;
+		for ( hd = due ; hd != NULL ; hd = hd->ping_due ) {
+			hd->ping_pending = 0 ;
+		}
+		my_pthread_cond_broadcast( &ping_done ) ;
+		PINGUNLOCK ;
 	}
+	return VOID_RETURN ;
 }
 
-struct timeval tv_long  = { 1 , 000000 } ; // 1 second
-struct timeval tv_short = { 0 , 500000 } ; // 1/2 second
-
-static enum toclient_state Ping_or_Send( enum toclient_state last_toclient, struct handlerdata * hd )
+/* Called without the ping lock, the request can't leave until it's done */
+static void PingCheck( struct handlerdata * hd, const struct timeval * now )
 {
-	struct timeval tv ;
-	fd_set read_set ;
-	int select_value ;
-	enum toclient_state next_toclient ;
-
-	FD_ZERO( &read_set ) ;
-	FD_SET( hd->ping_pipe[fd_pipe_read], &read_set ) ;
+	timeradd( now, &tv_long, &(hd->ping_time) ) ;
 
-	switch ( last_toclient ) {
+	TOCLIENTLOCK(hd);
+	switch ( hd->toclient ) {
+		case toclient_complete:
+			// crossed paths, we're really done
+			break ;
 		case toclient_postmessage:
-			tv = tv_short ;
+			LEVEL_DEBUG("Ping forestalled by a directory element");
+			hd->toclient = toclient_postping ;
 			break ;
-		case toclient_complete:
-			return toclient_complete ;
 		case toclient_postping:
-			tv = tv_long ;
+			LEVEL_DEBUG("Taking too long, send a keep-alive pulse");
+			PingClient(hd);	// send the ping
 			break ;
 	}
+	TOCLIENTUNLOCK(hd);
+}
 
-	select_value = select( hd->ping_pipe[fd_pipe_read]+1, &read_set, NULL, NULL, &tv ) ;
+static void PingRegister( struct handlerdata * hd )
+{
+	struct timeval now ;
 
-	TOCLIENTLOCK(hd);
-	next_toclient = hd->toclient ;
-	
-	switch ( select_value ) {
-		case 1: // message from other thread that we're done
-			// some architectures (like MIPS) want this check inside the lock
-			next_toclient = toclient_complete ;
-			break ;
-		case 0: // timeout -- time for ping?
-			switch ( next_toclient ) {
-				case toclient_complete:
-					// crossed paths, we're really done
-					break ;
-				case toclient_postmessage:
-					LEVEL_DEBUG("Ping forestalled by a directory element");
-					hd->toclient = toclient_postping ;
-					break ;
-				case toclient_postping:
-					LEVEL_DEBUG("Taking too long, send a keep-alive pulse");
-					PingClient(hd);	// send the ping
-					next_toclient = toclient_postping ;
-					break ;
-			}
-			break ;
-		default: // select error
-			LEVEL_DEBUG("Select problem in keep-alive pulsing");
-			switch ( next_toclient ) {
-				case toclient_complete:
-					// fortunately we're done
-					break ;
-				case toclient_postmessage:
-				case toclient_postping:
-					// not done. Send a ping and resync the process
-					PingClient(hd);	// send the ping
-					next_toclient = toclient_postping ;
-					hd->toclient = toclient_postping ;
-					break ;
-			}
-			break ;
+	timernow( &now ) ;
+	hd->toclient = toclient_postping ;
+	timeradd( &now, &tv_long, &(hd->ping_time) ) ;
+	hd->ping_pending = 0 ;
+
+	PINGLOCK ;
+	hd->ping_prev = NULL ;
+	hd->ping_next = ping_head ;
+	if ( ping_head != NULL ) {
+		ping_head->ping_prev = hd ;
 	}
+	ping_head = hd ;
+	PINGUNLOCK ;
+}
 
-	TOCLIENTUNLOCK(hd);
-	return next_toclient ;
+static void PingUnregister( struct handlerdata * hd )
+{
+	PINGLOCK ;
+	if ( hd->ping_prev != NULL ) {
+		hd->ping_prev->ping_next = hd->ping_next ;
+	} else {
+		ping_head = hd->ping_next ;
+	}
+	if ( hd->ping_next != NULL ) {
+		hd->ping_next->ping_prev = hd->ping_prev ;
+	}
+	while ( hd->ping_pending ) {
+		// the ping thread is still using this handlerdata
+		my_pthread_cond_wait( &ping_done, &ping_mutex ) ;
+	}
+	PINGUNLOCK ;
 }
 
+/* Handle the request, with keep-alive pings from the ping thread */
 void PingLoop(struct handlerdata *hd)
 {
-	enum toclient_state current_toclient = toclient_postping ;
-	if ( GOOD( LoopSetup(hd) ) ) {
-		pthread_t thread ;
-		
-		// Create DataHandler
-		if (pthread_create(&thread, DEFAULT_THREAD_ATTR, DataHandler, hd) != 0) {
-			LEVEL_DEBUG("OWSERVER:handler() can't create new thread");
-			DataHandler(hd);		// do it without pings
-		} else {
-			// ping vs data loop
-			do {
-				current_toclient = Ping_or_Send( current_toclient, hd ) ;
-			} while ( current_toclient != toclient_complete ) ;
-
-			if (pthread_join(thread, NULL) != 0) {
-				LEVEL_DEBUG("Error waiting for finish of data thread");
-			}
-		}
-		LoopCleanup(hd);
+	if ( ping_thread_running ) {
+		PingRegister( hd ) ;
+		DataHandler( hd ) ;
+		PingUnregister( hd ) ;
+	} else {
+		DataHandler( hd );		// do it without pings
 	}
 }
@@ -96,12 +96,15 @@ int main(int argc, char **argv)
 
 	_MUTEX_INIT(persistence_mutex);
 
+	/* Keep-alive pings for slow requests */
+	PingSetup();
+
 	/* Set up "Antiloop" -- a unique token */
 	SetupAntiloop();
 
 	/* Call up main processing routine -- waits for network queries */
-	ServerProcess( Handler );
-	LEVEL_DEBUG("ServerProcess done");
+	ServerProcessRequests( Handler, FromClientLength, HandlerClose );
+	LEVEL_DEBUG("ServerProcessRequests done");
 
 	_MUTEX_DESTROY(persistence_mutex);
 
@@ -36,40 +36,71 @@
 
 #include "owserver.h"
 
+#define TO_CLIENT_IOV 64 // segments per writev
+
+/* Header (and tag) then the data segments, written as one reply
+   Returns non-zero if not all was sent */
+static int ToClientWritev(struct handlerdata *hd, struct client_msg *machine_order_cm, const struct iovec *data_io, int data_count)
+{
+	struct client_msg network_order_cm;
+	int32_t network_order_tag = htonl( hd->tag ) ;
+	struct iovec io[TO_CLIENT_IOV] ;
+	int nio = 0 ;
+	int data_index = 0 ;
+	int bad = 0 ;
+
+	// Prep header
+	network_order_cm.version       = htonl( machine_order_cm->version       );
+	network_order_cm.payload       = htonl( machine_order_cm->payload       );
+	network_order_cm.ret           = htonl( machine_order_cm->ret           );
+	network_order_cm.control_flags = htonl( machine_order_cm->control_flags );
+	network_order_cm.size          = htonl( machine_order_cm->size          );
+	network_order_cm.offset        = htonl( machine_order_cm->offset        );
+
+	io[nio].iov_base = &network_order_cm ;
+	io[nio].iov_len = sizeof(struct client_msg) ;
+	++nio ;
+
+	if ( hd->pipeline != NULL ) {
+		// tag goes between header and data
+		io[nio].iov_base = &network_order_tag ;
+		io[nio].iov_len = sizeof(int32_t) ;
+		++nio ;
+		LEVEL_DEBUG("tag=%d",hd->tag) ;
+		// replies to different requests share the socket
+		_MUTEX_LOCK( hd->pipeline->mutex ) ;
+	}
+
+	do {
+		ssize_t expected = 0 ;
+		int io_index ;
+
+		while ( nio < TO_CLIENT_IOV && data_index < data_count ) {
+			io[nio++] = data_io[data_index++] ;
+		}
+		for ( io_index = 0 ; io_index < nio ; ++io_index ) {
+			expected += io[io_index].iov_len ;
+		}
+		if ( writev( hd->file_descriptor, io, nio ) != expected ) {
+			bad = 1 ;
+			break ;
+		}
+		nio = 0 ;
+	} while ( data_index < data_count ) ;
+
+	if ( hd->pipeline != NULL ) {
+		_MUTEX_UNLOCK( hd->pipeline->mutex ) ;
+	}
+	return bad ;
+}
+
 /* Send fully configured message back to client.
    data is optional and length depends on "payload"
+   On a pipelined connection the request tag follows the header
  */
-int ToClient(int file_descriptor, struct client_msg *machine_order_cm, const char *data)
+int ToClient(struct handlerdata *hd, struct client_msg *machine_order_cm, const char *data)
 {
-	struct client_msg s_cm;
-	struct client_msg *network_order_cm = &s_cm;
-	
-	int nio = 1; // at least header
-
-#if ( __GNUC__ > 4 ) || (__GNUC__ == 4 && __GNUC_MINOR__ > 4 )
-#pragma GCC diagnostic push
-#pragma GCC diagnostic ignored "-Wcast-qual"
-	// note data should be (const char *) but iovec complains about const arguments
-	struct iovec io[] = {
-		{network_order_cm, sizeof(struct client_msg),},
-		{ (char *) data, machine_order_cm->payload,},
-	};
-#pragma GCC diagnostic pop
-#else
-	// note data should be (const char *) but iovec complains about const arguments
-	struct iovec io[] = {
-		{network_order_cm, sizeof(struct client_msg),},
-		{ (char *) data, machine_order_cm->payload,},
-	};
-#endif
-
-	// Prep header
-	network_order_cm->version       = htonl( machine_order_cm->version       );
-	network_order_cm->payload       = htonl( machine_order_cm->payload       );
-	network_order_cm->ret           = htonl( machine_order_cm->ret           );
-	network_order_cm->control_flags = htonl( machine_order_cm->control_flags );
-	network_order_cm->size          = htonl( machine_order_cm->size          );
-	network_order_cm->offset        = htonl( machine_order_cm->offset        );
+	struct iovec io_data ;
 
 	LEVEL_DEBUG("payload=%d size=%d, ret=%d, sg=0x%X offset=%d ", machine_order_cm->payload, machine_order_cm->size, machine_order_cm->ret,
 		     machine_order_cm->control_flags, machine_order_cm->offset);
@@ -85,9 +116,117 @@ int ToClient(int file_descriptor, struct client_msg *machine_order_cm, const cha
 	} else if ( data == NULL ) {
 		LEVEL_DEBUG("Bad data pointer -- NULL") ;
 	} else {
-		nio = 2; // add data segment
-		TrafficOutFD("to server data",io[1].iov_base,io[1].iov_len,file_descriptor);
+#if ( __GNUC__ > 4 ) || (__GNUC__ == 4 && __GNUC_MINOR__ > 4 )
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wcast-qual"
+		// note data should be (const char *) but iovec complains about const arguments
+		io_data.iov_base = (char *) data ;
+#pragma GCC diagnostic pop
+#else
+		// note data should be (const char *) but iovec complains about const arguments
+		io_data.iov_base = (char *) data ;
+#endif
+		io_data.iov_len = machine_order_cm->payload ;
+		TrafficOutFD("to server data",io_data.iov_base,io_data.iov_len,hd->file_descriptor);
+		return ToClientWritev( hd, machine_order_cm, &io_data, 1 ) ;
 	}
+	return ToClientWritev( hd, machine_order_cm, NULL, 0 ) ;
+}
+
+/* Reply chunks
+ * A long reply (directory listing) is collected in fixed-size chunks and
+ * written straight from them. Nothing is reallocated as it grows, and it
+ * isn't copied into one buffer to be sent.
+ * */
+
+void ReplyChunksInit(struct reply_chunks *rc)
+{
+	rc->head = rc->tail = NULL ;
+	rc->length = 0 ;
+	rc->count = 0 ;
+	rc->troubled = 0 ;
+}
+
+void ReplyChunksClear(struct reply_chunks *rc)
+{
+	while ( rc->head != NULL ) {
+		struct reply_chunk * next = rc->head->next ;
+		owfree( rc->head ) ;
+		rc->head = next ;
+	}
+	ReplyChunksInit( rc ) ;
+}
+
+/* Append data, starting new chunks as needed */
+int ReplyChunksAdd(const char *data, size_t length, struct reply_chunks *rc)
+{
+	while ( length > 0 ) {
+		size_t room ;
+
+		if ( rc->tail == NULL || rc->tail->used == REPLY_CHUNK_SIZE ) {
+			struct reply_chunk * chunk = owmalloc( sizeof(struct reply_chunk) ) ;
+			if ( chunk == NULL ) {
+				rc->troubled = 1 ;
+				return -ENOMEM ;
+			}
+			chunk->next = NULL ;
+			chunk->used = 0 ;
+			if ( rc->tail == NULL ) {
+				rc->head = chunk ;
+			} else {
+				rc->tail->next = chunk ;
+			}
+			rc->tail = chunk ;
+			++rc->count ;
+		}
+		room = REPLY_CHUNK_SIZE - rc->tail->used ;
+		if ( room > length ) {
+			room = length ;
+		}
+		memcpy( &(rc->tail->data[rc->tail->used]), data, room ) ;
+		rc->tail->used += room ;
+		rc->length += room ;
+		data += room ;
+		length -= room ;
+	}
+	return 0 ;
+}
+
+/* Send the chunks as the payload (with a final null, as from a string)
+   cm payload and size are set here */
+int ToClientChunks(struct handlerdata *hd, struct client_msg *cm, struct reply_chunks *rc)
+{
+	static char null_char = '\0' ;
+	struct iovec * io = owcalloc( rc->count + 1, sizeof(struct iovec) ) ;
+	struct reply_chunk * chunk ;
+	struct timeval now ;
+	int nio = 0 ;
+	int bad ;
+
+	if ( io == NULL ) {
+		cm->ret = -ENOMEM ;
+		cm->size = cm->payload = 0 ;
+		return ToClient( hd, cm, NULL ) ;
+	}
+
+	for ( chunk = rc->head ; chunk != NULL ; chunk = chunk->next ) {
+		io[nio].iov_base = chunk->data ;
+		io[nio].iov_len = chunk->used ;
+		TrafficOutFD("to server data",io[nio].iov_base,io[nio].iov_len,hd->file_descriptor);
+		++nio ;
+	}
+	io[nio].iov_base = &null_char ;
+	io[nio].iov_len = 1 ;
+	++nio ;
+
+	cm->size = rc->length ;
+	cm->payload = rc->length + 1 ;
+
+	timernow( &now ) ;
+	timersub( &now, &(hd->tv), &now ) ;
+	LEVEL_DEBUG("payload=%d in %d chunks, first byte after %ld.%06ld seconds", cm->payload, rc->count, (long) now.tv_sec, (long) now.tv_usec ) ;
 
-	return writev(file_descriptor, io, nio) != (ssize_t) (io[0].iov_len + io[1].iov_len);
+	bad = ToClientWritev( hd, cm, io, nio ) ;
+	owfree( io ) ;
+	return bad ;
 }
@@ -31,23 +31,73 @@ enum toclient_state {
 	toclient_complete, // final payload has been sent
 } ;
 
-// this structure holds the data needed for the handler function called in a separate thread by the ping wrapper
+/* Pipelined connection
+ * opened by a NOP with PIPELINE_MASK set, after which every request and
+ * every reply header is followed by a 4-byte tag, and requests run concurrently
+ * on the server worker threads.
+ * Replies go out on a dup of the connection's socket, so a request still running
+ * when the connection closes can finish; the last one frees the pipeline.
+ * */
+#define PIPELINE_DEPTH 16 // requests running at once on one connection
+
+struct request_pipeline {
+	pthread_mutex_t mutex; // whole replies written atomically, in_flight and closing
+	FILE_DESCRIPTOR_OR_ERROR file_descriptor; // for replies
+	int in_flight; // requests queued or running on the worker threads
+	int closing; // connection gone, free with the last request
+};
+
+/* Long reply (directory listing) collected in fixed-size pieces */
+#define REPLY_CHUNK_SIZE 4096
+
+struct reply_chunk {
+	struct reply_chunk *next;
+	size_t used;
+	char data[REPLY_CHUNK_SIZE];
+};
+
+struct reply_chunks {
+	struct reply_chunk *head;
+	struct reply_chunk *tail;
+	size_t length; // bytes in all chunks
+	int count; // chunks
+	int troubled; // an allocation failed
+};
+
+// this structure holds the data needed for the handler function, and the keep-alive state
 struct handlerdata {
 	int file_descriptor;
+	const BYTE *request; // whole request as read by the server loop
+	size_t request_length;
 	int persistent;
+	struct request_pipeline *pipeline; // NULL for a normal connection
+	int32_t tag; // from the client, returned with each reply (pipelined only)
 	pthread_mutex_t to_client;
-	int ping_pipe[2] ;
 	enum toclient_state toclient ;
+	struct timeval ping_time; // next keep-alive due
+	struct handlerdata *ping_next; // requests in progress (ping thread list)
+	struct handlerdata *ping_prev;
+	struct handlerdata *ping_due; // due for a ping (ping thread only)
+	int ping_pending; // ping thread is using this, under the ping lock
 	struct timeval tv;
 	struct server_msg sm;
 	struct serverpackage sp;
 };
 
-/* read from client, free return pointer if not Null */
+/* How much of the request the server loop should read */
+ssize_t FromClientLength(struct server_connection *sc);
+
+/* Parse the request from the client, free return pointer if not Null */
 int FromClient(struct handlerdata *hd);
 
 /* Send fully configured message back to client */
-int ToClient(int file_descriptor, struct client_msg *cm, const char *data);
+int ToClient(struct handlerdata *hd, struct client_msg *cm, const char *data);
+
+/* Send back a reply collected in chunks (payload and size are set) */
+int ToClientChunks(struct handlerdata *hd, struct client_msg *cm, struct reply_chunks *rc);
+void ReplyChunksInit(struct reply_chunks *rc);
+int ReplyChunksAdd(const char *data, size_t length, struct reply_chunks *rc);
+void ReplyChunksClear(struct reply_chunks *rc);
 
 /* Read from 1-wire bus and return file contents */
 void *ReadHandler(struct handlerdata *hd, struct client_msg *cm, struct one_wire_query *owq);
@@ -59,16 +109,22 @@ void WriteHandler(struct handlerdata *hd, struct client_msg *cm, struct one_wire
 void DirHandler(struct handlerdata *hd, struct client_msg *cm, const struct parsedname *pn);
 
 /* Newer directory-at-once */
-void *DirallHandler(struct handlerdata *hd, struct client_msg *cm, const struct parsedname *pn);
+void DirallHandler(struct handlerdata *hd, struct client_msg *cm, const struct parsedname *pn, struct reply_chunks *rc);
 
 /* Newer directory-at-once with directory '/' */
-void *DirallslashHandler(struct handlerdata *hd, struct client_msg *cm, const struct parsedname *pn);
+void DirallslashHandler(struct handlerdata *hd, struct client_msg *cm, const struct parsedname *pn, struct reply_chunks *rc);
+
+/* Several reads in one message, answered one at a time */
+void GetmanyHandler(struct handlerdata *hd, struct client_msg *cm);
 
 /* Handle the actual request -- pings handled higher up */
 void *DataHandler(void *v);
 
 /* Handle a client request, including timeout pings */
-void Handler(FILE_DESCRIPTOR_OR_ERROR file_descriptor);
+void Handler(struct server_connection *sc);
+
+/* Client connection closed */
+void HandlerClose(struct server_connection *sc);
 
 /* Send a response to client of an error */
 void ErrorToClient(struct handlerdata *hd, struct client_msg * cm ) ;
@@ -76,9 +132,12 @@ void ErrorToClient(struct handlerdata *hd, struct client_msg * cm ) ;
 /* Send a timeout ping */
 void PingClient(struct handlerdata *hd);
 
-/* Loop waiting for finish sending pings */
+/* Handle the request with keep-alive pings */
 void PingLoop(struct handlerdata *hd) ;
 
+/* Start the keep-alive thread */
+void PingSetup( void ) ;
+
 /* Create a md5 hash (for the token) */
 void md5(const uint8_t *initial_msg, size_t initial_len, uint8_t *digest) ;
 
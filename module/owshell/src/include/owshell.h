@@ -214,6 +214,7 @@ enum msg_classification {
 	msg_get,
 	msg_dirallslash,
 	msg_getslash,
+	msg_getmany,					// several paths read at once, one reply per path
 };
 /* message to owserver */
 struct server_msg {